@@ -1,25 +1,85 @@
-from flask import Flask, render_template, request, jsonify
+from flask import Flask, Response, render_template, request, jsonify, stream_with_context
 import parqueadero_cpp
 import placas
-import time
+import json
+import os
 
 app = Flask(__name__)
 
 # Crear instancia del parqueadero (20 carros, 30 motos)
 parqueadero = parqueadero_cpp.Parqueadero(20, 30, 3000.0, 2000.0)
+parqueadero.habilitar_cambios(65536)
 
-@app.route('/')
-def index():
-    return render_template('index.html')
+# Los IDs de evento llevan la creación del flujo: tras reiniciar la
+# secuencia vuelve a empezar y un cursor viejo debe recargar el estado.
+# Es la misma época que usa el servidor HTTP nativo en /api/estado.
+EPOCA_CAMBIOS = str(parqueadero.epoca_cambios())
+
+# Las lecturas (/api/estado, /api/vehiculo/<placa>, /api/tarifa/<placa>)
+# las sirve el módulo C++ en su propio puerto, sin pasar por Python;
+# Flask queda con la interfaz, las operaciones y el flujo de cambios
+PUERTO_LECTURAS = 5001
+servidor_lecturas = parqueadero_cpp.ServidorHttp(parqueadero, PUERTO_LECTURAS)
 
-@app.route('/api/estado')
-def estado():
-    """Obtiene el estado actual del parqueadero"""
-    return jsonify({
+def foto_estado():
+    """Estado completo con el cursor desde el que siguen los cambios"""
+    # La secuencia se lee antes de la foto: los cambios que se crucen con
+    # ella se repiten, y aplicarlos dos veces no altera el estado
+    secuencia = parqueadero.secuencia_cambios()
+    detalle = [{'placa': placa, 'tipo': tipo, 'espacio': espacio}
+               for placa, espacio, tipo, _, _ in sorted(parqueadero.tarifas_actuales().tuplas())]
+    return {
         'espacios_carros': parqueadero.espacios_disponibles_carros(),
         'espacios_motos': parqueadero.espacios_disponibles_motos(),
-        'vehiculos': parqueadero.listar_vehiculos()
-    })
+        'capacidad_carros': parqueadero.total_espacios_carros(),
+        'capacidad_motos': parqueadero.total_espacios_motos(),
+        'vehiculos': [v['placa'] for v in detalle],
+        'detalle': detalle,
+        'cursor': f"{EPOCA_CAMBIOS}:{secuencia}"
+    }
+
+def secuencia_de_cursor(cursor):
+    """Secuencia de un cursor "epoca:secuencia"; None si no es de este proceso"""
+    epoca, _, secuencia = (cursor or '').partition(':')
+    if epoca != EPOCA_CAMBIOS or not secuencia.isdigit():
+        return None
+    return int(secuencia)
+
+@app.route('/')
+def index():
+    host = request.host.rsplit(':', 1)[0]
+    return render_template('index.html',
+                           api_lecturas=f"{request.scheme}://{host}:{PUERTO_LECTURAS}")
+
+@app.route('/api/cambios')
+def cambios():
+    """Cambios de ocupación como Server-Sent Events desde un cursor
+
+    El navegador reanuda solo con Last-Event-ID; si el cursor ya no está en
+    el historial se envía un evento "reinicio" con el estado completo.
+    """
+    cursor = request.headers.get('Last-Event-ID') or request.args.get('desde', '')
+
+    def eventos(desde):
+        while True:
+            lista = None if desde is None else parqueadero.cambios(desde, 256, 15000)
+            if lista is None:
+                foto = foto_estado()
+                desde = secuencia_de_cursor(foto['cursor'])
+                yield f"event: reinicio\nid: {foto['cursor']}\ndata: {json.dumps(foto)}\n\n"
+            elif not lista:
+                yield ": sin cambios\n\n"   # Mantiene viva la conexión
+            else:
+                yield ''.join(
+                    f"id: {EPOCA_CAMBIOS}:{c.secuencia}\ndata: " + json.dumps({
+                        'tipo': c.tipo, 'placa': c.placa, 'tipo_vehiculo': c.tipo_vehiculo,
+                        'espacio': c.espacio, 'hora': c.hora}) + "\n\n"
+                    for c in lista)
+                desde = lista[-1].secuencia
+
+    return Response(stream_with_context(eventos(secuencia_de_cursor(cursor))),
+                    mimetype='text/event-stream',
+                    headers={'Cache-Control': 'no-cache', 'X-Accel-Buffering': 'no'})
 
 @app.route('/api/entrada', methods=['POST'])
 def registrar_entrada():
@@ -31,12 +91,13 @@ def registrar_entrada():
     if not placa or tipo not in ['carro', 'moto']:
         return jsonify({'error': 'Datos inválidos'}), 400
     
-    resultado = parqueadero.registrar_entrada(placa, tipo)
+    resultado = parqueadero.procesar_entrada(placa, tipo)
+    mensaje = parqueadero_cpp.describir_entrada(placa, tipo, resultado)
     
-    if resultado.startswith('ERROR'):
-        return jsonify({'error': resultado[7:]}), 400
+    if not resultado.ok:
+        return jsonify({'error': mensaje}), 400
     
-    return jsonify({'mensaje': resultado[4:]})
+    return jsonify({'mensaje': mensaje, 'espacio': resultado.espacio})
 
 
 
@@ -51,34 +112,17 @@ def registrar_salida():
     if not placa:
         return jsonify({'error': 'Placa requerida'}), 400
     
-    resultado = parqueadero.registrar_salida(placa)
-    
-    if resultado.startswith('ERROR'):
-        return jsonify({'error': resultado[7:]}), 400
-    
-    return jsonify({'mensaje': resultado[4:]})
-
-@app.route('/api/vehiculo/<placa>')
-def info_vehiculo(placa):
-    """Obtiene información de un vehículo"""
-    placa = placa.upper().strip()
-    info = parqueadero.info_vehiculo(placa)
-    
-    if info.startswith('ERROR'):
-        return jsonify({'error': info[7:]}), 404
-    
-    return jsonify({'info': info})
-
-@app.route('/api/tarifa/<placa>')
-def calcular_tarifa(placa):
-    """Calcula la tarifa actual de un vehículo"""
-    placa = placa.upper().strip()
+    resultado = parqueadero.procesar_salida(placa)
+    mensaje = parqueadero_cpp.describir_salida(placa, resultado)
     
-    if not parqueadero.vehiculo_presente(placa):
-        return jsonify({'error': 'Vehículo no encontrado'}), 404
+    if not resultado.ok:
+        return jsonify({'error': mensaje}), 400
     
-    tarifa = parqueadero.calcular_tarifa(placa)
-    return jsonify({'tarifa': tarifa})
+    return jsonify({'mensaje': mensaje, 'tarifa': resultado.tarifa})
 
 if __name__ == '__main__':
-    app.run(debug=True, port=5000)
\ No newline at end of file
+    # Con debug el recargador ejecuta el módulo en dos procesos: sólo el
+    # que atiende abre el puerto de lecturas
+    if os.environ.get('WERKZEUG_RUN_MAIN') == 'true':
+        servidor_lecturas.iniciar(2)
+    app.run(debug=True, port=5000, threaded=True)
\ No newline at end of file
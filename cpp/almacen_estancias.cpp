@@ -0,0 +1,669 @@
+#include "almacen_estancias.hpp"
+#include "bitacora.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define ABRIR(ruta, flags) _open((ruta), (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define LEER _read
+    #define CERRAR _close
+    #define RECORTAR _chsize_s
+    #define BUSCAR _lseeki64
+#else
+    #include <unistd.h>
+    #define ABRIR(ruta, flags) open((ruta), (flags), 0644)
+    #define LEER read
+    #define CERRAR close
+    #define RECORTAR ftruncate
+    #define BUSCAR lseek
+#endif
+
+static const char MAGIA_ALMACEN[8] = {'P', 'Q', 'C', 'O', 'L', 'U', 'M', '1'};
+static const uint32_t VERSION_ALMACEN = 1;
+static const size_t LARGO_CABECERA_ALMACEN = 32;
+static const uint32_t MAGIA_BLOQUE = 0x31514C42;  // "BLQ1"
+
+// Fuentes distintas que se guardan por nombre; el resto comparte la última
+static const size_t MAX_FUENTES = 255;
+
+// Debajo de esto no vale la pena lanzar hilos
+static const size_t FILAS_MINIMAS_POR_HILO = FILAS_POR_BLOQUE;
+
+// Bytes de una fila sumando todas las columnas
+static const size_t BYTES_POR_FILA = sizeof(PlacaCompacta) + 2 * sizeof(int64_t) +
+                                     sizeof(double) + sizeof(int32_t) + 3 * sizeof(uint8_t);
+
+struct CabeceraBloque {
+    uint32_t magia;
+    uint32_t filas;
+    int64_t min_entrada;
+    int64_t min_salida;
+    int64_t max_salida;
+    uint32_t suma;       // suma_columna() de todas las columnas, plegada
+    uint32_t relleno;
+};
+static_assert(sizeof(CabeceraBloque) == 40, "CabeceraBloque debe medir 40 bytes");
+
+// Lo que una consulta ve de un bloque: las filas se copian bajo el mutex
+// porque el bloque en curso sigue creciendo
+struct TramoBloque {
+    const BloqueEstancias* bloque;
+    size_t filas;
+    bool completo;   // Todas sus salidas caen dentro del intervalo
+};
+
+BloqueEstancias::BloqueEstancias()
+    : filas(0), min_entrada(std::numeric_limits<int64_t>::max()),
+      min_salida(std::numeric_limits<int64_t>::max()),
+      max_salida(std::numeric_limits<int64_t>::min()),
+      placa(new PlacaCompacta[FILAS_POR_BLOQUE]), entrada(new int64_t[FILAS_POR_BLOQUE]),
+      salida(new int64_t[FILAS_POR_BLOQUE]), tarifa(new double[FILAS_POR_BLOQUE]),
+      espacio(new int32_t[FILAS_POR_BLOQUE]), tipo(new uint8_t[FILAS_POR_BLOQUE]),
+      fuente_entrada(new uint8_t[FILAS_POR_BLOQUE]), fuente_salida(new uint8_t[FILAS_POR_BLOQUE]) {}
+
+// FNV-1a de 64 bits por palabras (no por bytes, para no frenar la carga)
+static uint64_t suma_columna(uint64_t h, const void* datos, size_t largo) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(datos);
+    size_t i = 0;
+    for (; i + 8 <= largo; i += 8) {
+        uint64_t palabra;
+        memcpy(&palabra, bytes + i, 8);
+        h ^= palabra;
+        h *= 1099511628211ull;
+    }
+    for (; i < largo; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint32_t plegar(uint64_t h) {
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static bool leer_todo(int archivo, void* destino, size_t largo) {
+    char* p = static_cast<char*>(destino);
+    while (largo > 0) {
+        int n = LEER(archivo, p, (unsigned)(largo > (1u << 30) ? (1u << 30) : largo));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        largo -= n;
+    }
+    return true;
+}
+
+// Columnas de un bloque en el orden del archivo
+struct ColumnaBloque {
+    void* datos;
+    size_t ancho;
+};
+
+static void columnas_bloque(const BloqueEstancias& b, ColumnaBloque (&columnas)[8]) {
+    ColumnaBloque c[8] = {
+        {b.placa.get(), sizeof(PlacaCompacta)}, {b.entrada.get(), sizeof(int64_t)},
+        {b.salida.get(), sizeof(int64_t)}, {b.tarifa.get(), sizeof(double)},
+        {b.espacio.get(), sizeof(int32_t)}, {b.tipo.get(), sizeof(uint8_t)},
+        {b.fuente_entrada.get(), sizeof(uint8_t)}, {b.fuente_salida.get(), sizeof(uint8_t)}
+    };
+    std::copy(c, c + 8, columnas);
+}
+
+// Reparte los tramos entre hilos (cada uno toma el siguiente libre) y
+// deja en parciales[k] el resultado del hilo k, para combinarlos después
+template <typename Parcial, typename F>
+static void repartir(const std::vector<TramoBloque>& tramos, int hilos, const Parcial& inicial,
+                     std::vector<Parcial>& parciales, F procesar) {
+    size_t filas = 0;
+    for (size_t i = 0; i < tramos.size(); i++) {
+        filas += tramos[i].filas;
+    }
+    size_t n = hilos > 0 ? (size_t)hilos : std::max(1u, std::thread::hardware_concurrency());
+    n = std::max<size_t>(1, std::min(n, std::min(tramos.size(), filas / FILAS_MINIMAS_POR_HILO)));
+    parciales.assign(n, inicial);
+
+    std::atomic<size_t> siguiente(0);
+    auto trabajar = [&](size_t k) {
+        for (size_t i = siguiente.fetch_add(1); i < tramos.size(); i = siguiente.fetch_add(1)) {
+            procesar(parciales[k], tramos[i]);
+        }
+    };
+    std::vector<std::thread> trabajadores;
+    for (size_t k = 1; k < n; k++) {
+        trabajadores.push_back(std::thread(trabajar, k));
+    }
+    trabajar(0);
+    for (size_t k = 0; k < trabajadores.size(); k++) {
+        trabajadores[k].join();
+    }
+}
+
+AlmacenEstancias::AlmacenEstancias() : total_filas(0), archivo(-1), inicio_cola(0) {}
+
+AlmacenEstancias::~AlmacenEstancias() {
+    sincronizar();
+    if (archivo >= 0) {
+        CERRAR(archivo);
+    }
+}
+
+bool AlmacenEstancias::abrir(const std::string& ruta_archivo) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (archivo >= 0 || total_filas != 0) {
+        return false;
+    }
+    ruta = ruta_archivo;
+    archivo = ABRIR(ruta.c_str(), O_RDWR | O_CREAT);
+    if (archivo < 0) {
+        std::cerr << "Error al abrir " << ruta << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (!cargar()) {
+        CERRAR(archivo);
+        archivo = -1;
+        return false;
+    }
+
+    std::ifstream lista((ruta + ".fuentes").c_str());
+    std::string nombre;
+    while (std::getline(lista, nombre) && nombres_fuentes.size() <= MAX_FUENTES) {
+        nombres_fuentes.push_back(nombre);
+    }
+    return true;
+}
+
+bool AlmacenEstancias::cargar() {
+    struct stat info;
+    if (fstat(archivo, &info) != 0) {
+        return false;
+    }
+    char cabecera[LARGO_CABECERA_ALMACEN] = {0};
+    if (info.st_size < (long long)LARGO_CABECERA_ALMACEN) {
+        // Archivo nuevo (o cabecera incompleta): empezar de cero
+        memcpy(cabecera, MAGIA_ALMACEN, 8);
+        uint32_t version = VERSION_ALMACEN, filas_bloque = (uint32_t)FILAS_POR_BLOQUE;
+        memcpy(cabecera + 8, &version, 4);
+        memcpy(cabecera + 12, &filas_bloque, 4);
+        if (RECORTAR(archivo, 0) != 0 || !escribir_todo(archivo, cabecera, LARGO_CABECERA_ALMACEN) ||
+            !sincronizar_archivo(archivo)) {
+            std::cerr << "Error al escribir cabecera de " << ruta << std::endl;
+            return false;
+        }
+        inicio_cola = LARGO_CABECERA_ALMACEN;
+        return true;
+    }
+
+    uint32_t version = 0, filas_bloque = 0;
+    if (!leer_todo(archivo, cabecera, LARGO_CABECERA_ALMACEN) ||
+        memcmp(cabecera, MAGIA_ALMACEN, 8) != 0) {
+        std::cerr << ruta << " no es un almacén de estancias" << std::endl;
+        return false;
+    }
+    memcpy(&version, cabecera + 8, 4);
+    memcpy(&filas_bloque, cabecera + 12, 4);
+    if (version != VERSION_ALMACEN || filas_bloque != FILAS_POR_BLOQUE) {
+        std::cerr << ruta << ": versión " << version << " con " << filas_bloque
+                  << " filas por bloque no soportada" << std::endl;
+        return false;
+    }
+
+    int64_t valido = LARGO_CABECERA_ALMACEN;
+    inicio_cola = valido;
+    bool danado = false;
+    while (true) {
+        CabeceraBloque cb;
+        if (!leer_todo(archivo, &cb, sizeof(cb))) {
+            // Fin del archivo, o una cabecera a medio escribir
+            danado = valido != (int64_t)info.st_size;
+            break;
+        }
+        if (cb.magia != MAGIA_BLOQUE || cb.filas == 0 || cb.filas > FILAS_POR_BLOQUE) {
+            danado = true;
+            break;
+        }
+
+        std::unique_ptr<BloqueEstancias> b(new BloqueEstancias());
+        ColumnaBloque columnas[8];
+        columnas_bloque(*b, columnas);
+        uint64_t suma = 14695981039346656037ull;
+        bool completo = true;
+        for (int c = 0; c < 8 && completo; c++) {
+            completo = leer_todo(archivo, columnas[c].datos, columnas[c].ancho * cb.filas);
+            suma = suma_columna(suma, columnas[c].datos, columnas[c].ancho * cb.filas);
+        }
+        if (!completo || plegar(suma) != cb.suma) {
+            danado = true;
+            break;
+        }
+
+        b->filas = cb.filas;
+        b->min_entrada = cb.min_entrada;
+        b->min_salida = cb.min_salida;
+        b->max_salida = cb.max_salida;
+        total_filas += cb.filas;
+        bloques.push_back(std::move(b));
+
+        int64_t largo = (int64_t)(sizeof(cb) + BYTES_POR_FILA * cb.filas);
+        if (cb.filas < FILAS_POR_BLOQUE) {
+            // El bloque en curso siempre es el último: se sigue llenando
+            inicio_cola = valido;
+            valido += largo;
+            break;
+        }
+        valido += largo;
+        inicio_cola = valido;
+    }
+
+    // Descartar lo que siga a lo válido (escritura incompleta al final)
+    if (danado || valido < info.st_size) {
+        std::cerr << "⚠️  " << ruta << ": bloque incompleto al final, se descarta" << std::endl;
+        if (RECORTAR(archivo, valido) != 0) {
+            std::cerr << "Error al recortar " << ruta << std::endl;
+        }
+    }
+    return true;
+}
+
+bool AlmacenEstancias::escribir_bloque(const BloqueEstancias& b) {
+    CabeceraBloque cb;
+    cb.magia = MAGIA_BLOQUE;
+    cb.filas = (uint32_t)b.filas;
+    cb.min_entrada = b.min_entrada;
+    cb.min_salida = b.min_salida;
+    cb.max_salida = b.max_salida;
+    cb.relleno = 0;
+
+    // Cabecera y columnas contiguas en un solo buffer: una sola escritura
+    std::vector<char> buffer(sizeof(cb) + BYTES_POR_FILA * b.filas);
+    ColumnaBloque columnas[8];
+    columnas_bloque(b, columnas);
+    size_t pos = sizeof(cb);
+    for (int c = 0; c < 8; c++) {
+        memcpy(&buffer[pos], columnas[c].datos, columnas[c].ancho * b.filas);
+        pos += columnas[c].ancho * b.filas;
+    }
+    uint64_t suma = 14695981039346656037ull;
+    for (int c = 0; c < 8; c++) {
+        suma = suma_columna(suma, columnas[c].datos, columnas[c].ancho * b.filas);
+    }
+    cb.suma = plegar(suma);
+    memcpy(&buffer[0], &cb, sizeof(cb));
+
+    if (BUSCAR(archivo, inicio_cola, SEEK_SET) < 0 ||
+        !escribir_todo(archivo, &buffer[0], buffer.size())) {
+        std::cerr << "Error al escribir " << ruta << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (b.filas == FILAS_POR_BLOQUE) {
+        inicio_cola += (int64_t)buffer.size();
+    }
+    return true;
+}
+
+bool AlmacenEstancias::sincronizar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (archivo < 0) {
+        return true;
+    }
+    bool ok = true;
+    if (!bloques.empty() && bloques.back()->filas < FILAS_POR_BLOQUE) {
+        ok = escribir_bloque(*bloques.back());
+    }
+    return sincronizar_archivo(archivo) && ok;
+}
+
+void AlmacenEstancias::agregar(const Estancia& e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bloques.empty() || bloques.back()->filas == FILAS_POR_BLOQUE) {
+        bloques.push_back(std::unique_ptr<BloqueEstancias>(new BloqueEstancias()));
+    }
+    BloqueEstancias& b = *bloques.back();
+    size_t i = b.filas;
+    b.placa[i] = e.placa;
+    b.entrada[i] = e.hora_entrada;
+    b.salida[i] = e.hora_salida;
+    b.tarifa[i] = e.tarifa;
+    b.espacio[i] = e.espacio;
+    b.tipo[i] = e.tipo;
+    b.fuente_entrada[i] = e.fuente_entrada;
+    b.fuente_salida[i] = e.fuente_salida;
+    if (e.hora_entrada != 0) {
+        b.min_entrada = std::min(b.min_entrada, e.hora_entrada);
+    }
+    b.min_salida = std::min(b.min_salida, e.hora_salida);
+    b.max_salida = std::max(b.max_salida, e.hora_salida);
+    b.filas++;
+    total_filas++;
+
+    // Un bloque lleno ya no cambia: se escribe una vez y queda en disco
+    if (archivo >= 0 && b.filas == FILAS_POR_BLOQUE) {
+        if (escribir_bloque(b)) {
+            sincronizar_archivo(archivo);
+        }
+    }
+}
+
+size_t AlmacenEstancias::filas() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_filas;
+}
+
+Estancia AlmacenEstancias::leer_fila(const BloqueEstancias& b, size_t i) {
+    Estancia e;
+    e.placa = b.placa[i];
+    e.hora_entrada = b.entrada[i];
+    e.hora_salida = b.salida[i];
+    e.tarifa = b.tarifa[i];
+    e.espacio = b.espacio[i];
+    e.tipo = b.tipo[i];
+    e.fuente_entrada = b.fuente_entrada[i];
+    e.fuente_salida = b.fuente_salida[i];
+    return e;
+}
+
+std::vector<Estancia> AlmacenEstancias::ultimas(size_t n) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    n = std::min(n, total_filas);
+    std::vector<Estancia> resultado(n);
+    size_t pendientes = n;
+    for (size_t b = bloques.size(); b > 0 && pendientes > 0; b--) {
+        const BloqueEstancias& bloque = *bloques[b - 1];
+        for (size_t i = bloque.filas; i > 0 && pendientes > 0; i--) {
+            resultado[--pendientes] = leer_fila(bloque, i - 1);
+        }
+    }
+    return resultado;
+}
+
+void AlmacenEstancias::vista(std::vector<const BloqueEstancias*>& destino,
+                             std::vector<size_t>& filas_bloque) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    destino.clear();
+    filas_bloque.clear();
+    for (size_t i = 0; i < bloques.size(); i++) {
+        destino.push_back(bloques[i].get());
+        filas_bloque.push_back(bloques[i]->filas);
+    }
+}
+
+// Tramos que pueden tener filas con salida en [desde, hasta) (o, con
+// por_entrada, estancias que se cruzan con el intervalo)
+static std::vector<TramoBloque> tramos_en_rango(std::mutex& mutex,
+                                                const std::vector<std::unique_ptr<BloqueEstancias> >& bloques,
+                                                int64_t desde, int64_t hasta, bool por_entrada) {
+    std::vector<TramoBloque> tramos;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < bloques.size(); i++) {
+        const BloqueEstancias& b = *bloques[i];
+        int64_t primera = por_entrada ? b.min_entrada : b.min_salida;
+        if (b.filas == 0 || primera >= hasta || b.max_salida < desde) {
+            continue;
+        }
+        TramoBloque t = {&b, b.filas, b.min_salida >= desde && b.max_salida < hasta};
+        tramos.push_back(t);
+    }
+    return tramos;
+}
+
+uint8_t AlmacenEstancias::indice_fuente(const std::string& fuente) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < nombres_fuentes.size(); i++) {
+        if (nombres_fuentes[i] == fuente) {
+            return (uint8_t)i;
+        }
+    }
+    if (nombres_fuentes.size() < MAX_FUENTES) {
+        nombres_fuentes.push_back(fuente);
+    } else if (nombres_fuentes.size() == MAX_FUENTES) {
+        nombres_fuentes.push_back("otras");
+    }
+    if (archivo >= 0) {
+        guardar_fuentes();
+    }
+    return (uint8_t)(nombres_fuentes.size() - 1);
+}
+
+std::vector<std::string> AlmacenEstancias::fuentes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nombres_fuentes;
+}
+
+bool AlmacenEstancias::guardar_fuentes() const {
+    // Pocas y casi nunca nuevas: se reescribe la lista entera
+    std::string temporal = ruta + ".fuentes.tmp";
+    FILE* f = fopen(temporal.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < nombres_fuentes.size(); i++) {
+        fprintf(f, "%s\n", nombres_fuentes[i].c_str());
+    }
+    bool ok = fclose(f) == 0;
+    std::string destino = ruta + ".fuentes";
+#ifdef _WIN32
+    remove(destino.c_str());
+#endif
+    return ok && rename(temporal.c_str(), destino.c_str()) == 0;
+}
+
+ResumenEstancias AlmacenEstancias::resumen(int64_t desde, int64_t hasta, int tipo, int hilos) const {
+    ResumenEstancias inicial;
+    memset(&inicial, 0, sizeof(inicial));
+    std::vector<TramoBloque> tramos = tramos_en_rango(mutex, bloques, desde, hasta, false);
+    std::vector<ResumenEstancias> parciales;
+    bool todos = tipo == TODOS_LOS_TIPOS;
+    int64_t t = tipo;
+    uint64_t rango = hasta > desde ? (uint64_t)hasta - (uint64_t)desde : 0;
+
+    repartir(tramos, hilos, inicial, parciales, [=](ResumenEstancias& p, const TramoBloque& tramo) {
+        const int64_t* entrada = tramo.bloque->entrada.get();
+        const int64_t* salida = tramo.bloque->salida.get();
+        const double* tarifa = tramo.bloque->tarifa.get();
+        const uint8_t* tipos = tramo.bloque->tipo.get();
+        size_t n = tramo.filas;
+        // Bloque entero dentro y sin filtro: sin máscara de rango
+        bool sin_filtro = tramo.completo && todos;
+        int64_t desde_filtro = sin_filtro ? std::numeric_limits<int64_t>::min() : desde;
+        uint64_t rango_filtro = sin_filtro ? std::numeric_limits<uint64_t>::max() : rango;
+        int64_t todos_filtro = sin_filtro ? 1 : (int64_t)todos;
+
+        uint64_t estancias = 0, con_entrada = 0;
+        int64_t suma = 0, maximo = p.estancia_max_s;
+        // Sin saltos: cada fila suma 0 o su valor según una máscara de 64
+        // bits, y con AVX2 el compilador vectoriza la pasada
+        for (size_t i = 0; i < n; i++) {
+            int64_t s = salida[i];
+            int64_t e = entrada[i];
+            int64_t dentro = (((uint64_t)s - (uint64_t)desde_filtro) < rango_filtro) &
+                             (todos_filtro | ((int64_t)tipos[i] == t));
+            int64_t con_duracion = dentro & (e != 0);
+            int64_t duracion = (s - e) & -con_duracion;
+            estancias += dentro;
+            con_entrada += con_duracion;
+            suma += duracion;
+            maximo = duracion > maximo ? duracion : maximo;
+        }
+        // Las sumas de double no se reordenan solas: cuatro acumuladores
+        // independientes
+        double recaudado[4] = {0.0, 0.0, 0.0, 0.0};
+        size_t i = 0;
+        if (sin_filtro) {
+            for (; i + 4 <= n; i += 4) {
+                for (size_t j = 0; j < 4; j++) {
+                    recaudado[j] += tarifa[i + j];
+                }
+            }
+        } else {
+            for (; i + 4 <= n; i += 4) {
+                for (size_t j = 0; j < 4; j++) {
+                    bool dentro = (((uint64_t)salida[i + j] - (uint64_t)desde) < rango) &
+                                  (todos | ((int64_t)tipos[i + j] == t));
+                    recaudado[j] += dentro ? tarifa[i + j] : 0.0;
+                }
+            }
+        }
+        for (; i < n; i++) {
+            bool dentro = (((uint64_t)salida[i] - (uint64_t)desde) < rango) & (todos | ((int64_t)tipos[i] == t));
+            recaudado[0] += dentro ? tarifa[i] : 0.0;
+        }
+        p.estancias += estancias;
+        p.con_entrada += con_entrada;
+        p.recaudado += (recaudado[0] + recaudado[1]) + (recaudado[2] + recaudado[3]);
+        p.suma_estancia_s += suma;
+        p.estancia_max_s = maximo;
+    });
+
+    ResumenEstancias total = inicial;
+    for (size_t k = 0; k < parciales.size(); k++) {
+        total.estancias += parciales[k].estancias;
+        total.con_entrada += parciales[k].con_entrada;
+        total.recaudado += parciales[k].recaudado;
+        total.suma_estancia_s += parciales[k].suma_estancia_s;
+        total.estancia_max_s = std::max(total.estancia_max_s, parciales[k].estancia_max_s);
+    }
+    return total;
+}
+
+// Número de intervalos de ancho_s en [desde, hasta)
+static size_t num_intervalos(int64_t desde, int64_t hasta, int64_t ancho_s) {
+    if (ancho_s <= 0 || hasta <= desde) {
+        return 0;
+    }
+    return (size_t)((hasta - desde + ancho_s - 1) / ancho_s);
+}
+
+void AlmacenEstancias::ingresos_por_intervalo(int64_t desde, int64_t hasta, int64_t ancho_s,
+                                              std::vector<double>& ingresos,
+                                              std::vector<uint64_t>& salidas,
+                                              int tipo, int hilos) const {
+    size_t m = num_intervalos(desde, hasta, ancho_s);
+    ingresos.assign(m, 0.0);
+    salidas.assign(m, 0);
+    if (m == 0) {
+        return;
+    }
+
+    struct Parcial {
+        std::vector<double> ingresos;
+        std::vector<uint64_t> salidas;
+    };
+    Parcial inicial;
+    inicial.ingresos.assign(m, 0.0);
+    inicial.salidas.assign(m, 0);
+    std::vector<TramoBloque> tramos = tramos_en_rango(mutex, bloques, desde, hasta, false);
+    std::vector<Parcial> parciales;
+    bool todos = tipo == TODOS_LOS_TIPOS;
+    uint8_t t = (uint8_t)tipo;
+
+    repartir(tramos, hilos, inicial, parciales, [=](Parcial& p, const TramoBloque& tramo) {
+        const int64_t* salida = tramo.bloque->salida.get();
+        const double* tarifa = tramo.bloque->tarifa.get();
+        const uint8_t* tipos = tramo.bloque->tipo.get();
+        for (size_t i = 0; i < tramo.filas; i++) {
+            int64_t s = salida[i];
+            if (s >= desde && s < hasta && (todos || tipos[i] == t)) {
+                size_t k = (size_t)((s - desde) / ancho_s);
+                p.ingresos[k] += tarifa[i];
+                p.salidas[k]++;
+            }
+        }
+    });
+
+    for (size_t k = 0; k < parciales.size(); k++) {
+        for (size_t j = 0; j < m; j++) {
+            ingresos[j] += parciales[k].ingresos[j];
+            salidas[j] += parciales[k].salidas[j];
+        }
+    }
+}
+
+void AlmacenEstancias::distribucion_estancias(int64_t desde, int64_t hasta, int64_t ancho_s,
+                                              size_t num_cubetas, std::vector<uint64_t>& cuentas,
+                                              int tipo, int hilos) const {
+    cuentas.assign(ancho_s > 0 ? num_cubetas : 0, 0);
+    if (cuentas.empty() || hasta <= desde) {
+        return;
+    }
+
+    std::vector<TramoBloque> tramos = tramos_en_rango(mutex, bloques, desde, hasta, false);
+    std::vector<std::vector<uint64_t> > parciales;
+    bool todos = tipo == TODOS_LOS_TIPOS;
+    uint8_t t = (uint8_t)tipo;
+    int64_t ultima = (int64_t)num_cubetas - 1;
+
+    repartir(tramos, hilos, cuentas, parciales, [=](std::vector<uint64_t>& p, const TramoBloque& tramo) {
+        const int64_t* entrada = tramo.bloque->entrada.get();
+        const int64_t* salida = tramo.bloque->salida.get();
+        const uint8_t* tipos = tramo.bloque->tipo.get();
+        for (size_t i = 0; i < tramo.filas; i++) {
+            int64_t s = salida[i];
+            int64_t e = entrada[i];
+            if (e != 0 && s >= desde && s < hasta && (todos || tipos[i] == t)) {
+                int64_t k = std::max<int64_t>(0, s - e) / ancho_s;
+                p[(size_t)std::min(k, ultima)]++;
+            }
+        }
+    });
+
+    for (size_t k = 0; k < parciales.size(); k++) {
+        for (size_t j = 0; j < num_cubetas; j++) {
+            cuentas[j] += parciales[k][j];
+        }
+    }
+}
+
+void AlmacenEstancias::ocupacion(int64_t desde, int64_t hasta, int64_t resolucion_s,
+                                 std::vector<uint64_t> (&por_tipo)[2], int hilos) const {
+    size_t m = num_intervalos(desde, hasta, resolucion_s);
+    por_tipo[0].assign(m, 0);
+    por_tipo[1].assign(m, 0);
+    if (m == 0) {
+        return;
+    }
+
+    // Cada estancia suma 1 desde el intervalo de su entrada y resta 1 tras
+    // el de su salida; la suma acumulada da los vehículos de cada intervalo
+    std::vector<int64_t> inicial(2 * (m + 1), 0);
+    std::vector<TramoBloque> tramos = tramos_en_rango(mutex, bloques, desde, hasta, true);
+    std::vector<std::vector<int64_t> > parciales;
+
+    repartir(tramos, hilos, inicial, parciales, [=](std::vector<int64_t>& p, const TramoBloque& tramo) {
+        const int64_t* entrada = tramo.bloque->entrada.get();
+        const int64_t* salida = tramo.bloque->salida.get();
+        const uint8_t* tipos = tramo.bloque->tipo.get();
+        for (size_t i = 0; i < tramo.filas; i++) {
+            int64_t e = entrada[i];
+            int64_t s = salida[i];
+            if (e == 0 || e >= hasta || s <= desde || tipos[i] > 1) {
+                continue;
+            }
+            size_t a = (size_t)((std::max(e, desde) - desde) / resolucion_s);
+            size_t b = (size_t)((std::min(s, hasta) - 1 - desde) / resolucion_s);
+            int64_t* diferencias = &p[tipos[i] * (m + 1)];
+            diferencias[a]++;
+            diferencias[std::max(a, b) + 1]--;
+        }
+    });
+
+    for (int t = 0; t < 2; t++) {
+        int64_t acumulado = 0;
+        for (size_t j = 0; j < m; j++) {
+            for (size_t k = 0; k < parciales.size(); k++) {
+                acumulado += parciales[k][t * (m + 1) + j];
+            }
+            por_tipo[t][j] = (uint64_t)acumulado;
+        }
+    }
+}
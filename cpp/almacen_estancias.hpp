@@ -0,0 +1,150 @@
+#ifndef ALMACEN_ESTANCIAS_HPP
+#define ALMACEN_ESTANCIAS_HPP
+
+#include "tabla_placas.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Tipo de una estancia cuya entrada no se registró
+static const uint8_t TIPO_DESCONOCIDO = 0xFF;
+
+struct Estancia {
+    PlacaCompacta placa;
+    int64_t hora_entrada;    // 0 si la salida no tenía entrada registrada
+    int64_t hora_salida;
+    double tarifa;
+    int32_t espacio;         // -1 si no se conoce
+    uint8_t tipo;            // TipoVehiculo o TIPO_DESCONOCIDO
+    uint8_t fuente_entrada;  // Índice en AlmacenEstancias::fuentes()
+    uint8_t fuente_salida;
+};
+
+// Filas por bloque: los bloques llenos no cambian más y se escriben enteros
+static const size_t FILAS_POR_BLOQUE = 1 << 16;
+
+// Un bloque de estancias guardado por columnas: cada consulta recorre sólo
+// los arreglos que necesita, de forma contigua y sin saltos
+struct BloqueEstancias {
+    size_t filas;
+    int64_t min_entrada;     // Rango de horas del bloque, para saltarlo entero
+    int64_t min_salida;      // si no toca el intervalo de una consulta
+    int64_t max_salida;
+
+    std::unique_ptr<PlacaCompacta[]> placa;
+    std::unique_ptr<int64_t[]> entrada;
+    std::unique_ptr<int64_t[]> salida;
+    std::unique_ptr<double[]> tarifa;
+    std::unique_ptr<int32_t[]> espacio;
+    std::unique_ptr<uint8_t[]> tipo;
+    std::unique_ptr<uint8_t[]> fuente_entrada;
+    std::unique_ptr<uint8_t[]> fuente_salida;
+
+    BloqueEstancias();
+};
+
+// Totales de las estancias con salida en [desde, hasta)
+struct ResumenEstancias {
+    uint64_t estancias;
+    uint64_t con_entrada;      // Las que tienen duración conocida
+    double recaudado;
+    int64_t suma_estancia_s;
+    int64_t estancia_max_s;
+};
+
+// Filtro por tipo de vehículo en las consultas
+static const int TODOS_LOS_TIPOS = -1;
+
+// Almacén de estancias cerradas por columnas.
+//
+// Se agrega al final (registrar_salida) y los bloques llenos son
+// inmutables: las consultas toman bajo el mutex sólo la lista de bloques y
+// las filas visibles, y luego recorren sin lock, repartiendo los bloques
+// entre varios hilos.
+//
+// Archivo (opcional): cabecera de 32 bytes y los bloques uno tras otro,
+// cada uno con su cabecera (filas, rango de horas, suma de verificación)
+// seguida de sus columnas. El bloque en curso se reescribe en su lugar
+// con sincronizar(); los nombres de las fuentes van en <ruta>.fuentes.
+class AlmacenEstancias {
+public:
+    AlmacenEstancias();
+    // Sincroniza y cierra el archivo, si lo hay
+    ~AlmacenEstancias();
+
+    AlmacenEstancias(const AlmacenEstancias&) = delete;
+    AlmacenEstancias& operator=(const AlmacenEstancias&) = delete;
+
+    // Cargar las estancias guardadas en ruta (si existe) y desde ahora
+    // escribir ahí cada bloque. Llamar con el almacén vacío.
+    bool abrir(const std::string& ruta);
+    // Escribir el bloque en curso y llevar el archivo a disco
+    bool sincronizar();
+
+    void agregar(const Estancia& estancia);
+
+    size_t filas() const;
+    // Últimas n estancias, la más reciente al final
+    std::vector<Estancia> ultimas(size_t n) const;
+
+    // Llama f(const Estancia&) por cada fila, en orden
+    template <typename F>
+    void recorrer(F f) const {
+        std::vector<const BloqueEstancias*> bloques;
+        std::vector<size_t> filas_bloque;
+        vista(bloques, filas_bloque);
+        for (size_t b = 0; b < bloques.size(); b++) {
+            for (size_t i = 0; i < filas_bloque[b]; i++) {
+                f(leer_fila(*bloques[b], i));
+            }
+        }
+    }
+
+    // Índice de una fuente (cámara, "web"...); se agrega si es nueva
+    uint8_t indice_fuente(const std::string& fuente);
+    std::vector<std::string> fuentes() const;
+
+    // Consultas sobre las estancias con salida en [desde, hasta). tipo es
+    // TODOS_LOS_TIPOS o un TipoVehiculo; hilos = 0 usa todos los núcleos.
+
+    ResumenEstancias resumen(int64_t desde, int64_t hasta,
+                             int tipo = TODOS_LOS_TIPOS, int hilos = 0) const;
+
+    // Recaudo y salidas por intervalo de ancho_s segundos
+    void ingresos_por_intervalo(int64_t desde, int64_t hasta, int64_t ancho_s,
+                                std::vector<double>& ingresos, std::vector<uint64_t>& salidas,
+                                int tipo = TODOS_LOS_TIPOS, int hilos = 0) const;
+
+    // Histograma de duraciones: cubeta i = [i*ancho_s, (i+1)*ancho_s); la
+    // última acumula las más largas
+    void distribucion_estancias(int64_t desde, int64_t hasta, int64_t ancho_s,
+                                size_t num_cubetas, std::vector<uint64_t>& cuentas,
+                                int tipo = TODOS_LOS_TIPOS, int hilos = 0) const;
+
+    // Vehículos de cada tipo dentro en cada intervalo de resolucion_s de
+    // [desde, hasta) (los que estuvieron en algún momento del intervalo),
+    // contando sólo estancias ya cerradas
+    void ocupacion(int64_t desde, int64_t hasta, int64_t resolucion_s,
+                   std::vector<uint64_t> (&por_tipo)[2], int hilos = 0) const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<BloqueEstancias> > bloques;
+    size_t total_filas;
+    std::vector<std::string> nombres_fuentes;
+
+    std::string ruta;
+    int archivo;             // -1 sin persistencia
+    int64_t inicio_cola;     // Offset del bloque en curso en el archivo
+
+    void vista(std::vector<const BloqueEstancias*>& destino, std::vector<size_t>& filas_bloque) const;
+    static Estancia leer_fila(const BloqueEstancias& b, size_t i);
+    bool escribir_bloque(const BloqueEstancias& b);
+    bool cargar();
+    bool guardar_fuentes() const;
+};
+
+#endif
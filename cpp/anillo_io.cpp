@@ -0,0 +1,266 @@
+#include "anillo_io.hpp"
+
+#ifdef CON_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstring>
+
+static int io_uring_setup(unsigned entradas, io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entradas, p);
+}
+
+static int io_uring_enter(int fd, unsigned entregar, unsigned min_completados, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, entregar, min_completados, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned operacion, void* arg, unsigned n) {
+    return (int)syscall(__NR_io_uring_register, fd, operacion, arg, n);
+}
+
+AnilloIO::AnilloIO()
+    : fd(-1), mapa_sq(MAP_FAILED), largo_mapa_sq(0), mapa_cq(MAP_FAILED), largo_mapa_cq(0),
+      sqes(nullptr), largo_sqes(0), sq_cola_local(0), por_entregar(0),
+      anillo_buffers(nullptr), largo_anillo_buffers(0), tamano_buffer(0),
+      buffers_mascara(0), buffers_cola(0) {}
+
+AnilloIO::~AnilloIO() {
+    cerrar();
+}
+
+void AnilloIO::cerrar() {
+    // Cerrar el anillo cancela lo que quede en vuelo
+    if (fd != -1) {
+        close(fd);
+        fd = -1;
+    }
+    if (anillo_buffers != nullptr) {
+        munmap(anillo_buffers, largo_anillo_buffers);
+        anillo_buffers = nullptr;
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, largo_sqes);
+        sqes = nullptr;
+    }
+    if (mapa_cq != MAP_FAILED && mapa_cq != mapa_sq) {
+        munmap(mapa_cq, largo_mapa_cq);
+    }
+    if (mapa_sq != MAP_FAILED) {
+        munmap(mapa_sq, largo_mapa_sq);
+    }
+    mapa_sq = mapa_cq = MAP_FAILED;
+}
+
+bool AnilloIO::abrir(unsigned entradas) {
+    // Con DEFER_TASKRUN el kernel completa las operaciones sólo cuando este
+    // hilo entra a esperar, sin interrumpirlo; kernels viejos no lo tienen
+    static const unsigned variantes[] = {
+        IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER |
+            IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+        IORING_SETUP_CQSIZE
+    };
+    io_uring_params p;
+    for (size_t i = 0; i < sizeof(variantes) / sizeof(variantes[0]) && fd == -1; i++) {
+        memset(&p, 0, sizeof(p));
+        p.flags = variantes[i];
+        p.cq_entries = entradas * 4;
+        fd = io_uring_setup(entradas, &p);
+    }
+    if (fd == -1) {
+        return false;
+    }
+    if (!(p.features & IORING_FEAT_NODROP)) {
+        cerrar();
+        return false;
+    }
+
+    largo_mapa_sq = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    largo_mapa_cq = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool un_mapa = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (un_mapa && largo_mapa_cq > largo_mapa_sq) {
+        largo_mapa_sq = largo_mapa_cq;
+    }
+    mapa_sq = mmap(nullptr, largo_mapa_sq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   fd, IORING_OFF_SQ_RING);
+    if (mapa_sq == MAP_FAILED) {
+        cerrar();
+        return false;
+    }
+    mapa_cq = un_mapa ? mapa_sq :
+        mmap(nullptr, largo_mapa_cq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             fd, IORING_OFF_CQ_RING);
+    largo_sqes = p.sq_entries * sizeof(io_uring_sqe);
+    void* mapa_sqes = mmap(nullptr, largo_sqes, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (mapa_cq == MAP_FAILED || mapa_sqes == MAP_FAILED) {
+        cerrar();
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(mapa_sqes);
+
+    char* sq = static_cast<char*>(mapa_sq);
+    char* cq = static_cast<char*>(mapa_cq);
+    sq_cabeza = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_cola = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mascara = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_entradas = p.sq_entries;
+    cq_cabeza = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_cola = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mascara = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    // Cada posición de la cola apunta a la SQE del mismo índice
+    unsigned* arreglo = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < sq_entradas; i++) {
+        arreglo[i] = i;
+    }
+    sq_cola_local = *sq_cola;
+    return true;
+}
+
+bool AnilloIO::registrar_buffers(unsigned cantidad, unsigned tamano) {
+    if (fd == -1 || cantidad == 0 || (cantidad & (cantidad - 1)) != 0 || cantidad > 32768) {
+        return false;
+    }
+    largo_anillo_buffers = cantidad * sizeof(io_uring_buf);
+    void* mapa = mmap(nullptr, largo_anillo_buffers, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapa == MAP_FAILED) {
+        return false;
+    }
+    anillo_buffers = static_cast<io_uring_buf_ring*>(mapa);
+
+    io_uring_buf_reg registro;
+    memset(&registro, 0, sizeof(registro));
+    registro.ring_addr = (uint64_t)(uintptr_t)anillo_buffers;
+    registro.ring_entries = cantidad;
+    registro.bgid = GRUPO_BUFFERS_IO;
+    if (io_uring_register(fd, IORING_REGISTER_PBUF_RING, &registro, 1) != 0) {
+        munmap(anillo_buffers, largo_anillo_buffers);
+        anillo_buffers = nullptr;
+        return false;
+    }
+
+    memoria_buffers.assign((size_t)cantidad * tamano, 0);
+    tamano_buffer = tamano;
+    buffers_mascara = cantidad - 1;
+    buffers_cola = 0;
+    for (unsigned i = 0; i < cantidad; i++) {
+        devolver_buffer(i);
+    }
+    return true;
+}
+
+void AnilloIO::devolver_buffer(unsigned id) {
+    // No usar anillo_buffers->bufs: en C++ el arreglo flexible del
+    // encabezado queda corrido 8 bytes (struct vacío de tamaño 1). Las
+    // entradas empiezan al inicio del anillo, con la cola encima de la
+    // primera.
+    io_uring_buf& b = reinterpret_cast<io_uring_buf*>(anillo_buffers)[buffers_cola & buffers_mascara];
+    b.addr = (uint64_t)(uintptr_t)buffer(id);
+    b.len = tamano_buffer;
+    b.bid = (uint16_t)id;
+    buffers_cola++;
+    __atomic_store_n(&anillo_buffers->tail, buffers_cola, __ATOMIC_RELEASE);
+}
+
+bool AnilloIO::disponible() {
+    static const bool resultado = [] {
+        // recv multishot llegó en 6.0; antes la SQE falla con EINVAL
+        struct utsname sistema;
+        int mayor = 0, menor = 0;
+        if (uname(&sistema) != 0 || sscanf(sistema.release, "%d.%d", &mayor, &menor) != 2 ||
+            mayor < 6) {
+            return false;
+        }
+        AnilloIO prueba;
+        return prueba.abrir(8) && prueba.registrar_buffers(2, 64);
+    }();
+    return resultado;
+}
+
+io_uring_sqe* AnilloIO::siguiente_sqe() {
+    if (sq_cola_local - __atomic_load_n(sq_cabeza, __ATOMIC_ACQUIRE) >= sq_entradas) {
+        // Cola llena: entregar lo preparado sin esperar
+        __atomic_store_n(sq_cola, sq_cola_local, __ATOMIC_RELEASE);
+        int n = io_uring_enter(fd, por_entregar, 0, 0);
+        if (n > 0) {
+            por_entregar -= (unsigned)n;
+        }
+    }
+    io_uring_sqe* sqe = &sqes[sq_cola_local & sq_mascara];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_cola_local++;
+    por_entregar++;
+    return sqe;
+}
+
+void AnilloIO::aceptar_multishot(int socket, uint64_t dato) {
+    io_uring_sqe* sqe = siguiente_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = socket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = dato;
+}
+
+void AnilloIO::recibir_multishot(int socket, uint64_t dato) {
+    io_uring_sqe* sqe = siguiente_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = GRUPO_BUFFERS_IO;
+    sqe->user_data = dato;
+}
+
+void AnilloIO::enviar(int socket, const char* datos, size_t largo, uint64_t dato) {
+    io_uring_sqe* sqe = siguiente_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = socket;
+    sqe->addr = (uint64_t)(uintptr_t)datos;
+    sqe->len = (uint32_t)largo;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = dato;
+}
+
+void AnilloIO::esperar_lectura(int descriptor, uint64_t dato) {
+    io_uring_sqe* sqe = siguiente_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = descriptor;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = dato;
+}
+
+void AnilloIO::cancelar(uint64_t dato_objetivo, uint64_t dato) {
+    io_uring_sqe* sqe = siguiente_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = dato_objetivo;
+    sqe->user_data = dato;
+}
+
+bool AnilloIO::enviar_y_esperar(unsigned min_completados) {
+    __atomic_store_n(sq_cola, sq_cola_local, __ATOMIC_RELEASE);
+    while (true) {
+        int n = io_uring_enter(fd, por_entregar, min_completados, IORING_ENTER_GETEVENTS);
+        if (n >= 0) {
+            por_entregar -= (unsigned)n < por_entregar ? (unsigned)n : por_entregar;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        // Cola de completados llena: el llamador los consume y reintenta
+        return errno == EBUSY || errno == EAGAIN;
+    }
+}
+
+#endif
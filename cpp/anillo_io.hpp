@@ -0,0 +1,115 @@
+#ifndef ANILLO_IO_HPP
+#define ANILLO_IO_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// io_uring sólo con los encabezados del kernel (sin liburing). Se compila
+// si el sistema trae un <linux/io_uring.h> con accept y recv multishot;
+// si no, AnilloIO::disponible() es false y el servidor usa sockets.
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #if defined(IORING_ACCEPT_MULTISHOT) && defined(IORING_RECV_MULTISHOT)
+            #define CON_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#ifdef CON_IO_URING
+
+// Un anillo de io_uring con lo que usa el servidor de dispositivos:
+// accept y recv multishot (una SQE atiende muchas conexiones o lecturas),
+// recepción en buffers registrados que el kernel elige, y envíos en lote
+// con una sola llamada al sistema por vuelta del loop.
+//
+// No es seguro entre hilos: cada reactor tiene el suyo.
+class AnilloIO {
+public:
+    AnilloIO();
+    ~AnilloIO();
+
+    AnilloIO(const AnilloIO&) = delete;
+    AnilloIO& operator=(const AnilloIO&) = delete;
+
+    // entradas: tamaño de la cola de envío (la de completados es 4 veces)
+    bool abrir(unsigned entradas);
+    // cantidad buffers de tamano bytes para recibir_multishot (cantidad
+    // potencia de dos, hasta 32768)
+    bool registrar_buffers(unsigned cantidad, unsigned tamano);
+
+    // ¿El kernel tiene todo lo necesario (6.0+, con recv multishot)?
+    static bool disponible();
+
+    // Preparar operaciones; dato vuelve en el completado (user_data)
+    void aceptar_multishot(int fd, uint64_t dato);
+    void recibir_multishot(int fd, uint64_t dato);
+    void enviar(int fd, const char* datos, size_t largo, uint64_t dato);
+    void esperar_lectura(int fd, uint64_t dato);  // Un solo aviso de POLLIN
+    void cancelar(uint64_t dato_objetivo, uint64_t dato);
+
+    // Entregar lo preparado y esperar al menos min_completados. Retorna
+    // false ante un error distinto de una interrupción.
+    bool enviar_y_esperar(unsigned min_completados);
+
+    // Llamar f(const io_uring_cqe&) con cada completado disponible
+    template <typename F>
+    unsigned recorrer(F f) {
+        unsigned cabeza = *cq_cabeza;
+        unsigned cola = __atomic_load_n(cq_cola, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        for (; cabeza != cola; cabeza++, n++) {
+            f(cqes[cabeza & cq_mascara]);
+        }
+        __atomic_store_n(cq_cabeza, cabeza, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    // Buffer de un completado con IORING_CQE_F_BUFFER, y su devolución
+    const char* buffer(unsigned id) const { return memoria_buffers.data() + (size_t)id * tamano_buffer; }
+    void devolver_buffer(unsigned id);
+
+private:
+    int fd;
+    void* mapa_sq;
+    size_t largo_mapa_sq;
+    void* mapa_cq;
+    size_t largo_mapa_cq;
+    io_uring_sqe* sqes;
+    size_t largo_sqes;
+    unsigned* sq_cabeza;
+    unsigned* sq_cola;
+    unsigned sq_mascara;
+    unsigned sq_entradas;
+    unsigned sq_cola_local;      // Preparadas; se publican al entregar
+    unsigned por_entregar;
+    unsigned* cq_cabeza;
+    unsigned* cq_cola;
+    unsigned cq_mascara;
+    io_uring_cqe* cqes;
+
+    io_uring_buf_ring* anillo_buffers;
+    size_t largo_anillo_buffers;
+    std::vector<char> memoria_buffers;
+    unsigned tamano_buffer;
+    unsigned buffers_mascara;
+    uint16_t buffers_cola;
+
+    io_uring_sqe* siguiente_sqe();
+    void cerrar();
+};
+
+// Grupo de buffers registrados que usa recibir_multishot
+static const uint16_t GRUPO_BUFFERS_IO = 0;
+
+#else
+
+class AnilloIO {
+public:
+    static bool disponible() { return false; }
+};
+
+#endif
+
+#endif
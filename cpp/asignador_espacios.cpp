@@ -0,0 +1,117 @@
+#include "asignador_espacios.hpp"
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+// Índice del bit en 1 menos significativo (x != 0)
+static inline int bit_menor(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long indice;
+    _BitScanForward64(&indice, x);
+    return (int)indice;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+AsignadorEspacios::AsignadorEspacios(int capacidad, PoliticaAsignacion politica)
+    : capacidad_total(capacidad > 0 ? capacidad : 0),
+      politica(politica),
+      num_libres(0) {
+
+    // Construir niveles hasta que uno quepa en una sola palabra
+    int bits = capacidad_total;
+    do {
+        int palabras = (bits + 63) / 64;
+        niveles.push_back(std::vector<uint64_t>(palabras > 0 ? palabras : 1, 0));
+        bits = palabras;
+    } while (bits > 1);
+
+    if (politica == PoliticaAsignacion::RAPIDA) {
+        pila_libres.reserve(capacidad_total);
+    }
+    // Apilar en orden inverso para que los primeros en salir sean los menores
+    for (int i = capacidad_total - 1; i >= 0; i--) {
+        marcar_libre(i);
+        if (politica == PoliticaAsignacion::RAPIDA) {
+            pila_libres.push_back(i);
+        }
+    }
+    num_libres.store(capacidad_total);
+}
+
+void AsignadorEspacios::marcar_libre(int indice) {
+    for (size_t nivel = 0; nivel < niveles.size(); nivel++) {
+        uint64_t& palabra = niveles[nivel][indice / 64];
+        bool estaba_vacia = (palabra == 0);
+        palabra |= (uint64_t)1 << (indice % 64);
+        if (!estaba_vacia) break; // Los niveles superiores ya lo sabían
+        indice /= 64;
+    }
+}
+
+void AsignadorEspacios::marcar_ocupado(int indice) {
+    for (size_t nivel = 0; nivel < niveles.size(); nivel++) {
+        uint64_t& palabra = niveles[nivel][indice / 64];
+        palabra &= ~((uint64_t)1 << (indice % 64));
+        if (palabra != 0) break; // Quedan libres en esta palabra
+        indice /= 64;
+    }
+}
+
+int AsignadorEspacios::buscar_menor_libre() const {
+    int nivel = (int)niveles.size() - 1;
+    if (niveles[nivel][0] == 0) {
+        return -1;
+    }
+    int indice = 0;
+    for (; nivel >= 0; nivel--) {
+        indice = indice * 64 + bit_menor(niveles[nivel][indice]);
+    }
+    return indice;
+}
+
+int AsignadorEspacios::asignar() {
+    int indice;
+    if (politica == PoliticaAsignacion::RAPIDA) {
+        // Descartar entradas de espacios ocupados con ocupar()
+        do {
+            if (pila_libres.empty()) return -1;
+            indice = pila_libres.back();
+            pila_libres.pop_back();
+        } while (ocupado(indice + 1));
+    } else {
+        indice = buscar_menor_libre();
+        if (indice < 0) return -1;
+    }
+    marcar_ocupado(indice);
+    num_libres.fetch_sub(1, std::memory_order_relaxed);
+    return indice + 1;
+}
+
+bool AsignadorEspacios::ocupar(int espacio) {
+    if (espacio < 1 || espacio > capacidad_total || ocupado(espacio)) {
+        return false;
+    }
+    marcar_ocupado(espacio - 1);
+    num_libres.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AsignadorEspacios::liberar(int espacio) {
+    if (espacio < 1 || espacio > capacidad_total || !ocupado(espacio)) {
+        return false;
+    }
+    marcar_libre(espacio - 1);
+    if (politica == PoliticaAsignacion::RAPIDA) {
+        pila_libres.push_back(espacio - 1);
+    }
+    num_libres.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AsignadorEspacios::ocupado(int espacio) const {
+    int indice = espacio - 1;
+    return (niveles[0][indice / 64] & ((uint64_t)1 << (indice % 64))) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef ASIGNADOR_ESPACIOS_HPP
+#define ASIGNADOR_ESPACIOS_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Cómo se elige el espacio libre al asignar
+enum class PoliticaAsignacion {
+    MENOR_NUMERO, // El espacio libre de menor número, O(log64 n)
+    RAPIDA        // El último espacio liberado (pila), O(1)
+};
+
+// Espacios libres de un tipo de vehículo. Los espacios se numeran desde 1.
+//
+// Un mapa de bits jerárquico (bit en 1 = libre) permite encontrar el menor
+// espacio libre bajando por los niveles con ctz: cada palabra de un nivel
+// indica qué palabras del nivel inferior tienen algún espacio libre. Con
+// la política RAPIDA además se mantiene una pila de espacios libres.
+//
+// No es seguro entre hilos salvo libres(), que se puede leer sin lock.
+class AsignadorEspacios {
+private:
+    int capacidad_total;
+    PoliticaAsignacion politica;
+    std::vector<std::vector<uint64_t> > niveles; // niveles[0] = un bit por espacio
+    std::vector<int> pila_libres;
+    std::atomic<int> num_libres;
+
+    void marcar_libre(int indice);
+    void marcar_ocupado(int indice);
+    int buscar_menor_libre() const;
+
+public:
+    explicit AsignadorEspacios(int capacidad,
+                               PoliticaAsignacion politica = PoliticaAsignacion::MENOR_NUMERO);
+
+    // Retorna el espacio asignado o -1 si no hay libres
+    int asignar();
+
+    // Ocupar un espacio concreto (p. ej. al recuperar estado); false si no estaba libre
+    bool ocupar(int espacio);
+
+    // false si el espacio no existe o ya estaba libre
+    bool liberar(int espacio);
+
+    bool ocupado(int espacio) const;
+    int libres() const { return num_libres.load(std::memory_order_relaxed); }
+    int capacidad() const { return capacidad_total; }
+};
+
+#endif
\ No newline at end of file
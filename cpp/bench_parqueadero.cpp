@@ -0,0 +1,1075 @@
+// Microbenchmarks del núcleo del parqueadero (sin Python).
+// Compilar y ejecutar con: make bench
+//
+// Uso: bench_parqueadero [--json archivo]
+// Con --json además se escriben todas las mediciones en formato JSON para
+// comparar entre versiones (una lista plana de objetos por escenario).
+
+#include "parqueadero.hpp"
+#include "tabla_placas.hpp"
+#include "protocolo.hpp"
+#include "historial.hpp"
+#include "almacen_estancias.hpp"
+#include "tarifas.hpp"
+#include "gestor_parqueaderos.hpp"
+#include "filtro_repetidos.hpp"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <atomic>
+#include <new>
+
+typedef std::chrono::steady_clock Reloj;
+
+// Asignaciones de memoria de todo el proceso, para contar las de cada evento.
+// Fuera de línea: si GCC ve malloc y free a la vez advierte que no coinciden.
+#if defined(__GNUC__)
+    #define FUERA_DE_LINEA __attribute__((noinline))
+#else
+    #define FUERA_DE_LINEA
+#endif
+
+static std::atomic<uint64_t> asignaciones(0);
+
+FUERA_DE_LINEA void* operator new(size_t n) {
+    asignaciones.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(n ? n : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+FUERA_DE_LINEA void* operator new[](size_t n) { return operator new(n); }
+FUERA_DE_LINEA void operator delete(void* p) noexcept { free(p); }
+FUERA_DE_LINEA void operator delete[](void* p) noexcept { free(p); }
+
+static double ns_por_operacion(Reloj::time_point inicio, size_t operaciones) {
+    std::chrono::duration<double, std::nano> total = Reloj::now() - inicio;
+    return total.count() / operaciones;
+}
+
+// Una medición: escenario + pares (nombre, valor) con parámetros y resultados
+struct Medicion {
+    std::string escenario;
+    std::vector<std::pair<std::string, double> > valores;
+};
+
+static std::vector<Medicion> mediciones;
+
+static void reportar(const std::string& escenario,
+                     const std::vector<std::pair<std::string, double> >& valores) {
+    Medicion m;
+    m.escenario = escenario;
+    m.valores = valores;
+    mediciones.push_back(m);
+}
+
+static bool escribir_json(const std::string& ruta) {
+    std::ofstream archivo(ruta.c_str());
+    archivo << "{\n  \"version\": 1,\n";
+#ifdef __VERSION__
+    archivo << "  \"compilador\": \"" << __VERSION__ << "\",\n";
+#endif
+    archivo << "  \"fecha\": " << (long long)time(nullptr) << ",\n";
+    archivo << "  \"mediciones\": [\n";
+    archivo << std::setprecision(10);
+    for (size_t i = 0; i < mediciones.size(); i++) {
+        const Medicion& m = mediciones[i];
+        archivo << "    {\"escenario\": \"" << m.escenario << "\"";
+        for (size_t j = 0; j < m.valores.size(); j++) {
+            archivo << ", \"" << m.valores[j].first << "\": " << m.valores[j].second;
+        }
+        archivo << (i + 1 < mediciones.size() ? "},\n" : "}\n");
+    }
+    archivo << "  ]\n}\n";
+    return (bool)archivo;
+}
+
+static std::vector<std::string> generar_placas(size_t n, unsigned semilla) {
+    std::mt19937 rng(semilla);
+    std::vector<std::string> placas;
+    placas.reserve(n);
+    char texto[7];
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) texto[j] = 'A' + rng() % 26;
+        for (int j = 3; j < 6; j++) texto[j] = '0' + rng() % 10;
+        texto[6] = '\0';
+        placas.push_back(texto);
+    }
+    return placas;
+}
+
+// Índice antiguo (std::map<std::string, ...>) contra TablaPlacas
+static void bench_indice(size_t n) {
+    std::vector<std::string> placas = generar_placas(n, 42);
+    std::vector<std::string> consultas = generar_placas(n, 7);
+    for (size_t i = 0; i < n; i += 2) consultas[i] = placas[i]; // 50% aciertos
+
+    struct VehiculoMapa {
+        std::string placa;
+        std::string tipo;
+        time_t hora_entrada;
+        int espacio;
+    };
+
+    // std::map
+    std::map<std::string, VehiculoMapa> mapa;
+    Reloj::time_point t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        VehiculoMapa v;
+        v.placa = placas[i];
+        v.tipo = (i & 1) ? "moto" : "carro";
+        v.hora_entrada = 0;
+        v.espacio = (int)i;
+        mapa[placas[i]] = v;
+    }
+    double mapa_insertar = ns_por_operacion(t, n);
+
+    size_t encontrados_mapa = 0;
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        encontrados_mapa += mapa.find(consultas[i]) != mapa.end();
+    }
+    double mapa_buscar = ns_por_operacion(t, n);
+
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        mapa.erase(placas[i]);
+    }
+    double mapa_borrar = ns_por_operacion(t, n);
+
+    // TablaPlacas (incluye el empaquetado de la placa en cada operación)
+    TablaPlacas tabla(n);
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        Vehiculo v;
+        empaquetar_placa(placas[i], v.placa);
+        v.tipo = (i & 1) ? TipoVehiculo::MOTO : TipoVehiculo::CARRO;
+        v.hora_entrada = 0;
+        v.espacio = (int)i;
+        tabla.insertar(v);
+    }
+    double tabla_insertar = ns_por_operacion(t, n);
+
+    size_t encontrados_tabla = 0;
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        PlacaCompacta clave;
+        empaquetar_placa(consultas[i], clave);
+        encontrados_tabla += tabla.buscar(clave) != nullptr;
+    }
+    double tabla_buscar = ns_por_operacion(t, n);
+
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        PlacaCompacta clave;
+        empaquetar_placa(placas[i], clave);
+        tabla.eliminar(clave);
+    }
+    double tabla_borrar = ns_por_operacion(t, n);
+
+    if (encontrados_mapa != encontrados_tabla) {
+        std::cerr << "❌ Resultados distintos entre índices" << std::endl;
+    }
+    reportar("indice", {{"n", (double)n},
+                        {"map_insertar_ns", mapa_insertar}, {"map_buscar_ns", mapa_buscar},
+                        {"map_borrar_ns", mapa_borrar}, {"tabla_insertar_ns", tabla_insertar},
+                        {"tabla_buscar_ns", tabla_buscar}, {"tabla_borrar_ns", tabla_borrar}});
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "indice n=" << std::setw(8) << n
+              << " | map: insertar " << mapa_insertar << " ns, buscar " << mapa_buscar
+              << " ns, borrar " << mapa_borrar << " ns"
+              << " | tabla: insertar " << tabla_insertar << " ns, buscar " << tabla_buscar
+              << " ns, borrar " << tabla_borrar << " ns" << std::endl;
+}
+
+// Directorio temporal para la bitácora, vaciado antes de cada escenario
+static std::string directorio_bitacora() {
+    const char* base = getenv("TMPDIR");
+    std::string dir = std::string(base ? base : "/tmp") + "/bench_bitacora";
+    const char* archivos[] = {"bitacora.log", "bitacora.anterior", "ocupacion.map"};
+    for (size_t i = 0; i < sizeof(archivos) / sizeof(archivos[0]); i++) {
+        remove((dir + "/" + archivos[i]).c_str());
+    }
+    return dir;
+}
+
+static std::string placa_numerada(char prefijo, size_t i) {
+    char texto[9];
+    snprintf(texto, sizeof(texto), "%c%06u", prefijo, (unsigned)(i % 1000000));
+    return texto;
+}
+
+// Entradas y salidas durables desde varios hilos: el commit agrupado
+// reparte cada fsync entre todos los eventos que llegaron mientras tanto
+static void bench_bitacora_escritura(int hilos, bool esperar_fsync, size_t operaciones) {
+    std::string dir = directorio_bitacora();
+    Parqueadero p((int)operaciones, 10);
+    OpcionesBitacora opciones;
+    opciones.esperar_fsync = esperar_fsync;
+    opciones.registros_por_instantanea = 0;
+    if (!p.habilitar_bitacora(dir, opciones)) {
+        std::cerr << "❌ No se pudo abrir la bitácora en " << dir << std::endl;
+        return;
+    }
+
+    size_t por_hilo = operaciones / 2 / hilos;
+    Reloj::time_point t = Reloj::now();
+    std::vector<std::thread> trabajadores;
+    for (int h = 0; h < hilos; h++) {
+        trabajadores.push_back(std::thread([&p, h, por_hilo]() {
+            for (size_t i = 0; i < por_hilo; i++) {
+                std::string placa = placa_numerada('A' + h % 26, h / 26 * por_hilo + i);
+                p.procesar_entrada(placa, "carro");
+                p.procesar_salida(placa);
+            }
+        }));
+    }
+    for (size_t i = 0; i < trabajadores.size(); i++) {
+        trabajadores[i].join();
+    }
+    p.sincronizar_bitacora();
+    size_t total = por_hilo * 2 * hilos;
+    double ns = ns_por_operacion(t, total);
+
+    const Bitacora* b = p.obtener_bitacora();
+    double por_lote = b->lotes_escritos() ? (double)b->registros_escritos() / b->lotes_escritos() : 0.0;
+    reportar("bitacora", {{"hilos", (double)hilos}, {"esperar_fsync", esperar_fsync ? 1.0 : 0.0},
+                          {"eventos_por_s", 1e9 / ns}, {"lotes", (double)b->lotes_escritos()},
+                          {"eventos_por_lote", por_lote}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "bitacora hilos=" << std::setw(3) << hilos
+              << (esperar_fsync ? " fsync=esperar " : " fsync=fondo   ")
+              << "| " << std::setw(9) << 1e9 / ns << " eventos/s, "
+              << b->lotes_escritos() << " lotes, " << por_lote << " eventos/lote" << std::endl;
+}
+
+// Tiempo de arranque tras n eventos: reproduciendo toda la bitácora y
+// cargando el mapa de ocupación
+static void bench_recuperacion(size_t n) {
+    std::string dir = directorio_bitacora();
+    size_t dentro = n / 20; // Vehículos que quedan al final
+    size_t entradas = (n + dentro) / 2;
+    {
+        Parqueadero p((int)dentro + 1, 10);
+        OpcionesBitacora opciones;
+        opciones.esperar_fsync = false;
+        opciones.registros_por_instantanea = 0;
+        p.habilitar_bitacora(dir, opciones);
+        for (size_t i = 0; i < entradas; i++) {
+            p.procesar_entrada(placa_numerada('R', i), "carro");
+            if (i >= dentro) {
+                p.procesar_salida(placa_numerada('R', i - dentro));
+            }
+        }
+        p.sincronizar_bitacora();
+    }
+    remove((dir + "/ocupacion.map").c_str()); // Forzar la reproducción completa
+
+    Reloj::time_point t = Reloj::now();
+    double ms_bitacora, ms_mapa;
+    {
+        Parqueadero p((int)dentro + 1, 10);
+        p.habilitar_bitacora(dir);
+        ms_bitacora = ns_por_operacion(t, 1) / 1e6;
+        if (p.total_vehiculos() != (int)dentro) {
+            std::cerr << "❌ Recuperación incompleta: " << p.total_vehiculos() << std::endl;
+        }
+        p.tomar_instantanea();
+    }
+
+    t = Reloj::now();
+    {
+        Parqueadero p((int)dentro + 1, 10);
+        p.habilitar_bitacora(dir);
+        ms_mapa = ns_por_operacion(t, 1) / 1e6;
+        if (p.total_vehiculos() != (int)dentro) {
+            std::cerr << "❌ Recuperación incompleta: " << p.total_vehiculos() << std::endl;
+        }
+    }
+
+    reportar("recuperacion", {{"eventos", (double)n}, {"vehiculos", (double)dentro},
+                              {"bitacora_ms", ms_bitacora}, {"mapa_ms", ms_mapa}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "recuperacion eventos=" << n << " vehiculos=" << dentro
+              << " | bitacora " << ms_bitacora << " ms, mapa " << ms_mapa
+              << " ms" << std::endl;
+    directorio_bitacora();
+}
+
+// registrar_entrada/registrar_salida (texto) y procesar_* (estructurado)
+// con el parqueadero ocupado al porcentaje dado
+static void bench_operaciones(int capacidad, int porcentaje) {
+    Parqueadero p(capacidad, 10);
+    int ocupados = (int)((long long)capacidad * porcentaje / 100);
+    for (int i = 0; i < ocupados; i++) {
+        p.procesar_entrada(placa_numerada('O', i), "carro");
+    }
+
+    // Rondas de entradas y salidas que no pasan de la capacidad
+    size_t por_ronda = std::max(1, std::min(capacidad - ocupados, 4096));
+    size_t rondas = std::max((size_t)1, (size_t)200000 / por_ronda);
+    std::vector<std::string> placas;
+    for (size_t i = 0; i < por_ronda; i++) {
+        placas.push_back(placa_numerada('N', i));
+    }
+
+    double ns_registrar_entrada = 0, ns_registrar_salida = 0;
+    double ns_procesar_entrada = 0, ns_procesar_salida = 0;
+    for (size_t r = 0; r < rondas; r++) {
+        Reloj::time_point t = Reloj::now();
+        for (size_t i = 0; i < por_ronda; i++) p.registrar_entrada(placas[i], "carro");
+        ns_registrar_entrada += ns_por_operacion(t, por_ronda * rondas);
+        t = Reloj::now();
+        for (size_t i = 0; i < por_ronda; i++) p.registrar_salida(placas[i]);
+        ns_registrar_salida += ns_por_operacion(t, por_ronda * rondas);
+
+        t = Reloj::now();
+        for (size_t i = 0; i < por_ronda; i++) p.procesar_entrada(placas[i], "carro");
+        ns_procesar_entrada += ns_por_operacion(t, por_ronda * rondas);
+        t = Reloj::now();
+        for (size_t i = 0; i < por_ronda; i++) p.procesar_salida(placas[i]);
+        ns_procesar_salida += ns_por_operacion(t, por_ronda * rondas);
+    }
+    if (p.total_vehiculos() != ocupados) {
+        std::cerr << "❌ Ocupación inesperada: " << p.total_vehiculos() << std::endl;
+    }
+
+    reportar("operaciones", {{"capacidad", (double)capacidad}, {"ocupacion_pct", (double)porcentaje},
+                             {"registrar_entrada_ns", ns_registrar_entrada},
+                             {"registrar_salida_ns", ns_registrar_salida},
+                             {"procesar_entrada_ns", ns_procesar_entrada},
+                             {"procesar_salida_ns", ns_procesar_salida}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "operaciones ocupacion=" << std::setw(3) << porcentaje << "%"
+              << " | registrar: entrada " << ns_registrar_entrada << " ns, salida "
+              << ns_registrar_salida << " ns | procesar: entrada " << ns_procesar_entrada
+              << " ns, salida " << ns_procesar_salida << " ns" << std::endl;
+}
+
+// Costo del flujo de cambios sobre entrada+salida, y lo que paga un
+// tablero al leer cambios frente a pedir la foto completa
+static void bench_cambios(int vehiculos) {
+    const size_t rondas = 200000;
+    double ns_operacion[2];
+    double ns_leer = 0.0, ns_foto = 0.0;
+    for (int con_flujo = 0; con_flujo < 2; con_flujo++) {
+        Parqueadero p(vehiculos + 16, 10);
+        if (con_flujo) {
+            p.habilitar_cambios(65536);
+        }
+        for (int i = 0; i < vehiculos; i++) {
+            p.procesar_entrada(placa_numerada('O', i), "carro");
+        }
+        PlacaCompacta clave;
+        empaquetar_placa(placa_numerada('N', 0), clave);
+        Reloj::time_point t = Reloj::now();
+        for (size_t i = 0; i < rondas; i++) {
+            p.procesar_entrada(clave, TipoVehiculo::CARRO);
+            p.procesar_salida(clave);
+        }
+        ns_operacion[con_flujo] = ns_por_operacion(t, rondas * 2);
+
+        if (con_flujo) {
+            FlujoCambios& f = *p.flujo_cambios();
+            std::vector<CambioOcupacion> lote;
+            lote.reserve(256);
+            uint64_t desde = f.ultima_secuencia() - 32768;
+            size_t leidos = 0;
+            t = Reloj::now();
+            while (desde < f.ultima_secuencia()) {
+                lote.clear();
+                f.leer(desde, lote, 256, 0);
+                desde = lote.back().secuencia;
+                leidos += lote.size();
+            }
+            ns_leer = ns_por_operacion(t, leidos);
+
+            std::vector<RegistroTarifa> foto;
+            t = Reloj::now();
+            for (int i = 0; i < 20; i++) {
+                foto.clear();
+                p.tarifas_actuales(foto);
+            }
+            ns_foto = ns_por_operacion(t, 20);
+        }
+    }
+
+    reportar("cambios", {{"vehiculos", (double)vehiculos},
+                         {"operacion_sin_flujo_ns", ns_operacion[0]},
+                         {"operacion_con_flujo_ns", ns_operacion[1]},
+                         {"leer_cambio_ns", ns_leer}, {"foto_ns", ns_foto}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "cambios vehiculos=" << std::setw(7) << vehiculos
+              << " | entrada/salida: sin flujo " << ns_operacion[0] << " ns, con flujo "
+              << ns_operacion[1] << " ns | leer 1 cambio " << ns_leer
+              << " ns, foto completa " << ns_foto / 1000.0 << " us" << std::endl;
+}
+
+// asignar/liberar con sólo `libres` espacios disponibles
+static void bench_asignador(int capacidad, int libres, PoliticaAsignacion politica) {
+    AsignadorEspacios a(capacidad, politica);
+    for (int i = 0; i < capacidad - libres; i++) {
+        a.asignar();
+    }
+
+    std::mt19937 rng(3);
+    const size_t rondas = std::max(1, 1000000 / libres);
+    const size_t operaciones = rondas * libres;
+    std::vector<int> asignados;
+    asignados.reserve(libres);
+    double ns_asignar = 0, ns_liberar = 0;
+    for (size_t r = 0; r < rondas; r++) {
+        Reloj::time_point t = Reloj::now();
+        for (int i = 0; i < libres; i++) asignados.push_back(a.asignar());
+        ns_asignar += ns_por_operacion(t, operaciones);
+        // Liberar en orden aleatorio para no favorecer a la pila
+        std::shuffle(asignados.begin(), asignados.end(), rng);
+        t = Reloj::now();
+        for (int i = 0; i < libres; i++) a.liberar(asignados[i]);
+        ns_liberar += ns_por_operacion(t, operaciones);
+        asignados.clear();
+    }
+
+    // Sin espacios: el caso "lleno" también debe ser barato
+    while (a.asignar() != -1) {}
+    Reloj::time_point t = Reloj::now();
+    int fallidos = 0;
+    for (size_t i = 0; i < operaciones; i++) fallidos += a.asignar() == -1;
+    double ns_lleno = ns_por_operacion(t, operaciones);
+    if (fallidos != (int)operaciones) {
+        std::cerr << "❌ Asignó espacio estando lleno" << std::endl;
+    }
+
+    bool rapida = politica == PoliticaAsignacion::RAPIDA;
+    reportar("asignador", {{"capacidad", (double)capacidad}, {"libres", (double)libres},
+                           {"politica_rapida", rapida ? 1.0 : 0.0}, {"asignar_ns", ns_asignar},
+                           {"liberar_ns", ns_liberar}, {"asignar_lleno_ns", ns_lleno}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "asignador capacidad=" << capacidad << " libres=" << std::setw(3) << libres
+              << (rapida ? " RAPIDA      " : " MENOR_NUMERO") << " | asignar " << ns_asignar
+              << " ns, liberar " << ns_liberar << " ns, lleno " << ns_lleno << " ns" << std::endl;
+}
+
+// calcular_tarifa, listar_vehiculos y tarifas_actuales con n vehículos
+static void bench_consultas(size_t n) {
+    Parqueadero p((int)n, 10);
+    for (size_t i = 0; i < n; i++) {
+        p.procesar_entrada(placa_numerada('C', i), "carro");
+    }
+
+    std::mt19937 rng(11);
+    const size_t consultas = 200000;
+    std::vector<std::string> placas;
+    placas.reserve(consultas);
+    for (size_t i = 0; i < consultas; i++) {
+        placas.push_back(placa_numerada('C', rng() % n));
+    }
+    double suma = 0;
+    Reloj::time_point t = Reloj::now();
+    for (size_t i = 0; i < consultas; i++) suma += p.calcular_tarifa(placas[i]);
+    double ns_tarifa = ns_por_operacion(t, consultas);
+
+    // Repetir las llamadas completas hasta cubrir ~1M de vehículos
+    size_t repeticiones = std::max((size_t)1, (size_t)1000000 / n);
+    size_t listados = 0;
+    t = Reloj::now();
+    for (size_t r = 0; r < repeticiones; r++) listados += p.listar_vehiculos().size();
+    double us_listar = ns_por_operacion(t, repeticiones) / 1e3;
+
+    std::vector<RegistroTarifa> tabla;
+    t = Reloj::now();
+    for (size_t r = 0; r < repeticiones; r++) {
+        tabla.clear();
+        p.tarifas_actuales(tabla);
+    }
+    double us_tarifas = ns_por_operacion(t, repeticiones) / 1e3;
+    if (listados != n * repeticiones || tabla.size() != n || suma < 0) {
+        std::cerr << "❌ Consultas incompletas" << std::endl;
+    }
+
+    reportar("consultas", {{"vehiculos", (double)n}, {"calcular_tarifa_ns", ns_tarifa},
+                           {"listar_vehiculos_us", us_listar}, {"tarifas_actuales_us", us_tarifas}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "consultas n=" << std::setw(8) << n << " | calcular_tarifa " << ns_tarifa
+              << " ns | listar_vehiculos " << us_listar << " us, tarifas_actuales "
+              << us_tarifas << " us" << std::endl;
+}
+
+// Fórmula anterior (horas iniciadas * tarifa por hora) contra el motor de
+// tarifas con las reglas por defecto y con todas las reglas activas
+static void bench_tarifas(size_t n) {
+    std::mt19937 rng(23);
+    int64_t ahora = 1700000000;
+    std::vector<uint8_t> tipos(n), abonados(n);
+    std::vector<int64_t> entradas(n);
+    for (size_t i = 0; i < n; i++) {
+        tipos[i] = (uint8_t)(rng() % 2);
+        entradas[i] = ahora - (int64_t)(rng() % (3 * 86400));
+        abonados[i] = rng() % 20 == 0;
+    }
+    std::vector<double> destino(n);
+    const int repeticiones = 5;
+
+    double suma_anterior = 0;
+    Reloj::time_point t = Reloj::now();
+    for (int r = 0; r < repeticiones; r++) {
+        for (size_t i = 0; i < n; i++) {
+            double horas = std::ceil(difftime((time_t)ahora, (time_t)entradas[i]) / 3600.0);
+            destino[i] = horas * (tipos[i] == (uint8_t)TipoVehiculo::CARRO ? 3000.0 : 2000.0);
+        }
+        suma_anterior += destino[n / 2];
+    }
+    double ns_anterior = ns_por_operacion(t, n * repeticiones);
+
+    MotorTarifas por_defecto((ConfiguracionTarifas()));
+    t = Reloj::now();
+    for (int r = 0; r < repeticiones; r++) {
+        por_defecto.tarifas(tipos.data(), entradas.data(), nullptr, n, ahora, destino.data());
+    }
+    double ns_defecto = ns_por_operacion(t, n * repeticiones);
+    bool iguales = destino[n / 2] * repeticiones == suma_anterior;
+
+    ConfiguracionTarifas config;
+    for (int k = 0; k < 2; k++) {
+        ReglaTarifa& regla = config.reglas[k];
+        regla.valor_bloque = k == 0 ? 800.0 : 500.0;
+        regla.minutos_bloque = 15;
+        regla.minutos_gracia = 10;
+        regla.tope_diario = k == 0 ? 25000.0 : 15000.0;
+        regla.valor_bloque_noche = regla.valor_bloque / 2;
+    }
+    MotorTarifas completo(config);
+    t = Reloj::now();
+    for (int r = 0; r < repeticiones; r++) {
+        completo.tarifas(tipos.data(), entradas.data(), abonados.data(), n, ahora, destino.data());
+    }
+    double ns_completo = ns_por_operacion(t, n * repeticiones);
+
+    double suma = 0;
+    t = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        suma += completo.tarifa((TipoVehiculo)tipos[i], entradas[i], ahora, abonados[i] != 0);
+    }
+    double ns_una = ns_por_operacion(t, n);
+    if (!completo.valido() || !iguales || suma < 0) {
+        std::cerr << "❌ Tarifas inconsistentes" << std::endl;
+    }
+
+    reportar("tarifas", {{"vehiculos", (double)n}, {"formula_anterior_ns", ns_anterior},
+                         {"motor_por_defecto_ns", ns_defecto}, {"motor_completo_ns", ns_completo},
+                         {"tarifa_individual_ns", ns_una}});
+    std::cout << std::fixed << std::setprecision(2)
+              << "tarifas n=" << n << " | fórmula anterior " << ns_anterior
+              << " ns | motor por defecto " << ns_defecto << " ns | con gracia, tope, noche y "
+              << "mensualidades " << ns_completo << " ns | de a una " << ns_una << " ns"
+              << std::endl;
+}
+
+// Parser anterior (stringstream + getline, cuatro std::string por mensaje)
+struct MensajeTexto {
+    std::string tipo, placa, tipo_vehiculo, dispositivo;
+};
+
+static MensajeTexto parsear_con_stringstream(const std::string& datos) {
+    MensajeTexto mensaje;
+    std::stringstream ss(datos);
+    std::string token;
+    int campo = 0;
+    while (std::getline(ss, token, '|')) {
+        switch (campo) {
+            case 0: mensaje.tipo = token; break;
+            case 1: mensaje.placa = token; break;
+            case 2: mensaje.tipo_vehiculo = token; break;
+            case 3: mensaje.dispositivo = token; break;
+        }
+        campo++;
+    }
+    return mensaje;
+}
+
+// Parseo de un lote de mensajes enmarcados, como llegan por una conexión
+static void bench_parseo() {
+    std::mt19937 rng(5);
+    std::string buffer;
+    size_t num_mensajes = 1024;
+    for (size_t i = 0; i < num_mensajes; i++) {
+        std::string placa = placa_numerada('P', rng() % 1000000);
+        buffer += (i % 3 == 2) ? "SALIDA|" + placa + "||CAMARA-01"
+                               : "ENTRADA|" + placa + (i & 1 ? "|moto" : "|carro") + "|CAMARA-01";
+        buffer += PROTOCOLO_FIN_MENSAJE;
+    }
+
+    const size_t rondas = 500;
+    const char* final = buffer.data() + buffer.size();
+    size_t validos = 0;
+    Reloj::time_point t = Reloj::now();
+    for (size_t r = 0; r < rondas; r++) {
+        const char* inicio = buffer.data();
+        const char* fin;
+        while ((fin = buscar_byte(inicio, final, PROTOCOLO_FIN_MENSAJE)) != final) {
+            MensajeDispositivo m;
+            validos += parsear_mensaje(inicio, fin - inicio, m) == ErrorMensaje::NINGUNO;
+            inicio = fin + 1;
+        }
+    }
+    double ns = ns_por_operacion(t, rondas * num_mensajes);
+
+    size_t validos_anterior = 0;
+    t = Reloj::now();
+    for (size_t r = 0; r < rondas; r++) {
+        size_t inicio = 0;
+        size_t fin;
+        while ((fin = buffer.find(PROTOCOLO_FIN_MENSAJE, inicio)) != std::string::npos) {
+            MensajeTexto m = parsear_con_stringstream(buffer.substr(inicio, fin - inicio));
+            validos_anterior += !m.placa.empty();
+            inicio = fin + 1;
+        }
+    }
+    double ns_anterior = ns_por_operacion(t, rondas * num_mensajes);
+    if (validos != rondas * num_mensajes || validos_anterior != validos) {
+        std::cerr << "❌ Mensajes rechazados: " << rondas * num_mensajes - validos << std::endl;
+    }
+
+    double mb_por_s = buffer.size() / (double)num_mensajes / ns * 1e3;
+    reportar("parseo", {{"parsear_mensaje_ns", ns}, {"mensajes_por_s", 1e9 / ns}, {"mb_por_s", mb_por_s},
+                        {"stringstream_ns", ns_anterior}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "parseo | parsear_mensaje " << ns << " ns, " << 1e9 / ns << " mensajes/s, "
+              << mb_por_s << " MB/s | stringstream " << ns_anterior << " ns" << std::endl;
+}
+
+// Ráfagas de una cámara LPR: cada placa llega 3 veces seguidas. Sin filtro
+// las repeticiones llegan al parqueadero y fallan; con FiltroRepetidos se
+// descartan tras el parseo.
+static void bench_repetidos(size_t placas) {
+    const int lecturas_por_placa = 3;
+    std::vector<std::string> mensajes;
+    for (size_t i = 0; i < placas; i++) {
+        std::string mensaje = "ENTRADA|" + placa_numerada('R', i) + "|carro|CAMARA-01";
+        for (int j = 0; j < lecturas_por_placa; j++) mensajes.push_back(mensaje);
+    }
+
+    double ns[2];
+    size_t aceptadas[2];
+    size_t descartadas = 0;
+    for (int con_filtro = 0; con_filtro < 2; con_filtro++) {
+        Parqueadero parqueadero((int)placas, 0);
+        FiltroRepetidos filtro(2000, 4096);
+        aceptadas[con_filtro] = 0;
+        int64_t ahora_ms = 0;
+        Reloj::time_point t = Reloj::now();
+        for (size_t i = 0; i < mensajes.size(); i++) {
+            MensajeDispositivo m;
+            parsear_mensaje(mensajes[i].data(), mensajes[i].size(), m);
+            ahora_ms += 1; // Una lectura por milisegundo
+            if (con_filtro && filtro.repetida(m, ahora_ms)) {
+                descartadas++;
+                continue;
+            }
+            aceptadas[con_filtro] += parqueadero.procesar_entrada(m.placa_compacta, m.tipo_vehiculo).ok();
+        }
+        ns[con_filtro] = ns_por_operacion(t, mensajes.size());
+    }
+    if (aceptadas[0] != placas || aceptadas[1] != placas ||
+        descartadas != placas * (lecturas_por_placa - 1)) {
+        std::cerr << "❌ Filtro de repetidos: " << aceptadas[1] << " aceptadas, "
+                  << descartadas << " descartadas" << std::endl;
+    }
+
+    // Sólo el núcleo: en el servidor cada repetición descartada se ahorra
+    // además la respuesta completa, el log, el evento y el callback
+    reportar("repetidos", {{"placas", (double)placas}, {"sin_filtro_ns", ns[0]},
+                           {"con_filtro_ns", ns[1]}, {"descartadas", (double)descartadas}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "repetidos placas=" << placas << " x" << lecturas_por_placa
+              << " | sin filtro " << ns[0] << " ns/lectura | con filtro " << ns[1]
+              << " ns/lectura (costo " << ns[1] - ns[0] << "), " << descartadas
+              << " descartadas" << std::endl;
+}
+
+// Enrutar mensajes ya parseados entre lotes, por campo LOTE y por prefijo
+// del dispositivo, y la consulta de espacios libres de todos los lotes
+static void bench_enrutamiento(int lotes) {
+    GestorParqueaderos gestor;
+    for (int i = 0; i < lotes; i++) {
+        std::string id = "LOTE" + std::to_string(i);
+        gestor.agregar_parqueadero(id, 100, 100);
+        gestor.asignar_prefijo("CAM" + std::to_string(i) + "-", id);
+    }
+
+    std::mt19937 rng(9);
+    const size_t num_mensajes = 4096;
+    std::vector<std::string> con_lote, con_prefijo;
+    for (size_t i = 0; i < num_mensajes; i++) {
+        int lote = (int)(rng() % lotes);
+        con_lote.push_back("ENTRADA|ABC123|carro|CAMARA-01|LOTE" + std::to_string(lote));
+        con_prefijo.push_back("ENTRADA|ABC123|carro|CAM" + std::to_string(lote) + "-01");
+    }
+
+    double ns[2];
+    const size_t rondas = 100;
+    for (int modo = 0; modo < 2; modo++) {
+        std::vector<std::string>& mensajes = modo == 0 ? con_lote : con_prefijo;
+        std::vector<MensajeDispositivo> parseados(num_mensajes);
+        for (size_t i = 0; i < num_mensajes; i++) {
+            parsear_mensaje(mensajes[i].data(), mensajes[i].size(), parseados[i]);
+        }
+        size_t enrutados = 0;
+        Reloj::time_point t = Reloj::now();
+        for (size_t r = 0; r < rondas; r++) {
+            for (size_t i = 0; i < num_mensajes; i++) {
+                enrutados += gestor.enrutar(parseados[i]) != nullptr;
+            }
+        }
+        ns[modo] = ns_por_operacion(t, rondas * num_mensajes);
+        if (enrutados != rondas * num_mensajes) {
+            std::cerr << "❌ Mensajes sin lote: " << rondas * num_mensajes - enrutados << std::endl;
+        }
+    }
+
+    const size_t consultas = 100000;
+    int libres = 0;
+    Reloj::time_point t = Reloj::now();
+    for (size_t i = 0; i < consultas; i++) libres += gestor.espacios_disponibles_carros();
+    double ns_libres = ns_por_operacion(t, consultas);
+    if (libres <= 0) {
+        std::cerr << "❌ Consulta entre lotes vacía" << std::endl;
+    }
+
+    reportar("enrutamiento", {{"lotes", (double)lotes}, {"por_lote_ns", ns[0]},
+                              {"por_prefijo_ns", ns[1]}, {"libres_todos_ns", ns_libres}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "enrutamiento lotes=" << std::setw(4) << lotes << " | campo LOTE " << ns[0]
+              << " ns | prefijo " << ns[1] << " ns | libres en todos " << ns_libres << " ns"
+              << std::endl;
+}
+
+// Camino de un evento en el servidor sin sockets (parsear, operar sobre el
+// parqueadero y escribir la respuesta en el buffer de la conexión), ya en
+// régimen: cuántas asignaciones de memoria hace cada evento. Se compara
+// con armar la respuesta con cadenas temporales, como antes.
+static void bench_asignaciones() {
+    const size_t vehiculos = 4096;
+    Parqueadero p((int)vehiculos, 10);
+    std::string lote;
+    for (size_t i = 0; i < vehiculos; i++) {
+        lote += "ENTRADA|" + placa_numerada('A', i) + "|carro|CAMARA-01\n";
+    }
+    for (size_t i = 0; i < vehiculos; i++) {
+        lote += "SALIDA|" + placa_numerada('A', i) + "||CAMARA-01\n";
+    }
+    const char* final = lote.data() + lote.size();
+    std::string salida;
+
+    double por_evento[2], ns[2];
+    const size_t rondas = 20;
+    for (int temporales = 0; temporales < 2; temporales++) {
+        uint64_t antes = 0;
+        Reloj::time_point t;
+        // La primera ronda calienta el buffer de salida
+        for (size_t r = 0; r <= rondas; r++) {
+            if (r == 1) {
+                antes = asignaciones.load();
+                t = Reloj::now();
+            }
+            salida.clear(); // Como el reactor tras enviar cada lote
+            const char* inicio = lote.data();
+            const char* fin;
+            while ((fin = buscar_byte(inicio, final, PROTOCOLO_FIN_MENSAJE)) != final) {
+                MensajeDispositivo m;
+                parsear_mensaje(inicio, fin - inicio, m);
+                ResultadoOperacion res;
+                if (m.operacion == OperacionMensaje::ENTRADA) {
+                    res = p.procesar_entrada(m.placa_compacta, m.tipo_vehiculo);
+                    salida += res.ok() ? "OK: " : "ERROR: ";
+                    if (temporales) {
+                        salida += describir_entrada(m.placa.texto(), nombre_tipo(m.tipo_vehiculo), res);
+                    } else {
+                        describir_entrada(salida, m.placa.datos, m.placa.largo,
+                                          nombre_tipo(m.tipo_vehiculo), res);
+                    }
+                } else {
+                    res = p.procesar_salida(m.placa_compacta);
+                    salida += res.ok() ? "OK: " : "ERROR: ";
+                    if (temporales) {
+                        salida += describir_salida(m.placa.texto(), res);
+                    } else {
+                        describir_salida(salida, m.placa.datos, m.placa.largo, res);
+                    }
+                }
+                salida += PROTOCOLO_FIN_MENSAJE;
+                inicio = fin + 1;
+            }
+        }
+        size_t eventos = rondas * 2 * vehiculos;
+        ns[temporales] = ns_por_operacion(t, eventos);
+        por_evento[temporales] = (double)(asignaciones.load() - antes) / eventos;
+    }
+    if (p.total_vehiculos() != 0) {
+        std::cerr << "❌ Quedaron vehículos dentro" << std::endl;
+    }
+
+    reportar("asignaciones", {{"asignaciones_por_evento", por_evento[0]}, {"evento_ns", ns[0]},
+                              {"con_temporales_asignaciones", por_evento[1]},
+                              {"con_temporales_ns", ns[1]}});
+    std::cout << std::fixed << std::setprecision(2)
+              << "asignaciones | por evento " << por_evento[0] << " (" << ns[0]
+              << " ns) | con cadenas temporales " << por_evento[1] << " (" << ns[1] << " ns)"
+              << std::endl;
+}
+
+// Registro anterior (database.py): lista de estancias recorrida en cada consulta
+struct EstanciaLista {
+    PlacaCompacta placa;
+    TipoVehiculo tipo;
+    bool abierta;
+    double tarifa;
+};
+
+// Historial con n estancias ya registradas: costo de registrar y de pedir
+// las estadísticas, frente a recorrer la lista como hacía database.py
+static void bench_historial(size_t n) {
+    HistorialParqueadero h;
+    std::vector<EstanciaLista> lista;
+    lista.reserve(n);
+    time_t t0 = 1700000000;
+    for (size_t i = 0; i < n; i++) {
+        PlacaCompacta placa;
+        empaquetar_placa(placa_numerada('H', i), placa);
+        TipoVehiculo tipo = i & 1 ? TipoVehiculo::MOTO : TipoVehiculo::CARRO;
+        h.registrar_entrada(placa, tipo, (int)i, "bench", t0 + (time_t)i);
+        EstanciaLista e = {placa, tipo, true, 0.0};
+        lista.push_back(e);
+        if (i % 4 != 0) {
+            h.registrar_salida(placa, 3000.0, "bench", t0 + (time_t)i + 1800);
+            lista.back().abierta = false;
+            lista.back().tarifa = 3000.0;
+        }
+    }
+
+    // Entrada y salida de vehículos nuevos sobre el historial ya lleno
+    const size_t eventos = 100000;
+    std::vector<PlacaCompacta> placas(eventos);
+    for (size_t i = 0; i < eventos; i++) empaquetar_placa(placa_numerada('N', i), placas[i]);
+    Reloj::time_point t = Reloj::now();
+    for (size_t i = 0; i < eventos; i++) {
+        h.registrar_entrada(placas[i], TipoVehiculo::CARRO, 1, "bench", t0 + (time_t)(n + i));
+        h.registrar_salida(placas[i], 3000.0, "bench", t0 + (time_t)(n + i) + 600);
+    }
+    double ns_evento = ns_por_operacion(t, eventos * 2);
+
+    const size_t consultas = 100000;
+    uint64_t suma = 0;
+    t = Reloj::now();
+    for (size_t i = 0; i < consultas; i++) suma += h.estadisticas().presentes;
+    double ns_estadisticas = ns_por_operacion(t, consultas);
+
+    size_t recorridos = std::max((size_t)3, (size_t)10000000 / n);
+    t = Reloj::now();
+    for (size_t r = 0; r < recorridos; r++) {
+        uint64_t presentes = 0, carros = 0;
+        double recaudado = 0;
+        for (size_t i = 0; i < lista.size(); i++) {
+            presentes += lista[i].abierta;
+            carros += lista[i].tipo == TipoVehiculo::CARRO;
+            recaudado += lista[i].tarifa;
+        }
+        suma += presentes + carros + (uint64_t)recaudado;
+    }
+    double us_recorrido = ns_por_operacion(t, recorridos) / 1e3;
+    if (suma == 0) {
+        std::cerr << "❌ Historial vacío" << std::endl;
+    }
+
+    reportar("historial", {{"estancias", (double)n}, {"registrar_ns", ns_evento},
+                           {"estadisticas_ns", ns_estadisticas}, {"recorrido_lista_us", us_recorrido}});
+    std::cout << std::fixed << std::setprecision(1)
+              << "historial n=" << std::setw(8) << n << " | registrar " << ns_evento
+              << " ns | estadisticas " << ns_estadisticas << " ns | recorrer lista "
+              << us_recorrido << " us" << std::endl;
+}
+
+// Reportes por rango sobre n estancias cerradas (30 días): el almacén por
+// columnas con 1 y con todos los hilos, frente a recorrer un vector de
+// Estancia; además escribir y cargar el archivo
+static void bench_almacen(size_t n) {
+    const char* base = getenv("TMPDIR");
+    std::string ruta = std::string(base ? base : "/tmp") + "/bench_estancias.col";
+    remove(ruta.c_str());
+    remove((ruta + ".fuentes").c_str());
+
+    std::vector<Estancia> filas;
+    filas.reserve(n);
+    std::mt19937 rng(7);
+    int64_t t0 = 1700000000, paso = (int64_t)(30 * 86400 / n) + 1;
+    for (size_t i = 0; i < n; i++) {
+        Estancia e;
+        empaquetar_placa(placa_numerada('C', i), e.placa);
+        e.hora_salida = t0 + (int64_t)i * paso;
+        e.hora_entrada = i % 20 != 0 ? e.hora_salida - 60 - (int64_t)(rng() % 28800) : 0;
+        e.tipo = e.hora_entrada != 0 ? (uint8_t)(rng() & 1) : TIPO_DESCONOCIDO;
+        e.tarifa = 1000.0 * (rng() % 30);
+        e.espacio = (int32_t)(i % 500);
+        e.fuente_entrada = e.fuente_salida = 0;
+        filas.push_back(e);
+    }
+
+    double ms_escribir;
+    {
+        AlmacenEstancias almacen;
+        almacen.abrir(ruta);
+        Reloj::time_point t = Reloj::now();
+        for (size_t i = 0; i < n; i++) {
+            almacen.agregar(filas[i]);
+        }
+        almacen.sincronizar();
+        ms_escribir = ns_por_operacion(t, 1) / 1e6;
+    }
+
+    Reloj::time_point t = Reloj::now();
+    AlmacenEstancias almacen;
+    almacen.abrir(ruta);
+    double ms_cargar = ns_por_operacion(t, 1) / 1e6;
+    if (almacen.filas() != n) {
+        std::cerr << "❌ Almacén incompleto: " << almacen.filas() << std::endl;
+    }
+
+    int64_t desde = t0, hasta = t0 + (int64_t)n * paso;
+    const int repeticiones = 5;
+    double suma = 0;
+
+    // Referencia: el mismo resumen sobre filas (struct por estancia)
+    t = Reloj::now();
+    for (int r = 0; r < repeticiones; r++) {
+        uint64_t estancias = 0;
+        double recaudado = 0;
+        for (size_t i = 0; i < filas.size(); i++) {
+            if (filas[i].hora_salida >= desde && filas[i].hora_salida < hasta) {
+                estancias++;
+                recaudado += filas[i].tarifa;
+            }
+        }
+        suma += estancias + recaudado;
+    }
+    double ms_filas = ns_por_operacion(t, repeticiones) / 1e6;
+
+    int todos = (int)std::max(1u, std::thread::hardware_concurrency());
+    int hilos[] = {1, todos};
+    for (int h = 0; h < (todos > 1 ? 2 : 1); h++) {
+        t = Reloj::now();
+        for (int r = 0; r < repeticiones; r++) {
+            suma += almacen.resumen(desde, hasta, TODOS_LOS_TIPOS, hilos[h]).recaudado;
+        }
+        double ms_resumen = ns_por_operacion(t, repeticiones) / 1e6;
+
+        // Un solo día: los demás bloques se saltan por su rango de horas
+        t = Reloj::now();
+        for (int r = 0; r < repeticiones; r++) {
+            suma += almacen.resumen(desde + 86400 * 10, desde + 86400 * 11, TODOS_LOS_TIPOS, hilos[h]).estancias;
+        }
+        double ms_dia = ns_por_operacion(t, repeticiones) / 1e6;
+
+        std::vector<double> ingresos;
+        std::vector<uint64_t> salidas;
+        t = Reloj::now();
+        almacen.ingresos_por_intervalo(desde, hasta, 3600, ingresos, salidas, TODOS_LOS_TIPOS, hilos[h]);
+        double ms_ingresos = ns_por_operacion(t, 1) / 1e6;
+
+        std::vector<uint64_t> ocupacion[2];
+        t = Reloj::now();
+        almacen.ocupacion(desde, hasta, 300, ocupacion, hilos[h]);
+        double ms_ocupacion = ns_por_operacion(t, 1) / 1e6;
+        suma += salidas.size() + ocupacion[0].size();
+
+        reportar("almacen", {{"estancias", (double)n}, {"hilos", (double)hilos[h]},
+                             {"resumen_ms", ms_resumen}, {"resumen_filas_ms", ms_filas},
+                             {"resumen_dia_ms", ms_dia}, {"ingresos_hora_ms", ms_ingresos},
+                             {"ocupacion_5min_ms", ms_ocupacion}, {"escribir_ms", ms_escribir},
+                             {"cargar_ms", ms_cargar}});
+        std::cout << std::fixed << std::setprecision(2)
+                  << "almacen n=" << n << " hilos=" << std::setw(2) << hilos[h]
+                  << " | resumen " << ms_resumen << " ms (filas " << ms_filas
+                  << " ms), un dia " << ms_dia << " ms, ingresos/hora " << ms_ingresos
+                  << " ms, ocupacion/5min " << ms_ocupacion << " ms | escribir "
+                  << ms_escribir << " ms, cargar " << ms_cargar << " ms" << std::endl;
+    }
+    if (suma == 0) {
+        std::cerr << "❌ Almacén vacío" << std::endl;
+    }
+    remove(ruta.c_str());
+    remove((ruta + ".fuentes").c_str());
+}
+
+int main(int argc, char* argv[]) {
+    std::string ruta_json;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--json" && i + 1 < argc) {
+            ruta_json = argv[++i];
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--json archivo]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "📏 Benchmarks del núcleo del parqueadero" << std::endl;
+
+    size_t tamanos[] = {100, 10000, 1000000};
+    for (size_t i = 0; i < sizeof(tamanos) / sizeof(tamanos[0]); i++) {
+        bench_indice(tamanos[i]);
+    }
+
+    int ocupaciones[] = {0, 50, 90, 99};
+    for (size_t i = 0; i < sizeof(ocupaciones) / sizeof(ocupaciones[0]); i++) {
+        bench_operaciones(100000, ocupaciones[i]);
+    }
+
+    int libres[] = {16, 256, 4096};
+    for (size_t i = 0; i < sizeof(libres) / sizeof(libres[0]); i++) {
+        bench_asignador(100000, libres[i], PoliticaAsignacion::MENOR_NUMERO);
+        bench_asignador(100000, libres[i], PoliticaAsignacion::RAPIDA);
+    }
+
+    for (size_t i = 0; i < sizeof(tamanos) / sizeof(tamanos[0]); i++) {
+        bench_consultas(tamanos[i]);
+    }
+    bench_tarifas(1000000);
+    bench_parseo();
+    bench_repetidos(100000);
+    bench_enrutamiento(8);
+    bench_enrutamiento(64);
+    bench_asignaciones();
+    bench_cambios(1000);
+    bench_cambios(100000);
+    for (size_t i = 0; i < sizeof(tamanos) / sizeof(tamanos[0]); i++) {
+        bench_historial(tamanos[i]);
+    }
+    bench_almacen(4000000);
+
+    int hilos[] = {1, 8, 64};
+    for (size_t i = 0; i < sizeof(hilos) / sizeof(hilos[0]); i++) {
+        bench_bitacora_escritura(hilos[i], true, 4096);
+    }
+    bench_bitacora_escritura(8, false, 200000);
+    bench_recuperacion(1000000);
+
+    if (!ruta_json.empty()) {
+        if (!escribir_json(ruta_json)) {
+            std::cerr << "❌ No se pudo escribir " << ruta_json << std::endl;
+            return 1;
+        }
+        std::cout << "📄 Resultados en " << ruta_json << std::endl;
+    }
+    return 0;
+}
\ No newline at end of file
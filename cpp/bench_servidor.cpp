@@ -0,0 +1,110 @@
+// Benchmark del servidor de dispositivos de punta a punta (TCP local) con
+// cada forma de atender conexiones: bloqueante (aceptar_conexion, una
+// conexión a la vez), reactores epoll y reactores io_uring.
+// Compilar y ejecutar con: make bench-servidor
+//
+// Uso: bench_servidor [segundos por escenario]
+// La carga es la de "cliente_dispositivo bench" en lazo cerrado.
+
+#include "servidor_parqueadero.hpp"
+#include "anillo_io.hpp"
+#include "generador_carga.hpp"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+enum class ModoServidor { BLOQUEANTE, EPOLL, IO_URING };
+
+static const char* nombre_modo(ModoServidor modo) {
+    switch (modo) {
+        case ModoServidor::BLOQUEANTE: return "bloqueante";
+        case ModoServidor::EPOLL: return "epoll";
+        case ModoServidor::IO_URING: return "io_uring";
+    }
+    return "";
+}
+
+static void medir(ModoServidor modo, int conexiones, int pipeline, double segundos, int puerto) {
+    Parqueadero parqueadero(200000, 200000);
+    ServidorParqueadero servidor(&parqueadero, puerto);
+    servidor.establecer_nivel_log(NivelLog::FALLO);
+    BackendServidor backend = modo == ModoServidor::IO_URING ? BackendServidor::IO_URING
+                                                             : BackendServidor::SOCKETS;
+    if (!servidor.iniciar(backend)) {
+        std::cerr << "No se pudo iniciar el servidor en el puerto " << puerto << std::endl;
+        return;
+    }
+
+    // El bloqueante atiende una conexión hasta que el cliente la cierra
+    std::thread hilo_servidor;
+    if (modo == ModoServidor::BLOQUEANTE) {
+        hilo_servidor = std::thread([&servidor, conexiones] {
+            for (int i = 0; i < conexiones; i++) {
+                servidor.aceptar_conexion();
+            }
+        });
+    } else {
+        hilo_servidor = std::thread([&servidor] { servidor.ejecutar(1); });
+    }
+
+    OpcionesCarga opciones;
+    opciones.puerto = puerto;
+    opciones.conexiones = conexiones;
+    opciones.pipeline = pipeline;
+    opciones.duracion_s = segundos;
+    ResultadoCarga r = ejecutar_carga(opciones);
+
+    if (modo != ModoServidor::BLOQUEANTE) {
+        servidor.detener();
+    }
+    hilo_servidor.join();
+
+    double por_segundo = r.segundos > 0 ? r.respuestas / r.segundos : 0.0;
+    std::cout << std::left << std::setw(12) << nombre_modo(modo)
+              << std::right << std::setw(6) << conexiones
+              << std::setw(10) << pipeline
+              << std::setw(14) << std::fixed << std::setprecision(0) << por_segundo
+              << std::setw(10) << std::setprecision(1) << r.latencias.percentil(50.0) / 1000.0
+              << std::setw(10) << r.latencias.percentil(99.0) / 1000.0;
+    if (r.errores > 0 || r.conexiones_fallidas > 0) {
+        std::cout << "  (" << r.errores << " errores, " << r.conexiones_fallidas
+                  << " conexiones fallidas)";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    double segundos = argc > 1 ? atof(argv[1]) : 3.0;
+    if (segundos <= 0) {
+        std::cerr << "Uso: " << argv[0] << " [segundos por escenario]" << std::endl;
+        return 1;
+    }
+
+    bool con_uring = AnilloIO::disponible();
+    std::cout << "📏 Servidor de dispositivos, un reactor, " << segundos << " s por escenario"
+              << std::endl;
+    if (!con_uring) {
+        std::cout << "   (io_uring no disponible en este sistema: se omite)" << std::endl;
+    }
+    std::cout << std::left << std::setw(12) << "modo" << std::right << std::setw(6) << "conex"
+              << std::setw(10) << "pipeline" << std::setw(14) << "eventos/s"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::endl;
+
+    int puerto = 18300;
+    const int pipelines[] = {1, 16};
+    for (size_t i = 0; i < sizeof(pipelines) / sizeof(pipelines[0]); i++) {
+        medir(ModoServidor::BLOQUEANTE, 1, pipelines[i], segundos, puerto++);
+        medir(ModoServidor::EPOLL, 1, pipelines[i], segundos, puerto++);
+        if (con_uring) {
+            medir(ModoServidor::IO_URING, 1, pipelines[i], segundos, puerto++);
+        }
+    }
+    // Muchas conexiones: el bloqueante no puede atenderlas a la vez
+    medir(ModoServidor::EPOLL, 64, 4, segundos, puerto++);
+    if (con_uring) {
+        medir(ModoServidor::IO_URING, 64, 4, segundos, puerto++);
+    }
+    return 0;
+}
@@ -2,27 +2,363 @@
 #include <pybind11/stl.h>
 #include "parqueadero.hpp"
 #include "servidor_parqueadero.hpp"
+#include "gestor_parqueaderos.hpp"
+#include "servidor_http.hpp"
+#include "historial.hpp"
 #include <pybind11/functional.h>
+#include <algorithm>
+#include <cstring>
 
 namespace py = pybind11;
 
+// Resultado de tarifas_actuales(); Python lo ve como un buffer de
+// RegistroTarifa (memoryview, struct.iter_unpack o numpy.frombuffer)
+struct TablaTarifas {
+    std::vector<RegistroTarifa> filas;
+};
+
+// Columna de resultados de un reporte del historial; también es un buffer
+// (memoryview o numpy.frombuffer sin copiar)
+template <typename T>
+struct SerieReporte {
+    std::vector<T> valores;
+};
+
+template <typename T>
+static void definir_serie(py::module& m, const char* nombre) {
+    py::class_<SerieReporte<T> >(m, nombre, py::buffer_protocol())
+        .def_buffer([](SerieReporte<T>& s) -> py::buffer_info {
+            return py::buffer_info(s.valores.data(), sizeof(T), py::format_descriptor<T>::format(), 1,
+                                   {(py::ssize_t)s.valores.size()}, {(py::ssize_t)sizeof(T)}, true);
+        })
+        .def("__len__", [](const SerieReporte<T>& s) { return s.valores.size(); })
+        .def("__getitem__", [](const SerieReporte<T>& s, py::ssize_t i) {
+            if (i < 0) i += (py::ssize_t)s.valores.size();
+            if (i < 0 || i >= (py::ssize_t)s.valores.size()) {
+                throw py::index_error();
+            }
+            return s.valores[(size_t)i];
+        })
+        .def("lista", [](const SerieReporte<T>& s) { return s.valores; });
+}
+
+template <typename T>
+static py::object serie(std::vector<T>& valores) {
+    SerieReporte<T> s;
+    s.valores.swap(valores);
+    return py::cast(std::move(s));
+}
+
+// Límite de intervalos de un reporte (una semana al segundo)
+static const int64_t MAX_INTERVALOS_REPORTE = 7 * 86400;
+
+static void validar_intervalos(long long desde, long long hasta, long long ancho_s) {
+    if (ancho_s <= 0 || hasta <= desde) {
+        throw py::value_error("Se requiere desde < hasta y un ancho positivo");
+    }
+    if ((hasta - desde) / ancho_s >= MAX_INTERVALOS_REPORTE) {
+        throw py::value_error("Demasiados intervalos; usar un ancho mayor");
+    }
+}
+
+// None = todos los tipos
+static int tipo_o_todos(const py::object& tipo) {
+    if (tipo.is_none()) {
+        return TODOS_LOS_TIPOS;
+    }
+    std::string texto = tipo.cast<std::string>();
+    TipoVehiculo t;
+    if (!tipo_desde_texto(texto, t)) {
+        throw py::value_error("Tipo de vehículo inválido: " + texto);
+    }
+    return (int)t;
+}
+
+static TipoVehiculo tipo_o_error(const std::string& texto) {
+    TipoVehiculo t;
+    if (!tipo_desde_texto(texto, t)) {
+        throw py::value_error("Tipo de vehículo inválido: " + texto);
+    }
+    return t;
+}
+
+static PlacaCompacta placa_o_error(const std::string& placa) {
+    PlacaCompacta compacta;
+    if (!empaquetar_placa(placa, compacta)) {
+        throw py::value_error("Placa inválida: " + placa);
+    }
+    return compacta;
+}
+
+static py::dict estancia_a_dict(const Estancia& e, const std::vector<std::string>& fuentes) {
+    py::dict d;
+    d["placa"] = desempaquetar_placa(e.placa);
+    d["tipo"] = e.tipo == TIPO_DESCONOCIDO ? py::object(py::none())
+                                           : py::object(py::str(nombre_tipo((TipoVehiculo)e.tipo)));
+    d["espacio"] = e.espacio;
+    d["hora_entrada"] = e.hora_entrada != 0 ? py::object(py::int_(e.hora_entrada)) : py::object(py::none());
+    d["hora_salida"] = e.hora_salida != 0 ? py::object(py::int_(e.hora_salida)) : py::object(py::none());
+    d["tarifa"] = e.tarifa;
+    d["fuente"] = e.fuente_entrada < fuentes.size() ? fuentes[e.fuente_entrada] : std::string();
+    d["fuente_salida"] = e.fuente_salida < fuentes.size() ? fuentes[e.fuente_salida] : std::string();
+    return d;
+}
+
 PYBIND11_MODULE(parqueadero_cpp, m) {
     m.doc() = "Sistema de gestión de parqueadero en C++";
     
+    py::enum_<PoliticaAsignacion>(m, "PoliticaAsignacion")
+        .value("MENOR_NUMERO", PoliticaAsignacion::MENOR_NUMERO)
+        .value("RAPIDA", PoliticaAsignacion::RAPIDA);
+    
+    py::enum_<TipoVehiculo>(m, "TipoVehiculo")
+        .value("CARRO", TipoVehiculo::CARRO)
+        .value("MOTO", TipoVehiculo::MOTO);
+    
+    py::enum_<BackendServidor>(m, "BackendServidor")
+        .value("SOCKETS", BackendServidor::SOCKETS)
+        .value("IO_URING", BackendServidor::IO_URING);
+    
+    py::enum_<CodigoResultado>(m, "CodigoResultado")
+        .value("OK", CodigoResultado::OK)
+        .value("YA_PRESENTE", CodigoResultado::YA_PRESENTE)
+        .value("NO_PRESENTE", CodigoResultado::NO_PRESENTE)
+        .value("SIN_ESPACIO", CodigoResultado::SIN_ESPACIO)
+        .value("PLACA_INVALIDA", CodigoResultado::PLACA_INVALIDA)
+        .value("TIPO_INVALIDO", CodigoResultado::TIPO_INVALIDO)
+        .value("ERROR_BITACORA", CodigoResultado::ERROR_BITACORA);
+    
+    // Resultado estructurado: evita formatear y re-parsear texto
+    py::class_<ResultadoOperacion>(m, "ResultadoOperacion")
+        .def_readonly("codigo", &ResultadoOperacion::codigo)
+        .def_property_readonly("ok", &ResultadoOperacion::ok)
+        .def_property_readonly("tipo", [](const ResultadoOperacion& r) {
+            return std::string(nombre_tipo(r.tipo));
+        })
+        .def_readonly("espacio", &ResultadoOperacion::espacio)
+        .def_property_readonly("hora_entrada", [](const ResultadoOperacion& r) {
+            return (long long)r.hora_entrada;
+        })
+        .def_readonly("tarifa", &ResultadoOperacion::tarifa)
+        .def("__bool__", &ResultadoOperacion::ok)
+        .def("__repr__", [](const ResultadoOperacion& r) {
+            return std::string("<ResultadoOperacion ") +
+                   (r.ok() ? "OK" : "ERROR") + " espacio=" + std::to_string(r.espacio) + ">";
+        });
+    
+    // Cambio del flujo de ocupación (ver Parqueadero.cambios)
+    py::class_<CambioOcupacion>(m, "CambioOcupacion")
+        .def_readonly("secuencia", &CambioOcupacion::secuencia)
+        .def_property_readonly("tipo", [](const CambioOcupacion& c) {
+            return std::string(c.tipo == (uint8_t)TipoCambio::ENTRADA ? "entrada" : "salida");
+        })
+        .def_property_readonly("placa", [](const CambioOcupacion& c) {
+            return desempaquetar_placa(c.placa);
+        })
+        .def_property_readonly("tipo_vehiculo", [](const CambioOcupacion& c) {
+            return std::string(nombre_tipo((TipoVehiculo)c.tipo_vehiculo));
+        })
+        .def_readonly("espacio", &CambioOcupacion::espacio)
+        .def_property_readonly("hora", [](const CambioOcupacion& c) { return (long long)c.hora; })
+        .def("__repr__", [](const CambioOcupacion& c) {
+            return "<CambioOcupacion " + std::to_string(c.secuencia) +
+                   (c.tipo == (uint8_t)TipoCambio::ENTRADA ? " entrada " : " salida ") +
+                   desempaquetar_placa(c.placa) + ">";
+        });
+
+    py::class_<TablaTarifas>(m, "TablaTarifas", py::buffer_protocol())
+        .def_buffer([](TablaTarifas& t) -> py::buffer_info {
+            return py::buffer_info(t.filas.data(), sizeof(RegistroTarifa),
+                                   FORMATO_REGISTRO_TARIFA, 1,
+                                   {(py::ssize_t)t.filas.size()},
+                                   {(py::ssize_t)sizeof(RegistroTarifa)}, true);
+        })
+        .def("__len__", [](const TablaTarifas& t) { return t.filas.size(); })
+        .def("tuplas", [](const TablaTarifas& t) {
+            py::list lista;
+            for (size_t i = 0; i < t.filas.size(); i++) {
+                const RegistroTarifa& r = t.filas[i];
+                lista.append(py::make_tuple(
+                    std::string(r.placa, strnlen(r.placa, sizeof(r.placa))),
+                    r.espacio,
+                    nombre_tipo((TipoVehiculo)r.tipo),
+                    (long long)r.hora_entrada,
+                    r.tarifa));
+            }
+            return lista;
+        }, "Lista de tuplas (placa, espacio, tipo, hora_entrada, tarifa)");
+    m.attr("FORMATO_REGISTRO_TARIFA") = FORMATO_REGISTRO_TARIFA;
+
+    py::class_<ReglaTarifa>(m, "ReglaTarifa")
+        .def(py::init([](double valor_bloque, int minutos_bloque, int minutos_gracia,
+                         double tope_diario, double valor_bloque_noche,
+                         int hora_inicio_noche, int hora_fin_noche) {
+                 ReglaTarifa r(valor_bloque);
+                 r.minutos_bloque = minutos_bloque;
+                 r.minutos_gracia = minutos_gracia;
+                 r.tope_diario = tope_diario;
+                 r.valor_bloque_noche = valor_bloque_noche;
+                 r.hora_inicio_noche = hora_inicio_noche;
+                 r.hora_fin_noche = hora_fin_noche;
+                 return r;
+             }),
+             py::arg("valor_bloque") = 0.0, py::arg("minutos_bloque") = 60,
+             py::arg("minutos_gracia") = 0, py::arg("tope_diario") = 0.0,
+             py::arg("valor_bloque_noche") = -1.0, py::arg("hora_inicio_noche") = 22,
+             py::arg("hora_fin_noche") = 6)
+        .def_readwrite("valor_bloque", &ReglaTarifa::valor_bloque)
+        .def_readwrite("minutos_bloque", &ReglaTarifa::minutos_bloque)
+        .def_readwrite("minutos_gracia", &ReglaTarifa::minutos_gracia)
+        .def_readwrite("tope_diario", &ReglaTarifa::tope_diario)
+        .def_readwrite("valor_bloque_noche", &ReglaTarifa::valor_bloque_noche)
+        .def_readwrite("hora_inicio_noche", &ReglaTarifa::hora_inicio_noche)
+        .def_readwrite("hora_fin_noche", &ReglaTarifa::hora_fin_noche)
+        .def("__repr__", [](const ReglaTarifa& r) {
+            return "<ReglaTarifa " + std::to_string(r.valor_bloque) + " cada " +
+                   std::to_string(r.minutos_bloque) + " min>";
+        });
+
+    definir_serie<double>(m, "SerieNumeros");
+    definir_serie<uint64_t>(m, "SerieConteos");
+    
+    m.def("describir_entrada",
+          static_cast<std::string (*)(const std::string&, const std::string&,
+                                      const ResultadoOperacion&)>(&describir_entrada),
+          py::arg("placa"), py::arg("tipo"), py::arg("resultado"),
+          "Texto de un resultado de entrada (sin prefijo OK/ERROR)");
+    m.def("describir_salida",
+          static_cast<std::string (*)(const std::string&, const ResultadoOperacion&)>(&describir_salida),
+          py::arg("placa"), py::arg("resultado"),
+          "Texto de un resultado de salida (sin prefijo OK/ERROR)");
+    
     py::class_<Parqueadero>(m, "Parqueadero")
-        .def(py::init<int, int, double, double>(),
+        .def(py::init<int, int, double, double, PoliticaAsignacion>(),
              py::arg("cap_carros"),
              py::arg("cap_motos"),
              py::arg("tarifa_carro") = 3000.0,
              py::arg("tarifa_moto") = 2000.0,
+             py::arg("politica") = PoliticaAsignacion::MENOR_NUMERO,
              "Constructor del parqueadero")
         
+        .def("habilitar_mapa", &Parqueadero::habilitar_mapa,
+             py::arg("ruta"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Refleja la ocupación en un archivo mapeado que otros procesos pueden leer")
+        
+        .def("habilitar_bitacora", [](Parqueadero& p, const std::string& directorio,
+                                       bool esperar_fsync, int intervalo_commit_ms,
+                                       uint64_t registros_por_instantanea) {
+            OpcionesBitacora opciones;
+            opciones.esperar_fsync = esperar_fsync;
+            opciones.intervalo_commit_ms = intervalo_commit_ms;
+            opciones.registros_por_instantanea = registros_por_instantanea;
+            py::gil_scoped_release release;
+            return p.habilitar_bitacora(directorio, opciones);
+        }, py::arg("directorio"),
+           py::arg("esperar_fsync") = true,
+           py::arg("intervalo_commit_ms") = 5,
+           py::arg("registros_por_instantanea") = 100000,
+           "Recupera el estado guardado en directorio y anota cada entrada/salida desde ahora")
+        
+        .def("sincronizar_bitacora", &Parqueadero::sincronizar_bitacora,
+             py::call_guard<py::gil_scoped_release>(),
+             "Escribe a disco los eventos pendientes de la bitácora")
+        
+        .def("tomar_instantanea", &Parqueadero::tomar_instantanea,
+             py::call_guard<py::gil_scoped_release>(),
+             "Guarda el estado completo y descarta la bitácora anterior")
+
+        .def("escrituras_fallidas_bitacora", [](const Parqueadero& p) -> uint64_t {
+            const Bitacora* b = p.obtener_bitacora();
+            return b == nullptr ? 0 : b->escrituras_fallidas();
+        }, "Lotes de la bitácora e instantáneas que no llegaron a disco")
+        
+        .def("habilitar_cambios", &Parqueadero::habilitar_cambios,
+             py::arg("capacidad") = 65536,
+             "Numera cada entrada/salida en un flujo que guarda los últimos capacidad cambios")
+
+        .def("secuencia_cambios", [](const Parqueadero& p) -> uint64_t {
+            const FlujoCambios* f = p.flujo_cambios();
+            return f == nullptr ? 0 : f->ultima_secuencia();
+        }, "Último cambio publicado; leerlo antes de una foto para seguir desde ahí")
+
+        .def("epoca_cambios", [](const Parqueadero& p) -> int64_t {
+            const FlujoCambios* f = p.flujo_cambios();
+            return f == nullptr ? 0 : f->epoca();
+        }, "Creación del flujo de cambios: primera parte de los cursores \"epoca:secuencia\"")
+
+        .def("cambios", [](Parqueadero& p, uint64_t desde, size_t max_n,
+                           int timeout_ms) -> py::object {
+            FlujoCambios* f = p.flujo_cambios();
+            if (f == nullptr) {
+                throw py::value_error("El flujo de cambios no está habilitado");
+            }
+            std::vector<CambioOcupacion> lista;
+            bool completo;
+            {
+                // Esperar sin retener el GIL: cada suscriptor puede tener su hilo
+                py::gil_scoped_release release;
+                completo = f->leer(desde, lista, max_n, timeout_ms);
+            }
+            if (!completo) {
+                return py::none();
+            }
+            return py::cast(lista);
+        }, py::arg("desde"), py::arg("max_n") = 1024, py::arg("timeout_ms") = 0,
+           "Cambios posteriores a desde (espera hasta timeout_ms si no hay); "
+           "None si se perdieron y hay que recargar el estado")
+
+        .def("procesar_entrada",
+             static_cast<ResultadoOperacion (Parqueadero::*)(const std::string&, const std::string&)>(
+                 &Parqueadero::procesar_entrada),
+             py::arg("placa"), py::arg("tipo"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Registra la entrada y retorna un ResultadoOperacion")
+        
+        .def("procesar_salida",
+             static_cast<ResultadoOperacion (Parqueadero::*)(const std::string&)>(
+                 &Parqueadero::procesar_salida),
+             py::arg("placa"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Registra la salida y retorna un ResultadoOperacion con la tarifa cobrada")
+        
+        .def("consultar_vehiculo",
+             static_cast<ResultadoOperacion (Parqueadero::*)(const std::string&) const>(
+                 &Parqueadero::consultar_vehiculo),
+             py::arg("placa"),
+             "Retorna espacio, hora de entrada y tarifa actual de un vehículo")
+        
+        .def("registrar_entradas", &Parqueadero::procesar_entradas,
+             py::arg("entradas"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Registra una lista de (placa, tipo); retorna un ResultadoOperacion por entrada")
+        
+        .def("registrar_salidas", &Parqueadero::procesar_salidas,
+             py::arg("placas"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Registra la salida de una lista de placas; retorna un ResultadoOperacion por placa")
+        
+        .def("tarifas_actuales", [](const Parqueadero& p) {
+            TablaTarifas* tabla = new TablaTarifas();
+            {
+                py::gil_scoped_release release;
+                p.tarifas_actuales(tabla->filas);
+            }
+            return tabla;
+        }, py::return_value_policy::take_ownership,
+           "Foto de todos los vehículos con su tarifa actual en una sola llamada")
+        
+        .def("total_vehiculos", &Parqueadero::total_vehiculos,
+             "Número de vehículos dentro (O(1))")
+        
         .def("registrar_entrada", &Parqueadero::registrar_entrada,
              py::arg("placa"), py::arg("tipo"),
+             py::call_guard<py::gil_scoped_release>(),
              "Registra la entrada de un vehículo")
         
         .def("registrar_salida", &Parqueadero::registrar_salida,
              py::arg("placa"),
+             py::call_guard<py::gil_scoped_release>(),
              "Registra la salida de un vehículo y calcula tarifa")
         
         .def("vehiculo_presente", &Parqueadero::vehiculo_presente,
@@ -35,6 +371,12 @@ PYBIND11_MODULE(parqueadero_cpp, m) {
         .def("espacios_disponibles_motos", &Parqueadero::espacios_disponibles_motos,
              "Retorna el número de espacios disponibles para motos")
         
+        .def("total_espacios_carros", &Parqueadero::total_espacios_carros,
+             "Capacidad de carros")
+
+        .def("total_espacios_motos", &Parqueadero::total_espacios_motos,
+             "Capacidad de motos")
+        
         .def("listar_vehiculos", &Parqueadero::listar_vehiculos,
              "Lista todas las placas de vehículos presentes")
         
@@ -44,20 +386,409 @@ PYBIND11_MODULE(parqueadero_cpp, m) {
         
         .def("calcular_tarifa", &Parqueadero::calcular_tarifa,
              py::arg("placa"),
-             "Calcula la tarifa actual de un vehículo");
+             "Calcula la tarifa actual de un vehículo")
+
+        .def("configurar_tarifa", [](Parqueadero& p, const std::string& tipo,
+                                     const ReglaTarifa& regla) {
+            ConfiguracionTarifas config = p.configuracion_tarifas();
+            config.reglas[(int)tipo_o_error(tipo)] = regla;
+            std::string error;
+            if (!p.configurar_tarifas(config, &error)) {
+                throw py::value_error(error);
+            }
+        }, py::arg("tipo"), py::arg("regla"),
+           "Cambia la regla de cobro de un tipo; aplica también a los que están dentro")
+
+        .def("regla_tarifa", [](const Parqueadero& p, const std::string& tipo) {
+            return p.configuracion_tarifas().reglas[(int)tipo_o_error(tipo)];
+        }, py::arg("tipo"), "Regla de cobro vigente de un tipo")
+
+        .def("tarifa_estancia", [](const Parqueadero& p, const std::string& tipo,
+                                   long long entrada, long long salida, bool abonado) {
+            return p.motor().tarifa(tipo_o_error(tipo), entrada, salida, abonado);
+        }, py::arg("tipo"), py::arg("entrada"), py::arg("salida"), py::arg("abonado") = false,
+           "Tarifa de una estancia con las reglas vigentes")
+
+        .def("agregar_abonado", [](Parqueadero& p, const std::string& placa, long long vence) {
+            if (!p.agregar_abonado(placa, (time_t)vence)) {
+                throw py::value_error("Placa inválida: " + placa);
+            }
+        }, py::arg("placa"), py::arg("vence") = 0,
+           "Registra una mensualidad (vence = 0: sin vencimiento)")
+
+        .def("quitar_abonado", &Parqueadero::quitar_abonado, py::arg("placa"),
+             "Quita una mensualidad; False si la placa no la tenía")
+
+        .def("total_abonados", &Parqueadero::total_abonados,
+             "Número de mensualidades registradas");
+
+    // Evento de dispositivo extraído de la cola del servidor
+    py::class_<EventoDispositivo>(m, "EventoDispositivo")
+        .def_property_readonly("tipo", [](const EventoDispositivo& e) { return std::string(e.tipo); })
+        .def_property_readonly("placa", [](const EventoDispositivo& e) { return std::string(e.placa); })
+        .def_property_readonly("tipo_vehiculo", [](const EventoDispositivo& e) { return std::string(e.tipo_vehiculo); })
+        .def_property_readonly("dispositivo", [](const EventoDispositivo& e) { return std::string(e.dispositivo); })
+        .def_property_readonly("lote", [](const EventoDispositivo& e) { return std::string(e.lote); })
+        .def_readonly("exito", &EventoDispositivo::exito)
+        .def_readonly("espacio", &EventoDispositivo::espacio)
+        .def_readonly("tarifa", &EventoDispositivo::tarifa)
+        .def_property_readonly("hora", [](const EventoDispositivo& e) { return (long long)e.hora; })
+        .def("__repr__", [](const EventoDispositivo& e) {
+            return std::string("<EventoDispositivo ") + e.tipo + " " + e.placa +
+                   (e.exito ? " OK>" : " RECHAZADO>");
+        });
+
+    // Varios lotes detrás de un solo servidor
+    py::class_<GestorParqueaderos>(m, "GestorParqueaderos")
+        .def(py::init<>())
+        .def("agregar_parqueadero", [](GestorParqueaderos& g, const std::string& id,
+                                       int cap_carros, int cap_motos, double tarifa_carro,
+                                       double tarifa_moto, PoliticaAsignacion politica) {
+            Parqueadero* p = g.agregar_parqueadero(id, cap_carros, cap_motos,
+                                                   tarifa_carro, tarifa_moto, politica);
+            if (p == nullptr) {
+                throw py::value_error("ID de lote inválido o repetido: " + id);
+            }
+            return p;
+        }, py::arg("id"), py::arg("cap_carros"), py::arg("cap_motos"),
+           py::arg("tarifa_carro") = 3000.0, py::arg("tarifa_moto") = 2000.0,
+           py::arg("politica") = PoliticaAsignacion::MENOR_NUMERO,
+           py::return_value_policy::reference_internal,
+           "Crea un lote (ID de 1 a 15 letras, dígitos, '-' o '_') y retorna su Parqueadero")
+        .def("asignar_prefijo", [](GestorParqueaderos& g, const std::string& prefijo,
+                                   const std::string& id) {
+            if (!g.asignar_prefijo(prefijo, id)) {
+                throw py::value_error("Prefijo vacío o lote desconocido: " + id);
+            }
+        }, py::arg("prefijo"), py::arg("id"),
+           "Enruta al lote los mensajes sin LOTE de dispositivos con ese prefijo")
+        .def("parqueadero", [](const GestorParqueaderos& g, const std::string& id) {
+            Parqueadero* p = g.parqueadero(id);
+            if (p == nullptr) {
+                throw py::key_error("Lote desconocido: " + id);
+            }
+            return p;
+        }, py::arg("id"), py::return_value_policy::reference_internal)
+        .def("ids", &GestorParqueaderos::ids)
+        .def("__len__", &GestorParqueaderos::total_lotes)
+        .def("espacios_disponibles_carros", &GestorParqueaderos::espacios_disponibles_carros,
+             "Espacios libres para carros sumando todos los lotes (sin locks)")
+        .def("espacios_disponibles_motos", &GestorParqueaderos::espacios_disponibles_motos,
+             "Espacios libres para motos sumando todos los lotes (sin locks)")
+        .def("total_vehiculos", &GestorParqueaderos::total_vehiculos)
+        .def("estado", [](const GestorParqueaderos& g) {
+            std::vector<EstadoLote> estado = g.estado();
+            py::list lista;
+            for (size_t i = 0; i < estado.size(); i++) {
+                py::dict d;
+                d["id"] = estado[i].id;
+                d["vehiculos"] = estado[i].vehiculos;
+                d["libres_carros"] = estado[i].libres_carros;
+                d["libres_motos"] = estado[i].libres_motos;
+                lista.append(d);
+            }
+            return lista;
+        }, "Vehículos y espacios libres de cada lote")
+        .def("ubicar_vehiculo", [](const GestorParqueaderos& g, const std::string& placa) -> py::object {
+            std::string id = g.ubicar_vehiculo(placa);
+            return id.empty() ? py::object(py::none()) : py::object(py::str(id));
+        }, py::arg("placa"), "ID del lote donde está la placa, o None");
+
+    // Historial con estadísticas incrementales (O(1) por consulta)
+    py::class_<HistorialParqueadero>(m, "HistorialParqueadero")
+        .def(py::init<>())
+        .def("registrar_entrada", [](HistorialParqueadero& h, const std::string& placa,
+                                     const std::string& tipo, int espacio,
+                                     const std::string& fuente, long long hora) {
+            PlacaCompacta compacta = placa_o_error(placa);
+            TipoVehiculo t;
+            if (!tipo_desde_texto(tipo, t)) {
+                throw py::value_error("Tipo de vehículo inválido: " + tipo);
+            }
+            py::gil_scoped_release release;
+            h.registrar_entrada(compacta, t, espacio, fuente, (time_t)hora);
+        }, py::arg("placa"), py::arg("tipo"), py::arg("espacio") = -1,
+           py::arg("fuente") = "", py::arg("hora") = 0,
+           "Abre la estancia de una placa (hora en segundos epoch; 0 = ahora)")
+        .def("registrar_salida", [](HistorialParqueadero& h, const std::string& placa,
+                                    double tarifa, const std::string& fuente, long long hora) {
+            PlacaCompacta compacta = placa_o_error(placa);
+            py::gil_scoped_release release;
+            return h.registrar_salida(compacta, tarifa, fuente, (time_t)hora);
+        }, py::arg("placa"), py::arg("tarifa") = 0.0, py::arg("fuente") = "", py::arg("hora") = 0,
+           "Cierra la estancia abierta; False si no había (se guarda la salida suelta)")
+        .def("estadisticas", [](const HistorialParqueadero& h) {
+            EstadisticasHistorial e = h.estadisticas();
+            py::dict d;
+            d["total_vehiculos"] = e.presentes;
+            d["carros_presentes"] = e.presentes_tipo[(int)TipoVehiculo::CARRO];
+            d["motos_presentes"] = e.presentes_tipo[(int)TipoVehiculo::MOTO];
+            d["total_carros"] = e.entradas_tipo[(int)TipoVehiculo::CARRO];
+            d["total_motos"] = e.entradas_tipo[(int)TipoVehiculo::MOTO];
+            d["total_salidas"] = e.salidas;
+            d["salidas_sin_entrada"] = e.salidas_sin_entrada;
+            d["total_recaudado"] = e.recaudado;
+            d["recaudado_carros"] = e.recaudado_tipo[(int)TipoVehiculo::CARRO];
+            d["recaudado_motos"] = e.recaudado_tipo[(int)TipoVehiculo::MOTO];
+            d["estancia_promedio_min"] = e.estancia_promedio_s / 60.0;
+            py::list por_hora;
+            for (int i = 0; i < 24; i++) por_hora.append(e.entradas_hora_del_dia[i]);
+            d["entradas_por_hora_del_dia"] = por_hora;
+            return d;
+        }, "Totales, presentes, recaudo y estancia promedio; no recorre el historial")
+        .def("ocupacion_por_hora", [](const HistorialParqueadero& h, int horas) {
+            std::vector<CubetaHora> serie;
+            {
+                py::gil_scoped_release release;
+                serie = h.ocupacion_por_hora(horas);
+            }
+            py::list lista;
+            for (size_t i = 0; i < serie.size(); i++) {
+                const CubetaHora& c = serie[i];
+                lista.append(py::make_tuple((long long)c.hora, c.entradas, c.salidas,
+                                            c.ocupacion_maxima, c.ocupacion_final, c.recaudado));
+            }
+            return lista;
+        }, py::arg("horas") = 24,
+           "Tuplas (hora, entradas, salidas, ocupacion_maxima, ocupacion_final, recaudado) "
+           "de las últimas horas (máximo una semana)")
+        .def("estancia_abierta", [](const HistorialParqueadero& h, const std::string& placa) -> py::object {
+            Estancia e;
+            if (!h.estancia_abierta(placa_o_error(placa), e)) {
+                return py::none();
+            }
+            return estancia_a_dict(e, h.fuentes());
+        }, py::arg("placa"), "Estancia en curso de una placa o None")
+        .def("ultimas_estancias", [](const HistorialParqueadero& h, size_t n) {
+            std::vector<Estancia> estancias = h.ultimas_estancias(n);
+            std::vector<std::string> fuentes = h.fuentes();
+            py::list lista;
+            for (size_t i = 0; i < estancias.size(); i++) {
+                lista.append(estancia_a_dict(estancias[i], fuentes));
+            }
+            return lista;
+        }, py::arg("n") = 100, "Últimas n estancias cerradas, la más reciente al final")
+        .def("abrir_archivo", &HistorialParqueadero::abrir_archivo, py::arg("ruta"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Guarda las estancias cerradas en ruta (por columnas) y carga las existentes")
+        .def("sincronizar", &HistorialParqueadero::sincronizar,
+             py::call_guard<py::gil_scoped_release>(),
+             "Lleva a disco las estancias cerradas pendientes")
+        .def("resumen", [](const HistorialParqueadero& h, long long desde, long long hasta,
+                           const py::object& tipo, int hilos) {
+            int t = tipo_o_todos(tipo);
+            ResumenEstancias r;
+            {
+                py::gil_scoped_release release;
+                r = h.almacen().resumen(desde, hasta, t, hilos);
+            }
+            py::dict d;
+            d["estancias"] = r.estancias;
+            d["con_entrada"] = r.con_entrada;
+            d["recaudado"] = r.recaudado;
+            d["estancia_promedio_min"] = r.con_entrada ? r.suma_estancia_s / 60.0 / r.con_entrada : 0.0;
+            d["estancia_maxima_min"] = r.estancia_max_s / 60.0;
+            return d;
+        }, py::arg("desde"), py::arg("hasta"), py::arg("tipo") = py::none(), py::arg("hilos") = 0,
+           "Totales de las estancias con salida en [desde, hasta)")
+        .def("ingresos_por_intervalo", [](const HistorialParqueadero& h, long long desde,
+                                          long long hasta, long long ancho_s,
+                                          const py::object& tipo, int hilos) {
+            validar_intervalos(desde, hasta, ancho_s);
+            int t = tipo_o_todos(tipo);
+            std::vector<double> ingresos;
+            std::vector<uint64_t> salidas;
+            {
+                py::gil_scoped_release release;
+                h.almacen().ingresos_por_intervalo(desde, hasta, ancho_s, ingresos, salidas, t, hilos);
+            }
+            py::dict d;
+            d["desde"] = desde;
+            d["ancho_s"] = ancho_s;
+            d["ingresos"] = serie(ingresos);
+            d["salidas"] = serie(salidas);
+            return d;
+        }, py::arg("desde"), py::arg("hasta"), py::arg("ancho_s") = 3600,
+           py::arg("tipo") = py::none(), py::arg("hilos") = 0,
+           "Recaudo (SerieNumeros) y salidas (SerieConteos) por intervalo")
+        .def("distribucion_estancias", [](const HistorialParqueadero& h, long long desde,
+                                          long long hasta, long long ancho_s, size_t cubetas,
+                                          const py::object& tipo, int hilos) {
+            if (ancho_s <= 0 || cubetas == 0 || cubetas > (size_t)MAX_INTERVALOS_REPORTE) {
+                throw py::value_error("Se requiere un ancho positivo y entre 1 y " +
+                                      std::to_string(MAX_INTERVALOS_REPORTE) + " cubetas");
+            }
+            int t = tipo_o_todos(tipo);
+            std::vector<uint64_t> cuentas;
+            {
+                py::gil_scoped_release release;
+                h.almacen().distribucion_estancias(desde, hasta, ancho_s, cubetas, cuentas, t, hilos);
+            }
+            return serie(cuentas);
+        }, py::arg("desde"), py::arg("hasta"), py::arg("ancho_s") = 900, py::arg("cubetas") = 32,
+           py::arg("tipo") = py::none(), py::arg("hilos") = 0,
+           "Histograma de duraciones (la última cubeta acumula las más largas)")
+        .def("ocupacion_por_intervalo", [](const HistorialParqueadero& h, long long desde,
+                                           long long hasta, long long resolucion_s, int hilos) {
+            validar_intervalos(desde, hasta, resolucion_s);
+            std::vector<uint64_t> por_tipo[2];
+            {
+                py::gil_scoped_release release;
+                h.almacen().ocupacion(desde, hasta, resolucion_s, por_tipo, hilos);
+            }
+            py::dict d;
+            d["desde"] = desde;
+            d["resolucion_s"] = resolucion_s;
+            const char* nombres[2] = {"carro", "moto"};
+            for (int t = 0; t < 2; t++) {
+                uint64_t pico = 0;
+                for (size_t i = 0; i < por_tipo[t].size(); i++) {
+                    pico = std::max(pico, por_tipo[t][i]);
+                }
+                d[(std::string("pico_") + nombres[t]).c_str()] = pico;
+                d[nombres[t]] = serie(por_tipo[t]);
+            }
+            return d;
+        }, py::arg("desde"), py::arg("hasta"), py::arg("resolucion_s") = 300, py::arg("hilos") = 0,
+           "Vehículos de cada tipo por intervalo según las estancias cerradas, y el pico")
+        .def("__len__", &HistorialParqueadero::total_estancias);
 
     // Binding para ServidorParqueadero
     py::class_<ServidorParqueadero>(m, "ServidorParqueadero")
-        .def(py::init<Parqueadero*, int>(),
-             py::arg("parqueadero"), py::arg("puerto") = 8080)
+        .def(py::init<Parqueadero*, int, int>(),
+             py::arg("parqueadero"), py::arg("puerto") = 8080,
+             py::arg("backlog") = SOMAXCONN, py::keep_alive<1, 2>())
+        .def(py::init<GestorParqueaderos*, int, int>(),
+             py::arg("gestor"), py::arg("puerto") = 8080,
+             py::arg("backlog") = SOMAXCONN, py::keep_alive<1, 2>(),
+             "Un servidor para todos los lotes del gestor")
         .def("iniciar", &ServidorParqueadero::iniciar,
-             "Inicia el servidor TCP")
+             py::arg("backend") = BackendServidor::SOCKETS,
+             py::call_guard<py::gil_scoped_release>(),
+             "Inicia el servidor TCP; con IO_URING ejecutar() usa io_uring si el kernel lo permite")
+        .def("backend", &ServidorParqueadero::backend,
+             "Backend con el que atiende ejecutar() (SOCKETS si io_uring no estaba disponible)")
         .def("detener", &ServidorParqueadero::detener,
+             py::call_guard<py::gil_scoped_release>(),
              "Detiene el servidor TCP")
         .def("aceptar_conexion", &ServidorParqueadero::aceptar_conexion,
-             "Acepta una conexión entrante (bloqueante)")
+             py::call_guard<py::gil_scoped_release>(),
+             "Acepta una conexión entrante (bloqueante, libera el GIL)")
+        .def("ejecutar", &ServidorParqueadero::ejecutar,
+             py::arg("num_hilos") = 1,
+             py::call_guard<py::gil_scoped_release>(),
+             "Atiende conexiones concurrentes con reactores epoll o io_uring hasta detener() (bloqueante)")
         .def("esta_ejecutando", &ServidorParqueadero::esta_ejecutando,
              "Retorna True si el servidor está ejecutando")
+        .def("obtener_puerto", &ServidorParqueadero::obtener_puerto,
+             "Puerto de escucha (el que eligió el sistema si se creó con puerto 0)")
+        .def("obtener_eventos", [](ServidorParqueadero& s, size_t max_n, int timeout_ms) {
+            std::vector<EventoDispositivo> eventos;
+            {
+                // Esperar y drenar la cola sin retener el GIL
+                py::gil_scoped_release release;
+                s.obtener_eventos(eventos, max_n, timeout_ms);
+            }
+            return eventos;
+        }, py::arg("max_n") = 256, py::arg("timeout_ms") = 0,
+           "Extrae hasta max_n eventos; espera hasta timeout_ms si no hay ninguno")
+        .def("eventos_descartados", &ServidorParqueadero::eventos_descartados,
+             "Eventos perdidos porque la cola estaba llena")
+        .def("filtrar_repetidos", &ServidorParqueadero::filtrar_repetidos,
+             py::arg("ventana_ms"), py::arg("capacidad") = 65536,
+             "Descarta la misma (dispositivo, placa, operación) dentro de ventana_ms; 0 lo apaga. "
+             "Antes de iniciar()")
+        .def("ventana_repetidos", &ServidorParqueadero::ventana_repetidos,
+             "Ventana del filtro de repetidos en ms (0 si está apagado)")
+        .def("lecturas_repetidas", &ServidorParqueadero::lecturas_repetidas,
+             "Lecturas descartadas por el filtro de repetidos")
+        .def("persistir_secuencias", &ServidorParqueadero::persistir_secuencias,
+             py::arg("ruta"),
+             "Guardar en ruta la última secuencia SINC de cada dispositivo (servidor detenido)")
+        .def("ultima_secuencia", &ServidorParqueadero::ultima_secuencia, py::arg("dispositivo"),
+             "Última secuencia aplicada del dispositivo en lotes SINC (0 si ninguna)")
+        .def("iniciar_metricas", &ServidorParqueadero::iniciar_metricas,
+             py::arg("puerto"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Sirve las métricas en formato Prometheus en http://0.0.0.0:puerto/metrics")
+        .def("detener_metricas", &ServidorParqueadero::detener_metricas,
+             py::call_guard<py::gil_scoped_release>(),
+             "Detiene el endpoint de métricas")
+        .def("texto_metricas", &ServidorParqueadero::texto_metricas,
+             py::call_guard<py::gil_scoped_release>(),
+             "Métricas en formato de texto de Prometheus")
+        .def("establecer_nivel_log", [](ServidorParqueadero& s, const std::string& nivel) {
+            bool valido;
+            NivelLog n = nivel_log_desde_texto(nivel, valido);
+            if (!valido) {
+                throw py::value_error("Nivel de log inválido: " + nivel +
+                                      " (debug, info, aviso, error u off)");
+            }
+            s.establecer_nivel_log(n);
+        }, py::arg("nivel"),
+           "Nivel mínimo del log del servidor: debug, info, aviso, error u off")
+        .def("log_a_archivo", &ServidorParqueadero::log_a_archivo,
+             py::arg("ruta"),
+             "Escribe el log del servidor al final de un archivo en vez de la consola")
+        .def("vaciar_log", &ServidorParqueadero::vaciar_log,
+             py::call_guard<py::gil_scoped_release>(),
+             "Escribe ya las líneas de log pendientes")
+        .def("registros_log_descartados", &ServidorParqueadero::registros_log_descartados,
+             "Líneas de log perdidas porque el anillo de su hilo estaba lleno")
+        .def("metricas", [](const ServidorParqueadero& s) {
+            FotoMetricas f;
+            {
+                py::gil_scoped_release release;
+                f = s.obtener_metricas();
+            }
+            static const char* operaciones[2] = {"entrada", "salida"};
+            static const char* tipos[2] = {"carro", "moto"};
+
+            py::dict eventos;
+            for (int o = 0; o < 2; o++) {
+                for (int t = 0; t < 2; t++) {
+                    eventos[py::make_tuple(operaciones[o], tipos[t])] = f.eventos[o][t];
+                }
+            }
+            py::dict dispositivos;
+            for (const EventosDispositivo& d : f.dispositivos) {
+                dispositivos[py::str(d.nombre)] =
+                    d.eventos[0][0] + d.eventos[0][1] + d.eventos[1][0] + d.eventos[1][1];
+            }
+            py::dict rechazos;
+            for (int i = 1; i < NUM_ERRORES_MENSAJE; i++) {
+                rechazos[motivo_mensaje((ErrorMensaje)i)] = f.rechazos_mensaje[i];
+            }
+            for (int i = 1; i < NUM_CODIGOS_RESULTADO; i++) {
+                rechazos[py::str(std::string("operacion_") + motivo_operacion((CodigoResultado)i))] =
+                    f.rechazos_operacion[i];
+            }
+            py::dict latencias;
+            for (int e = 0; e < NUM_ETAPAS; e++) {
+                const FotoHistograma& h = f.latencias[e];
+                py::dict etapa;
+                etapa["total"] = h.total;
+                etapa["suma_ns"] = h.suma_ns;
+                etapa["p50_ns"] = h.percentil(50);
+                etapa["p99_ns"] = h.percentil(99);
+                etapa["p999_ns"] = h.percentil(99.9);
+                latencias[nombre_etapa((EtapaServidor)e)] = etapa;
+            }
+
+            py::dict r;
+            r["conexiones_aceptadas"] = f.conexiones_aceptadas;
+            r["conexiones_activas"] = f.conexiones_aceptadas - f.conexiones_cerradas;
+            r["mensajes"] = f.mensajes;
+            r["bytes_recibidos"] = f.bytes_recibidos;
+            r["bytes_enviados"] = f.bytes_enviados;
+            r["eventos"] = eventos;
+            r["dispositivos"] = dispositivos;
+            r["rechazos"] = rechazos;
+            r["latencias"] = latencias;
+            r["cola_eventos"] = f.cola_eventos;
+            r["eventos_descartados"] = f.eventos_descartados;
+            return r;
+        }, "Foto de los contadores del servidor: eventos, rechazos por motivo y latencias por etapa")
         .def("establecer_callback", [](ServidorParqueadero &s, py::function cb){
             // Guardar el callback en una lambda que adquiere el GIL
             s.establecer_callback([cb](const std::string& tipo,
@@ -72,5 +803,24 @@ PYBIND11_MODULE(parqueadero_cpp, m) {
                     py::print("Exception in callback:", e.what());
                 }
             });
-        }, "Establece un callback Python para eventos (tipo, placa, tipo_vehiculo, exito)");
+        }, "Establece un callback Python síncrono para eventos (tipo, placa, tipo_vehiculo, exito)");
+
+    // Lecturas de tableros y kioscos servidas en C++
+    py::class_<ServidorHttp>(m, "ServidorHttp")
+        .def(py::init<const Parqueadero*, int, int>(),
+             py::arg("parqueadero"), py::arg("puerto") = 8081,
+             py::arg("backlog") = SOMAXCONN, py::keep_alive<1, 2>(),
+             "GET /api/estado, /api/vehiculo/<placa> y /api/tarifa/<placa> en JSON")
+        .def("iniciar", &ServidorHttp::iniciar,
+             py::arg("num_hilos") = 2,
+             py::call_guard<py::gil_scoped_release>(),
+             "Abre el puerto y atiende con num_hilos hilos propios (no bloquea)")
+        .def("detener", &ServidorHttp::detener,
+             py::call_guard<py::gil_scoped_release>(),
+             "Cierra el puerto y espera a los hilos")
+        .def("esta_ejecutando", &ServidorHttp::esta_ejecutando,
+             "Retorna True si el servidor está atendiendo")
+        .def("obtener_puerto", &ServidorHttp::obtener_puerto)
+        .def("total_pedidos", &ServidorHttp::total_pedidos,
+             "Pedidos respondidos desde que se inició");
 }
@@ -0,0 +1,431 @@
+#include "bitacora.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <direct.h>
+    #define ABRIR(ruta, flags) _open((ruta), (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define LEER _read
+    #define ESCRIBIR _write
+    #define CERRAR _close
+    #define RECORTAR _chsize_s
+#else
+    #include <unistd.h>
+    #define ABRIR(ruta, flags) open((ruta), (flags), 0644)
+    #define LEER read
+    #define ESCRIBIR write
+    #define CERRAR close
+    #define RECORTAR ftruncate
+#endif
+
+static const char MAGIA_BITACORA[8] = {'P', 'Q', 'B', 'I', 'T', 'A', 'C', '1'};
+static const size_t LARGO_CABECERA = 16;
+static const size_t REGISTROS_POR_LECTURA = 4096;
+
+uint16_t suma_registro(const RegistroBitacora& r) {
+    // FNV-1a de 32 bits plegado a 16
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&r);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(RegistroBitacora, suma); i++) {
+        h ^= bytes[i];
+        h *= 16777619u;
+    }
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+bool escribir_todo(int archivo, const void* datos, size_t largo) {
+    const char* p = static_cast<const char*>(datos);
+    while (largo > 0) {
+        int n = ESCRIBIR(archivo, p, (unsigned)(largo > (1u << 30) ? (1u << 30) : largo));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        largo -= n;
+    }
+    return true;
+}
+
+bool sincronizar_archivo(int archivo) {
+#if defined(_WIN32)
+    return _commit(archivo) == 0;
+#elif defined(__APPLE__)
+    return fsync(archivo) == 0;
+#else
+    return fdatasync(archivo) == 0;
+#endif
+}
+
+bool sincronizar_directorio(const std::string& directorio) {
+#ifdef _WIN32
+    (void)directorio;
+    return true;
+#else
+    // Hace durables los rename/unlink hechos en el directorio
+    int fd = open(directorio.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+static bool existe(const std::string& ruta) {
+    struct stat info;
+    return stat(ruta.c_str(), &info) == 0;
+}
+
+Bitacora::Bitacora(const std::string& directorio, const OpcionesBitacora& opciones)
+    : dir(directorio), opciones(opciones), archivo(-1), secuencia(0), durable(0), fallida(0),
+      desde_instantanea(0), detener_hilos(false), instantanea_solicitada(false),
+      largo_valido(0), bloqueada(false), lotes(0), escritos(0), fallos(0), rotada_hasta(0) {
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+}
+
+Bitacora::~Bitacora() {
+    cerrar();
+}
+
+std::string Bitacora::ruta(const char* nombre) const {
+    return dir + "/" + nombre;
+}
+
+bool Bitacora::reproducir(uint64_t desde,
+                          const std::function<void(const RegistroBitacora&)>& aplicar) {
+    const char* nombres[] = {"bitacora.anterior", "bitacora.log"};
+    std::vector<RegistroBitacora> bloque(REGISTROS_POR_LECTURA);
+    uint64_t ultima = desde;
+    uint64_t aplicados = 0;
+
+    for (size_t f = 0; f < 2; f++) {
+        std::string ruta_log = ruta(nombres[f]);
+        if (!existe(ruta_log)) {
+            continue;
+        }
+        int fd = ABRIR(ruta_log.c_str(), O_RDWR);
+        if (fd < 0) {
+            std::cerr << "Error al abrir " << ruta_log << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        char cabecera[LARGO_CABECERA];
+        int leidos = LEER(fd, cabecera, LARGO_CABECERA);
+        if (leidos < (int)LARGO_CABECERA || memcmp(cabecera, MAGIA_BITACORA, 8) != 0) {
+            // Archivo vacío o cabecera incompleta: nada que reproducir
+            CERRAR(fd);
+            continue;
+        }
+
+        long long valido = LARGO_CABECERA;
+        bool danado = false;
+        while (!danado) {
+            int bytes = LEER(fd, &bloque[0], (unsigned)(bloque.size() * sizeof(RegistroBitacora)));
+            if (bytes <= 0) {
+                break;
+            }
+            size_t n = bytes / sizeof(RegistroBitacora);
+            for (size_t i = 0; i < n; i++) {
+                const RegistroBitacora& r = bloque[i];
+                if (r.suma != suma_registro(r) || r.secuencia == 0) {
+                    danado = true;
+                    break;
+                }
+                valido += sizeof(RegistroBitacora);
+                if (r.secuencia > ultima) {
+                    ultima = r.secuencia;
+                }
+                if (r.secuencia > desde) {
+                    aplicar(r);
+                    aplicados++;
+                }
+            }
+            if (bytes % sizeof(RegistroBitacora) != 0) {
+                danado = true; // Registro final incompleto
+            }
+        }
+
+        // Descartar la cola dañada para seguir escribiendo tras lo válido
+        if (danado) {
+            std::cerr << "⚠️  " << ruta_log << ": registro incompleto al final, se descarta"
+                      << std::endl;
+            if (RECORTAR(fd, valido) != 0) {
+                std::cerr << "Error al recortar " << ruta_log << std::endl;
+            }
+        }
+        CERRAR(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ultima > secuencia.load()) {
+        secuencia = ultima;
+    }
+    durable = secuencia.load();
+    desde_instantanea = aplicados;
+    return true;
+}
+
+bool Bitacora::abrir_archivo_log() {
+    std::string ruta_log = ruta("bitacora.log");
+    archivo = ABRIR(ruta_log.c_str(), O_WRONLY | O_CREAT | O_APPEND);
+    if (archivo < 0) {
+        std::cerr << "Error al abrir " << ruta_log << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(archivo, &info) != 0) {
+        std::cerr << "Error al leer " << ruta_log << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    largo_valido = info.st_size;
+    if (largo_valido < (long long)LARGO_CABECERA) {
+        char cabecera[LARGO_CABECERA] = {0};
+        memcpy(cabecera, MAGIA_BITACORA, 8);
+        if (RECORTAR(archivo, 0) != 0 || !escribir_todo(archivo, cabecera, LARGO_CABECERA) ||
+            !sincronizar_archivo(archivo)) {
+            std::cerr << "Error al escribir cabecera de " << ruta_log << std::endl;
+            return false;
+        }
+        largo_valido = LARGO_CABECERA;
+    }
+    return true;
+}
+
+bool Bitacora::abrir(uint64_t ultima_secuencia, FuncionInstantanea instantanea) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ultima_secuencia > secuencia.load()) {
+            secuencia = ultima_secuencia;
+        }
+        durable = secuencia.load();
+    }
+    if (!abrir_archivo_log() || !sincronizar_directorio(dir)) {
+        return false;
+    }
+
+    funcion_instantanea = instantanea;
+    hilo_commit = std::thread(&Bitacora::loop_commit, this);
+    if (funcion_instantanea && opciones.registros_por_instantanea > 0) {
+        hilo_instantanea = std::thread(&Bitacora::loop_instantanea, this);
+    }
+    return true;
+}
+
+uint64_t Bitacora::anotar(OperacionBitacora operacion, PlacaCompacta placa,
+                          TipoVehiculo tipo, int espacio, time_t hora) {
+    RegistroBitacora r;
+    memset(&r, 0, sizeof(r));
+    r.placa = placa;
+    r.hora = (int64_t)hora;
+    r.espacio = espacio;
+    r.operacion = (uint8_t)operacion;
+    r.tipo = (uint8_t)tipo;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    r.secuencia = secuencia.load() + 1;
+    secuencia = r.secuencia;
+    r.suma = suma_registro(r);
+
+    bool estaba_vacio = pendientes.empty();
+    pendientes.push_back(r);
+
+    desde_instantanea++;
+    if (opciones.registros_por_instantanea > 0 && !instantanea_solicitada &&
+        desde_instantanea >= opciones.registros_por_instantanea) {
+        instantanea_solicitada = true;
+        pedir_instantanea.notify_one();
+    }
+    if (estaba_vacio) {
+        hay_pendientes.notify_one();
+    }
+    return r.secuencia;
+}
+
+bool Bitacora::esperar_durable(uint64_t sec) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (durable < sec && fallida < sec) {
+        hay_durables.wait(lock);
+    }
+    return durable >= sec;
+}
+
+bool Bitacora::volcar() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (en_escritura.empty()) {
+            // Intercambiar buffers: los productores siguen con el vacío
+            en_escritura.swap(pendientes);
+        } else {
+            // Quedó un lote fallido: va antes, la bitácora no admite huecos
+            en_escritura.insert(en_escritura.end(), pendientes.begin(), pendientes.end());
+            pendientes.clear();
+        }
+        if (en_escritura.empty()) {
+            return true;
+        }
+    }
+
+    size_t bytes = en_escritura.size() * sizeof(RegistroBitacora);
+    bool ok = !bloqueada && escribir_todo(archivo, &en_escritura[0], bytes) &&
+              sincronizar_archivo(archivo);
+    uint64_t ultimo = en_escritura.back().secuencia;
+    if (!ok) {
+        if (!bloqueada) {
+            std::cerr << "❌ Error al escribir la bitácora: " << strerror(errno) << std::endl;
+            // Quitar lo que alcanzó a escribirse: el reintento no puede
+            // quedar detrás de un registro a medias
+            if (RECORTAR(archivo, largo_valido) != 0) {
+                std::cerr << "❌ No se pudo recortar la bitácora: no se escribirá más"
+                          << std::endl;
+                bloqueada = true;
+            }
+        }
+        fallos++;
+        {
+            // Sin avanzar durable: quienes esperan estos registros reciben
+            // el error en vez de quedar bloqueados
+            std::lock_guard<std::mutex> lock(mutex);
+            fallida = ultimo;
+        }
+        hay_durables.notify_all();
+        return false;
+    }
+
+    largo_valido += bytes;
+    lotes++;
+    escritos += en_escritura.size();
+    en_escritura.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        durable = ultimo;
+    }
+    hay_durables.notify_all();
+    return true;
+}
+
+void Bitacora::sincronizar() {
+    std::lock_guard<std::mutex> lock_archivo(mutex_archivo);
+    if (archivo >= 0) {
+        volcar();
+    }
+}
+
+void Bitacora::loop_commit() {
+    std::chrono::milliseconds intervalo(opciones.intervalo_commit_ms > 0 ? opciones.intervalo_commit_ms : 1);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!detener_hilos) {
+        // fallida > durable: queda un lote por reintentar
+        if (pendientes.empty() && fallida <= durable) {
+            hay_pendientes.wait_for(lock, intervalo);
+            continue;
+        }
+        lock.unlock();
+        if (!opciones.esperar_fsync) {
+            // Nadie espera: acumular un lote más grande
+            std::this_thread::sleep_for(intervalo);
+        }
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock_archivo(mutex_archivo);
+            ok = volcar();
+        }
+        lock.lock();
+        if (!ok && !detener_hilos) {
+            // Esperar antes de reintentar (disco lleno, etc.)
+            hay_pendientes.wait_for(lock, intervalo);
+        }
+    }
+}
+
+void Bitacora::loop_instantanea() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        while (!detener_hilos && !instantanea_solicitada) {
+            pedir_instantanea.wait(lock);
+        }
+        if (detener_hilos) {
+            break;
+        }
+        lock.unlock();
+        funcion_instantanea();
+        lock.lock();
+        instantanea_solicitada = false;
+        // Si la instantánea falló, reintentar tras otro umbral de registros
+        if (desde_instantanea >= opciones.registros_por_instantanea) {
+            desde_instantanea = 0;
+        }
+    }
+}
+
+bool Bitacora::rotar(uint64_t& secuencia_estado) {
+    std::lock_guard<std::mutex> lock_archivo(mutex_archivo);
+    std::string anterior = ruta("bitacora.anterior");
+    if (archivo < 0 || existe(anterior)) {
+        // Una instantánea previa no terminó: su bitácora aún hace falta
+        return false;
+    }
+    if (!volcar()) {
+        return false;
+    }
+    secuencia_estado = secuencia.load();
+
+    CERRAR(archivo);
+    archivo = -1;
+    if (rename(ruta("bitacora.log").c_str(), anterior.c_str()) != 0 ||
+        !abrir_archivo_log() || !sincronizar_directorio(dir)) {
+        std::cerr << "❌ Error al rotar la bitácora: " << strerror(errno) << std::endl;
+        if (archivo < 0) {
+            abrir_archivo_log();
+        }
+        return false;
+    }
+
+    rotada_hasta = secuencia_estado;
+    std::lock_guard<std::mutex> lock(mutex);
+    desde_instantanea = 0;
+    return true;
+}
+
+bool Bitacora::descartar_rotada() {
+    std::string anterior = ruta("bitacora.anterior");
+    if (remove(anterior.c_str()) != 0 && existe(anterior)) {
+        std::cerr << "❌ No se pudo borrar " << anterior << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    sincronizar_directorio(dir);
+    return true;
+}
+
+bool Bitacora::hay_rotada() const {
+    return existe(ruta("bitacora.anterior"));
+}
+
+void Bitacora::cerrar() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        detener_hilos = true;
+    }
+    hay_pendientes.notify_all();
+    pedir_instantanea.notify_all();
+    if (hilo_commit.joinable()) hilo_commit.join();
+    if (hilo_instantanea.joinable()) hilo_instantanea.join();
+
+    std::lock_guard<std::mutex> lock_archivo(mutex_archivo);
+    if (archivo >= 0) {
+        volcar();
+        CERRAR(archivo);
+        archivo = -1;
+    }
+}
\ No newline at end of file
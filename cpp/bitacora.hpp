@@ -0,0 +1,157 @@
+#ifndef BITACORA_HPP
+#define BITACORA_HPP
+
+#include "tabla_placas.hpp"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+// Registro binario de la bitácora: 32 bytes en disco
+struct RegistroBitacora {
+    uint64_t secuencia;
+    PlacaCompacta placa;
+    int64_t hora;         // ENTRADA: hora de entrada; SALIDA: hora de salida
+    int32_t espacio;
+    uint8_t operacion;    // OperacionBitacora
+    uint8_t tipo;         // TipoVehiculo
+    uint16_t suma;        // Suma de verificación de los 30 bytes anteriores
+};
+static_assert(sizeof(RegistroBitacora) == 32, "RegistroBitacora debe medir 32 bytes");
+
+enum class OperacionBitacora : uint8_t {
+    ENTRADA = 1,
+    SALIDA = 2
+};
+
+struct OpcionesBitacora {
+    // true: registrar_entrada/salida no retorna hasta que el evento está en
+    // disco (fsync agrupado). false: se escribe en segundo plano.
+    bool esperar_fsync;
+    // Espera máxima antes de escribir un lote aunque nadie lo pida
+    int intervalo_commit_ms;
+    // Cada cuántos registros se toma una instantánea y se descarta la
+    // bitácora anterior; 0 desactiva las instantáneas automáticas
+    uint64_t registros_por_instantanea;
+
+    OpcionesBitacora()
+        : esperar_fsync(true), intervalo_commit_ms(5),
+          registros_por_instantanea(100000) {}
+};
+
+// Bitácora de escritura anticipada (write-ahead log) con commit agrupado.
+//
+// anotar() sólo copia el registro a un buffer en memoria; un hilo escribe
+// los lotes acumulados y hace un único fsync por lote, así muchos
+// eventos concurrentes comparten el costo de cada fsync.
+//
+// Archivos en el directorio:
+//   bitacora.log       registros desde la última instantánea
+//   bitacora.anterior  bitacora rotada mientras se escribe una instantánea
+//   ocupacion.map      estado completo (MapaOcupacion), sincronizado a
+//                      disco hasta una secuencia dada
+class Bitacora {
+public:
+    // Llamada (en el hilo de instantáneas) cuando se supera el umbral
+    typedef std::function<void()> FuncionInstantanea;
+
+    Bitacora(const std::string& directorio, const OpcionesBitacora& opciones);
+    ~Bitacora();
+
+    // Leer los registros existentes con secuencia > desde, en orden.
+    // Corta (y recorta el archivo) en el primer registro dañado, que sólo
+    // puede ser una escritura incompleta al final.
+    bool reproducir(uint64_t desde, const std::function<void(const RegistroBitacora&)>& aplicar);
+
+    // Abrir para escribir a continuación de ultima_secuencia
+    bool abrir(uint64_t ultima_secuencia, FuncionInstantanea instantanea);
+
+    // Agregar un registro; retorna su número de secuencia. Debe llamarse
+    // con el lock que ordena las operaciones sobre la misma placa.
+    uint64_t anotar(OperacionBitacora operacion, PlacaCompacta placa,
+                    TipoVehiculo tipo, int espacio, time_t hora);
+
+    // Bloquear hasta que el registro secuencia esté en disco. false si
+    // falló la escritura de su lote: el registro se reintenta con el
+    // siguiente, pero quien espera no debe darlo por guardado.
+    bool esperar_durable(uint64_t secuencia);
+
+    // Escribir y sincronizar todo lo pendiente
+    void sincronizar();
+
+    // Para instantáneas: con el estado congelado, pasar a un archivo nuevo
+    // y retornar la última secuencia incluida en el estado. Falla mientras
+    // quede la bitácora rotada de una instantánea anterior.
+    bool rotar(uint64_t& secuencia_estado);
+    // Tras escribir la instantánea, descartar la bitácora rotada
+    bool descartar_rotada();
+    // Quedó una bitácora rotada de una instantánea que no terminó
+    bool hay_rotada() const;
+    // Secuencia que cubre la bitácora rotada (la del último rotar())
+    uint64_t secuencia_rotada() const { return rotada_hasta.load(); }
+    // La instantánea no llegó a disco: se cuenta con las escrituras fallidas
+    void instantanea_fallida() { fallos++; }
+
+    const std::string& directorio() const { return dir; }
+    bool esperar_fsync() const { return opciones.esperar_fsync; }
+    uint64_t ultima_secuencia() const { return secuencia.load(); }
+    uint64_t lotes_escritos() const { return lotes.load(); }
+    uint64_t registros_escritos() const { return escritos.load(); }
+    // Lotes que no se pudieron escribir e instantáneas que no terminaron
+    uint64_t escrituras_fallidas() const { return fallos.load(); }
+
+    std::string ruta(const char* nombre) const;
+
+private:
+    std::string dir;
+    OpcionesBitacora opciones;
+    int archivo;
+
+    std::mutex mutex;               // Protege pendientes y secuencia
+    std::condition_variable hay_pendientes;
+    std::condition_variable hay_durables;
+    std::vector<RegistroBitacora> pendientes;
+    std::vector<RegistroBitacora> en_escritura;
+    std::atomic<uint64_t> secuencia;
+    uint64_t durable;
+    uint64_t fallida;               // Último registro de un lote que no se pudo escribir
+    uint64_t desde_instantanea;
+    bool detener_hilos;
+    bool instantanea_solicitada;
+
+    std::mutex mutex_archivo;       // Un solo escritor del archivo a la vez
+    long long largo_valido;         // Hasta dónde el archivo tiene registros completos
+    bool bloqueada;                 // No se pudo recortar tras un fallo: no escribir más
+    std::atomic<uint64_t> lotes;
+    std::atomic<uint64_t> escritos;
+    std::atomic<uint64_t> fallos;
+    std::atomic<uint64_t> rotada_hasta;
+
+    FuncionInstantanea funcion_instantanea;
+    std::condition_variable pedir_instantanea;
+    std::thread hilo_commit;
+    std::thread hilo_instantanea;
+
+    void loop_commit();
+    void loop_instantanea();
+    // Escribe y sincroniza lo pendiente (primero lo que falló antes);
+    // requiere mutex_archivo
+    bool volcar();
+    bool abrir_archivo_log();
+    void cerrar();
+};
+
+// Suma de verificación de un registro
+uint16_t suma_registro(const RegistroBitacora& r);
+
+// Escritura y sincronización portables
+bool escribir_todo(int archivo, const void* datos, size_t largo);
+bool sincronizar_archivo(int archivo);
+bool sincronizar_directorio(const std::string& directorio);
+
+
+#endif
\ No newline at end of file
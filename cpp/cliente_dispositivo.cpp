@@ -1,8 +1,12 @@
 #include "cpp/socket_utils.hpp"
+#include "cpp/protocolo.hpp"
+#include "cpp/generador_carga.hpp"
+#include "cpp/cola_offline.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <vector>
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
 
@@ -14,12 +18,31 @@
     #define SLEEP(ms) usleep((ms) * 1000)
 #endif
 
+// Un servidor que no responde en este tiempo se da por caído: el evento
+// queda en la cola y se reenvía después
+static const int TIMEOUT_RESPUESTA_MS = 5000;
+
+// Tope de un lote SINC al vaciar la cola, en eventos y en bytes (el
+// servidor corta conexiones con más de 64 KB sin procesar), y hasta
+// cuántos eventos nuevos se muestran uno por uno
+static const size_t MAX_LOTE_SINC = 2048;
+static const size_t MAX_BYTES_LOTE_SINC = 32 * 1024;
+static const size_t MAX_DETALLE = 32;
+
 class DispositivoSimulador {
 private:
     std::string id_dispositivo;
     std::string servidor_ip;
     int servidor_puerto;
     std::vector<std::string> placas_disponibles;
+
+    // Conexión persistente (modo enmarcado)
+    bool persistente;
+    socket_t sock;
+    std::string pendiente; // Bytes recibidos aún sin respuesta completa
+
+    // Eventos sin respuesta del servidor, en disco (sólo modo enmarcado)
+    ColaOffline cola;
     
     std::string generar_placa_aleatoria() {
         if (placas_disponibles.empty()) {
@@ -39,20 +62,21 @@ private:
     std::string generar_tipo_aleatorio() {
         return (rand() % 2 == 0) ? "carro" : "moto";
     }
-    
-    bool enviar_evento(const std::string& tipo, const std::string& placa, 
-                       const std::string& tipo_vehiculo) {
-        if (!inicializar_sockets()) {
-            std::cerr << "❌ Error al inicializar sockets" << std::endl;
-            return false;
-        }
-        
+
+    std::string construir_mensaje(const std::string& tipo, const std::string& placa,
+                                  const std::string& tipo_vehiculo) {
+        // Construir mensaje: TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO
+        std::stringstream ss;
+        ss << tipo << "|" << placa << "|" << tipo_vehiculo << "|" << id_dispositivo;
+        return ss.str();
+    }
+
+    socket_t conectar() {
         // Crear socket
-        socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (sock == INVALID_SOCKET) {
+        socket_t nuevo = socket(AF_INET, SOCK_STREAM, 0);
+        if (nuevo == INVALID_SOCKET) {
             std::cerr << "❌ Error al crear socket: " << obtener_error_socket() << std::endl;
-            limpiar_sockets();
-            return false;
+            return INVALID_SOCKET;
         }
         
         // Configurar dirección del servidor
@@ -66,50 +90,306 @@ private:
 #else
         if (inet_pton(AF_INET, servidor_ip.c_str(), &serv_addr.sin_addr) <= 0) {
             std::cerr << "❌ Dirección IP inválida" << std::endl;
-            CLOSE_SOCKET(sock);
-            limpiar_sockets();
-            return false;
+            CLOSE_SOCKET(nuevo);
+            return INVALID_SOCKET;
         }
 #endif
         
         // Conectar al servidor
-        if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == SOCKET_ERROR) {
+        if (connect(nuevo, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == SOCKET_ERROR) {
             std::cerr << "❌ Error al conectar: " << obtener_error_socket() << std::endl;
-            CLOSE_SOCKET(sock);
-            limpiar_sockets();
-            return false;
+            CLOSE_SOCKET(nuevo);
+            return INVALID_SOCKET;
         }
+
+        // Un servidor colgado no debe trabar al dispositivo
+#ifdef _WIN32
+        DWORD limite_ms = TIMEOUT_RESPUESTA_MS;
+        setsockopt(nuevo, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite_ms, sizeof(limite_ms));
+        setsockopt(nuevo, SOL_SOCKET, SO_SNDTIMEO, (const char*)&limite_ms, sizeof(limite_ms));
+#else
+        struct timeval limite;
+        limite.tv_sec = TIMEOUT_RESPUESTA_MS / 1000;
+        limite.tv_usec = (TIMEOUT_RESPUESTA_MS % 1000) * 1000;
+        setsockopt(nuevo, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite, sizeof(limite));
+        setsockopt(nuevo, SOL_SOCKET, SO_SNDTIMEO, (const char*)&limite, sizeof(limite));
+#endif
         
         std::cout << "✅ Conectado al servidor" << std::endl;
-        
-        // Construir mensaje: TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO
-        std::stringstream ss;
-        ss << tipo << "|" << placa << "|" << tipo_vehiculo << "|" << id_dispositivo;
-        std::string mensaje = ss.str();
+        return nuevo;
+    }
+
+    bool enviar_todo(socket_t s, const std::string& datos) {
+        size_t total = 0;
+        while (total < datos.length()) {
+            int enviados = send(s, datos.c_str() + total, (int)(datos.length() - total), 0);
+            if (enviados <= 0) {
+                return false;
+            }
+            total += enviados;
+        }
+        return true;
+    }
+
+    // Leer una respuesta terminada en '\n' de la conexión persistente
+    bool recibir_linea(std::string& linea) {
+        char buffer[1024];
+        size_t fin;
+        while ((fin = pendiente.find(PROTOCOLO_FIN_MENSAJE)) == std::string::npos) {
+            int bytes = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes <= 0) {
+                return false;
+            }
+            pendiente.append(buffer, bytes);
+        }
+        linea = pendiente.substr(0, fin);
+        pendiente.erase(0, fin + 1);
+        return true;
+    }
+
+    void cerrar_conexion() {
+        if (sock != INVALID_SOCKET) {
+            CLOSE_SOCKET(sock);
+            sock = INVALID_SOCKET;
+        }
+        pendiente.clear();
+    }
+
+    // Abrir la conexión persistente y negociar el modo enmarcado.
+    // Si el servidor no lo soporta se pasa al modo clásico.
+    bool asegurar_conexion() {
+        if (sock != INVALID_SOCKET) {
+            return true;
+        }
+        sock = conectar();
+        if (sock == INVALID_SOCKET) {
+            return false;
+        }
+
+        std::string respuesta;
+        if (!enviar_todo(sock, PROTOCOLO_SALUDO) || !recibir_linea(respuesta) ||
+            respuesta + PROTOCOLO_FIN_MENSAJE != PROTOCOLO_SALUDO_OK) {
+            std::cout << "⚠️  Servidor sin modo enmarcado, usando modo clásico" << std::endl;
+            cerrar_conexion();
+            persistente = false;
+            return false;
+        }
+        return true;
+    }
+
+    // Modo clásico: una conexión por evento
+    bool enviar_evento_clasico(const std::string& mensaje) {
+        socket_t s = conectar();
+        if (s == INVALID_SOCKET) {
+            return false;
+        }
         
         // Enviar mensaje
-        send(sock, mensaje.c_str(), mensaje.length(), 0);
+        send(s, mensaje.c_str(), mensaje.length(), 0);
         std::cout << "📤 Enviado: " << mensaje << std::endl;
         
         // Recibir respuesta
         char buffer[1024] = {0};
-        int bytes = recv(sock, buffer, sizeof(buffer) - 1, 0);
+        int bytes = recv(s, buffer, sizeof(buffer) - 1, 0);
         
         if (bytes > 0) {
             buffer[bytes] = '\0';
             std::cout << "📥 Respuesta: " << buffer << std::endl;
         }
         
-        CLOSE_SOCKET(sock);
-        limpiar_sockets();
-        
+        CLOSE_SOCKET(s);
         return true;
     }
 
+    // Enviar varios mensajes seguidos por la conexión persistente y
+    // luego leer las respuestas, que llegan en el mismo orden
+    bool enviar_pipeline(const std::vector<std::string>& mensajes) {
+        for (int intento = 0; intento < 2; intento++) {
+            if (!persistente || !asegurar_conexion()) {
+                break;
+            }
+
+            std::string lote;
+            for (size_t i = 0; i < mensajes.size(); i++) {
+                lote += mensajes[i];
+                lote += PROTOCOLO_FIN_MENSAJE;
+            }
+
+            if (!enviar_todo(sock, lote)) {
+                // Conexión caída: reconectar y reintentar una vez
+                cerrar_conexion();
+                continue;
+            }
+            for (size_t i = 0; i < mensajes.size(); i++) {
+                std::cout << "📤 Enviado: " << mensajes[i] << std::endl;
+            }
+
+            for (size_t i = 0; i < mensajes.size(); i++) {
+                std::string respuesta;
+                if (!recibir_linea(respuesta)) {
+                    std::cerr << "❌ Conexión cerrada por el servidor" << std::endl;
+                    cerrar_conexion();
+                    return false;
+                }
+                std::cout << "📥 Respuesta: " << respuesta << std::endl;
+            }
+            return true;
+        }
+
+        if (persistente) {
+            return false;
+        }
+        bool ok = true;
+        for (size_t i = 0; i < mensajes.size(); i++) {
+            ok = enviar_evento_clasico(mensajes[i]) && ok;
+        }
+        return ok;
+    }
+    
+    // Subir la cola en lotes SINC (una escritura por lote); cada lote se
+    // confirma con sus respuestas. Retorna false si quedó algo pendiente.
+    bool subir_pendientes(bool detallar) {
+        std::vector<EventoEncolado> lote;
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        size_t total = 0, aceptados = 0;
+        int fallos = 0;
+        while (cola.tamano() > 0) {
+            if (!persistente || !asegurar_conexion()) {
+                if (persistente) {
+                    return false;
+                }
+                // Servidor sin modo enmarcado: uno por conexión, sin SINC
+                uint64_t secuencia = cola.pendientes(1, lote);
+                if (!enviar_evento_clasico(lote[0].mensaje)) {
+                    return false;
+                }
+                cola.confirmar(secuencia);
+                continue;
+            }
+
+            uint64_t primera = cola.pendientes(MAX_LOTE_SINC, lote);
+            std::string mensajes;
+            size_t n = 0;
+            for (; n < lote.size() && mensajes.size() < MAX_BYTES_LOTE_SINC; n++) {
+                // Con la hora de la lectura: puede llevar horas en la cola
+                mensajes += std::to_string(lote[n].hora);
+                mensajes += PROTOCOLO_SEPARADOR;
+                mensajes += lote[n].mensaje;
+                mensajes += PROTOCOLO_FIN_MENSAJE;
+            }
+            lote.resize(n);
+            std::stringstream cabecera;
+            cabecera << PROTOCOLO_SINC << id_dispositivo << PROTOCOLO_SEPARADOR << primera
+                     << PROTOCOLO_SEPARADOR << n << PROTOCOLO_FIN_MENSAJE;
+            std::string respuesta;
+            if (!enviar_todo(sock, cabecera.str() + mensajes) || !recibir_linea(respuesta)) {
+                // Quizás el servidor cerró la conexión inactiva: reconectar
+                // y reintentar una vez (lo ya aplicado se descarta allá)
+                cerrar_conexion();
+                if (++fallos > 1) {
+                    return false;
+                }
+                continue;
+            }
+            if (respuesta.compare(0, 4, "OK: ") != 0) {
+                // Los mensajes igual se procesan, pero sin descartar duplicados
+                std::cout << "⚠️  El servidor no acepta SINC: " << respuesta << std::endl;
+            }
+
+            size_t respondidos = 0;
+            for (; respondidos < lote.size(); respondidos++) {
+                if (!recibir_linea(respuesta)) {
+                    break;
+                }
+                if (detallar) {
+                    std::cout << "📤 Enviado: " << lote[respondidos].mensaje << std::endl;
+                    std::cout << "📥 Respuesta: " << respuesta << std::endl;
+                }
+                aceptados += respuesta.compare(0, 4, "OK: ") == 0;
+            }
+            if (respondidos > 0) {
+                cola.confirmar(primera + respondidos - 1);
+                total += respondidos;
+            }
+            if (respondidos < lote.size()) {
+                std::cerr << "❌ Conexión cerrada por el servidor" << std::endl;
+                cerrar_conexion();
+                if (++fallos > 1) {
+                    return false;
+                }
+            }
+        }
+
+        if (!detallar && total > 0) {
+            double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - inicio).count();
+            std::cout << "🔄 " << total << " eventos sincronizados en " << ms << " ms ("
+                      << aceptados << " OK, " << total - aceptados << " rechazados)" << std::endl;
+        }
+        return true;
+    }
+
+    // Guardar los eventos en la cola (una escritura a disco para todos) y
+    // subir todo lo pendiente. Si el servidor no está, quedan guardados.
+    bool enviar_mensajes(const std::vector<std::string>& mensajes) {
+        if (!cola.abierta()) {
+            return enviar_pipeline(mensajes);
+        }
+        uint64_t previos = cola.tamano();
+        uint64_t perdidos = cola.perdidos();
+        int64_t hora = (int64_t)time(nullptr);
+        for (size_t i = 0; i < mensajes.size(); i++) {
+            if (cola.encolar(mensajes[i], hora) == 0) {
+                std::cerr << "⚠️  No se pudo guardar en la cola, se envía directo" << std::endl;
+                enviar_pipeline(std::vector<std::string>(1, mensajes[i]));
+            }
+        }
+        cola.sincronizar();
+        if (cola.perdidos() > perdidos) {
+            std::cerr << "⚠️  Cola llena: " << cola.perdidos() - perdidos
+                      << " eventos viejos descartados" << std::endl;
+        }
+
+        if (previos > 0) {
+            std::cout << "📦 Reenviando " << previos << " eventos guardados..." << std::endl;
+        }
+        if (!subir_pendientes(previos == 0 && mensajes.size() <= MAX_DETALLE)) {
+            std::cout << "📦 Servidor no disponible: " << cola.tamano() << " eventos en "
+                      << cola.ruta() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool enviar_evento(const std::string& tipo, const std::string& placa, 
+                       const std::string& tipo_vehiculo) {
+        std::vector<std::string> mensajes(1, construir_mensaje(tipo, placa, tipo_vehiculo));
+        return enviar_mensajes(mensajes);
+    }
+
 public:
+    // En modo enmarcado los eventos pasan por una cola en disco
+    // (ruta_cola, por defecto cola_<id>.pq) y nunca se pierden por un
+    // corte del servidor; se reenvían al reconectar.
     DispositivoSimulador(const std::string& id, const std::string& ip = "127.0.0.1", 
-                         int puerto = 8080)
-        : id_dispositivo(id), servidor_ip(ip), servidor_puerto(puerto) {
+                         int puerto = 8080, bool persistente = true,
+                         const std::string& ruta_cola = "")
+        : id_dispositivo(id), servidor_ip(ip), servidor_puerto(puerto),
+          persistente(persistente), sock(INVALID_SOCKET) {
+        
+        if (!inicializar_sockets()) {
+            std::cerr << "❌ Error al inicializar sockets" << std::endl;
+        }
+
+        if (persistente) {
+            if (!cola.abrir(ruta_cola.empty() ? "cola_" + id + ".pq" : ruta_cola)) {
+                std::cerr << "⚠️  Sin cola en disco: los eventos se pierden si el servidor cae"
+                          << std::endl;
+            } else if (cola.tamano() > 0) {
+                std::cout << "📦 " << cola.tamano() << " eventos pendientes en "
+                          << cola.ruta() << std::endl;
+            }
+        }
         
         // Placas predefinidas para simulación
         placas_disponibles = {
@@ -119,6 +399,11 @@ public:
         
         srand(time(nullptr));
     }
+
+    ~DispositivoSimulador() {
+        cerrar_conexion();
+        limpiar_sockets();
+    }
     
     void simular_entrada() {
         std::string placa = generar_placa_aleatoria();
@@ -164,6 +449,40 @@ public:
         
         std::cout << "\n✅ Simulación completada" << std::endl;
     }
+
+    // Enviar num_eventos seguidos por una sola conexión sin esperar respuestas
+    void simular_rafaga(int num_eventos = 10) {
+        std::cout << "⚡ Ráfaga de " << num_eventos << " eventos hacia "
+                  << servidor_ip << ":" << servidor_puerto << std::endl;
+
+        std::vector<std::string> mensajes;
+        for (int i = 0; i < num_eventos; i++) {
+            if (rand() % 100 < 60) {
+                mensajes.push_back(construir_mensaje("ENTRADA", generar_placa_aleatoria(),
+                                                     generar_tipo_aleatorio()));
+            } else {
+                mensajes.push_back(construir_mensaje("SALIDA", generar_placa_aleatoria(), ""));
+            }
+        }
+        enviar_mensajes(mensajes);
+
+        std::cout << "\n✅ Ráfaga completada" << std::endl;
+    }
+
+    // Subir lo que quedó en la cola de una ejecución anterior
+    bool sincronizar_pendientes() {
+        if (!cola.abierta() || cola.tamano() == 0) {
+            std::cout << "✅ Sin eventos pendientes" << std::endl;
+            return true;
+        }
+        std::cout << "📦 Reenviando " << cola.tamano() << " eventos guardados..." << std::endl;
+        if (!subir_pendientes(false)) {
+            std::cout << "📦 Servidor no disponible: " << cola.tamano() << " eventos en "
+                      << cola.ruta() << std::endl;
+            return false;
+        }
+        return true;
+    }
     
     void modo_interactivo() {
         std::cout << "\n🎮 Modo Interactivo - Simulador de Dispositivo" << std::endl;
@@ -206,7 +525,33 @@ public:
     }
 };
 
+// Modo benchmark: cliente_dispositivo bench --threads N --conns M --rate R --duration S
+static int ejecutar_bench(int argc, char* argv[]) {
+    OpcionesCarga opciones;
+    if (!parsear_opciones_carga(argc, argv, opciones)) {
+        std::cerr << "Uso: cliente_dispositivo bench [--threads N] [--conns M] [--rate R]\n"
+                  << "       [--duration S] [--pipeline P] [--trace archivo] [--speed X]\n"
+                  << "       [--record archivo] [--host IP] [--port P] [--device ID]" << std::endl;
+        return 1;
+    }
+    if (!inicializar_sockets()) {
+        std::cerr << "❌ Error al inicializar sockets" << std::endl;
+        return 1;
+    }
+
+    std::cout << "⚡ Generando carga hacia " << opciones.host << ":" << opciones.puerto << "..." << std::endl;
+    ResultadoCarga resultado = ejecutar_carga(opciones);
+    imprimir_resultado(opciones, resultado);
+
+    limpiar_sockets();
+    return resultado.respuestas > 0 ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        return ejecutar_bench(argc - 1, argv + 1);
+    }
+
     std::string id_dispositivo = "CAMARA-01";
     std::string servidor_ip = "127.0.0.1";
     int servidor_puerto = 8080;
@@ -216,7 +561,10 @@ int main(int argc, char* argv[]) {
     if (argc > 2) servidor_ip = argv[2];
     if (argc > 3) servidor_puerto = std::atoi(argv[3]);
     
-    DispositivoSimulador dispositivo(id_dispositivo, servidor_ip, servidor_puerto);
+    // "clasico" fuerza una conexión por evento (servidores antiguos)
+    bool persistente = !(argc > 6 && std::string(argv[6]) == "clasico");
+    
+    DispositivoSimulador dispositivo(id_dispositivo, servidor_ip, servidor_puerto, persistente);
     
     std::cout << "╔════════════════════════════════════════╗" << std::endl;
     std::cout << "║  Simulador de Dispositivo IoT          ║" << std::endl;
@@ -227,6 +575,11 @@ int main(int argc, char* argv[]) {
     if (argc > 4 && std::string(argv[4]) == "auto") {
         int num_eventos = (argc > 5) ? std::atoi(argv[5]) : 10;
         dispositivo.simular_trafico(num_eventos, 2000);
+    } else if (argc > 4 && std::string(argv[4]) == "rafaga") {
+        int num_eventos = (argc > 5) ? std::atoi(argv[5]) : 10;
+        dispositivo.simular_rafaga(num_eventos);
+    } else if (argc > 4 && std::string(argv[4]) == "sincronizar") {
+        return dispositivo.sincronizar_pendientes() ? 0 : 1;
     } else {
         dispositivo.modo_interactivo();
     }
@@ -0,0 +1,108 @@
+#ifndef COLA_EVENTOS_HPP
+#define COLA_EVENTOS_HPP
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Cola acotada sin locks para varios productores y consumidores
+// (algoritmo de D. Vyukov). Cada celda lleva un número de secuencia
+// que indica si está libre para escribir o lista para leer.
+template <typename T>
+class ColaEventos {
+private:
+    struct Celda {
+        std::atomic<size_t> secuencia;
+        T dato;
+    };
+
+    // Relleno para separar índices en líneas de caché distintas
+    // (sin alignas: C++11 no garantiza new alineado a 64)
+    std::atomic<size_t> pos_escritura;
+    char relleno_escritura[64];
+    std::atomic<size_t> pos_lectura;
+    char relleno_lectura[64];
+    std::atomic<size_t> descartados;
+    std::vector<Celda> celdas;
+    size_t mascara;
+
+public:
+    // capacidad se redondea a la siguiente potencia de dos
+    explicit ColaEventos(size_t capacidad)
+        : pos_escritura(0), pos_lectura(0), descartados(0) {
+        size_t tam = 2;
+        while (tam < capacidad) tam <<= 1;
+        celdas = std::vector<Celda>(tam);
+        mascara = tam - 1;
+        for (size_t i = 0; i < tam; i++) {
+            celdas[i].secuencia.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Retorna false (y cuenta el descarte) si la cola está llena
+    bool encolar(const T& dato) {
+        size_t pos = pos_escritura.load(std::memory_order_relaxed);
+        while (true) {
+            Celda& celda = celdas[pos & mascara];
+            size_t sec = celda.secuencia.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)sec - (intptr_t)pos;
+            if (dif == 0) {
+                if (pos_escritura.compare_exchange_weak(pos, pos + 1,
+                                                        std::memory_order_relaxed)) {
+                    celda.dato = dato;
+                    celda.secuencia.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                descartados.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = pos_escritura.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool desencolar(T& dato) {
+        size_t pos = pos_lectura.load(std::memory_order_relaxed);
+        while (true) {
+            Celda& celda = celdas[pos & mascara];
+            size_t sec = celda.secuencia.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)sec - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (pos_lectura.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    dato = celda.dato;
+                    celda.secuencia.store(pos + mascara + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = pos_lectura.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Extraer hasta max_n elementos; retorna cuántos se agregaron a destino
+    size_t desencolar_lote(std::vector<T>& destino, size_t max_n) {
+        size_t n = 0;
+        T dato;
+        while (n < max_n && desencolar(dato)) {
+            destino.push_back(dato);
+            n++;
+        }
+        return n;
+    }
+
+    size_t tamano_aproximado() const {
+        size_t e = pos_escritura.load(std::memory_order_relaxed);
+        size_t l = pos_lectura.load(std::memory_order_relaxed);
+        return e > l ? e - l : 0;
+    }
+
+    size_t capacidad() const { return mascara + 1; }
+    size_t total_descartados() const { return descartados.load(std::memory_order_relaxed); }
+};
+
+#endif
\ No newline at end of file
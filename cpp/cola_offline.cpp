@@ -0,0 +1,216 @@
+#include "cola_offline.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define ABRIR(ruta, flags) _open((ruta), (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define LEER _read
+    #define ESCRIBIR _write
+    #define CERRAR _close
+    #define RECORTAR _chsize_s
+    #define BUSCAR _lseeki64
+#else
+    #include <unistd.h>
+    #define ABRIR(ruta, flags) open((ruta), (flags), 0644)
+    #define LEER read
+    #define ESCRIBIR write
+    #define CERRAR close
+    #define RECORTAR ftruncate
+    #define BUSCAR lseek
+#endif
+
+static const char MAGIA_COLA[8] = {'P', 'Q', 'C', 'O', 'L', 'A', '0', '2'};
+static const size_t LARGO_CABECERA_COLA = 32;
+
+static bool leer_todo(int archivo, void* datos, size_t largo) {
+    char* p = static_cast<char*>(datos);
+    while (largo > 0) {
+        int n = LEER(archivo, p, (unsigned)largo);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        largo -= n;
+    }
+    return true;
+}
+
+ColaOffline::ColaOffline()
+    : archivo(-1), num_ranuras(0), primera(0), siguiente(0), descartados(0) {}
+
+ColaOffline::~ColaOffline() {
+    cerrar();
+}
+
+void ColaOffline::cerrar() {
+    if (archivo != -1) {
+        CERRAR(archivo);
+        archivo = -1;
+    }
+}
+
+bool ColaOffline::escribir_en(int64_t posicion, const void* datos, size_t largo) {
+    if (BUSCAR(archivo, posicion, SEEK_SET) != posicion) {
+        return false;
+    }
+    const char* p = static_cast<const char*>(datos);
+    while (largo > 0) {
+        int n = ESCRIBIR(archivo, p, (unsigned)largo);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        largo -= n;
+    }
+    return true;
+}
+
+bool ColaOffline::escribir_cabecera() {
+    char cabecera[LARGO_CABECERA_COLA] = {0};
+    memcpy(cabecera, MAGIA_COLA, 8);
+    memcpy(cabecera + 8, &num_ranuras, 4);
+    memcpy(cabecera + 16, &primera, 8);
+    memcpy(cabecera + 24, &siguiente, 8);
+    return escribir_en(0, cabecera, LARGO_CABECERA_COLA);
+}
+
+bool ColaOffline::sincronizar() {
+    if (archivo == -1) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(archivo) == 0;
+#elif defined(__APPLE__)
+    return fsync(archivo) == 0;
+#else
+    return fdatasync(archivo) == 0;
+#endif
+}
+
+bool ColaOffline::abrir(const std::string& ruta, uint32_t capacidad) {
+    cerrar();
+    ruta_archivo = ruta;
+    archivo = ABRIR(ruta.c_str(), O_RDWR | O_CREAT);
+    if (archivo == -1) {
+        std::cerr << "❌ No se pudo abrir la cola " << ruta << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    char cabecera[LARGO_CABECERA_COLA] = {0};
+    if (fstat(archivo, &info) != 0) {
+        cerrar();
+        return false;
+    }
+    if (info.st_size < (long long)LARGO_CABECERA_COLA) {
+        // Cola nueva: numerar desde la hora actual (ver cola_offline.hpp)
+        num_ranuras = capacidad > 0 ? capacidad : 1;
+        primera = siguiente = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        descartados = 0;
+        ranuras.assign((size_t)num_ranuras * LARGO_RANURA, 0);
+        int64_t largo = LARGO_CABECERA_COLA + (int64_t)ranuras.size();
+        if (RECORTAR(archivo, largo) != 0 || !escribir_cabecera() ||
+            !escribir_en(LARGO_CABECERA_COLA, ranuras.data(), ranuras.size()) || !sincronizar()) {
+            std::cerr << "❌ Error al crear la cola " << ruta << std::endl;
+            cerrar();
+            return false;
+        }
+        return true;
+    }
+
+    if (!leer_todo(archivo, cabecera, LARGO_CABECERA_COLA) || memcmp(cabecera, MAGIA_COLA, 6) != 0) {
+        std::cerr << ruta << " no es una cola de eventos" << std::endl;
+        cerrar();
+        return false;
+    }
+    if (memcmp(cabecera, MAGIA_COLA, 8) != 0) {
+        // PQCOLA01 no guardaba la hora de cada evento
+        std::cerr << ruta << ": cola de otra versión; subirla con el cliente anterior"
+                  << std::endl;
+        cerrar();
+        return false;
+    }
+    memcpy(&num_ranuras, cabecera + 8, 4);
+    memcpy(&primera, cabecera + 16, 8);
+    memcpy(&siguiente, cabecera + 24, 8);
+    ranuras.assign((size_t)num_ranuras * LARGO_RANURA, 0);
+    if (num_ranuras == 0 || primera > siguiente ||
+        !leer_todo(archivo, ranuras.data(), ranuras.size())) {
+        std::cerr << ruta << ": cola dañada" << std::endl;
+        cerrar();
+        return false;
+    }
+
+    // Eventos encolados después de la última cabecera escrita: cada ranura
+    // guarda su secuencia, así las de vueltas anteriores no coinciden
+    while (true) {
+        uint64_t secuencia;
+        memcpy(&secuencia, ranura(siguiente), 8);
+        if (secuencia != siguiente) {
+            break;
+        }
+        siguiente++;
+    }
+    descartados = 0;
+    if (siguiente - primera > num_ranuras) {
+        descartados = siguiente - primera - num_ranuras;
+        primera = siguiente - num_ranuras;
+    }
+    return true;
+}
+
+uint64_t ColaOffline::encolar(const std::string& mensaje, int64_t hora) {
+    if (archivo == -1 || mensaje.size() > MAX_MENSAJE) {
+        return 0;
+    }
+    if (siguiente - primera == num_ranuras) {
+        primera++;  // Llena: se pierde el más viejo
+        descartados++;
+    }
+
+    uint64_t secuencia = siguiente;
+    uint16_t largo = (uint16_t)mensaje.size();
+    char* r = ranura(secuencia);
+    memset(r, 0, LARGO_RANURA);
+    memcpy(r, &secuencia, 8);
+    memcpy(r + 8, &hora, 8);
+    memcpy(r + 16, &largo, 2);
+    memcpy(r + 18, mensaje.data(), mensaje.size());
+    int64_t posicion = LARGO_CABECERA_COLA + (int64_t)(secuencia % num_ranuras) * LARGO_RANURA;
+    if (!escribir_en(posicion, r, LARGO_RANURA)) {
+        return 0;
+    }
+    siguiente++;
+    return secuencia;
+}
+
+uint64_t ColaOffline::pendientes(size_t max, std::vector<EventoEncolado>& eventos) const {
+    eventos.clear();
+    for (uint64_t s = primera; s < siguiente && eventos.size() < max; s++) {
+        const char* r = ranura(s);
+        EventoEncolado evento;
+        uint16_t largo;
+        memcpy(&evento.hora, r + 8, 8);
+        memcpy(&largo, r + 16, 2);
+        if (largo > MAX_MENSAJE) {
+            largo = MAX_MENSAJE;
+        }
+        evento.mensaje.assign(r + 18, largo);
+        eventos.push_back(evento);
+    }
+    return primera;
+}
+
+void ColaOffline::confirmar(uint64_t hasta) {
+    if (archivo == -1 || hasta < primera) {
+        return;
+    }
+    primera = hasta < siguiente ? hasta + 1 : siguiente;
+    // Sin sincronizar: si se pierde, se reenvía y el servidor lo descarta
+    escribir_cabecera();
+}
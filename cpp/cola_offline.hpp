@@ -0,0 +1,88 @@
+#ifndef COLA_OFFLINE_HPP
+#define COLA_OFFLINE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Evento guardado en la cola
+struct EventoEncolado {
+    std::string mensaje;
+    int64_t hora;                 // Segundos Unix de la lectura
+};
+
+// Cola de eventos de un dispositivo mientras el servidor no responde
+// (store-and-forward): un anillo de capacidad fija en un archivo, con
+// números de secuencia crecientes que el servidor usa para no aplicar dos
+// veces un evento reenviado (ver SINC en protocolo.hpp).
+//
+// Archivo: cabecera de 32 bytes (magia, capacidad, primera pendiente y
+// siguiente secuencia) y capacidad ranuras de LARGO_RANURA bytes, cada
+// una con su secuencia, la hora de la lectura, el largo y el mensaje. La
+// hora viaja en el lote SINC: el servidor registra el evento cuando
+// ocurrió, no cuando llegó. encolar() escribe sólo la ranura; al abrir,
+// la siguiente secuencia se recupera recorriendo las ranuras escritas
+// después de la que dice la cabecera.
+//
+// Llena, un evento nuevo pisa al más viejo (el dispositivo sigue
+// operando; perdidos() los cuenta). Un archivo nuevo empieza a numerar en
+// la hora actual en milisegundos, así sus secuencias siguen siendo
+// mayores que las que el servidor ya vio aunque se borre el archivo.
+//
+// No es segura entre hilos.
+class ColaOffline {
+public:
+    static const size_t LARGO_RANURA = 128;
+    static const size_t MAX_MENSAJE = LARGO_RANURA - 18;  // Sin secuencia, hora ni largo
+
+    ColaOffline();
+    ~ColaOffline();
+
+    ColaOffline(const ColaOffline&) = delete;
+    ColaOffline& operator=(const ColaOffline&) = delete;
+
+    // Abrir (o crear con capacidad ranuras) y recuperar lo pendiente. Un
+    // archivo existente conserva su capacidad.
+    bool abrir(const std::string& ruta, uint32_t capacidad = 65536);
+    bool abierta() const { return archivo != -1; }
+    void cerrar();
+
+    // Guardar un mensaje leído a la hora dada; retorna su secuencia, o 0
+    // si no cabe en una ranura o no se pudo escribir. Queda en el sistema
+    // operativo: llamar sincronizar() para que sobreviva a un corte de luz.
+    uint64_t encolar(const std::string& mensaje, int64_t hora);
+    bool sincronizar();
+
+    // Hasta max eventos pendientes en orden; retorna la secuencia del
+    // primero (los demás siguen de uno en uno)
+    uint64_t pendientes(size_t max, std::vector<EventoEncolado>& eventos) const;
+
+    // El servidor respondió todo hasta la secuencia hasta (incluida)
+    void confirmar(uint64_t hasta);
+
+    uint64_t tamano() const { return siguiente - primera; }
+    uint64_t perdidos() const { return descartados; }
+    uint32_t capacidad() const { return num_ranuras; }
+    const std::string& ruta() const { return ruta_archivo; }
+
+private:
+    int archivo;
+    std::string ruta_archivo;
+    uint32_t num_ranuras;
+    uint64_t primera;             // Secuencia más vieja sin confirmar
+    uint64_t siguiente;           // La que recibirá el próximo evento
+    uint64_t descartados;
+    std::vector<char> ranuras;    // Copia en memoria de las ranuras
+
+    char* ranura(uint64_t secuencia) {
+        return &ranuras[(size_t)(secuencia % num_ranuras) * LARGO_RANURA];
+    }
+    const char* ranura(uint64_t secuencia) const {
+        return &ranuras[(size_t)(secuencia % num_ranuras) * LARGO_RANURA];
+    }
+    bool escribir_en(int64_t posicion, const void* datos, size_t largo);
+    bool escribir_cabecera();
+};
+
+#endif
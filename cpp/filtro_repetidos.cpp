@@ -0,0 +1,50 @@
+#include "filtro_repetidos.hpp"
+#include "tabla_placas.hpp"
+
+static const int BITS_TIC = 24;
+static const uint64_t MASCARA_TIC = ((uint64_t)1 << BITS_TIC) - 1;
+
+FiltroRepetidos::FiltroRepetidos(int ventana_ms, size_t capacidad)
+    : ventana(ventana_ms > 0 ? ventana_ms : 1), bits_ms_tic(0) {
+    // Tics de una potencia de dos de milisegundos (~ventana/8): la hora en
+    // tics sale con un desplazamiento en vez de una división
+    while (((int64_t)2 << bits_ms_tic) <= ventana / 8) bits_ms_tic++;
+    size_t cubetas = 1;
+    while (cubetas * RANURAS_CUBETA < capacidad) cubetas <<= 1;
+    mascara = cubetas - 1;
+    ranuras.reset(new std::atomic<uint64_t>[cubetas * RANURAS_CUBETA]);
+    for (size_t i = 0; i < cubetas * RANURAS_CUBETA; i++) {
+        ranuras[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool FiltroRepetidos::repetida(const MensajeDispositivo& mensaje, int64_t ahora_ms) {
+    // Dispositivo, operación y placa
+    uint64_t h = hash_texto(mensaje.dispositivo.datos, mensaje.dispositivo.largo);
+    h = hash_placa(mensaje.placa_compacta ^ hash_placa(h ^ (uint64_t)mensaje.operacion));
+
+    uint64_t huella = h >> BITS_TIC;
+    if (huella == 0) huella = 1;             // 0 marca una ranura vacía
+    uint64_t tic = ((uint64_t)ahora_ms >> bits_ms_tic) & MASCARA_TIC;
+    uint64_t nuevo = (huella << BITS_TIC) | tic;
+
+    std::atomic<uint64_t>* cubeta = &ranuras[(h & mascara) * RANURAS_CUBETA];
+    size_t libre = 0;
+    uint64_t edad_libre = 0;
+    for (size_t i = 0; i < RANURAS_CUBETA; i++) {
+        uint64_t valor = cubeta[i].load(std::memory_order_relaxed);
+        uint64_t edad = (tic - (valor & MASCARA_TIC)) & MASCARA_TIC;
+        if (valor == 0) {
+            edad = MASCARA_TIC;
+        } else if ((valor >> BITS_TIC) == huella) {
+            cubeta[i].store(nuevo, std::memory_order_relaxed);
+            return (int64_t)(edad << bits_ms_tic) < ventana;
+        }
+        if (edad >= edad_libre) {
+            libre = i;
+            edad_libre = edad;
+        }
+    }
+    cubeta[libre].store(nuevo, std::memory_order_relaxed);
+    return false;
+}
@@ -0,0 +1,49 @@
+#ifndef FILTRO_REPETIDOS_HPP
+#define FILTRO_REPETIDOS_HPP
+
+#include "protocolo.hpp"
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Descarta lecturas repetidas de las cámaras: la misma (dispositivo,
+// placa, operación) otra vez dentro de la ventana. Las cámaras LPR suelen
+// reportar una placa 2 a 5 veces en un par de segundos, y cada repetición
+// cruzaría todo el camino para fallar en el parqueadero ("ya está").
+//
+// Memoria fija: cubetas de 4 ranuras de 64 bits, cada una con una huella
+// de la clave (40 bits) y la hora en tics de ~ventana/8 (24 bits). Una
+// clave nueva ocupa una ranura vacía o vencida y, si no hay, la más vieja:
+// con más claves vivas que ranuras se olvidan las más antiguas (dejan
+// pasar una repetición, nunca descartan una lectura nueva salvo colisión
+// de huellas, ~1 en 2^40).
+//
+// Seguro entre hilos sin locks (cargas y escrituras relajadas); dos hilos
+// con la misma clave en el mismo instante pueden dejar pasar las dos.
+class FiltroRepetidos {
+public:
+    // ventana_ms > 0; capacidad en claves, redondeada a potencia de dos
+    FiltroRepetidos(int ventana_ms, size_t capacidad);
+
+    FiltroRepetidos(const FiltroRepetidos&) = delete;
+    FiltroRepetidos& operator=(const FiltroRepetidos&) = delete;
+
+    // true si la clave del mensaje pasó hace menos de la ventana; renueva
+    // su hora, así una cámara que sigue reportando sigue filtrada. Si no,
+    // la registra y retorna false. ahora_ms de un reloj monótono.
+    bool repetida(const MensajeDispositivo& mensaje, int64_t ahora_ms);
+
+    int ventana_ms() const { return ventana; }
+    size_t capacidad() const { return (mascara + 1) * RANURAS_CUBETA; }
+
+private:
+    static const size_t RANURAS_CUBETA = 4;  // 32 bytes: media línea de caché
+
+    int ventana;
+    int bits_ms_tic;                         // Un tic son 2^bits_ms_tic ms
+    size_t mascara;                          // Cubetas - 1
+    std::unique_ptr<std::atomic<uint64_t>[]> ranuras;
+};
+
+#endif
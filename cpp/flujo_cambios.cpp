@@ -0,0 +1,61 @@
+#include "flujo_cambios.hpp"
+#include <chrono>
+
+FlujoCambios::FlujoCambios(size_t capacidad)
+    : ultima(0), creado((int64_t)time(nullptr)), lectores_esperando(0) {
+    size_t tam = 2;
+    while (tam < capacidad) tam <<= 1;
+    anillo.resize(tam);
+    mascara = tam - 1;
+}
+
+uint64_t FlujoCambios::publicar(TipoCambio tipo, PlacaCompacta placa, TipoVehiculo tipo_vehiculo,
+                                int espacio, time_t hora) {
+    bool despertar;
+    uint64_t secuencia;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        secuencia = ultima.load(std::memory_order_relaxed) + 1;
+        CambioOcupacion& c = anillo[secuencia & mascara];
+        c.secuencia = secuencia;
+        c.placa = placa;
+        c.hora = (int64_t)hora;
+        c.espacio = espacio;
+        c.tipo = (uint8_t)tipo;
+        c.tipo_vehiculo = (uint8_t)tipo_vehiculo;
+        c.relleno[0] = c.relleno[1] = 0;
+        ultima.store(secuencia, std::memory_order_release);
+        despertar = lectores_esperando > 0;
+    }
+    if (despertar) {
+        hay_cambios.notify_all();
+    }
+    return secuencia;
+}
+
+bool FlujoCambios::leer(uint64_t desde, std::vector<CambioOcupacion>& destino, size_t max_n,
+                        int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t fin = ultima.load(std::memory_order_relaxed);
+    if (fin == desde && timeout_ms > 0) {
+        lectores_esperando++;
+        hay_cambios.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, desde] {
+            return ultima.load(std::memory_order_relaxed) != desde;
+        });
+        lectores_esperando--;
+        fin = ultima.load(std::memory_order_relaxed);
+    }
+
+    uint64_t primera = fin > anillo.size() ? fin - anillo.size() + 1 : 1;
+    if (desde > fin || desde + 1 < primera) {
+        return false;
+    }
+    if (fin - desde > max_n) {
+        fin = desde + max_n;
+    }
+    destino.reserve(destino.size() + (size_t)(fin - desde));
+    for (uint64_t s = desde + 1; s <= fin; s++) {
+        destino.push_back(anillo[s & mascara]);
+    }
+    return true;
+}
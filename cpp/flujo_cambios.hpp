@@ -0,0 +1,76 @@
+#ifndef FLUJO_CAMBIOS_HPP
+#define FLUJO_CAMBIOS_HPP
+
+#include "tabla_placas.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+
+enum class TipoCambio : uint8_t {
+    ENTRADA = 0,
+    SALIDA = 1
+};
+
+// Un cambio de ocupación. Aplicarlo es idempotente (ENTRADA pone la placa
+// en su espacio, SALIDA la quita), así que repetir cambios ya vistos no
+// daña el estado de un suscriptor.
+struct CambioOcupacion {
+    uint64_t secuencia;   // Desde 1, sin huecos
+    PlacaCompacta placa;
+    int64_t hora;         // Entrada o salida (segundos Unix)
+    int32_t espacio;
+    uint8_t tipo;         // TipoCambio
+    uint8_t tipo_vehiculo;
+    uint8_t relleno[2];
+};
+static_assert(sizeof(CambioOcupacion) == 32, "CambioOcupacion debe medir 32 bytes");
+
+// Historial acotado de los últimos cambios de un parqueadero, numerados
+// en orden. Los suscriptores (tableros, réplicas) leen desde la última
+// secuencia que vieron en vez de pedir el estado completo cada tanto; si
+// esa secuencia ya salió del anillo deben recargar una foto.
+//
+// Publicar toma un mutex corto y sólo despierta a alguien si hay lectores
+// esperando: el costo sobre entrada/salida es una copia de 32 bytes.
+class FlujoCambios {
+public:
+    // capacidad se redondea a la siguiente potencia de dos
+    explicit FlujoCambios(size_t capacidad);
+
+    FlujoCambios(const FlujoCambios&) = delete;
+    FlujoCambios& operator=(const FlujoCambios&) = delete;
+
+    // Retorna la secuencia asignada. Llamar bajo el lock de la placa para
+    // que sus cambios queden en el mismo orden que las operaciones.
+    uint64_t publicar(TipoCambio tipo, PlacaCompacta placa, TipoVehiculo tipo_vehiculo,
+                      int espacio, time_t hora);
+
+    // Agrega a destino hasta max_n cambios con secuencia > desde; si no hay
+    // ninguno espera hasta timeout_ms. false si se perdieron cambios (desde
+    // ya salió del historial o es posterior a la última secuencia): el
+    // suscriptor debe recargar el estado y seguir desde ultima_secuencia()
+    // leída antes de la foto.
+    bool leer(uint64_t desde, std::vector<CambioOcupacion>& destino, size_t max_n,
+              int timeout_ms);
+
+    uint64_t ultima_secuencia() const { return ultima.load(std::memory_order_acquire); }
+    // Hora de creación: distingue las secuencias de este flujo de las de
+    // uno anterior (p. ej. antes de reiniciar el proceso)
+    int64_t epoca() const { return creado; }
+    size_t capacidad() const { return anillo.size(); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable hay_cambios;
+    std::vector<CambioOcupacion> anillo;
+    size_t mascara;
+    std::atomic<uint64_t> ultima;
+    const int64_t creado;
+    int lectores_esperando;      // Protegido por mutex
+};
+
+#endif
@@ -0,0 +1,601 @@
+#include "generador_carga.hpp"
+#include "socket_utils.hpp"
+#include "protocolo.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+    #define poll WSAPoll
+    #define ERROR_BLOQUEO(e) ((e) == WSAEWOULDBLOCK)
+#else
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <netinet/tcp.h>
+    #define ERROR_BLOQUEO(e) ((e) == EAGAIN || (e) == EWOULDBLOCK || (e) == EINTR)
+#endif
+
+typedef std::chrono::steady_clock Reloj;
+
+// Tiempo máximo esperando respuestas pendientes al terminar
+static const double ESPERA_FINAL_S = 5.0;
+
+static uint64_t ns_desde(Reloj::time_point inicio, Reloj::time_point t) {
+    if (t <= inicio) {
+        return 0;
+    }
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t - inicio).count();
+}
+
+static Reloj::time_point mas_ns(Reloj::time_point t, double ns) {
+    return t + std::chrono::duration_cast<Reloj::duration>(std::chrono::duration<double, std::nano>(ns));
+}
+
+// Conexión enmarcada de un dispositivo simulado
+struct ConexionCarga {
+    socket_t sock;
+    int indice;                          // Global, entre todas las conexiones
+    std::string entrada;                 // Bytes recibidos sin respuesta completa
+    std::string salida;                  // Bytes por enviar
+    size_t enviados_salida;
+    std::deque<Reloj::time_point> en_vuelo; // Hora de referencia de cada mensaje
+
+    // Carga sintética
+    uint64_t secuencia;
+    std::vector<std::string> dentro;     // Placas que entraron y no han salido
+    double intervalo_ns;                 // Lazo abierto: tiempo entre envíos
+    Reloj::time_point proximo;
+
+    // Traza
+    std::vector<const EventoTraza*> traza;
+    size_t siguiente;
+
+    bool cerrada;
+
+    ConexionCarga()
+        : sock(INVALID_SOCKET), indice(0), enviados_salida(0), secuencia(0),
+          intervalo_ns(0.0), siguiente(0), cerrada(false) {}
+};
+
+static socket_t conectar_carga(const OpcionesCarga& opciones) {
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(opciones.puerto);
+#ifdef _WIN32
+    serv_addr.sin_addr.s_addr = inet_addr(opciones.host.c_str());
+#else
+    if (inet_pton(AF_INET, opciones.host.c_str(), &serv_addr.sin_addr) <= 0) {
+        CLOSE_SOCKET(s);
+        return INVALID_SOCKET;
+    }
+#endif
+    if (connect(s, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == SOCKET_ERROR) {
+        CLOSE_SOCKET(s);
+        return INVALID_SOCKET;
+    }
+
+    // Mensajes pequeños: sin Nagle para no inflar la latencia
+    int uno = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&uno, sizeof(uno));
+
+    // Saludo del modo enmarcado (bloqueante, antes de medir)
+    const size_t largo_saludo = sizeof(PROTOCOLO_SALUDO) - 1;
+    if (send(s, PROTOCOLO_SALUDO, (int)largo_saludo, 0) != (int)largo_saludo) {
+        CLOSE_SOCKET(s);
+        return INVALID_SOCKET;
+    }
+    std::string respuesta;
+    char c;
+    while (respuesta.size() < 64) {
+        if (recv(s, &c, 1, 0) != 1) {
+            CLOSE_SOCKET(s);
+            return INVALID_SOCKET;
+        }
+        respuesta += c;
+        if (c == PROTOCOLO_FIN_MENSAJE) {
+            break;
+        }
+    }
+    if (respuesta != PROTOCOLO_SALUDO_OK) {
+        CLOSE_SOCKET(s);
+        return INVALID_SOCKET;
+    }
+
+#ifdef _WIN32
+    u_long no_bloqueante = 1;
+    ioctlsocket(s, FIONBIO, &no_bloqueante);
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+#endif
+    return s;
+}
+
+// Placa única por conexión: letra por conexión + secuencia en base 36
+static std::string placa_sintetica(int conexion, uint64_t secuencia) {
+    static const char DIGITOS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char texto[9];
+    texto[0] = 'A' + (conexion % 26);
+    texto[1] = 'A' + (conexion / 26) % 26;
+    for (int i = 7; i >= 2; i--) {
+        texto[i] = DIGITOS[secuencia % 36];
+        secuencia /= 36;
+    }
+    texto[8] = '\0';
+    return texto;
+}
+
+class HiloCarga {
+public:
+    HiloCarga(const OpcionesCarga& opciones, unsigned semilla)
+        : opciones(opciones), rng(semilla) {}
+
+    std::vector<ConexionCarga> conexiones;
+    ResultadoCarga resultado;
+    std::vector<EventoTraza> grabados;
+
+    void ejecutar(Reloj::time_point t0) {
+        inicio = t0;
+        ultimo_envio = t0;
+        Reloj::time_point fin_envios = mas_ns(inicio, opciones.duracion_s * 1e9);
+        bool con_traza = !opciones.traza.empty();
+
+        std::vector<struct pollfd> fds(conexiones.size());
+        while (true) {
+            Reloj::time_point ahora = Reloj::now();
+            bool enviando = con_traza ? quedan_en_traza() : ahora < fin_envios;
+            if (!enviando && !hay_en_vuelo()) {
+                break;
+            }
+            if (!enviando && ahora > mas_ns(ultimo_envio, ESPERA_FINAL_S * 1e9)) {
+                break; // Respuestas perdidas: no esperar para siempre
+            }
+
+            // Programar envíos y calcular cuánto se puede dormir
+            Reloj::time_point despertar = mas_ns(ahora, 10e6);
+            if (enviando) {
+                for (size_t i = 0; i < conexiones.size(); i++) {
+                    if (!conexiones[i].cerrada) {
+                        programar(conexiones[i], ahora, despertar);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < conexiones.size(); i++) {
+                fds[i].fd = conexiones[i].cerrada ? INVALID_SOCKET : conexiones[i].sock;
+                fds[i].events = POLLIN;
+                if (conexiones[i].enviados_salida < conexiones[i].salida.size()) {
+                    fds[i].events |= POLLOUT;
+                }
+                fds[i].revents = 0;
+            }
+            int espera_ms = 0;
+            if (despertar > ahora) {
+                espera_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(despertar - ahora).count();
+            }
+            int listos = poll(fds.data(), (unsigned long)fds.size(), espera_ms);
+            if (listos <= 0) {
+                continue;
+            }
+
+            for (size_t i = 0; i < conexiones.size(); i++) {
+                ConexionCarga& c = conexiones[i];
+                if (c.cerrada || fds[i].revents == 0) {
+                    continue;
+                }
+                if (fds[i].revents & (POLLERR | POLLNVAL)) {
+                    cerrar(c);
+                    continue;
+                }
+                if (fds[i].revents & (POLLIN | POLLHUP)) {
+                    leer(c);
+                }
+                if (!c.cerrada && (fds[i].revents & POLLOUT)) {
+                    escribir(c);
+                }
+            }
+        }
+        for (size_t i = 0; i < conexiones.size(); i++) {
+            cerrar(conexiones[i]);
+        }
+    }
+
+private:
+    const OpcionesCarga& opciones;
+    Reloj::time_point inicio;
+    Reloj::time_point ultimo_envio;
+    std::mt19937 rng;
+
+    bool quedan_en_traza() const {
+        for (size_t i = 0; i < conexiones.size(); i++) {
+            const ConexionCarga& c = conexiones[i];
+            if (!c.cerrada && c.siguiente < c.traza.size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hay_en_vuelo() const {
+        for (size_t i = 0; i < conexiones.size(); i++) {
+            if (!conexiones[i].cerrada && !conexiones[i].en_vuelo.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Siguiente evento sintético: 60% entradas mientras haya pocas placas
+    // adentro; las salidas usan siempre una placa que entró por esta conexión
+    std::string mensaje_sintetico(ConexionCarga& c) {
+        std::string mensaje;
+        if (c.dentro.empty() || (c.dentro.size() < 64 && rng() % 100 < 60)) {
+            std::string placa = placa_sintetica(c.indice, c.secuencia++);
+            mensaje = "ENTRADA|" + placa + ((rng() & 1) ? "|carro|" : "|moto|") + opciones.dispositivo;
+            c.dentro.push_back(placa);
+        } else {
+            size_t i = rng() % c.dentro.size();
+            mensaje = "SALIDA|" + c.dentro[i] + "||" + opciones.dispositivo;
+            c.dentro[i] = c.dentro.back();
+            c.dentro.pop_back();
+        }
+        return mensaje;
+    }
+
+    void encolar(ConexionCarga& c, const std::string& mensaje, Reloj::time_point referencia) {
+        c.salida += mensaje;
+        c.salida += PROTOCOLO_FIN_MENSAJE;
+        c.en_vuelo.push_back(referencia);
+        resultado.enviados++;
+        ultimo_envio = Reloj::now();
+        if (!opciones.grabar.empty()) {
+            EventoTraza e;
+            e.ms = ns_desde(inicio, referencia) / 1e6;
+            e.mensaje = mensaje;
+            grabados.push_back(e);
+        }
+    }
+
+    void programar(ConexionCarga& c, Reloj::time_point ahora, Reloj::time_point& despertar) {
+        size_t antes = c.en_vuelo.size();
+        if (!opciones.traza.empty()) {
+            while (c.siguiente < c.traza.size()) {
+                const EventoTraza* e = c.traza[c.siguiente];
+                Reloj::time_point referencia = ahora;
+                if (e->ms >= 0) {
+                    referencia = mas_ns(inicio, e->ms * 1e6 / opciones.velocidad);
+                    if (referencia > ahora) {
+                        despertar = std::min(despertar, referencia);
+                        break;
+                    }
+                } else if (c.en_vuelo.size() >= (size_t)opciones.pipeline) {
+                    break;
+                }
+                encolar(c, e->mensaje, referencia);
+                c.siguiente++;
+            }
+        } else if (c.intervalo_ns > 0) {
+            // Lazo abierto: la latencia se mide desde la hora programada
+            while (c.proximo <= ahora) {
+                encolar(c, mensaje_sintetico(c), c.proximo);
+                c.proximo = mas_ns(c.proximo, c.intervalo_ns);
+            }
+            despertar = std::min(despertar, c.proximo);
+        } else {
+            while (c.en_vuelo.size() < (size_t)opciones.pipeline) {
+                encolar(c, mensaje_sintetico(c), ahora);
+            }
+        }
+        if (c.en_vuelo.size() != antes) {
+            escribir(c);
+        }
+    }
+
+    void escribir(ConexionCarga& c) {
+        while (c.enviados_salida < c.salida.size()) {
+            int n = send(c.sock, c.salida.data() + c.enviados_salida,
+                         (int)(c.salida.size() - c.enviados_salida), 0);
+            if (n > 0) {
+                c.enviados_salida += n;
+            } else {
+                if (n < 0 && ERROR_BLOQUEO(SOCKET_ERROR_CODE)) {
+                    return;
+                }
+                cerrar(c);
+                return;
+            }
+        }
+        c.salida.clear();
+        c.enviados_salida = 0;
+    }
+
+    void leer(ConexionCarga& c) {
+        char buffer[16 * 1024];
+        while (true) {
+            int n = recv(c.sock, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                c.entrada.append(buffer, n);
+                if (n < (int)sizeof(buffer)) {
+                    break;
+                }
+            } else {
+                if (n < 0 && ERROR_BLOQUEO(SOCKET_ERROR_CODE)) {
+                    break;
+                }
+                cerrar(c);
+                break;
+            }
+        }
+
+        Reloj::time_point ahora = Reloj::now();
+        size_t inicio_linea = 0;
+        size_t fin;
+        while ((fin = c.entrada.find(PROTOCOLO_FIN_MENSAJE, inicio_linea)) != std::string::npos) {
+            if (!c.en_vuelo.empty()) {
+                resultado.latencias.registrar(ns_desde(c.en_vuelo.front(), ahora));
+                c.en_vuelo.pop_front();
+            }
+            resultado.respuestas++;
+            if (c.entrada.compare(inicio_linea, 3, "OK:") == 0) {
+                resultado.ok++;
+            } else {
+                resultado.errores++;
+            }
+            inicio_linea = fin + 1;
+        }
+        c.entrada.erase(0, inicio_linea);
+    }
+
+    void cerrar(ConexionCarga& c) {
+        if (c.cerrada) {
+            return;
+        }
+        if (!c.en_vuelo.empty() || c.siguiente < c.traza.size()) {
+            resultado.conexiones_fallidas++;
+        }
+        CLOSE_SOCKET(c.sock);
+        c.sock = INVALID_SOCKET;
+        c.cerrada = true;
+        c.en_vuelo.clear();
+    }
+};
+
+bool cargar_traza(const std::string& ruta, std::vector<EventoTraza>& eventos) {
+    std::ifstream archivo(ruta.c_str());
+    if (!archivo) {
+        return false;
+    }
+    std::string linea;
+    while (std::getline(archivo, linea)) {
+        if (!linea.empty() && linea[linea.size() - 1] == '\r') {
+            linea.erase(linea.size() - 1);
+        }
+        if (linea.empty() || linea[0] == '#') {
+            continue;
+        }
+        EventoTraza e;
+        e.ms = -1.0;
+        size_t espacio = linea.find(' ');
+        size_t barra = linea.find('|');
+        if (espacio != std::string::npos && espacio < barra) {
+            char* fin = nullptr;
+            double ms = std::strtod(linea.c_str(), &fin);
+            if (fin == linea.c_str() + espacio && ms >= 0) {
+                e.ms = ms;
+                linea.erase(0, espacio + 1);
+            }
+        }
+        e.mensaje = linea;
+        eventos.push_back(e);
+    }
+    return true;
+}
+
+static size_t conexion_de_placa(const std::string& mensaje, int conexiones) {
+    size_t desde = mensaje.find('|');
+    size_t hasta = desde == std::string::npos ? std::string::npos : mensaje.find('|', desde + 1);
+    std::string placa = desde == std::string::npos ? mensaje : mensaje.substr(desde + 1, hasta - desde - 1);
+    // FNV-1a: estable entre ejecuciones, a diferencia de std::hash
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < placa.size(); i++) {
+        h = (h ^ (unsigned char)placa[i]) * 16777619u;
+    }
+    return h % (uint32_t)conexiones;
+}
+
+ResultadoCarga ejecutar_carga(const OpcionesCarga& opciones) {
+    ResultadoCarga total;
+
+    std::vector<EventoTraza> traza;
+    if (!opciones.traza.empty() && !cargar_traza(opciones.traza, traza)) {
+        std::cerr << "❌ No se pudo leer la traza " << opciones.traza << std::endl;
+        return total;
+    }
+
+    int hilos = std::max(1, std::min(opciones.hilos, opciones.conexiones));
+    std::vector<HiloCarga*> trabajadores;
+    for (int h = 0; h < hilos; h++) {
+        trabajadores.push_back(new HiloCarga(opciones, 1234567u + h));
+    }
+
+    // Conectar todo antes de medir; conexión i va al hilo i % hilos
+    for (int i = 0; i < opciones.conexiones; i++) {
+        ConexionCarga c;
+        c.indice = i;
+        c.sock = conectar_carga(opciones);
+        if (c.sock == INVALID_SOCKET) {
+            total.conexiones_fallidas++;
+            continue;
+        }
+        trabajadores[i % hilos]->conexiones.push_back(c);
+    }
+
+    std::vector<ConexionCarga*> abiertas;
+    for (size_t h = 0; h < trabajadores.size(); h++) {
+        for (size_t i = 0; i < trabajadores[h]->conexiones.size(); i++) {
+            abiertas.push_back(&trabajadores[h]->conexiones[i]);
+        }
+    }
+    if (abiertas.empty()) {
+        std::cerr << "❌ No se pudo conectar a " << opciones.host << ":" << opciones.puerto
+                  << " en modo enmarcado" << std::endl;
+        for (size_t h = 0; h < trabajadores.size(); h++) delete trabajadores[h];
+        return total;
+    }
+
+    // Repartir la traza por placa entre las conexiones abiertas
+    for (size_t i = 0; i < traza.size(); i++) {
+        abiertas[conexion_de_placa(traza[i].mensaje, (int)abiertas.size())]->traza.push_back(&traza[i]);
+    }
+
+    // Todos los hilos comparten el mismo instante cero
+    Reloj::time_point inicio = Reloj::now() + std::chrono::milliseconds(5);
+    double intervalo_ns = opciones.tasa > 0 ? abiertas.size() * 1e9 / opciones.tasa : 0.0;
+    for (size_t i = 0; i < abiertas.size(); i++) {
+        abiertas[i]->intervalo_ns = intervalo_ns;
+        // Escalonar las conexiones para no enviar todas a la vez
+        abiertas[i]->proximo = mas_ns(inicio, intervalo_ns * i / abiertas.size());
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t h = 0; h < trabajadores.size(); h++) {
+        threads.push_back(std::thread(&HiloCarga::ejecutar, trabajadores[h], inicio));
+    }
+    for (size_t h = 0; h < threads.size(); h++) {
+        threads[h].join();
+    }
+    total.segundos = std::chrono::duration<double>(Reloj::now() - inicio).count();
+
+    std::vector<EventoTraza> grabados;
+    for (size_t h = 0; h < trabajadores.size(); h++) {
+        const ResultadoCarga& r = trabajadores[h]->resultado;
+        total.enviados += r.enviados;
+        total.respuestas += r.respuestas;
+        total.ok += r.ok;
+        total.errores += r.errores;
+        total.conexiones_fallidas += r.conexiones_fallidas;
+        total.latencias.combinar(r.latencias);
+        grabados.insert(grabados.end(), trabajadores[h]->grabados.begin(), trabajadores[h]->grabados.end());
+        delete trabajadores[h];
+    }
+
+    if (!opciones.grabar.empty()) {
+        std::stable_sort(grabados.begin(), grabados.end(),
+                         [](const EventoTraza& a, const EventoTraza& b) { return a.ms < b.ms; });
+        std::ofstream archivo(opciones.grabar.c_str());
+        archivo << "# ms TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO\n";
+        archivo << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < grabados.size(); i++) {
+            archivo << grabados[i].ms << " " << grabados[i].mensaje << "\n";
+        }
+        if (!archivo) {
+            std::cerr << "❌ No se pudo escribir la traza " << opciones.grabar << std::endl;
+        }
+    }
+    return total;
+}
+
+static std::string formatear_ns(uint64_t ns) {
+    char texto[32];
+    if (ns < 1000) {
+        snprintf(texto, sizeof(texto), "%llu ns", (unsigned long long)ns);
+    } else if (ns < 1000000) {
+        snprintf(texto, sizeof(texto), "%.1f µs", ns / 1e3);
+    } else {
+        snprintf(texto, sizeof(texto), "%.2f ms", ns / 1e6);
+    }
+    return texto;
+}
+
+void imprimir_resultado(const OpcionesCarga& opciones, const ResultadoCarga& r) {
+    std::cout << "\n📏 Resultado (" << opciones.hilos << " hilos, " << opciones.conexiones
+              << " conexiones, ";
+    if (!opciones.traza.empty()) {
+        std::cout << "traza " << opciones.traza;
+    } else if (opciones.tasa > 0) {
+        std::cout << "lazo abierto " << opciones.tasa << " eventos/s";
+    } else {
+        std::cout << "lazo cerrado, pipeline " << opciones.pipeline;
+    }
+    std::cout << ")" << std::endl;
+
+    double por_segundo = r.segundos > 0 ? r.respuestas / r.segundos : 0.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "   Duración:     " << r.segundos << " s" << std::endl;
+    std::cout << "   Enviados:     " << r.enviados << std::endl;
+    std::cout << "   Respuestas:   " << r.respuestas << " (" << r.ok << " OK, "
+              << r.errores << " ERROR)" << std::endl;
+    if (r.conexiones_fallidas > 0) {
+        std::cout << "   ⚠️  Conexiones fallidas: " << r.conexiones_fallidas << std::endl;
+    }
+    std::cout << "   Throughput:   " << por_segundo << " respuestas/s" << std::endl;
+    std::cout << "   Latencia:     min " << formatear_ns(r.latencias.minimo())
+              << " | media " << formatear_ns((uint64_t)r.latencias.media())
+              << " | max " << formatear_ns(r.latencias.maximo()) << std::endl;
+    std::cout << "                 p50 " << formatear_ns(r.latencias.percentil(50.0))
+              << " | p99 " << formatear_ns(r.latencias.percentil(99.0))
+              << " | p99.9 " << formatear_ns(r.latencias.percentil(99.9)) << std::endl;
+}
+
+bool parsear_opciones_carga(int argc, char* argv[], OpcionesCarga& opciones) {
+    for (int i = 1; i < argc; i++) {
+        std::string opcion = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "❌ Falta el valor de " << opcion << std::endl;
+            return false;
+        }
+        std::string valor = argv[++i];
+        if (opcion == "--threads") {
+            opciones.hilos = std::atoi(valor.c_str());
+        } else if (opcion == "--conns") {
+            opciones.conexiones = std::atoi(valor.c_str());
+        } else if (opcion == "--rate") {
+            opciones.tasa = std::atof(valor.c_str());
+        } else if (opcion == "--duration") {
+            opciones.duracion_s = std::atof(valor.c_str());
+        } else if (opcion == "--pipeline") {
+            opciones.pipeline = std::atoi(valor.c_str());
+        } else if (opcion == "--trace") {
+            opciones.traza = valor;
+        } else if (opcion == "--speed") {
+            opciones.velocidad = std::atof(valor.c_str());
+        } else if (opcion == "--record") {
+            opciones.grabar = valor;
+        } else if (opcion == "--host") {
+            opciones.host = valor;
+        } else if (opcion == "--port") {
+            opciones.puerto = std::atoi(valor.c_str());
+        } else if (opcion == "--device") {
+            opciones.dispositivo = valor;
+        } else {
+            std::cerr << "❌ Opción desconocida: " << opcion << std::endl;
+            return false;
+        }
+    }
+    if (opciones.hilos < 1 || opciones.conexiones < 1 || opciones.pipeline < 1 ||
+        opciones.tasa < 0 || opciones.duracion_s <= 0 || opciones.velocidad <= 0) {
+        std::cerr << "❌ Valores inválidos: --threads, --conns, --pipeline >= 1; "
+                  << "--duration, --speed > 0; --rate >= 0" << std::endl;
+        return false;
+    }
+    if (opciones.hilos > opciones.conexiones) {
+        opciones.hilos = opciones.conexiones;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef GENERADOR_CARGA_HPP
+#define GENERADOR_CARGA_HPP
+
+#include "histograma.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Generador de carga para ServidorParqueadero (modo "bench" del cliente).
+//
+// Cada hilo atiende varias conexiones enmarcadas (PQ/1) con poll():
+// - Lazo cerrado (rate = 0): cada conexión mantiene `pipeline` mensajes
+//   en vuelo y envía el siguiente al recibir una respuesta.
+// - Lazo abierto (rate > 0): los envíos siguen un calendario fijo sin
+//   importar las respuestas; la latencia se mide desde la hora programada,
+//   así un servidor lento no esconde su cola (omisión coordinada).
+// - Traza: reproduce un archivo de eventos grabado; cada placa va siempre
+//   por la misma conexión para conservar el orden entrada/salida.
+struct OpcionesCarga {
+    std::string host;
+    int puerto;
+    int hilos;
+    int conexiones;         // Total, repartidas entre los hilos
+    double tasa;            // Eventos/s en total; 0 = lazo cerrado
+    double duracion_s;
+    int pipeline;           // Lazo cerrado: mensajes en vuelo por conexión
+    std::string traza;      // Archivo a reproducir ("" = carga sintética)
+    double velocidad;       // Traza con tiempos: 2.0 = el doble de rápido
+    std::string grabar;     // Guardar la carga sintética enviada como traza
+    std::string dispositivo;
+
+    OpcionesCarga()
+        : host("127.0.0.1"), puerto(8080), hilos(1), conexiones(1), tasa(0.0),
+          duracion_s(10.0), pipeline(1), velocidad(1.0), dispositivo("BENCH") {}
+};
+
+// Un evento de una traza: "[ms ]TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO"
+struct EventoTraza {
+    double ms;              // Desde el inicio; < 0 si la línea no tenía tiempo
+    std::string mensaje;
+};
+
+struct ResultadoCarga {
+    uint64_t enviados;
+    uint64_t respuestas;
+    uint64_t ok;
+    uint64_t errores;
+    uint64_t conexiones_fallidas;
+    double segundos;
+    HistogramaLatencia latencias; // ns
+
+    ResultadoCarga()
+        : enviados(0), respuestas(0), ok(0), errores(0), conexiones_fallidas(0), segundos(0.0) {}
+};
+
+// Lee una traza; líneas vacías y las que empiezan con '#' se ignoran
+bool cargar_traza(const std::string& ruta, std::vector<EventoTraza>& eventos);
+
+ResultadoCarga ejecutar_carga(const OpcionesCarga& opciones);
+
+void imprimir_resultado(const OpcionesCarga& opciones, const ResultadoCarga& r);
+
+// Parsear "bench --threads N --conns M ..." (argv a partir de "bench")
+bool parsear_opciones_carga(int argc, char* argv[], OpcionesCarga& opciones);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "gestor_parqueaderos.hpp"
+#include <algorithm>
+#include <cstring>
+
+static uint64_t hash_id(const char* id, size_t largo) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < largo; i++) {
+        h = (h ^ (unsigned char)id[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static bool id_valido(const std::string& id) {
+    if (id.empty() || id.size() > MAX_LARGO_ID_LOTE) {
+        return false;
+    }
+    for (size_t i = 0; i < id.size(); i++) {
+        unsigned char c = (unsigned char)id[i];
+        bool letra = (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+        if (!letra && !(c >= '0' && c <= '9') && c != '-' && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool prefijo_mas_largo(const std::pair<std::string, int>& a,
+                              const std::pair<std::string, int>& b) {
+    return a.first.size() > b.first.size();
+}
+
+int GestorParqueaderos::Rutas::buscar(const char* id, size_t largo) const {
+    if (tabla.empty()) {
+        return -1;
+    }
+    size_t mascara = tabla.size() - 1;
+    for (size_t i = (size_t)hash_id(id, largo) & mascara; tabla[i] >= 0; i = (i + 1) & mascara) {
+        const std::string& candidato = lotes[tabla[i]].id;
+        if (candidato.size() == largo && memcmp(candidato.data(), id, largo) == 0) {
+            return tabla[i];
+        }
+    }
+    return -1;
+}
+
+void GestorParqueaderos::Rutas::indexar() {
+    // Potencia de dos con al menos la mitad libre
+    size_t tamano = 8;
+    while (tamano < 2 * lotes.size()) {
+        tamano *= 2;
+    }
+    tabla.assign(tamano, -1);
+    for (size_t j = 0; j < lotes.size(); j++) {
+        size_t i = (size_t)hash_id(lotes[j].id.data(), lotes[j].id.size()) & (tamano - 1);
+        while (tabla[i] >= 0) {
+            i = (i + 1) & (tamano - 1);
+        }
+        tabla[i] = (int32_t)j;
+    }
+    std::stable_sort(prefijos.begin(), prefijos.end(), prefijo_mas_largo);
+}
+
+GestorParqueaderos::GestorParqueaderos() : rutas(nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    publicar(std::unique_ptr<Rutas>(new Rutas()));
+}
+
+void GestorParqueaderos::publicar(std::unique_ptr<Rutas> nuevas) {
+    nuevas->indexar();
+    rutas.store(nuevas.get(), std::memory_order_release);
+    versiones.push_back(std::move(nuevas));
+}
+
+Parqueadero* GestorParqueaderos::agregar_parqueadero(const std::string& id, int cap_carros,
+                                                     int cap_motos, double tarifa_carro,
+                                                     double tarifa_moto,
+                                                     PoliticaAsignacion politica) {
+    if (!id_valido(id)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    const Rutas& actuales = rutas_actuales();
+    if (actuales.buscar(id.data(), id.size()) >= 0) {
+        return nullptr;
+    }
+    std::unique_ptr<Parqueadero> p(
+        new Parqueadero(cap_carros, cap_motos, tarifa_carro, tarifa_moto, politica));
+    std::unique_ptr<Rutas> nuevas(new Rutas(actuales));
+    LoteGestor lote;
+    lote.id = id;
+    lote.indice = (int)nuevas->lotes.size();
+    lote.parqueadero = p.get();
+    nuevas->lotes.push_back(lote);
+    parqueaderos.push_back(std::move(p));
+    publicar(std::move(nuevas));
+    return lote.parqueadero;
+}
+
+bool GestorParqueaderos::asignar_prefijo(const std::string& prefijo, const std::string& id) {
+    if (prefijo.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    const Rutas& actuales = rutas_actuales();
+    int indice = actuales.buscar(id.data(), id.size());
+    if (indice < 0) {
+        return false;
+    }
+    std::unique_ptr<Rutas> nuevas(new Rutas(actuales));
+    bool reemplazado = false;
+    for (size_t i = 0; i < nuevas->prefijos.size(); i++) {
+        if (nuevas->prefijos[i].first == prefijo) {
+            nuevas->prefijos[i].second = indice;
+            reemplazado = true;
+        }
+    }
+    if (!reemplazado) {
+        nuevas->prefijos.push_back(std::make_pair(prefijo, indice));
+    }
+    publicar(std::move(nuevas));
+    return true;
+}
+
+Parqueadero* GestorParqueaderos::parqueadero(const std::string& id) const {
+    const Rutas& r = rutas_actuales();
+    int indice = r.buscar(id.data(), id.size());
+    return indice < 0 ? nullptr : r.lotes[indice].parqueadero;
+}
+
+std::vector<std::string> GestorParqueaderos::ids() const {
+    const Rutas& r = rutas_actuales();
+    std::vector<std::string> resultado;
+    resultado.reserve(r.lotes.size());
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        resultado.push_back(r.lotes[i].id);
+    }
+    return resultado;
+}
+
+const LoteGestor* GestorParqueaderos::enrutar(const MensajeDispositivo& mensaje) const {
+    const Rutas& r = rutas_actuales();
+    if (!mensaje.lote.vacio()) {
+        int indice = r.buscar(mensaje.lote.datos, mensaje.lote.largo);
+        return indice < 0 ? nullptr : &r.lotes[indice];
+    }
+    const Fragmento& dispositivo = mensaje.dispositivo;
+    for (size_t i = 0; i < r.prefijos.size(); i++) {
+        const std::string& prefijo = r.prefijos[i].first;
+        if (prefijo.size() <= dispositivo.largo &&
+            memcmp(prefijo.data(), dispositivo.datos, prefijo.size()) == 0) {
+            return &r.lotes[r.prefijos[i].second];
+        }
+    }
+    return r.lotes.size() == 1 ? &r.lotes[0] : nullptr;
+}
+
+int GestorParqueaderos::espacios_disponibles_carros() const {
+    const Rutas& r = rutas_actuales();
+    int total = 0;
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        total += r.lotes[i].parqueadero->espacios_disponibles_carros();
+    }
+    return total;
+}
+
+int GestorParqueaderos::espacios_disponibles_motos() const {
+    const Rutas& r = rutas_actuales();
+    int total = 0;
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        total += r.lotes[i].parqueadero->espacios_disponibles_motos();
+    }
+    return total;
+}
+
+int GestorParqueaderos::total_vehiculos() const {
+    const Rutas& r = rutas_actuales();
+    int total = 0;
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        total += r.lotes[i].parqueadero->total_vehiculos();
+    }
+    return total;
+}
+
+std::vector<EstadoLote> GestorParqueaderos::estado() const {
+    const Rutas& r = rutas_actuales();
+    std::vector<EstadoLote> resultado(r.lotes.size());
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        const Parqueadero* p = r.lotes[i].parqueadero;
+        resultado[i].id = r.lotes[i].id;
+        resultado[i].vehiculos = p->total_vehiculos();
+        resultado[i].libres_carros = p->espacios_disponibles_carros();
+        resultado[i].libres_motos = p->espacios_disponibles_motos();
+    }
+    return resultado;
+}
+
+std::string GestorParqueaderos::ubicar_vehiculo(const std::string& placa) const {
+    // Toma un instante el lock de una partición de cada lote
+    const Rutas& r = rutas_actuales();
+    for (size_t i = 0; i < r.lotes.size(); i++) {
+        if (r.lotes[i].parqueadero->vehiculo_presente(placa)) {
+            return r.lotes[i].id;
+        }
+    }
+    return "";
+}
@@ -0,0 +1,96 @@
+#ifndef GESTOR_PARQUEADEROS_HPP
+#define GESTOR_PARQUEADEROS_HPP
+
+#include "parqueadero.hpp"
+#include "protocolo.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Largo máximo del ID de un lote (cabe en EventoDispositivo::lote)
+static const size_t MAX_LARGO_ID_LOTE = 15;
+
+// Un lote como lo ve el enrutamiento
+struct LoteGestor {
+    std::string id;
+    int indice;                  // Orden de alta: fija el reactor que lo atiende
+    Parqueadero* parqueadero;
+};
+
+// Estado de un lote en las consultas entre lotes
+struct EstadoLote {
+    std::string id;
+    int vehiculos;
+    int libres_carros;
+    int libres_motos;
+};
+
+// Varios parqueaderos en un mismo proceso, detrás de un solo servidor.
+//
+// Cada mensaje se enruta por su campo LOTE o, si no lo trae, por el
+// prefijo más largo asignado al ID del dispositivo. Las rutas son una
+// tabla inmutable que se reemplaza entera al agregar un lote o un
+// prefijo (las anteriores se conservan), así que enrutar no toma locks y
+// se pueden agregar lotes con el servidor atendiendo.
+//
+// Las consultas entre lotes (espacios libres, vehículos) leen los
+// contadores sin lock de cada parqueadero: no frenan el tráfico.
+class GestorParqueaderos {
+public:
+    GestorParqueaderos();
+
+    GestorParqueaderos(const GestorParqueaderos&) = delete;
+    GestorParqueaderos& operator=(const GestorParqueaderos&) = delete;
+
+    // Crear un lote. id: 1 a MAX_LARGO_ID_LOTE letras, dígitos, '-' o '_'.
+    // nullptr si el id es inválido o ya existe.
+    Parqueadero* agregar_parqueadero(const std::string& id, int cap_carros, int cap_motos,
+                                     double tarifa_carro = 3000.0, double tarifa_moto = 2000.0,
+                                     PoliticaAsignacion politica = PoliticaAsignacion::MENOR_NUMERO);
+    // Mensajes sin LOTE de dispositivos cuyo ID empieza con prefijo van al
+    // lote id. false si el lote no existe o el prefijo está vacío.
+    bool asignar_prefijo(const std::string& prefijo, const std::string& id);
+
+    Parqueadero* parqueadero(const std::string& id) const;
+    size_t total_lotes() const { return rutas_actuales().lotes.size(); }
+    std::vector<std::string> ids() const;
+
+    // Lote de un mensaje (campo LOTE, prefijo del dispositivo o el único
+    // lote que haya); nullptr si no se puede enrutar. El puntero sigue
+    // siendo válido mientras exista el gestor.
+    const LoteGestor* enrutar(const MensajeDispositivo& mensaje) const;
+
+    // Consultas entre lotes
+    int espacios_disponibles_carros() const;
+    int espacios_disponibles_motos() const;
+    int total_vehiculos() const;
+    std::vector<EstadoLote> estado() const;
+    // Lote donde está una placa ("" si no está en ninguno)
+    std::string ubicar_vehiculo(const std::string& placa) const;
+
+private:
+    struct Rutas {
+        std::vector<LoteGestor> lotes;
+        std::vector<int32_t> tabla;  // Hash abierto id -> índice (-1 libre)
+        std::vector<std::pair<std::string, int> > prefijos; // Más largos primero
+
+        int buscar(const char* id, size_t largo) const;
+        void indexar();
+    };
+
+    mutable std::mutex mutex;    // Serializa los cambios
+    std::vector<std::unique_ptr<Parqueadero> > parqueaderos;
+    std::vector<std::unique_ptr<Rutas> > versiones;
+    std::atomic<const Rutas*> rutas;
+
+    const Rutas& rutas_actuales() const { return *rutas.load(std::memory_order_acquire); }
+    // Requiere el mutex
+    void publicar(std::unique_ptr<Rutas> nuevas);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef HISTOGRAMA_HPP
+#define HISTOGRAMA_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+// Histograma de latencias al estilo HDR: cubetas lineales dentro de cada
+// potencia de dos, así el error relativo es constante (< 1/64, ~1.6%) desde
+// nanosegundos hasta horas con un arreglo fijo de ~30 KB.
+//
+// Valores < 128 tienen cubeta propia; a partir de ahí cada potencia de dos
+// se divide en 64 cubetas. registrar() es O(1) y sin asignaciones; para
+// varios hilos se usa un histograma por hilo y luego combinar().
+class HistogramaLatencia {
+public:
+    static const int BITS_SUBCUBETA = 6;
+    static const uint64_t SUBCUBETAS = 1ull << BITS_SUBCUBETA;          // 64
+    static const size_t NUM_CUBETAS = (64 - BITS_SUBCUBETA + 1) * SUBCUBETAS; // 3776
+
+    HistogramaLatencia() : cuentas(NUM_CUBETAS, 0), total_(0), suma(0), minimo_(UINT64_MAX), maximo_(0) {}
+
+    void registrar(uint64_t valor) {
+        cuentas[indice(valor)]++;
+        total_++;
+        suma += valor;
+        if (valor < minimo_) minimo_ = valor;
+        if (valor > maximo_) maximo_ = valor;
+    }
+
+    void combinar(const HistogramaLatencia& otro) {
+        for (size_t i = 0; i < NUM_CUBETAS; i++) {
+            cuentas[i] += otro.cuentas[i];
+        }
+        total_ += otro.total_;
+        suma += otro.suma;
+        if (otro.minimo_ < minimo_) minimo_ = otro.minimo_;
+        if (otro.maximo_ > maximo_) maximo_ = otro.maximo_;
+    }
+
+    void reiniciar() {
+        std::fill(cuentas.begin(), cuentas.end(), 0);
+        total_ = 0;
+        suma = 0;
+        minimo_ = UINT64_MAX;
+        maximo_ = 0;
+    }
+
+    // Valor bajo el cual queda el porcentaje p (0-100) de las muestras;
+    // se reporta el mayor valor equivalente de la cubeta
+    uint64_t percentil(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        uint64_t objetivo = (uint64_t)(p / 100.0 * total_ + 0.5);
+        if (objetivo < 1) objetivo = 1;
+        if (objetivo > total_) objetivo = total_;
+        uint64_t acumulado = 0;
+        for (size_t i = 0; i < NUM_CUBETAS; i++) {
+            acumulado += cuentas[i];
+            if (acumulado >= objetivo) {
+                uint64_t alto = limite_superior(i);
+                return alto < maximo_ ? alto : maximo_;
+            }
+        }
+        return maximo_;
+    }
+
+    uint64_t total() const { return total_; }
+    uint64_t minimo() const { return total_ ? minimo_ : 0; }
+    uint64_t maximo() const { return maximo_; }
+    double media() const { return total_ ? (double)suma / total_ : 0.0; }
+
+    static size_t indice(uint64_t valor) {
+        if (valor < 2 * SUBCUBETAS) {
+            return (size_t)valor;
+        }
+        int desplazamiento = bit_mayor(valor) - BITS_SUBCUBETA;
+        return (size_t)desplazamiento * SUBCUBETAS + (size_t)(valor >> desplazamiento);
+    }
+
+    static uint64_t limite_inferior(size_t i) {
+        if (i < 2 * SUBCUBETAS) {
+            return i;
+        }
+        int desplazamiento = (int)(i / SUBCUBETAS) - 1;
+        return (uint64_t)(i % SUBCUBETAS + SUBCUBETAS) << desplazamiento;
+    }
+
+    static uint64_t limite_superior(size_t i) {
+        if (i < 2 * SUBCUBETAS) {
+            return i;
+        }
+        int desplazamiento = (int)(i / SUBCUBETAS) - 1;
+        return limite_inferior(i) + (((uint64_t)1 << desplazamiento) - 1);
+    }
+
+private:
+    std::vector<uint64_t> cuentas;
+    uint64_t total_;
+    uint64_t suma;
+    uint64_t minimo_;
+    uint64_t maximo_;
+
+    static int bit_mayor(uint64_t valor) {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanReverse64(&i, valor);
+        return (int)i;
+#else
+        return 63 - __builtin_clzll(valor);
+#endif
+    }
+};
+
+#endif
\ No newline at end of file
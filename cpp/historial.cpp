@@ -0,0 +1,222 @@
+#include "historial.hpp"
+#include <algorithm>
+#include <cstring>
+
+static int64_t hora_o_ahora(time_t hora) {
+    return hora != 0 ? (int64_t)hora : (int64_t)time(nullptr);
+}
+
+static int64_t inicio_hora(int64_t t) {
+    return t - ((t % 3600) + 3600) % 3600;
+}
+
+static int hora_local(int64_t t) {
+    time_t segundos = (time_t)t;
+    struct tm local;
+#ifdef _WIN32
+    localtime_s(&local, &segundos);
+#else
+    localtime_r(&segundos, &local);
+#endif
+    return local.tm_hour;
+}
+
+HistorialParqueadero::HistorialParqueadero()
+    : estancias_con_entrada(0), suma_estancias_s(0.0) {
+    memset(horas, 0, sizeof(horas));
+    memset(&totales, 0, sizeof(totales));
+}
+
+bool HistorialParqueadero::abrir_archivo(const std::string& ruta) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cerradas.abrir(ruta)) {
+        return false;
+    }
+
+    // Los totales de lo cargado, como si cada estancia se hubiera registrado
+    cerradas.recorrer([this](const Estancia& e) {
+        if (e.tipo != TIPO_DESCONOCIDO) {
+            totales.entradas_tipo[e.tipo]++;
+            totales.entradas_hora_del_dia[hora_local(e.hora_entrada)]++;
+            totales.recaudado_tipo[e.tipo] += e.tarifa;
+            estancias_con_entrada++;
+            suma_estancias_s += (double)std::max<int64_t>(0, e.hora_salida - e.hora_entrada);
+        } else {
+            totales.salidas_sin_entrada++;
+        }
+        totales.salidas++;
+        totales.recaudado += e.tarifa;
+    });
+    if (estancias_con_entrada > 0) {
+        totales.estancia_promedio_s = suma_estancias_s / estancias_con_entrada;
+    }
+    return true;
+}
+
+bool HistorialParqueadero::sincronizar() {
+    return cerradas.sincronizar();
+}
+
+CubetaHora& HistorialParqueadero::cubeta(int64_t hora) {
+    int64_t inicio = inicio_hora(hora);
+    int64_t indice = (inicio / 3600) % HORAS_HISTORIAL;
+    if (indice < 0) indice += HORAS_HISTORIAL;
+    CubetaHora& c = horas[indice];
+    if (c.hora != inicio) {
+        // Primera vez en esta hora (o cubeta de hace una semana): parte de
+        // la ocupación actual, antes de aplicar el evento
+        memset(&c, 0, sizeof(c));
+        c.hora = inicio;
+        c.ocupacion_maxima = c.ocupacion_final = (uint32_t)totales.presentes;
+    }
+    return c;
+}
+
+void HistorialParqueadero::anotar_ocupacion(CubetaHora& c) {
+    c.ocupacion_final = (uint32_t)totales.presentes;
+    c.ocupacion_maxima = std::max(c.ocupacion_maxima, c.ocupacion_final);
+}
+
+void HistorialParqueadero::registrar_entrada(PlacaCompacta placa, TipoVehiculo tipo, int espacio,
+                                             const std::string& fuente, time_t hora) {
+    int64_t t = hora_o_ahora(hora);
+    int hora_dia = hora_local(t);
+    int tipo_i = (int)tipo;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CubetaHora& c = cubeta(t);
+    Vehiculo* anterior = abiertas.buscar(placa);
+    if (anterior != nullptr) {
+        totales.presentes--;
+        totales.presentes_tipo[(int)anterior->tipo]--;
+        abiertas.eliminar(anterior);
+    }
+
+    Vehiculo v;
+    v.placa = placa;
+    v.tipo = tipo;
+    v.etiqueta = cerradas.indice_fuente(fuente);
+    v.espacio = espacio;
+    v.hora_entrada = (time_t)t;
+    abiertas.insertar(v);
+
+    totales.presentes++;
+    totales.presentes_tipo[tipo_i]++;
+    totales.entradas_tipo[tipo_i]++;
+    totales.entradas_hora_del_dia[hora_dia]++;
+
+    c.entradas++;
+    anotar_ocupacion(c);
+}
+
+bool HistorialParqueadero::registrar_salida(PlacaCompacta placa, double tarifa,
+                                            const std::string& fuente, time_t hora) {
+    int64_t t = hora_o_ahora(hora);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CubetaHora& c = cubeta(t);
+    Estancia e;
+    e.placa = placa;
+    e.hora_salida = t;
+    e.tarifa = tarifa;
+    e.fuente_salida = cerradas.indice_fuente(fuente);
+
+    Vehiculo* v = abiertas.buscar(placa);
+    bool encontrada = v != nullptr;
+    if (encontrada) {
+        e.hora_entrada = v->hora_entrada;
+        e.espacio = v->espacio;
+        e.tipo = (uint8_t)v->tipo;
+        e.fuente_entrada = v->etiqueta;
+        abiertas.eliminar(v);
+
+        totales.presentes--;
+        totales.presentes_tipo[e.tipo]--;
+        totales.recaudado_tipo[e.tipo] += tarifa;
+        estancias_con_entrada++;
+        suma_estancias_s += (double)std::max<int64_t>(0, t - e.hora_entrada);
+        totales.estancia_promedio_s = suma_estancias_s / estancias_con_entrada;
+    } else {
+        e.hora_entrada = 0;
+        e.espacio = -1;
+        e.tipo = TIPO_DESCONOCIDO;
+        e.fuente_entrada = e.fuente_salida;
+        totales.salidas_sin_entrada++;
+    }
+    totales.salidas++;
+    totales.recaudado += tarifa;
+    cerradas.agregar(e);
+
+    c.salidas++;
+    c.recaudado += tarifa;
+    anotar_ocupacion(c);
+    return encontrada;
+}
+
+EstadisticasHistorial HistorialParqueadero::estadisticas() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totales;
+}
+
+std::vector<CubetaHora> HistorialParqueadero::ocupacion_por_hora(int num_horas, time_t ahora) const {
+    num_horas = std::max(1, std::min(num_horas, HORAS_HISTORIAL));
+    int64_t fin = inicio_hora(hora_o_ahora(ahora));
+    int64_t inicio = fin - (int64_t)(num_horas - 1) * 3600;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Ocupación al empezar la serie: la última hora con eventos antes de ella
+    uint32_t ocupacion = 0;
+    int64_t mas_reciente = 0;
+    for (int i = 0; i < HORAS_HISTORIAL; i++) {
+        if (horas[i].hora != 0 && horas[i].hora < inicio && horas[i].hora > mas_reciente) {
+            mas_reciente = horas[i].hora;
+            ocupacion = horas[i].ocupacion_final;
+        }
+    }
+
+    std::vector<CubetaHora> serie;
+    serie.reserve(num_horas);
+    for (int64_t h = inicio; h <= fin; h += 3600) {
+        int64_t indice = (h / 3600) % HORAS_HISTORIAL;
+        if (indice < 0) indice += HORAS_HISTORIAL;
+        CubetaHora c = horas[indice];
+        if (c.hora != h) {
+            memset(&c, 0, sizeof(c));
+            c.hora = h;
+            c.ocupacion_maxima = c.ocupacion_final = ocupacion;
+        }
+        ocupacion = c.ocupacion_final;
+        serie.push_back(c);
+    }
+    return serie;
+}
+
+bool HistorialParqueadero::estancia_abierta(PlacaCompacta placa, Estancia& estancia) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Vehiculo* v = abiertas.buscar(placa);
+    if (v == nullptr) {
+        return false;
+    }
+    estancia.placa = placa;
+    estancia.hora_entrada = v->hora_entrada;
+    estancia.hora_salida = 0;
+    estancia.tarifa = 0.0;
+    estancia.espacio = v->espacio;
+    estancia.tipo = (uint8_t)v->tipo;
+    estancia.fuente_entrada = v->etiqueta;
+    estancia.fuente_salida = 0;
+    return true;
+}
+
+std::vector<Estancia> HistorialParqueadero::ultimas_estancias(size_t n) const {
+    return cerradas.ultimas(n);
+}
+
+size_t HistorialParqueadero::total_estancias() const {
+    return cerradas.filas();
+}
+
+std::vector<std::string> HistorialParqueadero::fuentes() const {
+    return cerradas.fuentes();
+}
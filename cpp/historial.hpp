@@ -0,0 +1,101 @@
+#ifndef HISTORIAL_HPP
+#define HISTORIAL_HPP
+
+#include "tabla_placas.hpp"
+#include "almacen_estancias.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+
+// Historial de estancias y estadísticas del parqueadero.
+//
+// Las estancias abiertas se indexan por placa (TablaPlacas) y las
+// cerradas se agregan en orden de salida a un AlmacenEstancias (por
+// columnas, opcionalmente en disco). Cada entrada o salida actualiza los
+// agregados en el momento, así que las estadísticas se leen en O(1) sin
+// recorrer el historial; los reportes por rango de fechas los responde
+// almacen().
+
+//
+// Seguro para usar desde varios hilos (un mutex por historial).
+
+// Horas hacia atrás que guarda la serie de ocupación (una semana)
+static const int HORAS_HISTORIAL = 24 * 7;
+
+// Actividad de una hora del reloj
+struct CubetaHora {
+    int64_t hora;            // Inicio de la hora (epoch, múltiplo de 3600)
+    uint32_t entradas;
+    uint32_t salidas;
+    uint32_t ocupacion_maxima;
+    uint32_t ocupacion_final;  // Vehículos dentro al último evento de la hora
+    double recaudado;
+};
+
+struct EstadisticasHistorial {
+    uint64_t presentes;
+    uint64_t presentes_tipo[2];      // Por TipoVehiculo
+    uint64_t entradas_tipo[2];
+    uint64_t salidas;
+    uint64_t salidas_sin_entrada;
+    double recaudado;
+    double recaudado_tipo[2];
+    double estancia_promedio_s;      // De las estancias cerradas con entrada
+    uint64_t entradas_hora_del_dia[24];  // Hora local
+};
+
+class HistorialParqueadero {
+public:
+    HistorialParqueadero();
+
+    // Guardar las estancias cerradas en ruta y cargar las que ya tenga
+    // (los totales se recalculan; la serie por hora empieza vacía).
+    // Llamar antes de registrar eventos.
+    bool abrir_archivo(const std::string& ruta);
+    // Llevar a disco las estancias cerradas que falten
+    bool sincronizar();
+
+    // hora = 0 usa la hora actual. Una segunda entrada de una placa que
+    // ya está dentro reemplaza a la anterior (se cuenta como nueva entrada).
+    void registrar_entrada(PlacaCompacta placa, TipoVehiculo tipo, int espacio,
+                           const std::string& fuente, time_t hora = 0);
+    // Cierra la estancia abierta de la placa; sin ella se guarda una
+    // salida suelta (su tarifa sí suma) y retorna false
+    bool registrar_salida(PlacaCompacta placa, double tarifa,
+                          const std::string& fuente, time_t hora = 0);
+
+    EstadisticasHistorial estadisticas() const;
+
+    // Últimas `horas` horas hasta la actual, la más antigua primero. Las
+    // horas sin eventos repiten la ocupación final de la anterior.
+    std::vector<CubetaHora> ocupacion_por_hora(int horas = 24, time_t ahora = 0) const;
+
+    // Estancia abierta de una placa; false si no está dentro
+    bool estancia_abierta(PlacaCompacta placa, Estancia& estancia) const;
+
+    // Últimas n estancias cerradas, la más reciente al final
+    std::vector<Estancia> ultimas_estancias(size_t n) const;
+    size_t total_estancias() const;
+
+    std::vector<std::string> fuentes() const;
+
+    // Estancias cerradas, para reportes por rango (seguro sin el mutex
+    // del historial)
+    const AlmacenEstancias& almacen() const { return cerradas; }
+
+private:
+    mutable std::mutex mutex;
+    TablaPlacas abiertas;  // placa -> tipo, espacio, hora y fuente (etiqueta) de la entrada
+    AlmacenEstancias cerradas;
+    CubetaHora horas[HORAS_HISTORIAL];
+    EstadisticasHistorial totales;
+    uint64_t estancias_con_entrada;
+    double suma_estancias_s;
+
+    CubetaHora& cubeta(int64_t hora);
+    void anotar_ocupacion(CubetaHora& c);
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "log_asincrono.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+// Cada cuánto vacía los anillos el hilo escritor
+static const int INTERVALO_ESCRITOR_MS = 10;
+
+static std::atomic<uint64_t> siguiente_id_log(1);
+
+size_t AnilloLog::extraer(std::vector<RegistroLog>& destino) {
+    size_t desde = lectura.load(std::memory_order_relaxed);
+    size_t hasta = escritura.load(std::memory_order_acquire);
+    for (size_t pos = desde; pos != hasta; pos++) {
+        destino.push_back(registros[pos & (CAPACIDAD - 1)]);
+    }
+    lectura.store(hasta, std::memory_order_release);
+    return hasta - desde;
+}
+
+LogAsincrono::LogAsincrono(NivelLog nivel)
+    : nivel_minimo((uint8_t)nivel), id(siguiente_id_log.fetch_add(1)),
+      archivo(nullptr), descartados_reportados(0), terminar(false) {
+    escritor = std::thread(&LogAsincrono::loop_escritor, this);
+}
+
+LogAsincrono::~LogAsincrono() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_hilo);
+        terminar = true;
+    }
+    despertar.notify_one();
+    escritor.join();
+    vaciar();
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+}
+
+AnilloLog& LogAsincrono::anillo() {
+    // Mismo esquema que MetricasServidor::hilo(): caché por hilo y
+    // búsqueda por id de hilo la primera vez
+    struct Cache {
+        uint64_t id;
+        AnilloLog* anillo;
+    };
+    static thread_local Cache cache = {0, nullptr};
+    if (cache.id == id) {
+        return *cache.anillo;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_anillos);
+    std::thread::id actual = std::this_thread::get_id();
+    AnilloLog* encontrado = nullptr;
+    for (size_t i = 0; i < anillos.size(); i++) {
+        if (anillos[i]->dueno == actual) {
+            encontrado = anillos[i].get();
+            break;
+        }
+    }
+    if (encontrado == nullptr) {
+        anillos.push_back(std::unique_ptr<AnilloLog>(new AnilloLog()));
+        encontrado = anillos.back().get();
+        encontrado->dueno = actual;
+    }
+    cache.id = id;
+    cache.anillo = encontrado;
+    return *encontrado;
+}
+
+void LogAsincrono::encolar(const FormatoLog& formato, const Fragmento& a, const Fragmento& b,
+                           const Fragmento& c, int64_t numero) {
+    RegistroLog registro;
+    registro.hora_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    registro.formato = &formato;
+    registro.numero = numero;
+
+    const Fragmento* campos[3] = {&a, &b, &c};
+    size_t usado = 0;
+    for (int i = 0; i < 3; i++) {
+        size_t n = std::min(campos[i]->largo, sizeof(registro.datos) - usado);
+        if (n > 0) {
+            memcpy(registro.datos + usado, campos[i]->datos, n);
+        }
+        registro.largos[i] = (uint8_t)n;
+        usado += n;
+    }
+    anillo().agregar(registro);
+}
+
+size_t LogAsincrono::descartados() const {
+    std::lock_guard<std::mutex> lock(mutex_anillos);
+    size_t total = 0;
+    for (size_t i = 0; i < anillos.size(); i++) {
+        total += anillos[i]->total_descartados();
+    }
+    return total;
+}
+
+bool LogAsincrono::abrir_archivo(const std::string& ruta) {
+    FILE* nuevo = fopen(ruta.c_str(), "a");
+    if (nuevo == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_escritura);
+    if (archivo != nullptr) {
+        fclose(archivo);
+    }
+    archivo = nuevo;
+    return true;
+}
+
+void LogAsincrono::loop_escritor() {
+    std::unique_lock<std::mutex> lock(mutex_hilo);
+    while (!terminar) {
+        despertar.wait_for(lock, std::chrono::milliseconds(INTERVALO_ESCRITOR_MS));
+        lock.unlock();
+        vaciar();
+        lock.lock();
+    }
+}
+
+void LogAsincrono::vaciar() {
+    std::lock_guard<std::mutex> lock(mutex_escritura);
+
+    pendientes.clear();
+    {
+        std::lock_guard<std::mutex> lock_anillos(mutex_anillos);
+        for (size_t i = 0; i < anillos.size(); i++) {
+            anillos[i]->extraer(pendientes);
+        }
+    }
+
+    // Los anillos se vacían por turnos: ordenar por hora para intercalar hilos
+    std::stable_sort(pendientes.begin(), pendientes.end(),
+                     [](const RegistroLog& x, const RegistroLog& y) { return x.hora_us < y.hora_us; });
+
+    lineas_salida.clear();
+    lineas_error.clear();
+    for (size_t i = 0; i < pendientes.size(); i++) {
+        const RegistroLog& r = pendientes[i];
+        bool error = archivo == nullptr && r.formato->nivel >= NivelLog::AVISO;
+        formatear(r, error ? lineas_error : lineas_salida);
+    }
+
+    size_t perdidos = 0;
+    {
+        std::lock_guard<std::mutex> lock_anillos(mutex_anillos);
+        for (size_t i = 0; i < anillos.size(); i++) {
+            perdidos += anillos[i]->total_descartados();
+        }
+    }
+    if (perdidos > descartados_reportados) {
+        std::string& destino = archivo == nullptr ? lineas_error : lineas_salida;
+        destino += "⚠️  Log: ";
+        destino += std::to_string(perdidos - descartados_reportados);
+        destino += " registros descartados (anillo lleno)\n";
+        descartados_reportados = perdidos;
+    }
+
+    if (!lineas_salida.empty()) {
+        FILE* salida = archivo != nullptr ? archivo : stdout;
+        fwrite(lineas_salida.data(), 1, lineas_salida.size(), salida);
+        fflush(salida);
+    }
+    if (!lineas_error.empty()) {
+        fwrite(lineas_error.data(), 1, lineas_error.size(), stderr);
+        fflush(stderr);
+    }
+}
+
+void LogAsincrono::formatear(const RegistroLog& registro, std::string& destino) {
+    time_t segundos = (time_t)(registro.hora_us / 1000000);
+    struct tm local;
+#ifdef _WIN32
+    localtime_s(&local, &segundos);
+#else
+    localtime_r(&segundos, &local);
+#endif
+    char hora[32];
+    snprintf(hora, sizeof(hora), "%02d:%02d:%02d.%03d ", local.tm_hour, local.tm_min,
+             local.tm_sec, (int)(registro.hora_us % 1000000 / 1000));
+
+    const FormatoLog& f = *registro.formato;
+    destino += hora;
+    destino += nombre_nivel_log(f.nivel);
+    destino += ' ';
+    destino += f.evento;
+
+    size_t desde = 0;
+    for (int i = 0; i < 3; i++) {
+        if (f.campos[i] != nullptr) {
+            destino += ' ';
+            destino += f.campos[i];
+            destino += '=';
+            destino.append(registro.datos + desde, registro.largos[i]);
+        }
+        desde += registro.largos[i];
+    }
+    if (f.campo_numero != nullptr) {
+        destino += ' ';
+        destino += f.campo_numero;
+        destino += '=';
+        destino += std::to_string((long long)registro.numero);
+    }
+    destino += '\n';
+}
+
+const char* nombre_nivel_log(NivelLog nivel) {
+    switch (nivel) {
+        case NivelLog::DEPURACION: return "DEBUG";
+        case NivelLog::INFO: return "INFO ";
+        case NivelLog::AVISO: return "AVISO";
+        case NivelLog::FALLO: return "ERROR";
+        case NivelLog::NINGUNO: return "-----";
+    }
+    return "?????";
+}
+
+NivelLog nivel_log_desde_texto(const std::string& texto, bool& valido) {
+    static const struct {
+        const char* nombre;
+        NivelLog nivel;
+    } niveles[] = {
+        {"debug", NivelLog::DEPURACION}, {"info", NivelLog::INFO}, {"aviso", NivelLog::AVISO},
+        {"warning", NivelLog::AVISO}, {"error", NivelLog::FALLO}, {"ninguno", NivelLog::NINGUNO},
+        {"off", NivelLog::NINGUNO}
+    };
+    std::string minusculas = texto;
+    std::transform(minusculas.begin(), minusculas.end(), minusculas.begin(), ::tolower);
+    for (size_t i = 0; i < sizeof(niveles) / sizeof(niveles[0]); i++) {
+        if (minusculas == niveles[i].nombre) {
+            valido = true;
+            return niveles[i].nivel;
+        }
+    }
+    valido = false;
+    return NivelLog::INFO;
+}
@@ -0,0 +1,147 @@
+#ifndef LOG_ASINCRONO_HPP
+#define LOG_ASINCRONO_HPP
+
+#include "protocolo.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Log asíncrono del servidor de dispositivos.
+//
+// Los hilos de red no formatean ni escriben: copian un registro de 64
+// bytes en su propio anillo, sin locks. Un hilo escritor vacía los anillos
+// cada pocos milisegundos, formatea las líneas y las escribe en bloque.
+// Con el anillo lleno el registro se descarta (y se cuenta): el log nunca
+// frena la respuesta a un dispositivo.
+
+enum class NivelLog : uint8_t {
+    DEPURACION = 0, // Cada mensaje y cada respuesta
+    INFO,           // Conexiones, entradas y salidas
+    AVISO,          // Mensajes rechazados, conexiones cortadas
+    FALLO,          // Errores de sockets (ERROR es una macro en Windows)
+    NINGUNO         // Sólo como filtro: no registrar nada
+};
+
+// Forma de una línea de log. Se declara static const en el punto de
+// llamada y el registro guarda sólo el puntero.
+struct FormatoLog {
+    NivelLog nivel;
+    const char* evento;        // Ej: "🚗 ENTRADA"
+    const char* campos[3];     // Nombres de los campos de texto (nullptr si no hay)
+    const char* campo_numero;  // Nombre del campo numérico (nullptr si no hay)
+};
+
+// Una línea de caché por registro
+struct RegistroLog {
+    int64_t hora_us;           // Hora de pared, en microsegundos
+    const FormatoLog* formato;
+    int64_t numero;
+    uint8_t largos[3];
+    char datos[37];            // Campos de texto seguidos; se truncan si no caben
+};
+
+// Anillo de un solo productor (el hilo dueño) y un solo consumidor (el escritor)
+class AnilloLog {
+public:
+    static const size_t CAPACIDAD = 4096; // Potencia de dos (256 KB por hilo)
+
+    AnilloLog() : escritura(0), lectura(0), descartados(0) {}
+
+    bool agregar(const RegistroLog& registro) {
+        size_t pos = escritura.load(std::memory_order_relaxed);
+        if (pos - lectura.load(std::memory_order_acquire) >= CAPACIDAD) {
+            descartados.store(descartados.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+            return false;
+        }
+        registros[pos & (CAPACIDAD - 1)] = registro;
+        escritura.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Mover los registros pendientes al final de destino
+    size_t extraer(std::vector<RegistroLog>& destino);
+
+    size_t total_descartados() const { return descartados.load(std::memory_order_relaxed); }
+
+    std::thread::id dueno;
+
+private:
+    char relleno_inicio[64];
+    std::atomic<size_t> escritura;
+    char relleno_escritura[64];
+    std::atomic<size_t> lectura;
+    char relleno_lectura[64];
+    std::atomic<size_t> descartados;
+    RegistroLog registros[CAPACIDAD];
+};
+
+class LogAsincrono {
+public:
+    explicit LogAsincrono(NivelLog nivel = NivelLog::INFO);
+    // Escribe lo pendiente y detiene el hilo escritor
+    ~LogAsincrono();
+
+    LogAsincrono(const LogAsincrono&) = delete;
+    LogAsincrono& operator=(const LogAsincrono&) = delete;
+
+    void establecer_nivel(NivelLog nivel) { nivel_minimo.store((uint8_t)nivel, std::memory_order_relaxed); }
+    NivelLog nivel() const { return (NivelLog)nivel_minimo.load(std::memory_order_relaxed); }
+    bool habilitado(NivelLog nivel) const {
+        return (uint8_t)nivel >= nivel_minimo.load(std::memory_order_relaxed);
+    }
+
+    // Registrar una línea; los fragmentos se copian al anillo del hilo
+    void registrar(const FormatoLog& formato, Fragmento a = Fragmento(),
+                   Fragmento b = Fragmento(), Fragmento c = Fragmento(), int64_t numero = 0) {
+        if (habilitado(formato.nivel)) {
+            encolar(formato, a, b, c, numero);
+        }
+    }
+
+    // Escribir ya todo lo pendiente (desde cualquier hilo)
+    void vaciar();
+
+    // Escribir en un archivo (en modo append) en vez de stdout/stderr
+    bool abrir_archivo(const std::string& ruta);
+
+    // Registros perdidos porque el anillo de su hilo estaba lleno
+    size_t descartados() const;
+
+private:
+    std::atomic<uint8_t> nivel_minimo;
+    uint64_t id; // Distingue logs en la caché thread_local
+
+    mutable std::mutex mutex_anillos;
+    std::vector<std::unique_ptr<AnilloLog> > anillos;
+
+    std::mutex mutex_escritura;         // Un solo consumidor a la vez
+    std::vector<RegistroLog> pendientes;
+    std::string lineas_salida;
+    std::string lineas_error;
+    FILE* archivo;                      // nullptr: stdout, y stderr desde AVISO
+    size_t descartados_reportados;
+
+    std::mutex mutex_hilo;
+    std::condition_variable despertar;
+    bool terminar;
+    std::thread escritor;
+
+    void encolar(const FormatoLog& formato, const Fragmento& a, const Fragmento& b,
+                 const Fragmento& c, int64_t numero);
+    AnilloLog& anillo();
+    void loop_escritor();
+    void formatear(const RegistroLog& registro, std::string& destino);
+};
+
+NivelLog nivel_log_desde_texto(const std::string& texto, bool& valido);
+const char* nombre_nivel_log(NivelLog nivel);
+
+#endif
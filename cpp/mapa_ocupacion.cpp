@@ -0,0 +1,315 @@
+#include "mapa_ocupacion.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+static size_t palabras_bits(int capacidad) {
+    return ((size_t)capacidad + 63) / 64;
+}
+
+RegionMapeada::RegionMapeada() : datos(nullptr), tamano(0) {
+#ifdef _WIN32
+    archivo = INVALID_HANDLE_VALUE;
+    mapeo = nullptr;
+#else
+    archivo = -1;
+#endif
+}
+
+RegionMapeada::~RegionMapeada() {
+    desmapear();
+}
+
+bool RegionMapeada::mapear(const std::string& ruta, bool escritura, size_t tamano_minimo) {
+#ifdef _WIN32
+    archivo = CreateFileA(ruta.c_str(), escritura ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          escritura ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (archivo == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER largo;
+    GetFileSizeEx(archivo, &largo);
+    tamano = (size_t)largo.QuadPart;
+    if (tamano < tamano_minimo) {
+        tamano = tamano_minimo; // CreateFileMapping extiende el archivo
+    }
+    if (tamano == 0) {
+        desmapear();
+        return false;
+    }
+    mapeo = CreateFileMappingA(archivo, nullptr, escritura ? PAGE_READWRITE : PAGE_READONLY,
+                               (DWORD)((uint64_t)tamano >> 32), (DWORD)tamano, nullptr);
+    if (mapeo == nullptr) {
+        desmapear();
+        return false;
+    }
+    datos = (char*)MapViewOfFile(mapeo, escritura ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, tamano);
+#else
+    archivo = open(ruta.c_str(), escritura ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (archivo < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(archivo, &info) != 0) {
+        desmapear();
+        return false;
+    }
+    tamano = (size_t)info.st_size;
+    if (tamano < tamano_minimo) {
+        // Archivo nuevo: los bytes agregados quedan en cero
+        if (ftruncate(archivo, tamano_minimo) != 0) {
+            desmapear();
+            return false;
+        }
+        tamano = tamano_minimo;
+    }
+    if (tamano == 0) {
+        desmapear();
+        return false;
+    }
+    void* p = mmap(nullptr, tamano, escritura ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                   MAP_SHARED, archivo, 0);
+    datos = (p == MAP_FAILED) ? nullptr : static_cast<char*>(p);
+#endif
+    if (datos == nullptr) {
+        desmapear();
+        return false;
+    }
+    return true;
+}
+
+void RegionMapeada::desmapear() {
+#ifdef _WIN32
+    if (datos) UnmapViewOfFile(datos);
+    if (mapeo) CloseHandle(mapeo);
+    if (archivo != INVALID_HANDLE_VALUE) CloseHandle(archivo);
+    mapeo = nullptr;
+    archivo = INVALID_HANDLE_VALUE;
+#else
+    if (datos) munmap(datos, tamano);
+    if (archivo >= 0) close(archivo);
+    archivo = -1;
+#endif
+    datos = nullptr;
+    tamano = 0;
+}
+
+bool RegionMapeada::validar(int cap_carros, int cap_motos) const {
+    if (tamano < sizeof(CabeceraMapa)) {
+        return false;
+    }
+    const CabeceraMapa& c = cabecera();
+    if (memcmp(c.magia, MAGIA_MAPA, sizeof(c.magia)) != 0 || c.version != VERSION_MAPA ||
+        c.tamano_cabecera != sizeof(CabeceraMapa) || c.tamano_espacio != sizeof(EspacioMapa) ||
+        c.tamano_total > tamano || c.capacidad_carros < 0 || c.capacidad_motos < 0) {
+        return false;
+    }
+    if (cap_carros >= 0 && (c.capacidad_carros != cap_carros || c.capacidad_motos != cap_motos)) {
+        return false;
+    }
+    // Las secciones deben caber en el archivo
+    size_t espacios = (size_t)c.capacidad_carros + c.capacidad_motos;
+    return c.offset_espacios + espacios * sizeof(EspacioMapa) <= c.offset_bits_carros &&
+           c.offset_bits_carros + palabras_bits(c.capacidad_carros) * 8 <= c.offset_bits_motos &&
+           c.offset_bits_motos + palabras_bits(c.capacidad_motos) * 8 <= c.tamano_total;
+}
+
+int RegionMapeada::capacidad(TipoVehiculo tipo) const {
+    return tipo == TipoVehiculo::CARRO ? cabecera().capacidad_carros : cabecera().capacidad_motos;
+}
+
+EspacioMapa* RegionMapeada::espacio(TipoVehiculo tipo, int espacio) const {
+    size_t indice = (size_t)(espacio - 1);
+    if (tipo == TipoVehiculo::MOTO) {
+        indice += cabecera().capacidad_carros;
+    }
+    return reinterpret_cast<EspacioMapa*>(datos + cabecera().offset_espacios) + indice;
+}
+
+std::atomic<uint64_t>* RegionMapeada::bits(TipoVehiculo tipo) const {
+    uint64_t offset = tipo == TipoVehiculo::CARRO ? cabecera().offset_bits_carros
+                                                  : cabecera().offset_bits_motos;
+    return reinterpret_cast<std::atomic<uint64_t>*>(datos + offset);
+}
+
+bool RegionMapeada::leer_espacio(TipoVehiculo tipo, int numero, EstadoEspacio& destino) const {
+    if (!datos || numero < 1 || numero > capacidad(tipo)) {
+        return false;
+    }
+    const EspacioMapa* e = espacio(tipo, numero);
+    while (true) {
+        uint32_t antes = e->version.load(std::memory_order_acquire);
+        if (antes & 1) {
+            continue; // Escritura en curso
+        }
+        destino.ocupado = e->ocupado != 0;
+        destino.tipo = (TipoVehiculo)e->tipo;
+        destino.placa = e->placa;
+        destino.hora_entrada = (time_t)e->hora_entrada;
+        destino.secuencia = e->secuencia;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e->version.load(std::memory_order_relaxed) == antes) {
+            return true;
+        }
+    }
+}
+
+int RegionMapeada::ocupados(TipoVehiculo tipo) const {
+    return tipo == TipoVehiculo::CARRO ? cabecera().ocupados_carros.load()
+                                       : cabecera().ocupados_motos.load();
+}
+
+bool MapaOcupacion::abrir(const std::string& ruta, int cap_carros, int cap_motos,
+                          double tarifa_carro, double tarifa_moto) {
+    size_t offset_espacios = sizeof(CabeceraMapa);
+    size_t offset_bits_carros = offset_espacios +
+                                ((size_t)cap_carros + cap_motos) * sizeof(EspacioMapa);
+    size_t offset_bits_motos = offset_bits_carros + palabras_bits(cap_carros) * 8;
+    size_t tamano_total = offset_bits_motos + palabras_bits(cap_motos) * 8;
+
+    if (!mapear(ruta, true, sizeof(CabeceraMapa))) {
+        std::cerr << "❌ No se pudo mapear " << ruta << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    CabeceraMapa& c = cabecera_escritura();
+    existia = memcmp(c.magia, MAGIA_MAPA, sizeof(c.magia)) == 0;
+    if (existia) {
+        if (!validar(cap_carros, cap_motos)) {
+            std::cerr << "❌ " << ruta << " tiene otra versión o capacidad" << std::endl;
+            desmapear();
+            return false;
+        }
+    } else {
+        // Archivo nuevo: dimensionar y escribir la cabecera
+        desmapear();
+        if (!mapear(ruta, true, tamano_total)) {
+            std::cerr << "❌ No se pudo crear " << ruta << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        CabeceraMapa& nueva = cabecera_escritura();
+        nueva.version = VERSION_MAPA;
+        nueva.tamano_cabecera = sizeof(CabeceraMapa);
+        nueva.tamano_espacio = sizeof(EspacioMapa);
+        nueva.capacidad_carros = cap_carros;
+        nueva.capacidad_motos = cap_motos;
+        nueva.offset_espacios = offset_espacios;
+        nueva.offset_bits_carros = offset_bits_carros;
+        nueva.offset_bits_motos = offset_bits_motos;
+        nueva.tamano_total = tamano_total;
+        // La magia va al final: un archivo a medio crear no se da por válido
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(nueva.magia, MAGIA_MAPA, sizeof(nueva.magia));
+    }
+    cabecera_escritura().tarifa_hora_carro = tarifa_carro;
+    cabecera_escritura().tarifa_hora_moto = tarifa_moto;
+    return true;
+}
+
+void MapaOcupacion::escribir(TipoVehiculo tipo, int numero, bool ocupado, PlacaCompacta placa,
+                             time_t hora_entrada, uint64_t secuencia) {
+    EspacioMapa* e = espacio(tipo, numero);
+    uint32_t version = e->version.load(std::memory_order_relaxed);
+    e->version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e->ocupado = ocupado ? 1 : 0;
+    e->tipo = (uint8_t)tipo;
+    e->placa = placa;
+    e->hora_entrada = (int64_t)hora_entrada;
+    e->secuencia = secuencia;
+    e->version.store(version + 2, std::memory_order_release);
+
+    size_t indice = (size_t)(numero - 1);
+    uint64_t bit = (uint64_t)1 << (indice % 64);
+    std::atomic<int32_t>& contador = tipo == TipoVehiculo::CARRO
+                                         ? cabecera_escritura().ocupados_carros
+                                         : cabecera_escritura().ocupados_motos;
+    if (ocupado) {
+        bits(tipo)[indice / 64].fetch_or(bit, std::memory_order_relaxed);
+        contador.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        bits(tipo)[indice / 64].fetch_and(~bit, std::memory_order_relaxed);
+        contador.fetch_sub(1, std::memory_order_relaxed);
+    }
+    cabecera_escritura().generacion.fetch_add(1, std::memory_order_release);
+}
+
+void MapaOcupacion::ocupar(TipoVehiculo tipo, int numero, PlacaCompacta placa,
+                           time_t hora_entrada, uint64_t secuencia) {
+    escribir(tipo, numero, true, placa, hora_entrada, secuencia);
+}
+
+void MapaOcupacion::liberar(TipoVehiculo tipo, int numero, uint64_t secuencia) {
+    escribir(tipo, numero, false, 0, 0, secuencia);
+}
+
+void MapaOcupacion::reconstruir_indices() {
+    TipoVehiculo tipos[] = {TipoVehiculo::CARRO, TipoVehiculo::MOTO};
+    for (size_t t = 0; t < 2; t++) {
+        int cap = capacidad(tipos[t]);
+        std::atomic<uint64_t>* palabras = bits(tipos[t]);
+        int32_t total = 0;
+        for (size_t w = 0; w < palabras_bits(cap); w++) {
+            uint64_t palabra = 0;
+            for (int i = (int)(w * 64); i < cap && i < (int)(w * 64 + 64); i++) {
+                if (espacio(tipos[t], i + 1)->ocupado) {
+                    palabra |= (uint64_t)1 << (i % 64);
+                    total++;
+                }
+            }
+            palabras[w].store(palabra, std::memory_order_relaxed);
+        }
+        (tipos[t] == TipoVehiculo::CARRO ? cabecera_escritura().ocupados_carros
+                                         : cabecera_escritura().ocupados_motos).store(total);
+    }
+}
+
+uint64_t MapaOcupacion::maxima_secuencia() const {
+    uint64_t maxima = secuencia_instantanea();
+    size_t total = (size_t)cabecera().capacidad_carros + cabecera().capacidad_motos;
+    const EspacioMapa* espacios = reinterpret_cast<const EspacioMapa*>(datos + cabecera().offset_espacios);
+    for (size_t i = 0; i < total; i++) {
+        if (espacios[i].secuencia > maxima) {
+            maxima = espacios[i].secuencia;
+        }
+    }
+    return maxima;
+}
+
+bool MapaOcupacion::sincronizar(uint64_t secuencia_cubierta) {
+#ifdef _WIN32
+    bool ok = FlushViewOfFile(datos, tamano) && FlushFileBuffers((HANDLE)archivo);
+#else
+    bool ok = msync(datos, tamano, MS_SYNC) == 0;
+#endif
+    if (!ok) {
+        return false;
+    }
+    cabecera_escritura().secuencia_instantanea.store(secuencia_cubierta, std::memory_order_release);
+#ifdef _WIN32
+    return FlushViewOfFile(datos, sizeof(CabeceraMapa)) && FlushFileBuffers((HANDLE)archivo);
+#else
+    return msync(datos, sizeof(CabeceraMapa), MS_SYNC) == 0;
+#endif
+}
+
+bool LectorOcupacion::abrir(const std::string& ruta) {
+    if (!mapear(ruta, false, 0)) {
+        return false;
+    }
+    if (!validar(-1, -1)) {
+        desmapear();
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#ifndef MAPA_OCUPACION_HPP
+#define MAPA_OCUPACION_HPP
+
+#include "tabla_placas.hpp"
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Archivo de ocupación mapeado en memoria (ocupacion.map).
+//
+// Disposición fija, little-endian:
+//   CabeceraMapa                          128 bytes
+//   EspacioMapa[capacidad_carros]         32 bytes c/u, espacio 1..N
+//   EspacioMapa[capacidad_motos]
+//   uint64_t bits_carros[(N + 63) / 64]   bit en 1 = ocupado
+//   uint64_t bits_motos[...]
+//
+// El parqueadero lo actualiza en cada entrada/salida, así el archivo es a
+// la vez la instantánea que se carga al arrancar y una vista en vivo que
+// otros procesos pueden mapear en solo lectura (LectorOcupacion).
+// Cada espacio lleva un contador de versión (seqlock): impar mientras se
+// escribe; el lector reintenta si cambió durante la copia.
+
+static const char MAGIA_MAPA[8] = {'P', 'Q', 'M', 'A', 'P', 'A', '0', '1'};
+static const uint32_t VERSION_MAPA = 1;
+
+struct CabeceraMapa {
+    char magia[8];
+    uint32_t version;
+    uint32_t tamano_cabecera;
+    uint32_t tamano_espacio;
+    int32_t capacidad_carros;
+    int32_t capacidad_motos;
+    uint32_t relleno;
+    uint64_t offset_espacios;
+    uint64_t offset_bits_carros;
+    uint64_t offset_bits_motos;
+    uint64_t tamano_total;
+    double tarifa_hora_carro;
+    double tarifa_hora_moto;
+    std::atomic<uint64_t> secuencia_instantanea; // Bitácora: todo <= esto está en disco
+    std::atomic<uint64_t> generacion;            // Sube con cada cambio
+    std::atomic<int32_t> ocupados_carros;
+    std::atomic<int32_t> ocupados_motos;
+    uint8_t reservado[128 - 104];
+};
+static_assert(sizeof(CabeceraMapa) == 128, "CabeceraMapa debe medir 128 bytes");
+
+struct EspacioMapa {
+    std::atomic<uint32_t> version;  // Impar: escritura en curso
+    uint8_t ocupado;
+    uint8_t tipo;                   // TipoVehiculo
+    uint16_t relleno;
+    PlacaCompacta placa;
+    int64_t hora_entrada;
+    uint64_t secuencia;             // Registro de bitácora del último cambio
+};
+static_assert(sizeof(EspacioMapa) == 32, "EspacioMapa debe medir 32 bytes");
+
+// Copia coherente de un espacio
+struct EstadoEspacio {
+    bool ocupado;
+    TipoVehiculo tipo;
+    PlacaCompacta placa;
+    time_t hora_entrada;
+    uint64_t secuencia;
+};
+
+// Región de archivo mapeada; base de MapaOcupacion y LectorOcupacion
+class RegionMapeada {
+public:
+    RegionMapeada();
+    ~RegionMapeada();
+
+    bool mapeada() const { return datos != nullptr; }
+    const CabeceraMapa& cabecera() const { return *reinterpret_cast<const CabeceraMapa*>(datos); }
+    int capacidad(TipoVehiculo tipo) const;
+
+    // Copia coherente (seqlock) del espacio 1..capacidad
+    bool leer_espacio(TipoVehiculo tipo, int espacio, EstadoEspacio& destino) const;
+    int ocupados(TipoVehiculo tipo) const;
+    uint64_t generacion() const { return cabecera().generacion.load(std::memory_order_acquire); }
+
+protected:
+    char* datos;
+    size_t tamano;
+#ifdef _WIN32
+    void* archivo;
+    void* mapeo;
+#else
+    int archivo;
+#endif
+
+    bool mapear(const std::string& ruta, bool escritura, size_t tamano_minimo);
+    void desmapear();
+    bool validar(int cap_carros, int cap_motos) const;
+    EspacioMapa* espacio(TipoVehiculo tipo, int espacio) const;
+    std::atomic<uint64_t>* bits(TipoVehiculo tipo) const;
+
+private:
+    RegionMapeada(const RegionMapeada&);
+    RegionMapeada& operator=(const RegionMapeada&);
+};
+
+// Lado del parqueadero: crea/abre el archivo y escribe los cambios.
+// escribir() para un mismo espacio debe llamarse en orden; lo garantiza
+// el asignador (un espacio tiene a lo sumo un dueño a la vez).
+class MapaOcupacion : public RegionMapeada {
+public:
+    MapaOcupacion() : existia(false) {}
+
+    // Abre ruta o la crea vacía. Si existe con otra capacidad o versión,
+    // falla sin tocarla.
+    bool abrir(const std::string& ruta, int cap_carros, int cap_motos,
+               double tarifa_carro, double tarifa_moto);
+
+    // true si el archivo ya existía y trae estado para cargar
+    bool tenia_estado() const { return existia; }
+
+    void ocupar(TipoVehiculo tipo, int espacio, PlacaCompacta placa,
+                time_t hora_entrada, uint64_t secuencia);
+    void liberar(TipoVehiculo tipo, int espacio, uint64_t secuencia);
+
+    // Recalcular bits y contadores desde los espacios (tras un corte del
+    // sistema sólo parte de las páginas pudo llegar a disco)
+    void reconstruir_indices();
+
+    // Llevar a disco todo lo escrito; luego registrar la secuencia de
+    // bitácora que queda cubierta
+    bool sincronizar(uint64_t secuencia_cubierta);
+
+    // Mayor secuencia escrita en algún espacio; puede superar a la última
+    // de la bitácora si el proceso murió con registros sin escribir
+    uint64_t maxima_secuencia() const;
+
+    uint64_t secuencia_instantanea() const {
+        return cabecera().secuencia_instantanea.load(std::memory_order_acquire);
+    }
+
+private:
+    bool existia;
+
+    void escribir(TipoVehiculo tipo, int espacio, bool ocupado, PlacaCompacta placa,
+                  time_t hora_entrada, uint64_t secuencia);
+    CabeceraMapa& cabecera_escritura() { return *reinterpret_cast<CabeceraMapa*>(datos); }
+};
+
+// Lado de los reportes: mapea el archivo en solo lectura
+class LectorOcupacion : public RegionMapeada {
+public:
+    bool abrir(const std::string& ruta);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "metricas.hpp"
+#include <sstream>
+#include <cstring>
+
+static std::atomic<uint64_t> siguiente_id_registro(1);
+
+static uint64_t leer(const std::atomic<uint64_t>& contador) {
+    return contador.load(std::memory_order_relaxed);
+}
+
+uint64_t FotoHistograma::percentil(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t objetivo = (uint64_t)(p / 100.0 * total + 0.5);
+    if (objetivo < 1) objetivo = 1;
+    uint64_t acumulado = 0;
+    for (int i = 0; i < NUM_CUBETAS_METRICAS; i++) {
+        acumulado += cuentas[i];
+        if (acumulado >= objetivo) {
+            return i == 0 ? 0 : ((uint64_t)1 << i) - 1;
+        }
+    }
+    return ((uint64_t)1 << (NUM_CUBETAS_METRICAS - 1)) - 1;
+}
+
+MetricasHilo::MetricasHilo() {
+    std::atomic<uint64_t>* contadores[] = {&conexiones_aceptadas, &conexiones_cerradas, &mensajes,
+                                           &bytes_recibidos, &bytes_enviados};
+    for (size_t i = 0; i < sizeof(contadores) / sizeof(contadores[0]); i++) {
+        contadores[i]->store(0, std::memory_order_relaxed);
+    }
+    for (int o = 0; o < 2; o++) {
+        for (int t = 0; t < 2; t++) {
+            eventos[o][t].store(0, std::memory_order_relaxed);
+            eventos_otros[o][t].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < NUM_ERRORES_MENSAJE; i++) rechazos_mensaje[i].store(0, std::memory_order_relaxed);
+    for (int i = 0; i < NUM_CODIGOS_RESULTADO; i++) rechazos_operacion[i].store(0, std::memory_order_relaxed);
+    for (int d = 0; d < MAX_DISPOSITIVOS; d++) {
+        dispositivos[d].ocupada.store(false, std::memory_order_relaxed);
+        dispositivos[d].largo = 0;
+        for (int o = 0; o < 2; o++) {
+            for (int t = 0; t < 2; t++) dispositivos[d].eventos[o][t].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MetricasHilo::mensaje_parseado(ErrorMensaje error) {
+    sumar(mensajes);
+    if (error != ErrorMensaje::NINGUNO) {
+        sumar(rechazos_mensaje[(int)error]);
+    }
+}
+
+void MetricasHilo::operacion(const MensajeDispositivo& mensaje, TipoVehiculo tipo,
+                             CodigoResultado codigo) {
+    if (codigo != CodigoResultado::OK) {
+        sumar(rechazos_operacion[(int)codigo]);
+        return;
+    }
+    int o = (int)mensaje.operacion;
+    int t = (int)tipo;
+    sumar(eventos[o][t]);
+    sumar(*contador_dispositivo(mensaje.dispositivo, o, t));
+}
+
+std::atomic<uint64_t>* MetricasHilo::contador_dispositivo(const Fragmento& nombre, int o, int t) {
+    size_t largo = nombre.largo < sizeof(dispositivos[0].nombre) ? nombre.largo
+                                                                   : sizeof(dispositivos[0].nombre);
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < largo; i++) {
+        h = (h ^ (unsigned char)nombre.datos[i]) * 16777619u;
+    }
+    for (int intento = 0; intento < MAX_DISPOSITIVOS; intento++) {
+        CeldaDispositivo& c = dispositivos[(h + intento) % MAX_DISPOSITIVOS];
+        if (!c.ocupada.load(std::memory_order_relaxed)) {
+            // Sólo este hilo escribe: publicar el nombre y luego la celda
+            memcpy(c.nombre, nombre.datos, largo);
+            c.largo = (uint8_t)largo;
+            c.ocupada.store(true, std::memory_order_release);
+            return &c.eventos[o][t];
+        }
+        if (c.largo == largo && memcmp(c.nombre, nombre.datos, largo) == 0) {
+            return &c.eventos[o][t];
+        }
+    }
+    return &eventos_otros[o][t];
+}
+
+void MetricasHilo::sumar_a(FotoMetricas& foto) const {
+    foto.conexiones_aceptadas += leer(conexiones_aceptadas);
+    foto.conexiones_cerradas += leer(conexiones_cerradas);
+    foto.mensajes += leer(mensajes);
+    foto.bytes_recibidos += leer(bytes_recibidos);
+    foto.bytes_enviados += leer(bytes_enviados);
+    for (int o = 0; o < 2; o++) {
+        for (int t = 0; t < 2; t++) {
+            foto.eventos[o][t] += leer(eventos[o][t]);
+            foto.eventos_otros_dispositivos[o][t] += leer(eventos_otros[o][t]);
+        }
+    }
+    for (int i = 0; i < NUM_ERRORES_MENSAJE; i++) foto.rechazos_mensaje[i] += leer(rechazos_mensaje[i]);
+    for (int i = 0; i < NUM_CODIGOS_RESULTADO; i++) foto.rechazos_operacion[i] += leer(rechazos_operacion[i]);
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        for (int i = 0; i < NUM_CUBETAS_METRICAS; i++) {
+            uint64_t n = latencias[e].cuenta(i);
+            foto.latencias[e].cuentas[i] += n;
+            foto.latencias[e].total += n;
+        }
+        foto.latencias[e].suma_ns += latencias[e].suma_ns();
+    }
+
+    for (int d = 0; d < MAX_DISPOSITIVOS; d++) {
+        const CeldaDispositivo& c = dispositivos[d];
+        if (!c.ocupada.load(std::memory_order_acquire)) {
+            continue;
+        }
+        std::string nombre(c.nombre, c.largo);
+        EventosDispositivo* destino = nullptr;
+        for (size_t i = 0; i < foto.dispositivos.size(); i++) {
+            if (foto.dispositivos[i].nombre == nombre) {
+                destino = &foto.dispositivos[i];
+                break;
+            }
+        }
+        if (destino == nullptr) {
+            EventosDispositivo nuevo;
+            nuevo.nombre = nombre;
+            memset(nuevo.eventos, 0, sizeof(nuevo.eventos));
+            foto.dispositivos.push_back(nuevo);
+            destino = &foto.dispositivos.back();
+        }
+        for (int o = 0; o < 2; o++) {
+            for (int t = 0; t < 2; t++) destino->eventos[o][t] += leer(c.eventos[o][t]);
+        }
+    }
+}
+
+MetricasServidor::MetricasServidor() : id(siguiente_id_registro.fetch_add(1)) {}
+
+MetricasHilo& MetricasServidor::hilo() {
+    struct Cache {
+        uint64_t id;
+        MetricasHilo* hilo;
+    };
+    static thread_local Cache cache = {0, nullptr};
+    if (cache.id == id) {
+        return *cache.hilo;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::thread::id actual = std::this_thread::get_id();
+    MetricasHilo* encontrado = nullptr;
+    for (size_t i = 0; i < hilos.size(); i++) {
+        if (hilos[i]->dueno == actual) {
+            encontrado = hilos[i].get();
+            break;
+        }
+    }
+    if (encontrado == nullptr) {
+        hilos.push_back(std::unique_ptr<MetricasHilo>(new MetricasHilo()));
+        encontrado = hilos.back().get();
+        encontrado->dueno = actual;
+    }
+    cache.id = id;
+    cache.hilo = encontrado;
+    return *encontrado;
+}
+
+FotoMetricas MetricasServidor::foto() const {
+    FotoMetricas foto;
+    memset(foto.eventos, 0, sizeof(foto.eventos));
+    memset(foto.eventos_otros_dispositivos, 0, sizeof(foto.eventos_otros_dispositivos));
+    memset(foto.rechazos_mensaje, 0, sizeof(foto.rechazos_mensaje));
+    memset(foto.rechazos_operacion, 0, sizeof(foto.rechazos_operacion));
+    memset(foto.latencias, 0, sizeof(foto.latencias));
+    foto.conexiones_aceptadas = foto.conexiones_cerradas = foto.mensajes = 0;
+    foto.bytes_recibidos = foto.bytes_enviados = 0;
+    foto.cola_eventos = foto.capacidad_cola = foto.eventos_descartados = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < hilos.size(); i++) {
+        hilos[i]->sumar_a(foto);
+    }
+    return foto;
+}
+
+const char* nombre_etapa(EtapaServidor etapa) {
+    switch (etapa) {
+        case EtapaServidor::ACEPTAR: return "aceptar";
+        case EtapaServidor::PARSEAR: return "parsear";
+        case EtapaServidor::PROCESAR: return "procesar";
+        case EtapaServidor::ENVIAR: return "enviar";
+    }
+    return "desconocida";
+}
+
+static const char* MOTIVOS_MENSAJE[NUM_ERRORES_MENSAJE] = {
+    "ninguno", "vacio", "campos_faltantes", "campos_sobrantes",
+    "operacion_desconocida", "placa_invalida", "tipo_invalido", "lote_desconocido",
+    "repetido", "sinc_invalida", "duplicado"
+};
+
+static const char* MOTIVOS_OPERACION[NUM_CODIGOS_RESULTADO] = {
+    "ok", "ya_presente", "no_presente", "sin_espacio", "placa_invalida", "tipo_invalido",
+    "error_bitacora"
+};
+
+const char* motivo_mensaje(ErrorMensaje error) {
+    return MOTIVOS_MENSAJE[(int)error];
+}
+
+const char* motivo_operacion(CodigoResultado codigo) {
+    return MOTIVOS_OPERACION[(int)codigo];
+}
+
+static const char* OPERACIONES[2] = {"entrada", "salida"};
+static const char* TIPOS[2] = {"carro", "moto"};
+
+// Escapar un valor de etiqueta: \ " y salto de línea
+static std::string escapar_etiqueta(const std::string& valor) {
+    std::string r;
+    for (size_t i = 0; i < valor.size(); i++) {
+        char c = valor[i];
+        if (c == '\\' || c == '"') {
+            r += '\\';
+            r += c;
+        } else if (c == '\n') {
+            r += "\\n";
+        } else {
+            r += c;
+        }
+    }
+    return r;
+}
+
+static void encabezado(std::ostringstream& ss, const char* nombre, const char* tipo, const char* ayuda) {
+    ss << "# HELP " << nombre << " " << ayuda << "\n# TYPE " << nombre << " " << tipo << "\n";
+}
+
+std::string formatear_prometheus(const FotoMetricas& foto) {
+    std::ostringstream ss;
+
+    encabezado(ss, "parqueadero_conexiones_aceptadas_total", "counter", "Conexiones de dispositivos aceptadas");
+    ss << "parqueadero_conexiones_aceptadas_total " << foto.conexiones_aceptadas << "\n";
+    encabezado(ss, "parqueadero_conexiones_activas", "gauge", "Conexiones de dispositivos abiertas");
+    ss << "parqueadero_conexiones_activas "
+       << (foto.conexiones_aceptadas > foto.conexiones_cerradas ? foto.conexiones_aceptadas - foto.conexiones_cerradas : 0)
+       << "\n";
+    encabezado(ss, "parqueadero_mensajes_total", "counter", "Mensajes recibidos (válidos o no)");
+    ss << "parqueadero_mensajes_total " << foto.mensajes << "\n";
+    encabezado(ss, "parqueadero_bytes_recibidos_total", "counter", "Bytes recibidos de dispositivos");
+    ss << "parqueadero_bytes_recibidos_total " << foto.bytes_recibidos << "\n";
+    encabezado(ss, "parqueadero_bytes_enviados_total", "counter", "Bytes enviados a dispositivos");
+    ss << "parqueadero_bytes_enviados_total " << foto.bytes_enviados << "\n";
+
+    encabezado(ss, "parqueadero_eventos_total", "counter", "Entradas y salidas exitosas");
+    for (int o = 0; o < 2; o++) {
+        for (int t = 0; t < 2; t++) {
+            ss << "parqueadero_eventos_total{operacion=\"" << OPERACIONES[o] << "\",tipo=\""
+               << TIPOS[t] << "\"} " << foto.eventos[o][t] << "\n";
+        }
+    }
+
+    encabezado(ss, "parqueadero_eventos_dispositivo_total", "counter",
+               "Entradas y salidas exitosas por dispositivo");
+    for (size_t d = 0; d < foto.dispositivos.size(); d++) {
+        std::string nombre = escapar_etiqueta(foto.dispositivos[d].nombre);
+        for (int o = 0; o < 2; o++) {
+            for (int t = 0; t < 2; t++) {
+                ss << "parqueadero_eventos_dispositivo_total{dispositivo=\"" << nombre
+                   << "\",operacion=\"" << OPERACIONES[o] << "\",tipo=\"" << TIPOS[t] << "\"} "
+                   << foto.dispositivos[d].eventos[o][t] << "\n";
+            }
+        }
+    }
+    for (int o = 0; o < 2; o++) {
+        for (int t = 0; t < 2; t++) {
+            if (foto.eventos_otros_dispositivos[o][t] > 0) {
+                ss << "parqueadero_eventos_dispositivo_total{dispositivo=\"_otros\",operacion=\""
+                   << OPERACIONES[o] << "\",tipo=\"" << TIPOS[t] << "\"} "
+                   << foto.eventos_otros_dispositivos[o][t] << "\n";
+            }
+        }
+    }
+
+    encabezado(ss, "parqueadero_rechazos_total", "counter",
+               "Mensajes rechazados al parsear o por el parqueadero, por motivo");
+    for (int i = 1; i < NUM_ERRORES_MENSAJE; i++) {
+        ss << "parqueadero_rechazos_total{etapa=\"mensaje\",motivo=\"" << MOTIVOS_MENSAJE[i] << "\"} "
+           << foto.rechazos_mensaje[i] << "\n";
+    }
+    for (int i = 1; i < NUM_CODIGOS_RESULTADO; i++) {
+        ss << "parqueadero_rechazos_total{etapa=\"operacion\",motivo=\"" << MOTIVOS_OPERACION[i] << "\"} "
+           << foto.rechazos_operacion[i] << "\n";
+    }
+
+    encabezado(ss, "parqueadero_cola_eventos", "gauge", "Eventos en cola esperando a Python");
+    ss << "parqueadero_cola_eventos " << foto.cola_eventos << "\n";
+    encabezado(ss, "parqueadero_cola_eventos_capacidad", "gauge", "Capacidad de la cola de eventos");
+    ss << "parqueadero_cola_eventos_capacidad " << foto.capacidad_cola << "\n";
+    encabezado(ss, "parqueadero_eventos_descartados_total", "counter", "Eventos perdidos con la cola llena");
+    ss << "parqueadero_eventos_descartados_total " << foto.eventos_descartados << "\n";
+
+    encabezado(ss, "parqueadero_latencia_segundos", "histogram",
+               "Tiempo por etapa del servidor (cubetas por potencia de dos)");
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        const FotoHistograma& h = foto.latencias[e];
+        const char* etapa = nombre_etapa((EtapaServidor)e);
+        uint64_t acumulado = 0;
+        for (int i = 0; i < NUM_CUBETAS_METRICAS - 1; i++) {
+            acumulado += h.cuentas[i];
+            // Cubeta i: valores menores que 2^i ns. Omitir las menores a 64 ns.
+            if (i < 6) {
+                continue;
+            }
+            ss << "parqueadero_latencia_segundos_bucket{etapa=\"" << etapa << "\",le=\""
+               << (double)((uint64_t)1 << i) / 1e9 << "\"} " << acumulado << "\n";
+        }
+        ss << "parqueadero_latencia_segundos_bucket{etapa=\"" << etapa << "\",le=\"+Inf\"} "
+           << h.total << "\n";
+        ss << "parqueadero_latencia_segundos_sum{etapa=\"" << etapa << "\"} " << h.suma_ns / 1e9 << "\n";
+        ss << "parqueadero_latencia_segundos_count{etapa=\"" << etapa << "\"} " << h.total << "\n";
+    }
+    return ss.str();
+}
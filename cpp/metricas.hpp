@@ -0,0 +1,182 @@
+#ifndef METRICAS_HPP
+#define METRICAS_HPP
+
+#include "protocolo.hpp"
+#include "parqueadero.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+// Métricas del servidor de dispositivos sin locks en el camino caliente.
+//
+// Cada hilo de red escribe sólo en su propio MetricasHilo (contadores
+// relajados, sin instrucciones atómicas de lectura-modificación-escritura)
+// y los lectores suman todos los hilos al pedir una foto. Los bloques de
+// cada hilo van rellenos para no compartir líneas de caché.
+
+enum class EtapaServidor : uint8_t {
+    ACEPTAR = 0,  // accept() de una conexión
+    PARSEAR,      // parsear_mensaje()
+    PROCESAR,     // Operación sobre el parqueadero
+    ENVIAR        // send() de las respuestas pendientes
+};
+static const int NUM_ETAPAS = 4;
+static const int NUM_ERRORES_MENSAJE = 11;   // ErrorMensaje
+static const int NUM_CODIGOS_RESULTADO = 7; // CodigoResultado
+
+// Una cubeta por potencia de dos en nanosegundos: cubeta i cuenta los
+// valores con i bits significativos (la última acumula el resto)
+static const int NUM_CUBETAS_METRICAS = 40;
+
+// Histograma escrito por un solo hilo y leído por cualquiera
+class HistogramaAtomico {
+public:
+    HistogramaAtomico() : suma(0) {
+        for (int i = 0; i < NUM_CUBETAS_METRICAS; i++) cuentas[i].store(0, std::memory_order_relaxed);
+    }
+
+    void registrar(uint64_t ns) {
+        std::atomic<uint64_t>& c = cuentas[cubeta(ns)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        suma.store(suma.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    uint64_t cuenta(int i) const { return cuentas[i].load(std::memory_order_relaxed); }
+    uint64_t suma_ns() const { return suma.load(std::memory_order_relaxed); }
+
+    static int cubeta(uint64_t ns) {
+        if (ns == 0) {
+            return 0;
+        }
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanReverse64(&i, ns);
+        int bits = (int)i + 1;
+#else
+        int bits = 64 - __builtin_clzll(ns);
+#endif
+        return bits < NUM_CUBETAS_METRICAS ? bits : NUM_CUBETAS_METRICAS - 1;
+    }
+
+private:
+    std::atomic<uint64_t> cuentas[NUM_CUBETAS_METRICAS];
+    std::atomic<uint64_t> suma;
+};
+
+// Eventos exitosos de un dispositivo: [operación][tipo de vehículo]
+struct EventosDispositivo {
+    std::string nombre;
+    uint64_t eventos[2][2];
+};
+
+struct FotoHistograma {
+    uint64_t cuentas[NUM_CUBETAS_METRICAS];
+    uint64_t total;
+    uint64_t suma_ns;
+
+    // Límite superior de la cubeta donde cae el percentil p (0-100)
+    uint64_t percentil(double p) const;
+};
+
+// Suma de las métricas de todos los hilos en un instante
+struct FotoMetricas {
+    uint64_t conexiones_aceptadas;
+    uint64_t conexiones_cerradas;
+    uint64_t mensajes;
+    uint64_t bytes_recibidos;
+    uint64_t bytes_enviados;
+    uint64_t eventos[2][2];          // Exitosos: [OperacionMensaje][TipoVehiculo]
+    uint64_t rechazos_mensaje[NUM_ERRORES_MENSAJE];     // Por ErrorMensaje
+    uint64_t rechazos_operacion[NUM_CODIGOS_RESULTADO]; // Por CodigoResultado
+    FotoHistograma latencias[NUM_ETAPAS];
+    std::vector<EventosDispositivo> dispositivos;
+    uint64_t eventos_otros_dispositivos[2][2]; // Dispositivos que no cupieron en la tabla
+    size_t cola_eventos;
+    size_t capacidad_cola;
+    size_t eventos_descartados;
+};
+
+class MetricasHilo {
+public:
+    // Dispositivos distintos que se cuentan por separado en cada hilo
+    static const int MAX_DISPOSITIVOS = 64;
+
+    MetricasHilo();
+
+    void sumar(std::atomic<uint64_t>& contador, uint64_t n = 1) {
+        contador.store(contador.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void conexion_aceptada() { sumar(conexiones_aceptadas); }
+    void conexion_cerrada() { sumar(conexiones_cerradas); }
+    void recibidos(size_t bytes) { sumar(bytes_recibidos, bytes); }
+    void enviados(size_t bytes) { sumar(bytes_enviados, bytes); }
+    void registrar(EtapaServidor etapa, uint64_t ns) { latencias[(int)etapa].registrar(ns); }
+    void mensaje_parseado(ErrorMensaje error);
+    // Resultado de la operación sobre el parqueadero
+    void operacion(const MensajeDispositivo& mensaje, TipoVehiculo tipo, CodigoResultado codigo);
+
+    void sumar_a(FotoMetricas& foto) const;
+
+    std::thread::id dueno;
+
+private:
+    char relleno_inicio[64];
+    std::atomic<uint64_t> conexiones_aceptadas;
+    std::atomic<uint64_t> conexiones_cerradas;
+    std::atomic<uint64_t> mensajes;
+    std::atomic<uint64_t> bytes_recibidos;
+    std::atomic<uint64_t> bytes_enviados;
+    std::atomic<uint64_t> eventos[2][2];
+    std::atomic<uint64_t> rechazos_mensaje[NUM_ERRORES_MENSAJE];
+    std::atomic<uint64_t> rechazos_operacion[NUM_CODIGOS_RESULTADO];
+    HistogramaAtomico latencias[NUM_ETAPAS];
+
+    // Tabla de dispositivos (direccionamiento abierto): el nombre se
+    // escribe una vez y se publica con `ocupada` (release)
+    struct CeldaDispositivo {
+        std::atomic<bool> ocupada;
+        uint8_t largo;
+        char nombre[31];
+        std::atomic<uint64_t> eventos[2][2];
+    };
+    CeldaDispositivo dispositivos[MAX_DISPOSITIVOS];
+    std::atomic<uint64_t> eventos_otros[2][2];
+    char relleno_fin[64];
+
+    std::atomic<uint64_t>* contador_dispositivo(const Fragmento& nombre, int operacion, int tipo);
+};
+
+// Registro de los bloques por hilo de un servidor
+class MetricasServidor {
+public:
+    MetricasServidor();
+
+    // Bloque del hilo actual; se crea en el primer uso de cada hilo
+    MetricasHilo& hilo();
+
+    FotoMetricas foto() const;
+
+private:
+    uint64_t id; // Distingue registros en la caché thread_local
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<MetricasHilo> > hilos;
+};
+
+// Formato de texto de Prometheus (version 0.0.4)
+std::string formatear_prometheus(const FotoMetricas& foto);
+
+const char* nombre_etapa(EtapaServidor etapa);
+// Nombres cortos de los motivos de rechazo (etiquetas de las métricas)
+const char* motivo_mensaje(ErrorMensaje error);
+const char* motivo_operacion(CodigoResultado codigo);
+
+#endif
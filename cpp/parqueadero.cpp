@@ -2,141 +2,736 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
 
 Parqueadero::Parqueadero(int cap_carros, int cap_motos, 
-                         double tarifa_carro, double tarifa_moto)
+                         double tarifa_carro, double tarifa_moto,
+                         PoliticaAsignacion politica)
     : capacidad_carros(cap_carros), 
       capacidad_motos(cap_motos),
+      espacios_carros(cap_carros, politica),
+      espacios_motos(cap_motos, politica),
       tarifa_hora_carro(tarifa_carro),
-      tarifa_hora_moto(tarifa_moto) {
-    
-    espacios_carros.resize(cap_carros, false);
-    espacios_motos.resize(cap_motos, false);
+      tarifa_hora_moto(tarifa_moto),
+      motor_tarifas(nullptr) {
+    configurar_tarifas(ConfiguracionTarifas(tarifa_carro, tarifa_moto));
+
+    // Dimensionar cada partición para la capacidad del parqueadero,
+    // así las entradas no asignan memoria
+    size_t por_particion = (size_t)(cap_carros + cap_motos) / NUM_PARTICIONES + 1;
+    for (size_t i = 0; i < NUM_PARTICIONES; i++) {
+        particiones[i].vehiculos = TablaPlacas(por_particion + por_particion / 2, BITS_PARTICION);
+    }
 }
 
-std::string Parqueadero::registrar_entrada(const std::string& placa, const std::string& tipo) {
-    if (vehiculo_presente(placa)) {
-        return "ERROR: El vehículo con placa " + placa + " ya está en el parqueadero";
+Parqueadero::Particion& Parqueadero::particion(PlacaCompacta placa) {
+    return particiones[hash_placa(placa) & (NUM_PARTICIONES - 1)];
+}
+
+const Parqueadero::Particion& Parqueadero::particion(PlacaCompacta placa) const {
+    return particiones[hash_placa(placa) & (NUM_PARTICIONES - 1)];
+}
+
+ResultadoOperacion Parqueadero::resultado(CodigoResultado codigo) const {
+    ResultadoOperacion r;
+    r.codigo = codigo;
+    r.tipo = TipoVehiculo::CARRO;
+    r.espacio = -1;
+    r.hora_entrada = 0;
+    r.tarifa = 0.0;
+    return r;
+}
+
+ResultadoOperacion Parqueadero::procesar_entrada(PlacaCompacta placa, TipoVehiculo tipo) {
+    return procesar_entrada(placa, tipo, time(nullptr));
+}
+
+ResultadoOperacion Parqueadero::procesar_entrada(PlacaCompacta placa, TipoVehiculo tipo, time_t hora) {
+    uint64_t secuencia = 0;
+    ResultadoOperacion r = entrada(placa, tipo, hora, secuencia);
+    if (!esperar_bitacora(secuencia)) {
+        marcar_sin_bitacora(r);
     }
-    
-    int espacio = asignar_espacio(tipo);
-    if (espacio == -1) {
-        return "ERROR: No hay espacios disponibles para " + tipo;
+    return r;
+}
+
+ResultadoOperacion Parqueadero::entrada(PlacaCompacta placa, TipoVehiculo tipo, time_t hora,
+                                        uint64_t& secuencia) {
+    Particion& p = particion(placa);
+    ResultadoOperacion r = resultado(CodigoResultado::OK);
+    r.tipo = tipo;
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.vehiculos.buscar(placa) != nullptr) {
+            r.codigo = CodigoResultado::YA_PRESENTE;
+            return r;
+        }
+
+        int espacio = asignar_espacio(tipo);
+        if (espacio == -1) {
+            r.codigo = CodigoResultado::SIN_ESPACIO;
+            return r;
+        }
+
+        Vehiculo v;
+        v.placa = placa;
+        v.tipo = tipo;
+        v.hora_entrada = hora;
+        v.espacio = espacio;
+        v.etiqueta = etiqueta_abonado(p, placa, v.hora_entrada);
+        p.vehiculos.insertar(v);
+
+        // Anotar bajo el lock: la bitácora queda en el mismo orden que
+        // las operaciones sobre cada placa
+        if (bitacora) {
+            secuencia = bitacora->anotar(OperacionBitacora::ENTRADA, placa, tipo,
+                                         espacio, v.hora_entrada);
+        }
+        if (mapa) {
+            mapa->ocupar(tipo, espacio, placa, v.hora_entrada, secuencia);
+        }
+        if (cambios) {
+            cambios->publicar(TipoCambio::ENTRADA, placa, tipo, espacio, v.hora_entrada);
+        }
+        r.espacio = espacio;
+        r.hora_entrada = v.hora_entrada;
     }
-    
-    Vehiculo v;
-    v.placa = placa;
-    v.tipo = tipo;
-    v.hora_entrada = time(nullptr);
-    v.espacio = espacio;
-    
-    vehiculos_activos[placa] = v;
-    
-    std::stringstream ss;
-    ss << "OK: Vehículo " << placa << " registrado en espacio " << espacio;
-    return ss.str();
+    return r;
 }
 
-std::string Parqueadero::registrar_salida(const std::string& placa) {
-    if (!vehiculo_presente(placa)) {
-        return "ERROR: El vehículo con placa " + placa + " no está en el parqueadero";
+ResultadoOperacion Parqueadero::procesar_entrada(const std::string& placa, const std::string& tipo) {
+    uint64_t secuencia = 0;
+    ResultadoOperacion r = entrada(placa, tipo, secuencia);
+    if (!esperar_bitacora(secuencia)) {
+        marcar_sin_bitacora(r);
     }
-    
-    Vehiculo v = vehiculos_activos[placa];
-    double tarifa = calcular_tarifa(placa);
-    
-    liberar_espacio(v.tipo, v.espacio);
-    vehiculos_activos.erase(placa);
-    
-    std::stringstream ss;
-    ss << "OK: Vehículo " << placa << " retirado. Tarifa: $" 
-       << std::fixed << std::setprecision(0) << tarifa;
-    return ss.str();
+    return r;
+}
+
+ResultadoOperacion Parqueadero::entrada(const std::string& placa, const std::string& tipo,
+                                        uint64_t& secuencia) {
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return resultado(CodigoResultado::PLACA_INVALIDA);
+    }
+    TipoVehiculo tipo_vehiculo;
+    if (!tipo_desde_texto(tipo, tipo_vehiculo)) {
+        return resultado(CodigoResultado::TIPO_INVALIDO);
+    }
+    return entrada(clave, tipo_vehiculo, time(nullptr), secuencia);
+}
+
+ResultadoOperacion Parqueadero::procesar_salida(PlacaCompacta placa) {
+    return procesar_salida(placa, time(nullptr));
+}
+
+ResultadoOperacion Parqueadero::procesar_salida(PlacaCompacta placa, time_t hora) {
+    uint64_t secuencia = 0;
+    ResultadoOperacion r = salida(placa, hora, secuencia);
+    if (!esperar_bitacora(secuencia)) {
+        marcar_sin_bitacora(r);
+    }
+    return r;
+}
+
+ResultadoOperacion Parqueadero::salida(PlacaCompacta placa, time_t hora, uint64_t& secuencia) {
+    Particion& p = particion(placa);
+    ResultadoOperacion r = resultado(CodigoResultado::OK);
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        Vehiculo* v = p.vehiculos.buscar(placa);
+        if (v == nullptr) {
+            return resultado(CodigoResultado::NO_PRESENTE);
+        }
+
+        // Una salida guardada por otro dispositivo puede ser anterior a una
+        // entrada registrada en vivo: se cobra como si saliera al entrar
+        time_t ahora = hora > v->hora_entrada ? hora : v->hora_entrada;
+        r.tipo = v->tipo;
+        r.espacio = v->espacio;
+        r.hora_entrada = v->hora_entrada;
+        r.tarifa = tarifa_vehiculo(*v, ahora);
+
+        // Anotar y limpiar el mapa antes de liberar: otra entrada puede
+        // recibir el espacio en cuanto se libera
+        if (bitacora) {
+            secuencia = bitacora->anotar(OperacionBitacora::SALIDA, placa, r.tipo,
+                                         r.espacio, ahora);
+        }
+        if (mapa) {
+            mapa->liberar(r.tipo, r.espacio, secuencia);
+        }
+        if (cambios) {
+            cambios->publicar(TipoCambio::SALIDA, placa, r.tipo, r.espacio, ahora);
+        }
+        liberar_espacio(v->tipo, v->espacio);
+        p.vehiculos.eliminar(v);
+    }
+    return r;
+}
+
+ResultadoOperacion Parqueadero::procesar_salida(const std::string& placa) {
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return resultado(CodigoResultado::NO_PRESENTE);
+    }
+    return procesar_salida(clave);
+}
+
+bool Parqueadero::esperar_bitacora(uint64_t secuencia) {
+    // Esperar el fsync sin locks, así el lote agrupa otras operaciones
+    if (secuencia != 0 && bitacora->esperar_fsync()) {
+        return bitacora->esperar_durable(secuencia);
+    }
+    return true;
+}
+
+void Parqueadero::marcar_sin_bitacora(ResultadoOperacion& r) {
+    // Espacio, hora y tarifa se conservan: el cambio sí quedó en memoria
+    // y la bitácora lo reintenta, pero no se puede confirmar
+    if (r.ok()) {
+        r.codigo = CodigoResultado::ERROR_BITACORA;
+    }
+}
+
+ResultadoOperacion Parqueadero::consultar_vehiculo(PlacaCompacta placa) const {
+    const Particion& p = particion(placa);
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    const Vehiculo* v = p.vehiculos.buscar(placa);
+    if (v == nullptr) {
+        return resultado(CodigoResultado::NO_PRESENTE);
+    }
+
+    ResultadoOperacion r = resultado(CodigoResultado::OK);
+    r.tipo = v->tipo;
+    r.espacio = v->espacio;
+    r.hora_entrada = v->hora_entrada;
+    r.tarifa = tarifa_vehiculo(*v, time(nullptr));
+    return r;
+}
+
+ResultadoOperacion Parqueadero::consultar_vehiculo(const std::string& placa) const {
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return resultado(CodigoResultado::NO_PRESENTE);
+    }
+    return consultar_vehiculo(clave);
+}
+
+std::vector<ResultadoOperacion> Parqueadero::procesar_entradas(
+        const std::vector<std::pair<std::string, std::string> >& entradas) {
+    std::vector<ResultadoOperacion> resultados;
+    resultados.reserve(entradas.size());
+    // Un solo fsync para todo el lote: se espera sólo la última secuencia
+    uint64_t secuencia = 0;
+    for (size_t i = 0; i < entradas.size(); i++) {
+        resultados.push_back(entrada(entradas[i].first, entradas[i].second, secuencia));
+    }
+    // Sin saber qué parte del lote llegó a disco, no se confirma ninguna
+    if (!esperar_bitacora(secuencia)) {
+        for (size_t i = 0; i < resultados.size(); i++) {
+            marcar_sin_bitacora(resultados[i]);
+        }
+    }
+    return resultados;
+}
+
+std::vector<ResultadoOperacion> Parqueadero::procesar_salidas(const std::vector<std::string>& placas) {
+    std::vector<ResultadoOperacion> resultados;
+    resultados.reserve(placas.size());
+    uint64_t secuencia = 0;
+    for (size_t i = 0; i < placas.size(); i++) {
+        PlacaCompacta clave;
+        if (empaquetar_placa(placas[i], clave)) {
+            resultados.push_back(salida(clave, time(nullptr), secuencia));
+        } else {
+            resultados.push_back(resultado(CodigoResultado::NO_PRESENTE));
+        }
+    }
+    if (!esperar_bitacora(secuencia)) {
+        for (size_t i = 0; i < resultados.size(); i++) {
+            marcar_sin_bitacora(resultados[i]);
+        }
+    }
+    return resultados;
+}
+
+// Agrega las filas de una partición con la calculadora de tarifas ya
+// especializada: el ciclo se compila por variante de las reglas
+struct FilasTarifas {
+    const TablaPlacas* vehiculos;
+    std::vector<RegistroTarifa>* destino;
+    int64_t ahora;
+
+    template <typename Calculadora>
+    void operator()(const Calculadora& calcular) const {
+        std::vector<RegistroTarifa>& filas = *destino;
+        int64_t hora = ahora;
+        vehiculos->recorrer([&](const Vehiculo& v) {
+            RegistroTarifa r;
+            // El empaquetado ya guarda los caracteres en orden de texto
+            for (size_t j = 0; j < sizeof(r.placa); j++) {
+                r.placa[j] = (char)((v.placa >> (8 * j)) & 0xff);
+            }
+            r.espacio = v.espacio;
+            r.tipo = (uint8_t)v.tipo;
+            r.relleno[0] = r.relleno[1] = r.relleno[2] = 0;
+            r.hora_entrada = v.hora_entrada;
+            r.tarifa = calcular((uint8_t)v.tipo, v.hora_entrada, hora,
+                                (v.etiqueta & ETIQUETA_ABONADO) != 0);
+            filas.push_back(r);
+        });
+    }
+};
+
+void Parqueadero::tarifas_actuales(std::vector<RegistroTarifa>& destino) const {
+    time_t ahora = time(nullptr);
+    const MotorTarifas& m = motor();
+    destino.reserve(destino.size() + total_vehiculos() + NUM_PARTICIONES);
+    for (size_t i = 0; i < NUM_PARTICIONES; i++) {
+        std::lock_guard<std::mutex> lock(particiones[i].mutex);
+        FilasTarifas filas = {&particiones[i].vehiculos, &destino, (int64_t)ahora};
+        m.especializar(filas);
+    }
+}
+
+bool Parqueadero::habilitar_cambios(size_t capacidad) {
+    if (cambios || capacidad == 0) {
+        return false;
+    }
+    cambios.reset(new FlujoCambios(capacidad));
+    return true;
+}
+
+bool Parqueadero::habilitar_mapa(const std::string& ruta) {
+    if (mapa) {
+        return false;
+    }
+    std::unique_ptr<MapaOcupacion> nuevo(new MapaOcupacion());
+    if (!nuevo->abrir(ruta, capacidad_carros, capacidad_motos,
+                      tarifa_hora_carro, tarifa_hora_moto)) {
+        return false;
+    }
+    if (nuevo->tenia_estado() && total_vehiculos() > 0) {
+        std::cerr << "❌ " << ruta << " trae estado y el parqueadero no está vacío" << std::endl;
+        return false;
+    }
+    mapa = std::move(nuevo);
+    if (mapa->tenia_estado()) {
+        return cargar_mapa();
+    }
+    return true;
+}
+
+bool Parqueadero::cargar_mapa() {
+    // Los espacios son la fuente de verdad: se reconstruyen la tabla de
+    // placas y el asignador sin pasar por procesar_entrada
+    mapa->reconstruir_indices();
+    TipoVehiculo tipos[] = {TipoVehiculo::CARRO, TipoVehiculo::MOTO};
+    for (size_t t = 0; t < 2; t++) {
+        AsignadorEspacios& espacios = (tipos[t] == TipoVehiculo::CARRO) ? espacios_carros : espacios_motos;
+        int cap = mapa->capacidad(tipos[t]);
+        for (int e = 1; e <= cap; e++) {
+            EstadoEspacio estado;
+            if (!mapa->leer_espacio(tipos[t], e, estado) || !estado.ocupado) {
+                continue;
+            }
+            Particion& p = particion(estado.placa);
+            if (p.vehiculos.buscar(estado.placa) != nullptr) {
+                // Sólo posible si un corte del sistema dejó páginas viejas
+                std::cerr << "⚠️  Placa " << desempaquetar_placa(estado.placa)
+                          << " repetida en el mapa, se libera el espacio " << e << std::endl;
+                mapa->liberar(tipos[t], e, estado.secuencia);
+                continue;
+            }
+            Vehiculo v;
+            v.placa = estado.placa;
+            v.tipo = tipos[t];
+            v.espacio = e;
+            v.hora_entrada = estado.hora_entrada;
+            v.etiqueta = etiqueta_abonado(p, v.placa, v.hora_entrada);
+            p.vehiculos.insertar(v);
+            espacios.ocupar(e);
+        }
+    }
+    return true;
+}
+
+bool Parqueadero::habilitar_bitacora(const std::string& directorio,
+                                     const OpcionesBitacora& opciones) {
+    if (bitacora) {
+        return false;
+    }
+    std::unique_ptr<Bitacora> nueva(new Bitacora(directorio, opciones));
+
+    // 1. Mapa: estado completo, en disco al menos hasta la secuencia desde
+    if (!mapa && !habilitar_mapa(nueva->ruta("ocupacion.map"))) {
+        return false;
+    }
+    uint64_t desde = mapa->secuencia_instantanea();
+
+    // 2. Bitácora: eventos posteriores. aplicar_registro() salta los que
+    // el mapa ya refleja, así da igual cuánto alcanzó a escribirse
+    if (!nueva->reproducir(desde, [this](const RegistroBitacora& r) { aplicar_registro(r); })) {
+        return false;
+    }
+
+    // 3. Seguir anotando. Se asigna antes de abrir porque el hilo de
+    // instantáneas puede llamar a tomar_instantanea() de inmediato
+    bool quedo_rotada = nueva->hay_rotada();
+    bitacora = std::move(nueva);
+    // Las secuencias nuevas deben superar a todas las que ya tiene el mapa
+    if (!bitacora->abrir(std::max(desde, mapa->maxima_secuencia()),
+                         [this]() { tomar_instantanea(); })) {
+        bitacora.reset();
+        return false;
+    }
+
+    // Una instantánea anterior quedó a medias: el mapa ya incluye todo lo
+    // reproducido, basta con llevarlo a disco
+    if (quedo_rotada) {
+        if (!mapa->sincronizar(bitacora->ultima_secuencia())) {
+            return false;
+        }
+        bitacora->descartar_rotada();
+    }
+    return true;
+}
+
+void Parqueadero::sincronizar_bitacora() {
+    if (bitacora) {
+        bitacora->sincronizar();
+    }
+}
+
+bool Parqueadero::tomar_instantanea() {
+    if (!bitacora) {
+        return false;
+    }
+
+    // La instantánea anterior no llegó a disco y rotar() no avanza con su
+    // bitácora ahí: terminarla primero, igual que al abrir. El mapa ya
+    // incluye todo lo que cubre la bitácora rotada.
+    if (bitacora->hay_rotada()) {
+        if (!mapa->sincronizar(bitacora->secuencia_rotada()) || !bitacora->descartar_rotada()) {
+            std::cerr << "❌ No se pudo terminar la instantánea anterior" << std::endl;
+            bitacora->instantanea_fallida();
+            return false;
+        }
+    }
+
+    // Congelar todas las particiones (en orden, para no interbloquear)
+    // sólo mientras se rota la bitácora: desde ese punto el mapa contiene
+    // todo lo anotado hasta secuencia
+    uint64_t secuencia = 0;
+    for (size_t i = 0; i < NUM_PARTICIONES; i++) {
+        particiones[i].mutex.lock();
+    }
+    bool rotada = bitacora->rotar(secuencia);
+    for (size_t i = NUM_PARTICIONES; i-- > 0;) {
+        particiones[i].mutex.unlock();
+    }
+    if (!rotada) {
+        return false;
+    }
+
+    // msync sin locks: también lleva cambios posteriores a secuencia, que
+    // la recuperación reconoce por la secuencia de cada espacio. Si falla,
+    // bitacora.anterior sigue ahí: la reproduce la próxima recuperación o
+    // la descarta la próxima instantánea
+    if (!mapa->sincronizar(secuencia)) {
+        std::cerr << "❌ No se pudo sincronizar el mapa de ocupación" << std::endl;
+        bitacora->instantanea_fallida();
+        return false;
+    }
+    if (!bitacora->descartar_rotada()) {
+        bitacora->instantanea_fallida();
+        return false;
+    }
+    return true;
+}
+
+void Parqueadero::aplicar_registro(const RegistroBitacora& r) {
+    Particion& p = particion(r.placa);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    TipoVehiculo tipo = (TipoVehiculo)r.tipo;
+    AsignadorEspacios& espacios = (tipo == TipoVehiculo::CARRO) ? espacios_carros : espacios_motos;
+
+    // Cada espacio guarda la secuencia de su último cambio
+    EstadoEspacio estado;
+    if (mapa && mapa->leer_espacio(tipo, r.espacio, estado) && estado.secuencia >= r.secuencia) {
+        return;
+    }
+
+    if (r.operacion == (uint8_t)OperacionBitacora::ENTRADA) {
+        // ocupar() rechaza espacios inexistentes o ya ocupados
+        if (p.vehiculos.buscar(r.placa) != nullptr || !espacios.ocupar(r.espacio)) {
+            std::cerr << "⚠️  Registro " << r.secuencia << " inconsistente, se ignora" << std::endl;
+            return;
+        }
+        Vehiculo v;
+        v.placa = r.placa;
+        v.tipo = tipo;
+        v.espacio = r.espacio;
+        v.hora_entrada = (time_t)r.hora;
+        v.etiqueta = etiqueta_abonado(p, v.placa, v.hora_entrada);
+        p.vehiculos.insertar(v);
+        if (mapa) {
+            mapa->ocupar(tipo, r.espacio, r.placa, v.hora_entrada, r.secuencia);
+        }
+    } else {
+        Vehiculo* v = p.vehiculos.buscar(r.placa);
+        if (v == nullptr || v->espacio != r.espacio) {
+            std::cerr << "⚠️  Registro " << r.secuencia << " inconsistente, se ignora" << std::endl;
+            return;
+        }
+        if (mapa) {
+            mapa->liberar(v->tipo, v->espacio, r.secuencia);
+        }
+        espacios.liberar(v->espacio);
+        p.vehiculos.eliminar(v);
+    }
+}
+
+std::string Parqueadero::registrar_entrada(const std::string& placa, const std::string& tipo) {
+    ResultadoOperacion r = procesar_entrada(placa, tipo);
+    return (r.ok() ? "OK: " : "ERROR: ") + describir_entrada(placa, tipo, r);
+}
+
+std::string Parqueadero::registrar_salida(const std::string& placa) {
+    ResultadoOperacion r = procesar_salida(placa);
+    return (r.ok() ? "OK: " : "ERROR: ") + describir_salida(placa, r);
 }
 
 bool Parqueadero::vehiculo_presente(const std::string& placa) const {
-    return vehiculos_activos.find(placa) != vehiculos_activos.end();
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return false;
+    }
+    const Particion& p = particion(clave);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.vehiculos.buscar(clave) != nullptr;
 }
 
 int Parqueadero::espacios_disponibles_carros() const {
-    int count = 0;
-    for (bool ocupado : espacios_carros) {
-        if (!ocupado) count++;
-    }
-    return count;
+    return espacios_carros.libres();
 }
 
 int Parqueadero::espacios_disponibles_motos() const {
-    int count = 0;
-    for (bool ocupado : espacios_motos) {
-        if (!ocupado) count++;
-    }
-    return count;
+    return espacios_motos.libres();
+}
+
+int Parqueadero::total_vehiculos() const {
+    return (capacidad_carros - espacios_carros.libres()) +
+           (capacidad_motos - espacios_motos.libres());
 }
 
 std::vector<std::string> Parqueadero::listar_vehiculos() const {
+    // Cada partición se copia bajo su propio lock: la lista no es una
+    // foto atómica de todo el parqueadero, pero nunca bloquea a las demás
+    std::vector<PlacaCompacta> claves;
+    claves.reserve(total_vehiculos() + NUM_PARTICIONES);
+    for (size_t i = 0; i < NUM_PARTICIONES; i++) {
+        std::lock_guard<std::mutex> lock(particiones[i].mutex);
+        particiones[i].vehiculos.recorrer([&claves](const Vehiculo& v) {
+            claves.push_back(v.placa);
+        });
+    }
+
     std::vector<std::string> lista;
-    for (const auto& par : vehiculos_activos) {
-        lista.push_back(par.first);
+    lista.reserve(claves.size());
+    for (size_t i = 0; i < claves.size(); i++) {
+        lista.push_back(desempaquetar_placa(claves[i]));
     }
+    std::sort(lista.begin(), lista.end()); // Mismo orden que el antiguo std::map
     return lista;
 }
 
 std::string Parqueadero::info_vehiculo(const std::string& placa) const {
-    if (!vehiculo_presente(placa)) {
+    ResultadoOperacion r = consultar_vehiculo(placa);
+    if (!r.ok()) {
         return "ERROR: Vehículo no encontrado";
     }
     
-    const Vehiculo& v = vehiculos_activos.at(placa);
-    double tarifa = calcular_tarifa(placa);
-    
     char buffer[80];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&v.hora_entrada));
+    struct tm tm_entrada;
+#ifdef _WIN32
+    localtime_s(&tm_entrada, &r.hora_entrada);
+#else
+    localtime_r(&r.hora_entrada, &tm_entrada);
+#endif
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm_entrada);
     
     std::stringstream ss;
-    ss << "Placa: " << v.placa << "\n"
-       << "Tipo: " << v.tipo << "\n"
-       << "Espacio: " << v.espacio << "\n"
+    ss << "Placa: " << placa << "\n"
+       << "Tipo: " << nombre_tipo(r.tipo) << "\n"
+       << "Espacio: " << r.espacio << "\n"
        << "Entrada: " << buffer << "\n"
-       << "Tarifa actual: $" << std::fixed << std::setprecision(0) << tarifa;
+       << "Tarifa actual: $" << std::fixed << std::setprecision(0) << r.tarifa;
     
     return ss.str();
 }
 
 double Parqueadero::calcular_tarifa(const std::string& placa) const {
-    if (!vehiculo_presente(placa)) {
-        return 0.0;
+    return consultar_vehiculo(placa).tarifa;
+}
+
+int Parqueadero::asignar_espacio(TipoVehiculo tipo) {
+    if (tipo == TipoVehiculo::CARRO) {
+        std::lock_guard<std::mutex> lock(mutex_carros);
+        return espacios_carros.asignar();
     }
-    
-    const Vehiculo& v = vehiculos_activos.at(placa);
-    time_t ahora = time(nullptr);
-    double horas = calcular_horas(v.hora_entrada, ahora);
-    
-    double tarifa_hora = (v.tipo == "carro") ? tarifa_hora_carro : tarifa_hora_moto;
-    return horas * tarifa_hora;
+    std::lock_guard<std::mutex> lock(mutex_motos);
+    return espacios_motos.asignar();
 }
 
-int Parqueadero::asignar_espacio(const std::string& tipo) {
-    std::vector<bool>& espacios = (tipo == "carro") ? espacios_carros : espacios_motos;
-    
-    for (size_t i = 0; i < espacios.size(); i++) {
-        if (!espacios[i]) {
-            espacios[i] = true;
-            return i + 1;
+void Parqueadero::liberar_espacio(TipoVehiculo tipo, int espacio) {
+    if (tipo == TipoVehiculo::CARRO) {
+        std::lock_guard<std::mutex> lock(mutex_carros);
+        espacios_carros.liberar(espacio);
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_motos);
+        espacios_motos.liberar(espacio);
+    }
+}
+
+double Parqueadero::tarifa_vehiculo(const Vehiculo& v, time_t ahora) const {
+    return motor().tarifa(v.tipo, v.hora_entrada, ahora, (v.etiqueta & ETIQUETA_ABONADO) != 0);
+}
+
+uint8_t Parqueadero::etiqueta_abonado(const Particion& p, PlacaCompacta placa, time_t hora) {
+    if (p.abonados.empty()) {
+        return 0;
+    }
+    std::unordered_map<PlacaCompacta, int64_t>::const_iterator it = p.abonados.find(placa);
+    bool vigente = it != p.abonados.end() && (it->second == 0 || it->second > (int64_t)hora);
+    return vigente ? ETIQUETA_ABONADO : 0;
+}
+
+bool Parqueadero::configurar_tarifas(const ConfiguracionTarifas& config, std::string* error) {
+    std::unique_ptr<MotorTarifas> nuevo(new MotorTarifas(config));
+    if (!nuevo->valido()) {
+        if (error != nullptr) {
+            *error = nuevo->error();
         }
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_tarifas);
+    motor_tarifas.store(nuevo.get(), std::memory_order_release);
+    motores.push_back(std::move(nuevo));
+    return true;
+}
+
+ConfiguracionTarifas Parqueadero::configuracion_tarifas() const {
+    return motor().configuracion();
+}
+
+bool Parqueadero::agregar_abonado(const std::string& placa, time_t vence) {
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return false;
+    }
+    Particion& p = particion(clave);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.abonados[clave] = (int64_t)vence;
+    Vehiculo* v = p.vehiculos.buscar(clave);
+    if (v != nullptr) {
+        v->etiqueta = etiqueta_abonado(p, clave, v->hora_entrada);
+    }
+    return true;
+}
+
+bool Parqueadero::quitar_abonado(const std::string& placa) {
+    PlacaCompacta clave;
+    if (!empaquetar_placa(placa, clave)) {
+        return false;
+    }
+    Particion& p = particion(clave);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    if (p.abonados.erase(clave) == 0) {
+        return false;
+    }
+    Vehiculo* v = p.vehiculos.buscar(clave);
+    if (v != nullptr) {
+        v->etiqueta &= (uint8_t)~ETIQUETA_ABONADO;
     }
-    return -1;
+    return true;
 }
 
-void Parqueadero::liberar_espacio(const std::string& tipo, int espacio) {
-    std::vector<bool>& espacios = (tipo == "carro") ? espacios_carros : espacios_motos;
-    if (espacio > 0 && espacio <= (int)espacios.size()) {
-        espacios[espacio - 1] = false;
+size_t Parqueadero::total_abonados() const {
+    size_t total = 0;
+    for (size_t i = 0; i < NUM_PARTICIONES; i++) {
+        std::lock_guard<std::mutex> lock(particiones[i].mutex);
+        total += particiones[i].abonados.size();
     }
+    return total;
 }
 
-double Parqueadero::calcular_horas(time_t entrada, time_t salida) const {
-    double segundos = difftime(salida, entrada);
-    double horas = segundos / 3600.0;
-    return std::ceil(horas); // Redondear hacia arriba
-}
\ No newline at end of file
+void describir_entrada(std::string& destino, const char* placa, size_t largo_placa,
+                       const char* tipo, const ResultadoOperacion& r) {
+    switch (r.codigo) {
+        case CodigoResultado::OK: {
+            char espacio[16];
+            int n = snprintf(espacio, sizeof(espacio), "%d", r.espacio);
+            destino.append("Vehículo ").append(placa, largo_placa);
+            destino.append(" registrado en espacio ").append(espacio, n);
+            break;
+        }
+        case CodigoResultado::YA_PRESENTE:
+            destino.append("El vehículo con placa ").append(placa, largo_placa);
+            destino.append(" ya está en el parqueadero");
+            break;
+        case CodigoResultado::SIN_ESPACIO:
+            destino.append("No hay espacios disponibles para ").append(tipo);
+            break;
+        case CodigoResultado::PLACA_INVALIDA:
+            destino.append("Placa inválida: ").append(placa, largo_placa);
+            break;
+        case CodigoResultado::TIPO_INVALIDO:
+            destino.append("Tipo de vehículo inválido: ").append(tipo);
+            break;
+        case CodigoResultado::ERROR_BITACORA:
+            destino.append("No se pudo guardar la entrada de ").append(placa, largo_placa);
+            destino.append(" en la bitácora");
+            break;
+        default:
+            destino.append("El vehículo con placa ").append(placa, largo_placa);
+            destino.append(" no está en el parqueadero");
+            break;
+    }
+}
+
+void describir_salida(std::string& destino, const char* placa, size_t largo_placa,
+                      const ResultadoOperacion& r) {
+    if (r.codigo == CodigoResultado::ERROR_BITACORA) {
+        destino.append("No se pudo guardar la salida de ").append(placa, largo_placa);
+        destino.append(" en la bitácora");
+        return;
+    }
+    if (!r.ok()) {
+        destino.append("El vehículo con placa ").append(placa, largo_placa);
+        destino.append(" no está en el parqueadero");
+        return;
+    }
+    char tarifa[32];
+    int n = snprintf(tarifa, sizeof(tarifa), "%.0f", r.tarifa);
+    destino.append("Vehículo ").append(placa, largo_placa);
+    destino.append(" retirado. Tarifa: $").append(tarifa, n);
+}
+
+std::string describir_entrada(const std::string& placa, const std::string& tipo,
+                              const ResultadoOperacion& r) {
+    std::string texto;
+    describir_entrada(texto, placa.data(), placa.size(), tipo.c_str(), r);
+    return texto;
+}
+
+std::string describir_salida(const std::string& placa, const ResultadoOperacion& r) {
+    std::string texto;
+    describir_salida(texto, placa.data(), placa.size(), r);
+    return texto;
+}
@@ -3,49 +3,211 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <utility>
+#include <cstdint>
+#include <mutex>
 #include <ctime>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include "asignador_espacios.hpp"
+#include "tabla_placas.hpp"
+#include "bitacora.hpp"
+#include "mapa_ocupacion.hpp"
+#include "tarifas.hpp"
+#include "flujo_cambios.hpp"
 
-struct Vehiculo {
-    std::string placa;
-    std::string tipo; // "carro", "moto"
-    time_t hora_entrada;
-    int espacio;
+// Resultado de una operación sobre el parqueadero
+enum class CodigoResultado : uint8_t {
+    OK = 0,
+    YA_PRESENTE,    // Entrada de un vehículo que ya está dentro
+    NO_PRESENTE,    // Salida o consulta de un vehículo que no está
+    SIN_ESPACIO,
+    PLACA_INVALIDA,
+    TIPO_INVALIDO,
+    ERROR_BITACORA  // Se aplicó en memoria pero no se pudo escribir a disco
 };
 
+struct ResultadoOperacion {
+    CodigoResultado codigo;
+    TipoVehiculo tipo;
+    int espacio;          // -1 si no aplica
+    time_t hora_entrada;  // 0 si no aplica
+    double tarifa;        // Salida: tarifa cobrada; consulta: tarifa actual
+
+    bool ok() const { return codigo == CodigoResultado::OK; }
+};
+
+// Fila de tarifas_actuales(): tamaño y disposición fijos (32 bytes) para
+// exponerla a Python como buffer con formato FORMATO_REGISTRO_TARIFA
+struct RegistroTarifa {
+    char placa[8];        // Sin '\0' final si la placa tiene 8 caracteres
+    int32_t espacio;
+    uint8_t tipo;         // TipoVehiculo
+    uint8_t relleno[3];
+    int64_t hora_entrada;
+    double tarifa;
+};
+static_assert(sizeof(RegistroTarifa) == 32, "RegistroTarifa debe medir 32 bytes");
+
+// Formato de struct de Python equivalente a RegistroTarifa
+static const char FORMATO_REGISTRO_TARIFA[] = "=8siB3xqd";
+
+// Seguro para usar desde varios hilos: los vehículos se reparten por
+// placa en particiones con su propio mutex y cada tipo de espacio tiene
+// su propio lock. Orden de locks: partición -> espacios.
 class Parqueadero {
 private:
+    static const int BITS_PARTICION = 4;
+    static const size_t NUM_PARTICIONES = 1 << BITS_PARTICION;
+
+    struct Particion {
+        mutable std::mutex mutex;
+        TablaPlacas vehiculos; // placa compacta -> vehiculo
+        std::unordered_map<PlacaCompacta, int64_t> abonados; // placa -> vencimiento (0 = sin)
+    };
+
     int capacidad_carros;
     int capacidad_motos;
-    std::map<std::string, Vehiculo> vehiculos_activos; // placa -> vehiculo
-    std::vector<bool> espacios_carros;
-    std::vector<bool> espacios_motos;
+    Particion particiones[NUM_PARTICIONES];
+    AsignadorEspacios espacios_carros;
+    AsignadorEspacios espacios_motos;
+    std::mutex mutex_carros;
+    std::mutex mutex_motos;
     
-    double tarifa_hora_carro;
+    double tarifa_hora_carro;  // Tarifas base: las que lleva el mapa de ocupación
     double tarifa_hora_moto;
 
+    // Motor vigente. Los anteriores se conservan (cambian muy rara vez):
+    // así un cálculo en curso nunca lee un motor liberado
+    std::atomic<const MotorTarifas*> motor_tarifas;
+    std::vector<std::unique_ptr<MotorTarifas> > motores;
+    std::mutex mutex_tarifas;
+
+    std::unique_ptr<MapaOcupacion> mapa;
+    std::unique_ptr<FlujoCambios> cambios;
+    // Último miembro: se destruye primero y detiene sus hilos antes que
+    // desaparezcan las particiones y el mapa que usa la instantánea
+    std::unique_ptr<Bitacora> bitacora;
+
 public:
     Parqueadero(int cap_carros, int cap_motos, 
-                double tarifa_carro = 3000.0, double tarifa_moto = 2000.0);
+                double tarifa_carro = 3000.0, double tarifa_moto = 2000.0,
+                PoliticaAsignacion politica = PoliticaAsignacion::MENOR_NUMERO);
     
-    // Operaciones principales
+    // Reflejar la ocupación en un archivo mapeado (ver MapaOcupacion). Si
+    // el archivo ya existe se carga su estado: el parqueadero debe estar
+    // vacío. Otros procesos pueden leerlo con LectorOcupacion.
+    bool habilitar_mapa(const std::string& ruta);
+
+    // Persistencia: recupera el estado guardado en directorio (ocupacion.map
+    // + bitácora) y desde entonces anota cada entrada/salida exitosa.
+    // Llamar una sola vez, antes de empezar a recibir eventos.
+    bool habilitar_bitacora(const std::string& directorio,
+                            const OpcionesBitacora& opciones = OpcionesBitacora());
+    // Escribir a disco lo pendiente (útil con esperar_fsync = false)
+    void sincronizar_bitacora();
+    // Rotar la bitácora, llevar el mapa a disco y descartar la bitácora
+    // que ya no hace falta. La bitácora la llama sola cada N registros.
+    // false si no terminó (cuenta en Bitacora::escrituras_fallidas); la
+    // siguiente completa primero la que quedó a medias.
+    bool tomar_instantanea();
+    const Bitacora* obtener_bitacora() const { return bitacora.get(); }
+
+    // Numerar cada entrada/salida exitosa en un FlujoCambios que guarda
+    // los últimos capacidad cambios. Llamar antes de recibir eventos.
+    bool habilitar_cambios(size_t capacidad = 65536);
+    // nullptr si no se habilitó
+    FlujoCambios* flujo_cambios() const { return cambios.get(); }
+
+    // Operaciones principales (sin formatear texto)
+    ResultadoOperacion procesar_entrada(PlacaCompacta placa, TipoVehiculo tipo);
+    ResultadoOperacion procesar_entrada(const std::string& placa, const std::string& tipo);
+    ResultadoOperacion procesar_salida(PlacaCompacta placa);
+    ResultadoOperacion procesar_salida(const std::string& placa);
+    // Con la hora del evento en vez de la actual (lecturas que un
+    // dispositivo guardó sin conexión): la entrada queda a esa hora y la
+    // salida cobra hasta ella (nunca antes de la entrada)
+    ResultadoOperacion procesar_entrada(PlacaCompacta placa, TipoVehiculo tipo, time_t hora);
+    ResultadoOperacion procesar_salida(PlacaCompacta placa, time_t hora);
+    ResultadoOperacion consultar_vehiculo(PlacaCompacta placa) const;
+    ResultadoOperacion consultar_vehiculo(const std::string& placa) const;
+
+    // Operaciones en lote: un solo cruce desde Python para muchos vehículos
+    std::vector<ResultadoOperacion> procesar_entradas(
+        const std::vector<std::pair<std::string, std::string> >& entradas);
+    std::vector<ResultadoOperacion> procesar_salidas(const std::vector<std::string>& placas);
+
+    // Placa, espacio, tipo, entrada y tarifa actual de todos los vehículos,
+    // calculadas con una sola lectura del reloj. Se agregan a destino.
+    void tarifas_actuales(std::vector<RegistroTarifa>& destino) const;
+
+    // Versiones con mensaje de texto ("OK: ..." / "ERROR: ...")
     std::string registrar_entrada(const std::string& placa, const std::string& tipo);
     std::string registrar_salida(const std::string& placa);
     
     // Consultas
     bool vehiculo_presente(const std::string& placa) const;
-    int espacios_disponibles_carros() const;
-    int espacios_disponibles_motos() const;
+    int espacios_disponibles_carros() const; // O(1), sin lock
+    int espacios_disponibles_motos() const;  // O(1), sin lock
+    int total_vehiculos() const;             // O(1), sin lock
+    int total_espacios_carros() const { return capacidad_carros; }
+    int total_espacios_motos() const { return capacidad_motos; }
     std::vector<std::string> listar_vehiculos() const;
     std::string info_vehiculo(const std::string& placa) const;
     
     // Cálculo de tarifa
     double calcular_tarifa(const std::string& placa) const;
 
+    // Reglas de cobro del sitio; aplican desde ya, también a los vehículos
+    // que están dentro. false (y error) si alguna regla es inválida.
+    bool configurar_tarifas(const ConfiguracionTarifas& config, std::string* error = nullptr);
+    ConfiguracionTarifas configuracion_tarifas() const;
+    const MotorTarifas& motor() const { return *motor_tarifas.load(std::memory_order_acquire); }
+
+    // Mensualidades: una estancia que empieza con la mensualidad vigente
+    // (vence = 0: sin vencimiento) no paga. Aplica también si el vehículo
+    // ya está dentro.
+    bool agregar_abonado(const std::string& placa, time_t vence = 0);
+    bool quitar_abonado(const std::string& placa);
+    size_t total_abonados() const;
+
 private:
-    int asignar_espacio(const std::string& tipo);
-    void liberar_espacio(const std::string& tipo, int espacio);
-    double calcular_horas(time_t entrada, time_t salida) const;
+    ResultadoOperacion resultado(CodigoResultado codigo) const;
+    // Operaciones sin esperar la bitácora; secuencia queda con el número
+    // anotado (si hubo), para esperar una sola vez por lote
+    ResultadoOperacion entrada(PlacaCompacta placa, TipoVehiculo tipo, time_t hora,
+                               uint64_t& secuencia);
+    ResultadoOperacion entrada(const std::string& placa, const std::string& tipo,
+                               uint64_t& secuencia);
+    ResultadoOperacion salida(PlacaCompacta placa, time_t hora, uint64_t& secuencia);
+    // false si el registro no llegó a disco (ver Bitacora::esperar_durable)
+    bool esperar_bitacora(uint64_t secuencia);
+    // Con la bitácora fallida, los resultados exitosos pasan a ERROR_BITACORA
+    static void marcar_sin_bitacora(ResultadoOperacion& r);
+    Particion& particion(PlacaCompacta placa);
+    const Particion& particion(PlacaCompacta placa) const;
+    int asignar_espacio(TipoVehiculo tipo);
+    void liberar_espacio(TipoVehiculo tipo, int espacio);
+    double tarifa_vehiculo(const Vehiculo& v, time_t ahora) const;
+    // ETIQUETA_ABONADO si la placa tiene mensualidad vigente a esa hora;
+    // requiere el lock de la partición
+    static uint8_t etiqueta_abonado(const Particion& p, PlacaCompacta placa, time_t hora);
+    // Recuperación: aplica un registro sin volver a anotarlo
+    void aplicar_registro(const RegistroBitacora& r);
+    // Cargar los vehículos de un mapa existente
+    bool cargar_mapa();
 };
 
+// Texto para mostrar un resultado, sin el prefijo "OK: "/"ERROR: "
+std::string describir_entrada(const std::string& placa, const std::string& tipo,
+                              const ResultadoOperacion& r);
+std::string describir_salida(const std::string& placa, const ResultadoOperacion& r);
+// Lo mismo agregado al final de destino, sin cadenas temporales (el
+// servidor reutiliza el buffer de salida de cada conexión)
+void describir_entrada(std::string& destino, const char* placa, size_t largo_placa,
+                       const char* tipo, const ResultadoOperacion& r);
+void describir_salida(std::string& destino, const char* placa, size_t largo_placa,
+                      const ResultadoOperacion& r);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "protocolo.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define PROTOCOLO_SSE2 1
+#endif
+
+static inline int bit_menor(unsigned mascara) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mascara);
+    return (int)i;
+#else
+    return __builtin_ctz(mascara);
+#endif
+}
+
+const char* buscar_byte(const char* desde, const char* hasta, char c) {
+#ifdef PROTOCOLO_SSE2
+    const __m128i buscado = _mm_set1_epi8(c);
+    while (hasta - desde >= 16) {
+        __m128i bloque = _mm_loadu_si128((const __m128i*)desde);
+        unsigned mascara = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bloque, buscado));
+        if (mascara != 0) {
+            return desde + bit_menor(mascara);
+        }
+        desde += 16;
+    }
+#endif
+    while (desde < hasta && *desde != c) {
+        desde++;
+    }
+    return desde;
+}
+
+static inline bool alfanumerico(unsigned char c) {
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+// Validar y empaquetar la placa en el mismo recorrido
+static bool placa_valida(const char* placa, size_t largo, PlacaCompacta& resultado) {
+    if (largo == 0 || largo > MAX_LARGO_PLACA) {
+        return false;
+    }
+    PlacaCompacta valor = 0;
+    for (size_t i = 0; i < largo; i++) {
+        unsigned char c = (unsigned char)placa[i];
+        if (!alfanumerico(c)) {
+            return false;
+        }
+        valor |= (PlacaCompacta)c << (8 * i);
+    }
+    resultado = valor;
+    return true;
+}
+
+ErrorMensaje parsear_mensaje(const char* datos, size_t largo, MensajeDispositivo& mensaje) {
+    if (largo == 0) {
+        return ErrorMensaje::VACIO;
+    }
+
+    // Los cuatro campos, el lote opcional y el resto, para detectar
+    // separadores de más
+    const char* fin = datos + largo;
+    Fragmento campos[5];
+    const char* p = datos;
+    for (int i = 0; i < 5; i++) {
+        const char* sep = buscar_byte(p, fin, PROTOCOLO_SEPARADOR);
+        if (sep == fin && i < 3) {
+            return ErrorMensaje::CAMPOS_FALTANTES;
+        }
+        campos[i] = Fragmento(p, sep - p);
+        if (sep == fin) {
+            break;
+        }
+        if (i == 4) {
+            return ErrorMensaje::CAMPOS_SOBRANTES;
+        }
+        p = sep + 1;
+    }
+
+    if (campos[0].igual("ENTRADA", 7)) {
+        mensaje.operacion = OperacionMensaje::ENTRADA;
+    } else if (campos[0].igual("SALIDA", 6)) {
+        mensaje.operacion = OperacionMensaje::SALIDA;
+    } else {
+        return ErrorMensaje::OPERACION_DESCONOCIDA;
+    }
+
+    if (!placa_valida(campos[1].datos, campos[1].largo, mensaje.placa_compacta)) {
+        return ErrorMensaje::PLACA_INVALIDA;
+    }
+    mensaje.placa = campos[1];
+
+    mensaje.con_tipo = true;
+    if (campos[2].igual("carro", 5)) {
+        mensaje.tipo_vehiculo = TipoVehiculo::CARRO;
+    } else if (campos[2].igual("moto", 4)) {
+        mensaje.tipo_vehiculo = TipoVehiculo::MOTO;
+    } else if (campos[2].vacio() && mensaje.operacion == OperacionMensaje::SALIDA) {
+        mensaje.con_tipo = false;
+        mensaje.tipo_vehiculo = TipoVehiculo::CARRO;
+    } else {
+        return ErrorMensaje::TIPO_INVALIDO;
+    }
+
+    mensaje.dispositivo = campos[3];
+    mensaje.lote = campos[4];
+    return ErrorMensaje::NINGUNO;
+}
+
+// Número decimal sin signo en todo el fragmento, sin desbordar
+static bool parsear_numero(const Fragmento& campo, uint64_t& valor) {
+    if (campo.vacio() || campo.largo > 19) {
+        return false;
+    }
+    valor = 0;
+    for (size_t i = 0; i < campo.largo; i++) {
+        unsigned char c = (unsigned char)campo.datos[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        valor = valor * 10 + (c - '0');
+    }
+    return true;
+}
+
+ErrorMensaje parsear_sincronizacion(const char* datos, size_t largo,
+                                    CabeceraSincronizacion& cabecera) {
+    if (!es_sincronizacion(datos, largo)) {
+        return ErrorMensaje::OPERACION_DESCONOCIDA;
+    }
+    const char* p = datos + sizeof(PROTOCOLO_SINC) - 1;
+    const char* fin = datos + largo;
+    Fragmento campos[3];
+    for (int i = 0; i < 3; i++) {
+        const char* sep = buscar_byte(p, fin, PROTOCOLO_SEPARADOR);
+        if (sep == fin && i < 2) {
+            return ErrorMensaje::SINC_INVALIDA;
+        }
+        if (sep != fin && i == 2) {
+            return ErrorMensaje::SINC_INVALIDA;
+        }
+        campos[i] = Fragmento(p, sep - p);
+        p = sep + 1;
+    }
+
+    uint64_t secuencia, cantidad;
+    if (campos[0].vacio() || !parsear_numero(campos[1], secuencia) || secuencia == 0 ||
+        !parsear_numero(campos[2], cantidad) || cantidad == 0 || cantidad > MAX_EVENTOS_SINC) {
+        return ErrorMensaje::SINC_INVALIDA;
+    }
+    cabecera.dispositivo = campos[0];
+    cabecera.secuencia = secuencia;
+    cabecera.cantidad = (uint32_t)cantidad;
+    return ErrorMensaje::NINGUNO;
+}
+
+ErrorMensaje separar_hora_sincronizada(const char* datos, size_t largo, int64_t& hora,
+                                       Fragmento& mensaje) {
+    const char* fin = datos + largo;
+    const char* sep = buscar_byte(datos, fin, PROTOCOLO_SEPARADOR);
+    uint64_t valor;
+    if (sep == fin || !parsear_numero(Fragmento(datos, sep - datos), valor) || valor == 0 ||
+        valor > (uint64_t)INT64_MAX) {
+        return ErrorMensaje::SINC_INVALIDA;
+    }
+    hora = (int64_t)valor;
+    mensaje = Fragmento(sep + 1, fin - sep - 1);
+    return ErrorMensaje::NINGUNO;
+}
+
+uint64_t hash_texto(const char* datos, size_t largo) {
+    uint64_t h = 14695981039346656037ULL ^ largo;
+    uint64_t palabra;
+    for (; largo >= 8; datos += 8, largo -= 8) {
+        memcpy(&palabra, datos, 8);
+        h = (h ^ palabra) * 1099511628211ULL;
+    }
+    if (largo > 0) {
+        palabra = 0;
+        memcpy(&palabra, datos, largo);
+        h = (h ^ palabra) * 1099511628211ULL;
+    }
+    return h;
+}
+
+const char* describir_error(ErrorMensaje error) {
+    switch (error) {
+        case ErrorMensaje::NINGUNO: return "Mensaje válido";
+        case ErrorMensaje::VACIO: return "Mensaje vacío";
+        case ErrorMensaje::CAMPOS_FALTANTES: return "Faltan campos (TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO[|LOTE])";
+        case ErrorMensaje::CAMPOS_SOBRANTES: return "Sobran campos (TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO[|LOTE])";
+        case ErrorMensaje::OPERACION_DESCONOCIDA: return "Tipo de operación desconocido";
+        case ErrorMensaje::PLACA_INVALIDA: return "Placa inválida (1 a 8 letras o dígitos)";
+        case ErrorMensaje::TIPO_INVALIDO: return "Tipo de vehículo inválido (carro o moto)";
+        case ErrorMensaje::LOTE_DESCONOCIDO: return "Parqueadero desconocido (campo LOTE o prefijo del dispositivo)";
+        case ErrorMensaje::REPETIDO: return "Lectura repetida, ignorada";
+        case ErrorMensaje::SINC_INVALIDA: return "Sincronización inválida (SINC|DISPOSITIVO|SECUENCIA|CANTIDAD, luego HORA|mensaje)";
+        case ErrorMensaje::DUPLICADO: return "Evento ya aplicado";
+    }
+    return "Mensaje inválido";
+}
+
+const char* nombre_operacion(OperacionMensaje operacion) {
+    return operacion == OperacionMensaje::ENTRADA ? "ENTRADA" : "SALIDA";
+}
@@ -0,0 +1,122 @@
+#ifndef PROTOCOLO_HPP
+#define PROTOCOLO_HPP
+
+#include "tabla_placas.hpp"
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Protocolo de dispositivos
+//
+// Modo clásico (cámaras antiguas): una conexión por evento, un mensaje
+// TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO sin terminador y una respuesta.
+// Un quinto campo opcional, |LOTE, indica el parqueadero cuando un mismo
+// servidor atiende varios (ver GestorParqueaderos).
+//
+// Modo enmarcado: el dispositivo abre con PROTOCOLO_SALUDO, el servidor
+// contesta PROTOCOLO_SALUDO_OK y la conexión queda abierta. Cada mensaje
+// y cada respuesta terminan en '\n'; se pueden enviar varios mensajes
+// seguidos sin esperar respuesta y éstas llegan en el mismo orden.
+//
+// Sincronización (modo enmarcado): un dispositivo que guardó eventos sin
+// conexión los sube en lotes, con la línea SINC|DISPOSITIVO|SECUENCIA|CANTIDAD
+// seguida de CANTIDAD mensajes numerados desde SECUENCIA, cada uno con la
+// hora de la lectura delante (HORA|TIPO|PLACA|..., segundos Unix). Se
+// responde la cabecera ("OK: SINC n") y cada mensaje; los que el servidor
+// ya aplicó (secuencia no mayor que la última del dispositivo) responden
+// "OK: Evento ya aplicado" sin repetirse, así reenviar un lote es inocuo.
+
+static const char PROTOCOLO_SALUDO[] = "PQ/1\n";
+static const char PROTOCOLO_SALUDO_OK[] = "OK: PQ/1\n";
+static const char PROTOCOLO_SINC[] = "SINC|";
+static const char PROTOCOLO_FIN_MENSAJE = '\n';
+static const char PROTOCOLO_SEPARADOR = '|';
+static const uint32_t MAX_EVENTOS_SINC = 65536;
+
+// Trozo de un buffer, sin copiarlo (std::string_view no existe en C++11).
+// Sólo es válido mientras el buffer original no cambie.
+struct Fragmento {
+    const char* datos;
+    size_t largo;
+
+    Fragmento() : datos(nullptr), largo(0) {}
+    Fragmento(const char* d, size_t n) : datos(d), largo(n) {}
+    Fragmento(const char* texto) : datos(texto), largo(texto ? strlen(texto) : 0) {}
+
+    bool vacio() const { return largo == 0; }
+    bool igual(const char* texto, size_t n) const {
+        return largo == n && memcmp(datos, texto, n) == 0;
+    }
+    std::string texto() const { return std::string(datos, largo); }
+};
+
+enum class OperacionMensaje : uint8_t {
+    ENTRADA = 0,
+    SALIDA = 1
+};
+
+// Por qué se rechazó un mensaje
+enum class ErrorMensaje : uint8_t {
+    NINGUNO = 0,
+    VACIO,
+    CAMPOS_FALTANTES,      // Menos de 4 campos
+    CAMPOS_SOBRANTES,      // Más de 5 campos
+    OPERACION_DESCONOCIDA, // Ni ENTRADA ni SALIDA
+    PLACA_INVALIDA,        // 1 a 8 caracteres alfanuméricos ASCII
+    TIPO_INVALIDO,         // ENTRADA exige carro/moto; SALIDA lo admite vacío
+    LOTE_DESCONOCIDO,      // Con varios lotes: no se pudo enrutar (lo detecta el servidor)
+    REPETIDO,              // Misma lectura dentro de la ventana de FiltroRepetidos (ídem)
+    SINC_INVALIDA,         // Cabecera SINC con campos de más o de menos, números inválidos o mensaje sin hora
+    DUPLICADO              // Secuencia ya aplicada en una sincronización anterior (ídem)
+};
+
+// Mensaje de un dispositivo ya validado. Los fragmentos apuntan al buffer
+// de recepción: parsear no asigna memoria.
+struct MensajeDispositivo {
+    OperacionMensaje operacion;
+    Fragmento placa;
+    PlacaCompacta placa_compacta;
+    bool con_tipo;               // SALIDA puede venir sin tipo de vehículo
+    TipoVehiculo tipo_vehiculo;
+    Fragmento dispositivo;       // ID del dispositivo (ej: "CAMARA-01")
+    Fragmento lote;              // Vacío si el mensaje no trae el campo
+};
+
+// Cabecera de un lote de sincronización. dispositivo apunta al buffer.
+struct CabeceraSincronizacion {
+    Fragmento dispositivo;
+    uint64_t secuencia;          // La del primer mensaje del lote (> 0)
+    uint32_t cantidad;           // 1 a MAX_EVENTOS_SINC
+};
+
+// Primer byte igual a c en [desde, hasta), o hasta si no hay. Usa SSE2
+// (16 bytes por comparación) cuando está disponible.
+const char* buscar_byte(const char* desde, const char* hasta, char c);
+
+// Parsear TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO[|LOTE] en una sola pasada,
+// validando la operación, la placa y el tipo de vehículo
+ErrorMensaje parsear_mensaje(const char* datos, size_t largo, MensajeDispositivo& mensaje);
+
+// ¿La línea empieza con PROTOCOLO_SINC?
+inline bool es_sincronizacion(const char* datos, size_t largo) {
+    const size_t n = sizeof(PROTOCOLO_SINC) - 1;
+    return largo >= n && memcmp(datos, PROTOCOLO_SINC, n) == 0;
+}
+
+// Parsear SINC|DISPOSITIVO|SECUENCIA|CANTIDAD
+ErrorMensaje parsear_sincronizacion(const char* datos, size_t largo, CabeceraSincronizacion& cabecera);
+
+// Separar la hora de un mensaje de un lote SINC (HORA|mensaje); mensaje
+// queda apuntando al resto de la línea
+ErrorMensaje separar_hora_sincronizada(const char* datos, size_t largo, int64_t& hora,
+                                       Fragmento& mensaje);
+
+// FNV-1a de 64 bits por palabras de 8 bytes, para claves cortas como el
+// ID de un dispositivo
+uint64_t hash_texto(const char* datos, size_t largo);
+
+const char* describir_error(ErrorMensaje error);
+const char* nombre_operacion(OperacionMensaje operacion);
+
+#endif
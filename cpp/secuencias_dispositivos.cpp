@@ -0,0 +1,126 @@
+#include "secuencias_dispositivos.hpp"
+#include "bitacora.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define ABRIR(ruta, flags) _open((ruta), (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define CERRAR _close
+#else
+    #include <unistd.h>
+    #define ABRIR(ruta, flags) open((ruta), (flags), 0644)
+    #define CERRAR close
+#endif
+
+static const char CABECERA_SECUENCIAS[] = "PQSINC1";
+
+static std::string directorio_de(const std::string& ruta) {
+    size_t barra = ruta.find_last_of("/\\");
+    return barra == std::string::npos ? "." : ruta.substr(0, barra);
+}
+
+bool SecuenciasDispositivos::cargar(const std::string& ruta) {
+    std::unordered_map<std::string, uint64_t> leidas;
+    std::ifstream archivo(ruta.c_str());
+    if (archivo) {
+        std::string linea;
+        if (!std::getline(archivo, linea) || linea != CABECERA_SECUENCIAS) {
+            std::cerr << ruta << " no es un archivo de secuencias" << std::endl;
+            return false;
+        }
+        while (std::getline(archivo, linea)) {
+            size_t sep = linea.rfind('|');
+            char* fin = nullptr;
+            unsigned long long secuencia =
+                sep == std::string::npos ? 0 : strtoull(linea.c_str() + sep + 1, &fin, 10);
+            if (sep == 0 || secuencia == 0 || *fin != '\0') {
+                std::cerr << ruta << ": línea dañada: " << linea << std::endl;
+                return false;
+            }
+            leidas[linea.substr(0, sep)] = secuencia;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Lo anotado antes de cargar también cuenta
+    for (std::unordered_map<std::string, uint64_t>::const_iterator it = ultimas.begin();
+         it != ultimas.end(); ++it) {
+        uint64_t& ultima = leidas[it->first];
+        if (ultima < it->second) {
+            ultima = it->second;
+        }
+    }
+    ultimas.swap(leidas);
+    ruta_archivo = ruta;
+    modificadas = true;
+    return true;
+}
+
+bool SecuenciasDispositivos::persistente() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !ruta_archivo.empty();
+}
+
+uint64_t SecuenciasDispositivos::ultima(const std::string& dispositivo) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<std::string, uint64_t>::const_iterator it = ultimas.find(dispositivo);
+    return it != ultimas.end() ? it->second : 0;
+}
+
+void SecuenciasDispositivos::anotar(const std::string& dispositivo, uint64_t secuencia) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t& ultima = ultimas[dispositivo];
+    if (ultima < secuencia) {
+        ultima = secuencia;
+        modificadas = true;
+    }
+}
+
+bool SecuenciasDispositivos::guardar() {
+    std::lock_guard<std::mutex> lock_archivo(mutex_archivo);
+    std::string ruta;
+    std::ostringstream texto;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ruta_archivo.empty() || !modificadas) {
+            return true;
+        }
+        ruta = ruta_archivo;
+        texto << CABECERA_SECUENCIAS << '\n';
+        for (std::unordered_map<std::string, uint64_t>::const_iterator it = ultimas.begin();
+             it != ultimas.end(); ++it) {
+            texto << it->first << '|' << it->second << '\n';
+        }
+        modificadas = false;
+    }
+
+    // Temporal sincronizado y rename: el archivo queda entero, viejo o nuevo
+    std::string temporal = ruta + ".tmp";
+    std::string datos = texto.str();
+    int fd = ABRIR(temporal.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+    bool ok = fd >= 0 && escribir_todo(fd, datos.data(), datos.size()) &&
+              sincronizar_archivo(fd);
+    if (fd >= 0) {
+        CERRAR(fd);
+    }
+#ifdef _WIN32
+    if (ok) {
+        remove(ruta.c_str());  // rename no reemplaza en Windows
+    }
+#endif
+    ok = ok && rename(temporal.c_str(), ruta.c_str()) == 0 &&
+         sincronizar_directorio(directorio_de(ruta));
+    if (!ok) {
+        std::cerr << "❌ Error al guardar " << ruta << ": " << strerror(errno) << std::endl;
+        std::lock_guard<std::mutex> lock(mutex);
+        modificadas = true;  // Reintentar la próxima vez
+    }
+    return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef SECUENCIAS_DISPOSITIVOS_HPP
+#define SECUENCIAS_DISPOSITIVOS_HPP
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+// Última secuencia SINC aplicada de cada dispositivo, por su ID (ver SINC
+// en protocolo.hpp). Con un archivo (normalmente en el directorio de la
+// bitácora) sobrevive a un reinicio del servidor: un lote reenviado
+// después no vuelve a aplicar lo que ya se aplicó.
+//
+// Archivo de texto: la línea "PQSINC1" y una línea DISPOSITIVO|SECUENCIA
+// por dispositivo. guardar() lo reescribe completo en un temporal y lo
+// renombra, así nunca queda a medias.
+//
+// Seguro entre hilos.
+class SecuenciasDispositivos {
+public:
+    SecuenciasDispositivos() : modificadas(false) {}
+
+    SecuenciasDispositivos(const SecuenciasDispositivos&) = delete;
+    SecuenciasDispositivos& operator=(const SecuenciasDispositivos&) = delete;
+
+    // Cargar ruta si existe y guardar ahí desde ahora. false si el archivo
+    // existe pero no se puede leer o está dañado.
+    bool cargar(const std::string& ruta);
+    bool persistente() const;
+
+    // 0 si el dispositivo no ha sincronizado nada
+    uint64_t ultima(const std::string& dispositivo) const;
+    // Subir la marca del dispositivo a secuencia (nunca la baja)
+    void anotar(const std::string& dispositivo, uint64_t secuencia);
+
+    // Llevar a disco (con fsync) lo anotado desde la última vez; true si
+    // no hay archivo o no cambió nada
+    bool guardar();
+
+private:
+    mutable std::mutex mutex;          // Protege todo lo demás
+    std::unordered_map<std::string, uint64_t> ultimas;
+    bool modificadas;
+    std::string ruta_archivo;
+
+    std::mutex mutex_archivo;          // Un solo guardar() a la vez
+};
+
+#endif
@@ -0,0 +1,687 @@
+#include "servidor_http.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifndef _WIN32
+    #include <sys/select.h>
+    #include <netinet/tcp.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+#endif
+
+// Encabezados de un pedido más largos que esto cierran la conexión
+static const size_t MAX_PEDIDO_HTTP = 8 * 1024;
+
+// Buffers más grandes que esto no vuelven a la reserva con su conexión
+static const size_t MAX_BUFFER_RESERVA = 16 * 1024;
+
+// Conexiones cerradas que cada hilo guarda para reutilizar
+static const size_t MAX_CONEXIONES_RESERVA = 1024;
+
+#ifdef MSG_NOSIGNAL
+static const int FLAGS_ENVIO = MSG_NOSIGNAL;
+#else
+static const int FLAGS_ENVIO = 0;
+#endif
+
+static void agregar_entero(std::string& destino, long long valor) {
+    char texto[24];
+    int largo = snprintf(texto, sizeof(texto), "%lld", valor);
+    destino.append(texto, (size_t)largo);
+}
+
+static void agregar_pesos(std::string& destino, double valor, const char* formato = "%.2f") {
+    char texto[48];
+    int largo = snprintf(texto, sizeof(texto), formato, valor);
+    destino.append(texto, (size_t)std::min(largo, (int)sizeof(texto) - 1));
+}
+
+// Texto dentro de una cadena JSON, con los escapes obligatorios
+static void agregar_escapado_json(std::string& destino, const char* texto, size_t largo) {
+    for (size_t i = 0; i < largo; i++) {
+        unsigned char c = (unsigned char)texto[i];
+        if (c == '"' || c == '\\') {
+            destino += '\\';
+            destino += (char)c;
+        } else if (c == '\n') {
+            destino += "\\n";
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            destino += escape;
+        } else {
+            destino += (char)c;
+        }
+    }
+}
+
+// Cadena JSON entre comillas
+static void agregar_texto_json(std::string& destino, const char* texto, size_t largo) {
+    destino += '"';
+    agregar_escapado_json(destino, texto, largo);
+    destino += '"';
+}
+
+static void agregar_texto_json(std::string& destino, const char* texto) {
+    agregar_texto_json(destino, texto, strlen(texto));
+}
+
+static size_t largo_placa(const char (&placa)[8]) {
+    const void* fin = memchr(placa, '\0', sizeof(placa));
+    return fin == nullptr ? sizeof(placa) : (size_t)((const char*)fin - placa);
+}
+
+static bool placa_menor(const RegistroTarifa& a, const RegistroTarifa& b) {
+    return strncmp(a.placa, b.placa, sizeof(a.placa)) < 0;
+}
+
+// Comparar sin distinguir mayúsculas con un texto en minúsculas
+static bool empieza_sin_mayusculas(const char* datos, size_t largo, const char* prefijo) {
+    size_t n = strlen(prefijo);
+    if (largo < n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if ((char)((unsigned char)datos[i] | 0x20) != prefijo[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool contiene_sin_mayusculas(const char* datos, size_t largo, const char* palabra) {
+    size_t n = strlen(palabra);
+    for (size_t i = 0; i + n <= largo; i++) {
+        if (empieza_sin_mayusculas(datos + i, largo - i, palabra)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Valor de encabezado que es sólo ceros (Content-Length: 0)
+static bool valor_cero(const char* datos, size_t largo) {
+    bool digito = false;
+    for (size_t i = 0; i < largo; i++) {
+        if (datos[i] == '0') {
+            digito = true;
+        } else if (datos[i] != ' ' && datos[i] != '\t') {
+            return false;
+        }
+    }
+    return digito;
+}
+
+// Línea de estado y encabezados; el cuerpo se agrega aparte
+static void escribir_encabezado(std::string& salida, const char* estado, size_t largo_cuerpo,
+                                bool cerrar) {
+    salida += "HTTP/1.1 ";
+    salida += estado;
+    salida += "\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: ";
+    agregar_entero(salida, (long long)largo_cuerpo);
+    salida += "\r\nAccess-Control-Allow-Origin: *\r\nCache-Control: no-cache\r\n";
+    if (cerrar) {
+        salida += "Connection: close\r\n";
+    }
+    salida += "\r\n";
+}
+
+static void escribir_respuesta(std::string& salida, const char* estado, const std::string& cuerpo,
+                               bool cabeza, bool cerrar) {
+    escribir_encabezado(salida, estado, cuerpo.size(), cerrar);
+    if (!cabeza) {
+        salida += cuerpo;
+    }
+}
+
+static void escribir_error(std::string& salida, const char* estado, const char* mensaje,
+                           bool cabeza, bool cerrar, std::string& cuerpo) {
+    cuerpo.assign("{\"error\":");
+    agregar_texto_json(cuerpo, mensaje);
+    cuerpo += '}';
+    escribir_respuesta(salida, estado, cuerpo, cabeza, cerrar);
+}
+
+// Placa de una ruta (en mayúsculas, como la normaliza app.py)
+static bool placa_de_ruta(const char* datos, size_t largo, PlacaCompacta& placa) {
+    char texto[8];
+    if (largo == 0 || largo > sizeof(texto)) {
+        return false;
+    }
+    for (size_t i = 0; i < largo; i++) {
+        char c = datos[i];
+        texto[i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+    }
+    return empaquetar_placa(texto, largo, placa);
+}
+
+ServidorHttp::ServidorHttp(const Parqueadero* p, int puerto, int backlog)
+    : parqueadero(p), puerto(puerto), backlog(backlog), servidor_socket(INVALID_SOCKET),
+      ejecutando(false), evento_parada(-1) {}
+
+ServidorHttp::~ServidorHttp() {
+    detener();
+}
+
+bool ServidorHttp::iniciar(int num_hilos) {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (ejecutando) {
+        return true;
+    }
+    if (!inicializar_sockets()) {
+        return false;
+    }
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        limpiar_sockets();
+        return false;
+    }
+    int opt = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    struct sockaddr_in direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_addr.s_addr = INADDR_ANY;
+    direccion.sin_port = htons(puerto);
+    if (bind(s, (struct sockaddr*)&direccion, sizeof(direccion)) == SOCKET_ERROR ||
+        listen(s, backlog) == SOCKET_ERROR) {
+        CLOSE_SOCKET(s);
+        limpiar_sockets();
+        return false;
+    }
+    servidor_socket = s;
+
+#ifdef __linux__
+    // Aceptar sin bloquear: todos los hilos comparten el socket servidor
+    int flags = fcntl(servidor_socket, F_GETFL, 0);
+    fcntl(servidor_socket, F_SETFL, flags | O_NONBLOCK);
+    evento_parada = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+
+    if (num_hilos < 1) num_hilos = 1;
+    ejecutando = true;
+    estados_hilos.clear();
+    for (int i = 0; i < num_hilos; i++) {
+        estados_hilos.push_back(std::unique_ptr<HiloHttp>(new HiloHttp()));
+    }
+    for (int i = 0; i < num_hilos; i++) {
+        hilos.push_back(std::thread(&ServidorHttp::loop_hilo, this, estados_hilos[i].get()));
+    }
+    return true;
+}
+
+void ServidorHttp::detener() {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (!ejecutando) {
+        return;
+    }
+    ejecutando = false;
+#ifdef __linux__
+    if (evento_parada != -1) {
+        uint64_t uno = 1;
+        ssize_t escrito = write(evento_parada, &uno, sizeof(uno));
+        (void)escrito;
+    }
+#endif
+    for (size_t i = 0; i < hilos.size(); i++) {
+        hilos[i].join();
+    }
+    hilos.clear();
+    CLOSE_SOCKET(servidor_socket);
+    servidor_socket = INVALID_SOCKET;
+#ifdef __linux__
+    if (evento_parada != -1) {
+        close(evento_parada);
+        evento_parada = -1;
+    }
+#endif
+    limpiar_sockets();
+}
+
+uint64_t ServidorHttp::total_pedidos() const {
+    // Los hilos sólo se crean al iniciar; sus estados viven hasta el próximo
+    uint64_t total = 0;
+    for (size_t i = 0; i < estados_hilos.size(); i++) {
+        total += estados_hilos[i]->pedidos.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void ServidorHttp::procesar_entrada(Conexion& conexion, HiloHttp& hilo) {
+    const std::string& entrada = conexion.entrada;
+    size_t inicio = 0;
+    while (!conexion.cerrar_al_enviar) {
+        size_t fin = entrada.find("\r\n\r\n", inicio);
+        if (fin == std::string::npos) {
+            if (entrada.size() - inicio > MAX_PEDIDO_HTTP) {
+                escribir_error(conexion.salida, "431 Request Header Fields Too Large",
+                               "Pedido demasiado grande", false, true, hilo.cuerpo);
+                conexion.cerrar_al_enviar = true;
+            }
+            break;
+        }
+
+        // Línea de pedido: MÉTODO RUTA VERSIÓN
+        const char* pedido = entrada.data() + inicio;
+        size_t largo = fin - inicio;
+        const char* fin_linea = (const char*)memchr(pedido, '\r', largo);
+        size_t largo_linea = fin_linea != nullptr ? (size_t)(fin_linea - pedido) : largo;
+        const char* espacio1 = (const char*)memchr(pedido, ' ', largo_linea);
+        const char* espacio2 = espacio1 == nullptr ? nullptr :
+            (const char*)memchr(espacio1 + 1, ' ', largo_linea - (size_t)(espacio1 + 1 - pedido));
+        inicio = fin + 4;
+        hilo.pedidos.store(hilo.pedidos.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+        if (espacio2 == nullptr) {
+            escribir_error(conexion.salida, "400 Bad Request", "Pedido inválido", false, true,
+                           hilo.cuerpo);
+            conexion.cerrar_al_enviar = true;
+            break;
+        }
+
+        const char* version = espacio2 + 1;
+        size_t largo_version = largo_linea - (size_t)(version - pedido);
+        bool http10 = largo_version == 8 && memcmp(version, "HTTP/1.0", 8) == 0;
+        bool cerrar = http10;
+        bool con_cuerpo = false;
+
+        // Encabezados que cambian el manejo: Connection y un cuerpo (no se leen)
+        const char* linea = fin_linea != nullptr ? fin_linea + 2 : pedido + largo;
+        while (linea < pedido + largo) {
+            size_t resto = (size_t)(pedido + largo - linea);
+            const char* fin_encabezado = (const char*)memchr(linea, '\r', resto);
+            size_t n = fin_encabezado != nullptr ? (size_t)(fin_encabezado - linea) : resto;
+            if (empieza_sin_mayusculas(linea, n, "connection:")) {
+                if (contiene_sin_mayusculas(linea, n, "close")) {
+                    cerrar = true;
+                } else if (contiene_sin_mayusculas(linea, n, "keep-alive")) {
+                    cerrar = false;
+                }
+            } else if (empieza_sin_mayusculas(linea, n, "transfer-encoding:") ||
+                       (empieza_sin_mayusculas(linea, n, "content-length:") &&
+                        !valor_cero(linea + 15, n - 15))) {
+                con_cuerpo = true;
+            }
+            linea += n + 2;
+        }
+
+        bool get = espacio1 - pedido == 3 && memcmp(pedido, "GET", 3) == 0;
+        bool cabeza = espacio1 - pedido == 4 && memcmp(pedido, "HEAD", 4) == 0;
+        if (con_cuerpo) {
+            escribir_error(conexion.salida, "400 Bad Request", "Los pedidos no llevan cuerpo",
+                           cabeza, true, hilo.cuerpo);
+            conexion.cerrar_al_enviar = true;
+        } else if (!get && !cabeza) {
+            escribir_error(conexion.salida, "405 Method Not Allowed", "Sólo GET y HEAD",
+                           false, cerrar, hilo.cuerpo);
+        } else {
+            responder(espacio1 + 1, (size_t)(espacio2 - espacio1 - 1), cabeza, cerrar,
+                      conexion.salida, hilo);
+        }
+        if (cerrar) {
+            conexion.cerrar_al_enviar = true;
+        }
+    }
+    conexion.entrada.erase(0, conexion.cerrar_al_enviar ? conexion.entrada.size() : inicio);
+}
+
+void ServidorHttp::responder(const char* ruta, size_t largo, bool cabeza, bool cerrar,
+                             std::string& salida, HiloHttp& hilo) {
+    const char* consulta = (const char*)memchr(ruta, '?', largo);
+    if (consulta != nullptr) {
+        largo = (size_t)(consulta - ruta);
+    }
+
+    static const char ESTADO[] = "/api/estado";
+    static const char VEHICULO[] = "/api/vehiculo/";
+    static const char TARIFA[] = "/api/tarifa/";
+    std::string& cuerpo = hilo.cuerpo;
+
+    if (largo == sizeof(ESTADO) - 1 && memcmp(ruta, ESTADO, largo) == 0) {
+        armar_estado(hilo);
+        escribir_respuesta(salida, "200 OK", hilo.estado, cabeza, cerrar);
+        return;
+    }
+
+    bool vehiculo = largo > sizeof(VEHICULO) - 1 && memcmp(ruta, VEHICULO, sizeof(VEHICULO) - 1) == 0;
+    bool tarifa = largo > sizeof(TARIFA) - 1 && memcmp(ruta, TARIFA, sizeof(TARIFA) - 1) == 0;
+    if (!vehiculo && !tarifa) {
+        escribir_error(salida, "404 Not Found", "Ruta no encontrada", cabeza, cerrar, cuerpo);
+        return;
+    }
+
+    size_t prefijo = vehiculo ? sizeof(VEHICULO) - 1 : sizeof(TARIFA) - 1;
+    PlacaCompacta placa = 0;
+    bool valida = placa_de_ruta(ruta + prefijo, largo - prefijo, placa);
+    ResultadoOperacion r = parqueadero->consultar_vehiculo(placa);
+    if (!valida || !r.ok()) {
+        escribir_error(salida, "404 Not Found", "Vehículo no encontrado", cabeza, cerrar, cuerpo);
+        return;
+    }
+
+    cuerpo.assign("{\"tarifa\":");
+    agregar_pesos(cuerpo, r.tarifa);
+    if (vehiculo) {
+        char placa_texto[9];
+        size_t largo_texto = largo - prefijo;
+        for (size_t i = 0; i < largo_texto; i++) {
+            char c = ruta[prefijo + i];
+            placa_texto[i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+        }
+        placa_texto[largo_texto] = '\0';
+        const char* tipo = nombre_tipo(r.tipo);
+
+        char hora[32];
+        time_t entrada = r.hora_entrada;
+        struct tm local;
+#ifdef _WIN32
+        localtime_s(&local, &entrada);
+#else
+        localtime_r(&entrada, &local);
+#endif
+        strftime(hora, sizeof(hora), "%Y-%m-%d %H:%M:%S", &local);
+
+        cuerpo += ",\"placa\":";
+        agregar_texto_json(cuerpo, placa_texto, largo_texto);
+        cuerpo += ",\"tipo\":";
+        agregar_texto_json(cuerpo, tipo);
+        cuerpo += ",\"espacio\":";
+        agregar_entero(cuerpo, r.espacio);
+        cuerpo += ",\"hora_entrada\":";
+        agregar_entero(cuerpo, (long long)r.hora_entrada);
+        // El mismo texto que mostraba app.py
+        cuerpo += ",\"info\":\"Placa: ";
+        agregar_escapado_json(cuerpo, placa_texto, largo_texto);
+        cuerpo += "\\nTipo: ";
+        cuerpo += tipo;
+        cuerpo += "\\nEspacio: ";
+        agregar_entero(cuerpo, r.espacio);
+        cuerpo += "\\nEntrada: ";
+        cuerpo += hora;
+        cuerpo += "\\nTarifa actual: $";
+        agregar_pesos(cuerpo, r.tarifa, "%.0f");
+        cuerpo += '"';
+    }
+    cuerpo += '}';
+    escribir_respuesta(salida, "200 OK", cuerpo, cabeza, cerrar);
+}
+
+void ServidorHttp::armar_estado(HiloHttp& hilo) {
+    // Con flujo de cambios, la misma secuencia garantiza el mismo estado:
+    // se lee antes de la foto, así la foto nunca es más vieja que ella
+    const FlujoCambios* flujo = parqueadero->flujo_cambios();
+    uint64_t secuencia = flujo != nullptr ? flujo->ultima_secuencia() : 0;
+    if (flujo != nullptr && hilo.estado_valido && hilo.secuencia_estado == secuencia) {
+        return;
+    }
+
+    std::vector<RegistroTarifa>& filas = hilo.filas;
+    filas.clear();
+    parqueadero->tarifas_actuales(filas);
+    std::sort(filas.begin(), filas.end(), placa_menor);
+    int carros = 0;
+    for (size_t i = 0; i < filas.size(); i++) {
+        carros += filas[i].tipo == (uint8_t)TipoVehiculo::CARRO;
+    }
+    int motos = (int)filas.size() - carros;
+
+    // Libres según la misma foto: concuerda con la lista de vehículos
+    std::string& s = hilo.estado;
+    s.assign("{\"espacios_carros\":");
+    agregar_entero(s, parqueadero->total_espacios_carros() - carros);
+    s += ",\"espacios_motos\":";
+    agregar_entero(s, parqueadero->total_espacios_motos() - motos);
+    s += ",\"capacidad_carros\":";
+    agregar_entero(s, parqueadero->total_espacios_carros());
+    s += ",\"capacidad_motos\":";
+    agregar_entero(s, parqueadero->total_espacios_motos());
+    s += ",\"total_vehiculos\":";
+    agregar_entero(s, (long long)filas.size());
+    s += ",\"vehiculos\":[";
+    for (size_t i = 0; i < filas.size(); i++) {
+        if (i > 0) s += ',';
+        agregar_texto_json(s, filas[i].placa, largo_placa(filas[i].placa));
+    }
+    s += "],\"detalle\":[";
+    for (size_t i = 0; i < filas.size(); i++) {
+        if (i > 0) s += ',';
+        s += "{\"placa\":";
+        agregar_texto_json(s, filas[i].placa, largo_placa(filas[i].placa));
+        s += ",\"tipo\":";
+        agregar_texto_json(s, nombre_tipo((TipoVehiculo)filas[i].tipo));
+        s += ",\"espacio\":";
+        agregar_entero(s, filas[i].espacio);
+        s += '}';
+    }
+    s += "],\"cursor\":";
+    if (flujo != nullptr) {
+        s += '"';
+        agregar_entero(s, (long long)flujo->epoca());
+        s += ':';
+        agregar_entero(s, (long long)secuencia);
+        s += '"';
+    } else {
+        s += "null";
+    }
+    s += '}';
+    hilo.secuencia_estado = secuencia;
+    hilo.estado_valido = true;
+}
+
+bool ServidorHttp::enviar_pendiente(Conexion& conexion) {
+    while (conexion.enviados < conexion.salida.size()) {
+        int n = send(conexion.socket, conexion.salida.data() + conexion.enviados,
+                     (int)(conexion.salida.size() - conexion.enviados), FLAGS_ENVIO);
+        if (n <= 0) {
+#ifdef __linux__
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+#endif
+            return false;
+        }
+        conexion.enviados += (size_t)n;
+    }
+    conexion.salida.clear();
+    conexion.enviados = 0;
+    return true;
+}
+
+#ifdef __linux__
+void ServidorHttp::loop_hilo(HiloHttp* hilo) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        return;
+    }
+
+    // ptr nulo identifica al socket servidor, &evento_parada al eventfd
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, servidor_socket, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &evento_parada;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, evento_parada, &ev);
+
+    // Abiertas (cada una sabe su posición) y cerradas con sus buffers
+    std::vector<Conexion*> abiertas;
+    std::vector<Conexion*> reserva;
+    const int MAX_EVENTOS = 256;
+    struct epoll_event eventos[MAX_EVENTOS];
+    char buffer[4096];
+
+    while (ejecutando) {
+        int n = epoll_wait(epoll_fd, eventos, MAX_EVENTOS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            void* origen = eventos[i].data.ptr;
+            if (origen == &evento_parada) {
+                continue;
+            }
+
+            if (origen == nullptr) {
+                while (true) {
+                    socket_t cliente = accept4(servidor_socket, nullptr, nullptr,
+                                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (cliente == INVALID_SOCKET) {
+                        break;
+                    }
+                    // Respuestas chicas en conexiones persistentes: sin Nagle
+                    int uno = 1;
+                    setsockopt(cliente, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+
+                    Conexion* conexion;
+                    if (reserva.empty()) {
+                        conexion = new Conexion();
+                    } else {
+                        conexion = reserva.back();
+                        reserva.pop_back();
+                    }
+                    conexion->socket = cliente;
+                    conexion->enviados = 0;
+                    conexion->cerrar_al_enviar = false;
+                    conexion->esperando_escritura = false;
+                    conexion->posicion = abiertas.size();
+                    abiertas.push_back(conexion);
+
+                    struct epoll_event ev_cliente;
+                    ev_cliente.events = EPOLLIN | EPOLLRDHUP;
+                    ev_cliente.data.ptr = conexion;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, cliente, &ev_cliente);
+                }
+                continue;
+            }
+
+            Conexion* conexion = static_cast<Conexion*>(origen);
+            bool cerrar = (eventos[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            if (!cerrar && (eventos[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                while (true) {
+                    ssize_t leidos = recv(conexion->socket, buffer, sizeof(buffer), 0);
+                    if (leidos > 0) {
+                        conexion->entrada.append(buffer, (size_t)leidos);
+                        continue;
+                    }
+                    if (leidos == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                        cerrar = true;
+                    }
+                    if (leidos < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    break;
+                }
+                if (!conexion->cerrar_al_enviar) {
+                    procesar_entrada(*conexion, *hilo);
+                }
+            }
+
+            if (!enviar_pendiente(*conexion)) {
+                cerrar = true;
+            }
+            bool pendiente = !conexion->salida.empty();
+            if (!pendiente && conexion->cerrar_al_enviar) {
+                cerrar = true;
+            }
+
+            if (cerrar) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conexion->socket, nullptr);
+                CLOSE_SOCKET(conexion->socket);
+                Conexion* ultima = abiertas.back();
+                abiertas[conexion->posicion] = ultima;
+                ultima->posicion = conexion->posicion;
+                abiertas.pop_back();
+
+                conexion->entrada.clear();
+                conexion->salida.clear();
+                if (conexion->entrada.capacity() > MAX_BUFFER_RESERVA) std::string().swap(conexion->entrada);
+                if (conexion->salida.capacity() > MAX_BUFFER_RESERVA) std::string().swap(conexion->salida);
+                if (reserva.size() < MAX_CONEXIONES_RESERVA) {
+                    reserva.push_back(conexion);
+                } else {
+                    delete conexion;
+                }
+            } else if (pendiente != conexion->esperando_escritura) {
+                // Pedir EPOLLOUT sólo mientras quede algo por enviar
+                struct epoll_event ev_cliente;
+                ev_cliente.events = EPOLLIN | EPOLLRDHUP | (pendiente ? (uint32_t)EPOLLOUT : 0u);
+                ev_cliente.data.ptr = conexion;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conexion->socket, &ev_cliente);
+                conexion->esperando_escritura = pendiente;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < abiertas.size(); i++) {
+        CLOSE_SOCKET(abiertas[i]->socket);
+        delete abiertas[i];
+    }
+    for (size_t i = 0; i < reserva.size(); i++) {
+        delete reserva[i];
+    }
+    close(epoll_fd);
+}
+#else
+void ServidorHttp::loop_hilo(HiloHttp* hilo) {
+    Conexion conexion;
+    char buffer[4096];
+    while (ejecutando) {
+        // Esperar con timeout para revisar ejecutando
+        fd_set lectura;
+        FD_ZERO(&lectura);
+        FD_SET(servidor_socket, &lectura);
+        struct timeval espera;
+        espera.tv_sec = 0;
+        espera.tv_usec = 200000;
+        if (select((int)servidor_socket + 1, &lectura, nullptr, nullptr, &espera) <= 0) {
+            continue;
+        }
+        socket_t cliente = accept(servidor_socket, nullptr, nullptr);
+        if (cliente == INVALID_SOCKET) {
+            continue;
+        }
+
+        // Una conexión a la vez; se cierra tras un segundo sin pedidos
+#ifdef _WIN32
+        DWORD limite_ms = 1000;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite_ms, sizeof(limite_ms));
+#else
+        struct timeval limite;
+        limite.tv_sec = 1;
+        limite.tv_usec = 0;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite, sizeof(limite));
+#endif
+        conexion.socket = cliente;
+        conexion.entrada.clear();
+        conexion.salida.clear();
+        conexion.enviados = 0;
+        conexion.cerrar_al_enviar = false;
+        while (ejecutando && !conexion.cerrar_al_enviar) {
+            int n = recv(cliente, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                break;
+            }
+            conexion.entrada.append(buffer, (size_t)n);
+            procesar_entrada(conexion, *hilo);
+            if (!enviar_pendiente(conexion)) {
+                break;
+            }
+        }
+        CLOSE_SOCKET(cliente);
+    }
+}
+#endif
@@ -0,0 +1,91 @@
+#ifndef SERVIDOR_HTTP_HPP
+#define SERVIDOR_HTTP_HPP
+
+#include "parqueadero.hpp"
+#include "socket_utils.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Servidor HTTP/1.1 de sólo lectura para tableros, kioscos y apps:
+//
+//   GET /api/estado            espacios libres, capacidad, vehículos y cursor
+//   GET /api/vehiculo/<placa>  tipo, espacio, hora de entrada y tarifa actual
+//   GET /api/tarifa/<placa>    tarifa actual
+//
+// Responde JSON directamente desde el Parqueadero, sin Python en el camino.
+// Cada hilo es un reactor epoll que comparte el socket servidor. Las
+// conexiones son persistentes (keep-alive, con pedidos encadenados) y
+// reutilizan sus buffers. Con el flujo de cambios habilitado, cada hilo
+// guarda el JSON de /api/estado y sólo lo rearma cuando hubo cambios.
+// En plataformas sin epoll cada hilo atiende una conexión a la vez.
+class ServidorHttp {
+public:
+    ServidorHttp(const Parqueadero* p, int puerto = 8081, int backlog = SOMAXCONN);
+    ~ServidorHttp();
+
+    ServidorHttp(const ServidorHttp&) = delete;
+    ServidorHttp& operator=(const ServidorHttp&) = delete;
+
+    // Abrir el puerto y atender con num_hilos hilos propios (no bloquea)
+    bool iniciar(int num_hilos = 2);
+    void detener();
+    bool esta_ejecutando() const { return ejecutando; }
+    int obtener_puerto() const { return puerto; }
+
+    // Pedidos respondidos desde que se creó (cualquier código)
+    uint64_t total_pedidos() const;
+
+private:
+    // Estado de una conexión persistente
+    struct Conexion {
+        socket_t socket;
+        std::string entrada;   // Bytes recibidos sin procesar
+        std::string salida;    // Respuestas pendientes de enviar
+        size_t enviados;
+        bool cerrar_al_enviar;
+        bool esperando_escritura; // Registrada con EPOLLOUT
+        size_t posicion;       // En la lista de abiertas de su hilo
+    };
+
+    // Lo que cada hilo reutiliza entre pedidos
+    struct HiloHttp {
+        std::string cuerpo;
+        std::vector<RegistroTarifa> filas;
+        std::string estado;    // JSON de /api/estado ya armado
+        uint64_t secuencia_estado;
+        bool estado_valido;
+        std::atomic<uint64_t> pedidos;
+        char relleno[64];
+
+        HiloHttp() : secuencia_estado(0), estado_valido(false), pedidos(0) {}
+    };
+
+    const Parqueadero* parqueadero;
+    int puerto;
+    int backlog;
+    socket_t servidor_socket;
+    std::atomic<bool> ejecutando;
+    int evento_parada;         // eventfd que despierta a los reactores (Linux)
+    std::vector<std::thread> hilos;
+    std::vector<std::unique_ptr<HiloHttp> > estados_hilos;
+    std::mutex mutex_estado;   // Protege iniciar/detener
+
+    void loop_hilo(HiloHttp* hilo);
+    // Responder los pedidos completos de la conexión; uno inválido o
+    // demasiado grande deja cerrar_al_enviar
+    void procesar_entrada(Conexion& conexion, HiloHttp& hilo);
+    // Agregar a salida la respuesta a un pedido GET/HEAD
+    void responder(const char* ruta, size_t largo, bool cabeza, bool cerrar,
+                   std::string& salida, HiloHttp& hilo);
+    void armar_estado(HiloHttp& hilo);
+    // Enviar lo pendiente; false si la conexión se cayó
+    static bool enviar_pendiente(Conexion& conexion);
+};
+
+#endif
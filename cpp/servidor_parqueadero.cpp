@@ -1,25 +1,207 @@
 #include "servidor_parqueadero.hpp"
-#include <iostream>
+#include "anillo_io.hpp"
 #include <sstream>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
-ServidorParqueadero::ServidorParqueadero(Parqueadero* p, int puerto)
-    : parqueadero(p), puerto(puerto), servidor_socket(INVALID_SOCKET), ejecutando(false) {
+#ifndef _WIN32
+    #include <sys/select.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <cstdint>
+#endif
+
+// Tamaño máximo del buffer de lectura por conexión
+static const size_t MAX_BUFFER_CONEXION = 64 * 1024;
+
+// Buffers más grandes que esto no vuelven a la reserva con su conexión
+static const size_t MAX_BUFFER_RESERVA = 16 * 1024;
+
+// Conexiones cerradas que cada reactor guarda para reutilizar
+static const size_t MAX_CONEXIONES_RESERVA = 1024;
+
+// Eventos que pueden esperar a ser consumidos desde Python
+static const size_t CAPACIDAD_COLA_EVENTOS = 1 << 16;
+
+typedef std::chrono::steady_clock Reloj;
+
+// Líneas del log del servidor (ver log_asincrono.hpp)
+#define SIN_CAMPOS {nullptr, nullptr, nullptr}
+static const FormatoLog LOG_ERROR_SOCKETS = {NivelLog::FALLO, "Error al inicializar sockets", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_ERROR_SOCKET = {NivelLog::FALLO, "Error al crear socket", {"error", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_ERROR_BIND = {NivelLog::FALLO, "Error en bind", {"error", nullptr, nullptr}, "puerto"};
+static const FormatoLog LOG_ERROR_LISTEN = {NivelLog::FALLO, "Error en listen", {"error", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_INICIADO = {NivelLog::INFO, "✅ Servidor iniciado", SIN_CAMPOS, "puerto"};
+static const FormatoLog LOG_DETENIDO = {NivelLog::INFO, "🛑 Servidor detenido", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_REACTOR = {NivelLog::INFO, "⚡ Reactor epoll", {"backlog", nullptr, nullptr}, "hilos"};
+static const FormatoLog LOG_REACTOR_URING = {NivelLog::INFO, "⚡ Reactor io_uring", {"backlog", nullptr, nullptr}, "hilos"};
+static const FormatoLog LOG_SIN_IO_URING = {NivelLog::AVISO, "io_uring no disponible, se usan sockets", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_ERROR_URING = {NivelLog::FALLO, "Error en io_uring", {"llamada", "error", nullptr}, nullptr};
+static const FormatoLog LOG_ERROR_EPOLL = {NivelLog::FALLO, "Error en epoll", {"llamada", "error", nullptr}, nullptr};
+static const FormatoLog LOG_ESPERANDO = {NivelLog::DEPURACION, "⏳ Esperando conexión de dispositivo...", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_ERROR_ACCEPT = {NivelLog::FALLO, "Error en accept", {"error", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_CONECTADO = {NivelLog::INFO, "📡 Dispositivo conectado", {"ip", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_MENSAJE_GRANDE = {NivelLog::AVISO, "Mensaje demasiado grande, cerrando conexión", SIN_CAMPOS, "bytes"};
+static const FormatoLog LOG_ERROR_RECV = {NivelLog::AVISO, "Error al recibir datos", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_ERROR_SEND = {NivelLog::AVISO, "Error al enviar respuesta", SIN_CAMPOS, nullptr};
+static const FormatoLog LOG_MENSAJE = {NivelLog::DEPURACION, "📨 Mensaje recibido", {"mensaje", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_RESPUESTA = {NivelLog::DEPURACION, "📤 Respuesta enviada", {"respuesta", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_REPETIDO = {NivelLog::DEPURACION, "🔁 Lectura repetida ignorada", {"mensaje", nullptr, nullptr}, nullptr};
+static const FormatoLog LOG_SINCRONIZACION = {NivelLog::INFO, "🔄 Sincronización", {"dispositivo", nullptr, nullptr}, "eventos"};
+static const FormatoLog LOG_DUPLICADO = {NivelLog::DEPURACION, "🔁 Evento ya aplicado", {"mensaje", nullptr, nullptr}, "secuencia"};
+static const FormatoLog LOG_RECHAZO = {NivelLog::AVISO, "⚠️  Mensaje rechazado", {"motivo", "mensaje", nullptr}, nullptr};
+static const FormatoLog LOG_ENTRADA = {NivelLog::INFO, "🚗 ENTRADA", {"placa", "tipo", "dispositivo"}, "espacio"};
+static const FormatoLog LOG_ENTRADA_RECHAZADA = {NivelLog::INFO, "🚗 ENTRADA rechazada", {"placa", "motivo", "dispositivo"}, nullptr};
+static const FormatoLog LOG_SALIDA = {NivelLog::INFO, "🚙 SALIDA", {"placa", "tipo", "dispositivo"}, "tarifa"};
+static const FormatoLog LOG_SALIDA_RECHAZADA = {NivelLog::INFO, "🚙 SALIDA rechazada", {"placa", "motivo", "dispositivo"}, nullptr};
+static const FormatoLog LOG_ERROR_METRICAS = {NivelLog::FALLO, "Error al abrir el puerto de métricas", {"error", nullptr, nullptr}, "puerto"};
+static const FormatoLog LOG_METRICAS = {NivelLog::INFO, "📈 Métricas en /metrics", SIN_CAMPOS, "puerto"};
+#undef SIN_CAMPOS
+
+static uint64_t ns_desde(Reloj::time_point inicio) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Reloj::now() - inicio).count();
+}
+
+static int64_t ms_monotonos(Reloj::time_point t) {
+    return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+}
+
+// Copiar un fragmento truncándolo al tamaño del arreglo destino
+template <size_t N>
+static void copiar_campo(char (&destino)[N], const Fragmento& origen) {
+    size_t n = std::min(origen.largo, N - 1);
+    memcpy(destino, origen.datos, n);
+    destino[n] = '\0';
+}
+
+template <size_t N>
+static void copiar_campo(char (&destino)[N], const char* origen) {
+    copiar_campo(destino, Fragmento(origen, strlen(origen)));
+}
+
+void ServidorParqueadero::Conexion::reiniciar(socket_t s) {
+    socket = s;
+    entrada.clear();
+    salida.clear();
+    en_vuelo.clear();
+    if (entrada.capacity() > MAX_BUFFER_RESERVA) std::string().swap(entrada);
+    if (salida.capacity() > MAX_BUFFER_RESERVA) std::string().swap(salida);
+    if (en_vuelo.capacity() > MAX_BUFFER_RESERVA) std::string().swap(en_vuelo);
+    enviados = 0;
+    cerrar_al_enviar = false;
+    negociado = false;
+    enmarcado = false;
+    destino = -1;
+    posicion = 0;
+    recibiendo = false;
+    enviando = false;
+    cerrando = false;
+    cancelando = false;
+    sinc_restantes = 0;
+    sinc_secuencia = 0;
+    sinc_dispositivo.clear();
+    sinc_aplicada = 0;
+}
+
+ServidorParqueadero::ConexionesReactor::~ConexionesReactor() {
+    for (size_t i = 0; i < abiertas.size(); i++) delete abiertas[i];
+    for (size_t i = 0; i < reserva.size(); i++) delete reserva[i];
+}
+
+ServidorParqueadero::Conexion* ServidorParqueadero::ConexionesReactor::abrir(socket_t s) {
+    Conexion* conexion;
+    if (reserva.empty()) {
+        conexion = new Conexion(s);
+    } else {
+        conexion = reserva.back();
+        reserva.pop_back();
+        conexion->reiniciar(s);
+    }
+    agregar(conexion);
+    return conexion;
+}
+
+void ServidorParqueadero::ConexionesReactor::agregar(Conexion* conexion) {
+    conexion->posicion = abiertas.size();
+    abiertas.push_back(conexion);
+}
+
+void ServidorParqueadero::ConexionesReactor::quitar(Conexion* conexion) {
+    Conexion* ultima = abiertas.back();
+    abiertas[conexion->posicion] = ultima;
+    ultima->posicion = conexion->posicion;
+    abiertas.pop_back();
+}
+
+void ServidorParqueadero::ConexionesReactor::liberar(Conexion* conexion) {
+    quitar(conexion);
+    if (reserva.size() < MAX_CONEXIONES_RESERVA) {
+        reserva.push_back(conexion);
+    } else {
+        delete conexion;
+    }
+}
+
+ServidorParqueadero::ServidorParqueadero(Parqueadero* p, int puerto, int backlog)
+    : parqueadero(p), gestor(nullptr), puerto(puerto), backlog(backlog > 0 ? backlog : SOMAXCONN),
+      servidor_socket(INVALID_SOCKET), ejecutando(false), en_reactor(false),
+      backend_activo(BackendServidor::SOCKETS), evento_parada(-1), num_reactores(1), cola_eventos(CAPACIDAD_COLA_EVENTOS),
+      consumidor_esperando(false), metricas_socket(INVALID_SOCKET), sirviendo_metricas(false) {
+}
+
+ServidorParqueadero::ServidorParqueadero(GestorParqueaderos* g, int puerto, int backlog)
+    : parqueadero(nullptr), gestor(g), puerto(puerto), backlog(backlog > 0 ? backlog : SOMAXCONN),
+      servidor_socket(INVALID_SOCKET), ejecutando(false), en_reactor(false),
+      backend_activo(BackendServidor::SOCKETS), evento_parada(-1), num_reactores(1), cola_eventos(CAPACIDAD_COLA_EVENTOS),
+      consumidor_esperando(false), metricas_socket(INVALID_SOCKET), sirviendo_metricas(false) {
 }
 
 ServidorParqueadero::~ServidorParqueadero() {
+    detener_metricas();
     detener();
+    // Lotes que quedaron a medias al cortarse su conexión
+    secuencias_aplicadas.guardar();
 }
 
-bool ServidorParqueadero::iniciar() {
+bool ServidorParqueadero::iniciar(BackendServidor backend) {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (ejecutando) {
+        return true;
+    }
+
+    if (backend == BackendServidor::IO_URING && !AnilloIO::disponible()) {
+        log_servidor.registrar(LOG_SIN_IO_URING);
+        backend = BackendServidor::SOCKETS;
+    }
+    backend_activo = backend;
+
+    // Las secuencias SINC viven junto a la bitácora del parqueadero
+    if (!secuencias_aplicadas.persistente() && parqueadero != nullptr &&
+        parqueadero->obtener_bitacora() != nullptr &&
+        !secuencias_aplicadas.cargar(parqueadero->obtener_bitacora()->ruta("secuencias.sinc"))) {
+        return false;
+    }
+
     if (!inicializar_sockets()) {
-        std::cerr << "Error al inicializar sockets" << std::endl;
+        log_servidor.registrar(LOG_ERROR_SOCKETS);
         return false;
     }
     
     // Crear socket
     servidor_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (servidor_socket == INVALID_SOCKET) {
-        std::cerr << "Error al crear socket: " << obtener_error_socket() << std::endl;
+        log_servidor.registrar(LOG_ERROR_SOCKET, obtener_error_socket().c_str());
         limpiar_sockets();
         return false;
     }
@@ -40,37 +222,75 @@ bool ServidorParqueadero::iniciar() {
     
     // Bind
     if (bind(servidor_socket, (struct sockaddr*)&direccion, sizeof(direccion)) == SOCKET_ERROR) {
-        std::cerr << "Error en bind: " << obtener_error_socket() << std::endl;
+        log_servidor.registrar(LOG_ERROR_BIND, obtener_error_socket().c_str(),
+                               Fragmento(), Fragmento(), puerto);
         CLOSE_SOCKET(servidor_socket);
         limpiar_sockets();
         return false;
     }
     
+    // Con puerto 0 el sistema elige uno libre (ver obtener_puerto())
+    if (puerto == 0) {
+#ifdef _WIN32
+        int largo_direccion = sizeof(direccion);
+#else
+        socklen_t largo_direccion = sizeof(direccion);
+#endif
+        if (getsockname(servidor_socket, (struct sockaddr*)&direccion, &largo_direccion) == 0) {
+            puerto = ntohs(direccion.sin_port);
+        }
+    }
+    
     // Listen
-    if (listen(servidor_socket, 5) == SOCKET_ERROR) {
-        std::cerr << "Error en listen: " << obtener_error_socket() << std::endl;
+    if (listen(servidor_socket, backlog) == SOCKET_ERROR) {
+        log_servidor.registrar(LOG_ERROR_LISTEN, obtener_error_socket().c_str());
         CLOSE_SOCKET(servidor_socket);
         limpiar_sockets();
         return false;
     }
+
+#ifdef __linux__
+    evento_parada = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
     
     ejecutando = true;
-    std::cout << "✅ Servidor iniciado en puerto " << puerto << std::endl;
+    log_servidor.registrar(LOG_INICIADO, Fragmento(), Fragmento(), Fragmento(), puerto);
     return true;
 }
 
 void ServidorParqueadero::detener() {
+    std::lock_guard<std::mutex> lock(mutex_estado);
     if (ejecutando) {
         ejecutando = false;
-        if (servidor_socket != INVALID_SOCKET) {
-            CLOSE_SOCKET(servidor_socket);
-            servidor_socket = INVALID_SOCKET;
+#ifdef __linux__
+        // Despertar a los reactores; ellos liberan los recursos al salir
+        if (evento_parada != -1) {
+            uint64_t uno = 1;
+            ssize_t escrito = write(evento_parada, &uno, sizeof(uno));
+            (void)escrito;
         }
-        limpiar_sockets();
-        std::cout << "🛑 Servidor detenido" << std::endl;
+#endif
+        if (!en_reactor) {
+            liberar_recursos();
+        }
+        log_servidor.registrar(LOG_DETENIDO);
     }
 }
 
+void ServidorParqueadero::liberar_recursos() {
+    if (servidor_socket != INVALID_SOCKET) {
+        CLOSE_SOCKET(servidor_socket);
+        servidor_socket = INVALID_SOCKET;
+    }
+#ifdef __linux__
+    if (evento_parada != -1) {
+        close(evento_parada);
+        evento_parada = -1;
+    }
+#endif
+    limpiar_sockets();
+}
+
 bool ServidorParqueadero::aceptar_conexion() {
     if (!ejecutando) {
         return false;
@@ -83,107 +303,1051 @@ bool ServidorParqueadero::aceptar_conexion() {
     socklen_t addrlen = sizeof(direccion_cliente);
 #endif
     
-    std::cout << "⏳ Esperando conexión de dispositivo..." << std::endl;
+    log_servidor.registrar(LOG_ESPERANDO);
     
     socket_t cliente_socket = accept(servidor_socket, 
                                      (struct sockaddr*)&direccion_cliente, 
                                      &addrlen);
     
     if (cliente_socket == INVALID_SOCKET) {
-        std::cerr << "Error en accept: " << obtener_error_socket() << std::endl;
+        log_servidor.registrar(LOG_ERROR_ACCEPT, obtener_error_socket().c_str());
         return false;
     }
     
     char ip_cliente[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &direccion_cliente.sin_addr, ip_cliente, INET_ADDRSTRLEN);
-    std::cout << "📡 Dispositivo conectado desde " << ip_cliente << std::endl;
+    log_servidor.registrar(LOG_CONECTADO, ip_cliente);
     
+    metricas.hilo().conexion_aceptada();
     manejar_cliente(cliente_socket);
     CLOSE_SOCKET(cliente_socket);
+    metricas.hilo().conexion_cerrada();
     
     return true;
 }
 
-void ServidorParqueadero::manejar_cliente(socket_t cliente_socket) {
-    char buffer[1024] = {0};
-    
-    // Recibir datos
-    int bytes_recibidos = recv(cliente_socket, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytes_recibidos <= 0) {
-        std::cerr << "Error al recibir datos" << std::endl;
+bool ServidorParqueadero::ejecutar(int num_hilos) {
+#ifdef __linux__
+    {
+        std::lock_guard<std::mutex> lock(mutex_estado);
+        if (!ejecutando || en_reactor) {
+            return false;
+        }
+        en_reactor = true;
+    }
+
+    // Aceptar sin bloquear: varios reactores comparten el socket servidor
+    int flags = fcntl(servidor_socket, F_GETFL, 0);
+    fcntl(servidor_socket, F_SETFL, flags | O_NONBLOCK);
+
+    if (num_hilos < 1) num_hilos = 1;
+    bool con_uring = backend_activo == BackendServidor::IO_URING;
+    log_servidor.registrar(con_uring ? LOG_REACTOR_URING : LOG_REACTOR,
+                           std::to_string(backlog).c_str(), Fragmento(), Fragmento(), num_hilos);
+    void (ServidorParqueadero::*loop)(int) = con_uring ? &ServidorParqueadero::loop_uring
+                                                       : &ServidorParqueadero::loop_reactor;
+
+    num_reactores = num_hilos;
+    buzones.clear();
+    for (int i = 0; i < num_hilos; i++) {
+        buzones.push_back(std::unique_ptr<Buzon>(new Buzon()));
+        buzones.back()->evento = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    std::vector<std::thread> hilos;
+    for (int i = 1; i < num_hilos; i++) {
+        hilos.push_back(std::thread(loop, this, i));
+    }
+    (this->*loop)(0);
+    for (size_t i = 0; i < hilos.size(); i++) {
+        hilos[i].join();
+    }
+
+    // Conexiones que quedaron de paso entre reactores
+    for (size_t i = 0; i < buzones.size(); i++) {
+        for (size_t j = 0; j < buzones[i]->conexiones.size(); j++) {
+            CLOSE_SOCKET(buzones[i]->conexiones[j]->socket);
+            delete buzones[i]->conexiones[j];
+            metricas.hilo().conexion_cerrada();
+        }
+        if (buzones[i]->evento != -1) {
+            close(buzones[i]->evento);
+        }
+    }
+    buzones.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    en_reactor = false;
+    if (!ejecutando) {
+        liberar_recursos();
+    }
+    return true;
+#else
+    (void)num_hilos;
+    while (ejecutando) {
+        aceptar_conexion();
+    }
+    return true;
+#endif
+}
+
+#ifdef __linux__
+// Fijar el hilo actual a un núcleo; afinidad queda con la anterior
+static bool fijar_nucleo(int indice, cpu_set_t& afinidad) {
+    unsigned nucleos = std::thread::hardware_concurrency();
+    if (nucleos == 0 || pthread_getaffinity_np(pthread_self(), sizeof(afinidad), &afinidad) != 0) {
+        return false;
+    }
+    cpu_set_t uno;
+    CPU_ZERO(&uno);
+    CPU_SET(indice % nucleos, &uno);
+    return pthread_setaffinity_np(pthread_self(), sizeof(uno), &uno) == 0;
+}
+
+void ServidorParqueadero::loop_reactor(int indice) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        log_servidor.registrar(LOG_ERROR_EPOLL, "epoll_create", obtener_error_socket().c_str());
         return;
     }
-    
-    buffer[bytes_recibidos] = '\0';
-    std::string datos(buffer);
-    
-    std::cout << "📨 Mensaje recibido: " << datos << std::endl;
-    
-    // Parsear y procesar
-    MensajeDispositivo mensaje = parsear_mensaje(datos);
-    std::string respuesta = procesar_comando(mensaje);
-    
-    // Enviar respuesta
-    send(cliente_socket, respuesta.c_str(), respuesta.length(), 0);
-    std::cout << "📤 Respuesta enviada: " << respuesta << std::endl;
+
+    // Con varios lotes cada reactor es dueño de algunos: mantenerlo en un
+    // núcleo conserva sus datos en esa caché
+    cpu_set_t afinidad_anterior;
+    bool fijado = gestor != nullptr && fijar_nucleo(indice, afinidad_anterior);
+    Buzon* buzon = buzones[indice].get();
+
+    // ptr nulo identifica al socket servidor, &evento_parada al eventfd
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, servidor_socket, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &evento_parada;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, evento_parada, &ev);
+    ev.data.ptr = buzon;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, buzon->evento, &ev);
+
+    ConexionesReactor conexiones;
+    std::vector<Conexion*> llegadas;
+    const int MAX_EVENTOS = 256;
+    struct epoll_event eventos[MAX_EVENTOS];
+    char buffer[4096];
+    MetricasHilo& m = metricas.hilo();
+
+    while (ejecutando) {
+        int n = epoll_wait(epoll_fd, eventos, MAX_EVENTOS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_servidor.registrar(LOG_ERROR_EPOLL, "epoll_wait", obtener_error_socket().c_str());
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            void* origen = eventos[i].data.ptr;
+
+            if (origen == &evento_parada) {
+                continue;
+            }
+
+            if (origen == buzon) {
+                // Conexiones que otro reactor pasó a éste
+                uint64_t avisos;
+                ssize_t leido = read(buzon->evento, &avisos, sizeof(avisos));
+                (void)leido;
+                {
+                    std::lock_guard<std::mutex> lock(buzon->mutex);
+                    llegadas.swap(buzon->conexiones);
+                }
+                for (size_t j = 0; j < llegadas.size(); j++) {
+                    Conexion* conexion = llegadas[j];
+                    conexion->destino = -1;
+                    conexiones.agregar(conexion);
+                    struct epoll_event ev_cliente;
+                    ev_cliente.events = EPOLLIN | EPOLLRDHUP;
+                    ev_cliente.data.ptr = conexion;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conexion->socket, &ev_cliente);
+                    atender_conexion(epoll_fd, indice, conexion, false, conexiones, m);
+                }
+                llegadas.clear(); // Conserva la capacidad para el próximo intercambio
+                continue;
+            }
+
+            if (origen == nullptr) {
+                // Aceptar todas las conexiones pendientes
+                while (true) {
+                    struct sockaddr_in direccion_cliente;
+                    socklen_t addrlen = sizeof(direccion_cliente);
+                    Reloj::time_point t = Reloj::now();
+                    socket_t cliente = accept4(servidor_socket,
+                                               (struct sockaddr*)&direccion_cliente,
+                                               &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (cliente == INVALID_SOCKET) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            log_servidor.registrar(LOG_ERROR_ACCEPT, obtener_error_socket().c_str());
+                        }
+                        break;
+                    }
+                    m.registrar(EtapaServidor::ACEPTAR, ns_desde(t));
+                    m.conexion_aceptada();
+
+                    char ip_cliente[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &direccion_cliente.sin_addr, ip_cliente, INET_ADDRSTRLEN);
+                    log_servidor.registrar(LOG_CONECTADO, ip_cliente);
+
+                    Conexion* conexion = conexiones.abrir(cliente);
+                    struct epoll_event ev_cliente;
+                    ev_cliente.events = EPOLLIN | EPOLLRDHUP;
+                    ev_cliente.data.ptr = conexion;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, cliente, &ev_cliente);
+                }
+                continue;
+            }
+
+            Conexion* conexion = static_cast<Conexion*>(origen);
+            bool cerrar = (eventos[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+
+            // Leer todo lo disponible
+            if (!cerrar && !conexion->cerrar_al_enviar &&
+                (eventos[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                while (true) {
+                    ssize_t leidos = recv(conexion->socket, buffer, sizeof(buffer), 0);
+                    if (leidos > 0) {
+                        m.recibidos(leidos);
+                        conexion->entrada.append(buffer, leidos);
+                        if (conexion->entrada.size() > MAX_BUFFER_CONEXION) {
+                            log_servidor.registrar(LOG_MENSAJE_GRANDE, Fragmento(), Fragmento(),
+                                                   Fragmento(), conexion->entrada.size());
+                            cerrar = true;
+                            break;
+                        }
+                        continue;
+                    }
+                    if (leidos == 0) {
+                        cerrar = conexion->entrada.empty() && conexion->salida.empty();
+                        conexion->cerrar_al_enviar = true;
+                    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                        cerrar = true;
+                    }
+                    break;
+                }
+            }
+            atender_conexion(epoll_fd, indice, conexion, cerrar, conexiones, m);
+        }
+    }
+
+    for (size_t i = 0; i < conexiones.abiertas.size(); i++) {
+        CLOSE_SOCKET(conexiones.abiertas[i]->socket);
+        m.conexion_cerrada();
+    }
+    close(epoll_fd);
+    if (fijado) {
+        pthread_setaffinity_np(pthread_self(), sizeof(afinidad_anterior), &afinidad_anterior);
+    }
+}
+
+void ServidorParqueadero::atender_conexion(int epoll_fd, int reactor, Conexion* conexion,
+                                           bool cerrar, ConexionesReactor& conexiones,
+                                           MetricasHilo& m) {
+    if (!cerrar && !conexion->entrada.empty()) {
+        procesar_entrada(*conexion, reactor);
+    }
+
+    if (!cerrar && conexion->destino >= 0) {
+        // Pasarla con lo que falte procesar y enviar: el otro reactor sigue
+        // en el mismo mensaje, así las respuestas conservan el orden
+        socket_t cliente = conexion->socket;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, cliente, nullptr);
+        conexiones.quitar(conexion);
+        Buzon& destino = *buzones[conexion->destino];
+        {
+            std::lock_guard<std::mutex> lock(destino.mutex);
+            destino.conexiones.push_back(conexion);
+        }
+        uint64_t uno = 1;
+        ssize_t escrito = write(destino.evento, &uno, sizeof(uno));
+        (void)escrito;
+        return;
+    }
+
+    // Enviar respuestas pendientes
+    if (!cerrar && conexion->enviados < conexion->salida.size()) {
+        Reloj::time_point t = Reloj::now();
+        size_t antes = conexion->enviados;
+        while (conexion->enviados < conexion->salida.size()) {
+            ssize_t enviados = send(conexion->socket,
+                                    conexion->salida.data() + conexion->enviados,
+                                    conexion->salida.size() - conexion->enviados,
+                                    MSG_NOSIGNAL);
+            if (enviados < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    cerrar = true;
+                }
+                break;
+            }
+            conexion->enviados += enviados;
+        }
+        m.enviados(conexion->enviados - antes);
+        m.registrar(EtapaServidor::ENVIAR, ns_desde(t));
+    }
+
+    bool pendiente = conexion->enviados < conexion->salida.size();
+    if (!cerrar && !pendiente) {
+        conexion->salida.clear();
+        conexion->enviados = 0;
+        if (conexion->cerrar_al_enviar) {
+            cerrar = true;
+        }
+    }
+
+    if (cerrar) {
+        socket_t cliente = conexion->socket;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, cliente, nullptr);
+        CLOSE_SOCKET(cliente);
+        conexiones.liberar(conexion);
+        m.conexion_cerrada();
+        return;
+    }
+
+    // Esperar EPOLLOUT sólo mientras haya bytes sin enviar. Si ya no se
+    // va a leer (el otro lado cerró su mitad o el modo clásico terminó),
+    // sólo EPOLLOUT: EPOLLIN/EPOLLRDHUP seguirían listos tras el EOF y
+    // el reactor giraría hasta que el cliente lea la respuesta
+    struct epoll_event ev_cliente;
+    if (conexion->cerrar_al_enviar) {
+        ev_cliente.events = EPOLLOUT;
+    } else {
+        ev_cliente.events = pendiente ? (EPOLLIN | EPOLLOUT | EPOLLRDHUP)
+                                      : (EPOLLIN | EPOLLRDHUP);
+    }
+    ev_cliente.data.ptr = conexion;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conexion->socket, &ev_cliente);
+}
+#else
+void ServidorParqueadero::loop_reactor(int indice) {
+    (void)indice;
+}
+
+void ServidorParqueadero::atender_conexion(int epoll_fd, int reactor, Conexion* conexion,
+                                           bool cerrar, ConexionesReactor& conexiones,
+                                           MetricasHilo& m) {
+    (void)epoll_fd; (void)reactor; (void)conexion; (void)cerrar; (void)conexiones; (void)m;
+}
+#endif
+
+#ifdef CON_IO_URING
+// user_data de los completados: la dirección de la conexión con la
+// operación en los bits bajos, o uno de estos valores fijos
+static const uint64_t URING_ACEPTAR = 1;
+static const uint64_t URING_PARADA = 2;
+static const uint64_t URING_BUZON = 3;
+static const uint64_t URING_CANCELACION = 4;
+static const uint64_t URING_RECIBIR = 0;
+static const uint64_t URING_ENVIAR = 1;
+static const uint64_t URING_OPERACION = 7;
+
+// Por reactor: cola de envío, y buffers de recepción que elige el kernel
+static const unsigned ENTRADAS_URING = 256;
+static const unsigned BUFFERS_URING = 512;
+static const unsigned TAMANO_BUFFER_URING = 4096;
+
+static uint64_t dato_uring(const void* conexion, uint64_t operacion) {
+    return (uint64_t)(uintptr_t)conexion | operacion;
+}
+
+void ServidorParqueadero::loop_uring(int indice) {
+    // Antes que el anillo: así se cierra (y cancela lo que quede en vuelo)
+    // antes de liberar los buffers de las conexiones
+    ConexionesReactor conexiones;
+    AnilloIO anillo;
+    if (!anillo.abrir(ENTRADAS_URING) ||
+        !anillo.registrar_buffers(BUFFERS_URING, TAMANO_BUFFER_URING)) {
+        log_servidor.registrar(LOG_ERROR_URING, "io_uring_setup", obtener_error_socket().c_str());
+        return;
+    }
+
+    cpu_set_t afinidad_anterior;
+    bool fijado = gestor != nullptr && fijar_nucleo(indice, afinidad_anterior);
+    Buzon* buzon = buzones[indice].get();
+
+    // Cada reactor deja un accept multishot sobre el socket compartido: una
+    // sola SQE entrega todas las conexiones que le toquen
+    anillo.aceptar_multishot(servidor_socket, URING_ACEPTAR);
+    anillo.esperar_lectura(evento_parada, URING_PARADA);
+    anillo.esperar_lectura(buzon->evento, URING_BUZON);
+
+    std::vector<Conexion*> llegadas;
+    MetricasHilo& m = metricas.hilo();
+
+    while (ejecutando) {
+        // Una llamada al sistema entrega todo lo preparado en la vuelta
+        // anterior y espera el próximo completado
+        if (!anillo.enviar_y_esperar(1)) {
+            log_servidor.registrar(LOG_ERROR_URING, "io_uring_enter", obtener_error_socket().c_str());
+            break;
+        }
+
+        anillo.recorrer([&](const io_uring_cqe& cqe) {
+            switch (cqe.user_data) {
+            case URING_PARADA:
+            case URING_CANCELACION:
+                return;
+
+            case URING_BUZON: {
+                uint64_t avisos;
+                ssize_t leido = read(buzon->evento, &avisos, sizeof(avisos));
+                (void)leido;
+                {
+                    std::lock_guard<std::mutex> lock(buzon->mutex);
+                    llegadas.swap(buzon->conexiones);
+                }
+                for (size_t j = 0; j < llegadas.size(); j++) {
+                    Conexion* conexion = llegadas[j];
+                    conexion->destino = -1;
+                    conexion->cancelando = false;
+                    conexiones.agregar(conexion);
+                    anillo.recibir_multishot(conexion->socket, dato_uring(conexion, URING_RECIBIR));
+                    conexion->recibiendo = true;
+                    atender_uring(anillo, indice, conexion, conexiones, m);
+                }
+                llegadas.clear();
+                anillo.esperar_lectura(buzon->evento, URING_BUZON);
+                return;
+            }
+
+            case URING_ACEPTAR:
+                if (cqe.res >= 0) {
+                    socket_t cliente = cqe.res;
+                    m.conexion_aceptada();
+                    if (log_servidor.habilitado(NivelLog::INFO)) {
+                        struct sockaddr_in direccion_cliente;
+                        socklen_t addrlen = sizeof(direccion_cliente);
+                        char ip_cliente[INET_ADDRSTRLEN] = "";
+                        if (getpeername(cliente, (struct sockaddr*)&direccion_cliente, &addrlen) == 0) {
+                            inet_ntop(AF_INET, &direccion_cliente.sin_addr, ip_cliente, INET_ADDRSTRLEN);
+                        }
+                        log_servidor.registrar(LOG_CONECTADO, ip_cliente);
+                    }
+                    Conexion* conexion = conexiones.abrir(cliente);
+                    anillo.recibir_multishot(cliente, dato_uring(conexion, URING_RECIBIR));
+                    conexion->recibiendo = true;
+                } else if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+                    errno = -cqe.res;
+                    log_servidor.registrar(LOG_ERROR_ACCEPT, obtener_error_socket().c_str());
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE) && ejecutando) {
+                    anillo.aceptar_multishot(servidor_socket, URING_ACEPTAR);
+                }
+                return;
+            }
+
+            Conexion* conexion = reinterpret_cast<Conexion*>(
+                (uintptr_t)(cqe.user_data & ~URING_OPERACION));
+
+            if ((cqe.user_data & URING_OPERACION) == URING_ENVIAR) {
+                conexion->enviando = false;
+                if (cqe.res < 0) {
+                    conexion->cerrando = true;
+                } else {
+                    conexion->enviados += cqe.res;
+                    m.enviados(cqe.res);
+                    if (conexion->enviados < conexion->en_vuelo.size()) {
+                        // Envío parcial: seguir con el resto antes que nada
+                        anillo.enviar(conexion->socket, conexion->en_vuelo.data() + conexion->enviados,
+                                      conexion->en_vuelo.size() - conexion->enviados,
+                                      dato_uring(conexion, URING_ENVIAR));
+                        conexion->enviando = true;
+                    } else {
+                        conexion->en_vuelo.clear();
+                        conexion->enviados = 0;
+                    }
+                }
+            } else {
+                if (cqe.res > 0) {
+                    // Copiar del buffer registrado y devolverlo de inmediato
+                    unsigned id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                    if (!conexion->cerrando) {
+                        conexion->entrada.append(anillo.buffer(id), cqe.res);
+                    }
+                    anillo.devolver_buffer(id);
+                    m.recibidos(cqe.res);
+                    if (!conexion->cerrando && conexion->entrada.size() > MAX_BUFFER_CONEXION) {
+                        log_servidor.registrar(LOG_MENSAJE_GRANDE, Fragmento(), Fragmento(),
+                                               Fragmento(), conexion->entrada.size());
+                        conexion->cerrando = true;
+                    }
+                } else if (cqe.res == 0) {
+                    // Cerrará al terminar de responder lo que ya llegó
+                    conexion->cerrar_al_enviar = true;
+                } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+                    conexion->cerrando = true;
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    conexion->recibiendo = false;
+                    // Sin buffers libres o fin del multishot por el kernel:
+                    // volver a armarlo si la conexión sigue aquí
+                    if ((cqe.res > 0 || cqe.res == -ENOBUFS) && !conexion->cerrando &&
+                        !conexion->cancelando && conexion->destino < 0) {
+                        anillo.recibir_multishot(conexion->socket,
+                                                 dato_uring(conexion, URING_RECIBIR));
+                        conexion->recibiendo = true;
+                    }
+                }
+            }
+            atender_uring(anillo, indice, conexion, conexiones, m);
+        });
+    }
+
+    for (size_t i = 0; i < conexiones.abiertas.size(); i++) {
+        CLOSE_SOCKET(conexiones.abiertas[i]->socket);
+        m.conexion_cerrada();
+    }
+    if (fijado) {
+        pthread_setaffinity_np(pthread_self(), sizeof(afinidad_anterior), &afinidad_anterior);
+    }
+}
+
+void ServidorParqueadero::atender_uring(AnilloIO& anillo, int reactor, Conexion* conexion,
+                                        ConexionesReactor& conexiones, MetricasHilo& m) {
+    // Mientras un envío está en vuelo el kernel lee de en_vuelo; las
+    // respuestas nuevas se acumulan en salida y salen juntas en el próximo
+    if (!conexion->cerrando && conexion->destino < 0) {
+        if (!conexion->entrada.empty()) {
+            procesar_entrada(*conexion, reactor);
+        }
+        if (!conexion->enviando && conexion->destino < 0) {
+            if (!conexion->salida.empty()) {
+                conexion->en_vuelo.swap(conexion->salida);
+                conexion->salida.clear();
+                conexion->enviados = 0;
+                anillo.enviar(conexion->socket, conexion->en_vuelo.data(),
+                              conexion->en_vuelo.size(), dato_uring(conexion, URING_ENVIAR));
+                conexion->enviando = true;
+            } else if (conexion->cerrar_al_enviar) {
+                conexion->cerrando = true;
+            }
+        }
+    }
+
+    if (!conexion->cerrando && conexion->destino < 0) {
+        return;
+    }
+
+    // Cerrar o traspasar sólo sin operaciones en vuelo: cancelar el recv
+    // (y al cerrar también el envío) y esperar sus completados
+    if (!conexion->cancelando && (conexion->recibiendo || conexion->enviando)) {
+        if (conexion->recibiendo) {
+            anillo.cancelar(dato_uring(conexion, URING_RECIBIR), URING_CANCELACION);
+        }
+        if (conexion->enviando && conexion->cerrando) {
+            anillo.cancelar(dato_uring(conexion, URING_ENVIAR), URING_CANCELACION);
+        }
+        conexion->cancelando = true;
+    }
+    if (conexion->recibiendo || conexion->enviando) {
+        return;
+    }
+
+    if (conexion->cerrando) {
+        CLOSE_SOCKET(conexion->socket);
+        conexiones.liberar(conexion);
+        m.conexion_cerrada();
+        return;
+    }
+
+    // Pasarla con lo que falte procesar y enviar, igual que con epoll
+    conexiones.quitar(conexion);
+    Buzon& destino = *buzones[conexion->destino];
+    {
+        std::lock_guard<std::mutex> lock(destino.mutex);
+        destino.conexiones.push_back(conexion);
+    }
+    uint64_t uno = 1;
+    ssize_t escrito = write(destino.evento, &uno, sizeof(uno));
+    (void)escrito;
+}
+#else
+void ServidorParqueadero::loop_uring(int indice) {
+    loop_reactor(indice);
 }
 
-MensajeDispositivo ServidorParqueadero::parsear_mensaje(const std::string& datos) {
+void ServidorParqueadero::atender_uring(AnilloIO& anillo, int reactor, Conexion* conexion,
+                                        ConexionesReactor& conexiones, MetricasHilo& m) {
+    (void)anillo; (void)reactor; (void)conexion; (void)conexiones; (void)m;
+}
+#endif
+
+void ServidorParqueadero::procesar_entrada(Conexion& conexion, int reactor) {
+    std::string& entrada = conexion.entrada;
+
+    if (!conexion.negociado) {
+        // ¿Empieza con el saludo del modo enmarcado?
+        const size_t largo_saludo = sizeof(PROTOCOLO_SALUDO) - 1;
+        size_t comparar = std::min(entrada.size(), largo_saludo);
+        if (entrada.compare(0, comparar, PROTOCOLO_SALUDO, comparar) == 0) {
+            if (entrada.size() < largo_saludo) {
+                return; // Saludo incompleto, esperar más bytes
+            }
+            entrada.erase(0, largo_saludo);
+            conexion.enmarcado = true;
+            conexion.salida += PROTOCOLO_SALUDO_OK;
+        }
+        conexion.negociado = true;
+    }
+
+    if (!conexion.enmarcado) {
+        // Protocolo clásico: lo recibido es el mensaje completo
+        size_t largo = entrada.size();
+        while (largo > 0 && (entrada[largo - 1] == '\n' || entrada[largo - 1] == '\r')) {
+            largo--;
+        }
+        conexion.destino = procesar_mensaje(entrada.data(), largo, conexion.salida, reactor, 0);
+        if (conexion.destino >= 0) {
+            return;
+        }
+        entrada.clear();
+        conexion.cerrar_al_enviar = true;
+        return;
+    }
+
+    // Modo enmarcado: procesar cada línea completa en orden, directamente
+    // sobre el buffer de recepción
+    const char* inicio = entrada.data();
+    const char* final = inicio + entrada.size();
+    const char* fin;
+    while ((fin = buscar_byte(inicio, final, PROTOCOLO_FIN_MENSAJE)) != final) {
+        size_t largo = fin - inicio;
+        if (largo > 0 && fin[-1] == '\r') {
+            largo--;
+        }
+        if (largo > 0) {
+            if (conexion.sinc_restantes > 0) {
+                conexion.destino = procesar_sincronizado(conexion, inicio, largo, reactor);
+            } else if (es_sincronizacion(inicio, largo)) {
+                iniciar_sincronizacion(conexion, inicio, largo);
+            } else {
+                conexion.destino = procesar_mensaje(inicio, largo, conexion.salida, reactor, 0);
+            }
+            if (conexion.destino >= 0) {
+                break; // Sigue desde este mensaje en el reactor de su lote
+            }
+            conexion.salida += PROTOCOLO_FIN_MENSAJE;
+        }
+        inicio = fin + 1;
+    }
+    entrada.erase(0, inicio - entrada.data());
+}
+
+void ServidorParqueadero::iniciar_sincronizacion(Conexion& conexion, const char* datos,
+                                                 size_t largo) {
+    CabeceraSincronizacion cabecera;
+    ErrorMensaje error = parsear_sincronizacion(datos, largo, cabecera);
+    if (error != ErrorMensaje::NINGUNO) {
+        metricas.hilo().mensaje_parseado(error);
+        log_servidor.registrar(LOG_RECHAZO, motivo_mensaje(error), Fragmento(datos, largo));
+        conexion.salida += "ERROR: ";
+        conexion.salida += describir_error(error);
+        return;
+    }
+
+    conexion.sinc_restantes = cabecera.cantidad;
+    conexion.sinc_secuencia = cabecera.secuencia;
+    conexion.sinc_dispositivo.assign(cabecera.dispositivo.datos, cabecera.dispositivo.largo);
+    conexion.sinc_aplicada = secuencias_aplicadas.ultima(conexion.sinc_dispositivo);
+    log_servidor.registrar(LOG_SINCRONIZACION, cabecera.dispositivo, Fragmento(), Fragmento(),
+                           cabecera.cantidad);
+    char texto[32];
+    int n = snprintf(texto, sizeof(texto), "OK: SINC %u", (unsigned)cabecera.cantidad);
+    conexion.salida.append(texto, n);
+}
+
+int ServidorParqueadero::procesar_sincronizado(Conexion& conexion, const char* datos,
+                                               size_t largo, int reactor) {
+    uint64_t secuencia = conexion.sinc_secuencia;
+    if (secuencia <= conexion.sinc_aplicada) {
+        // Llegó en un lote anterior cuya respuesta el dispositivo no recibió
+        metricas.hilo().mensaje_parseado(ErrorMensaje::DUPLICADO);
+        log_servidor.registrar(LOG_DUPLICADO, Fragmento(datos, largo), Fragmento(), Fragmento(),
+                               (int64_t)secuencia);
+        conexion.salida += "OK: ";
+        conexion.salida += describir_error(ErrorMensaje::DUPLICADO);
+    } else {
+        int64_t hora;
+        Fragmento mensaje;
+        ErrorMensaje error = separar_hora_sincronizada(datos, largo, hora, mensaje);
+        if (error != ErrorMensaje::NINGUNO) {
+            metricas.hilo().mensaje_parseado(error);
+            log_servidor.registrar(LOG_RECHAZO, motivo_mensaje(error), Fragmento(datos, largo));
+            conexion.salida += "ERROR: ";
+            conexion.salida += describir_error(error);
+        } else {
+            int destino = procesar_mensaje(mensaje.datos, mensaje.largo, conexion.salida, reactor,
+                                           (time_t)hora);
+            if (destino >= 0) {
+                return destino; // Se aplica y anota en el reactor del lote
+            }
+            secuencias_aplicadas.anotar(conexion.sinc_dispositivo, secuencia);
+        }
+    }
+    conexion.sinc_secuencia++;
+    conexion.sinc_restantes--;
+    if (conexion.sinc_restantes == 0) {
+        // Una escritura a disco por lote, no por evento
+        secuencias_aplicadas.guardar();
+    }
+    return -1;
+}
+
+void ServidorParqueadero::manejar_cliente(socket_t cliente_socket) {
+    Conexion conexion(cliente_socket);
+    char buffer[1024];
+
+    while (ejecutando) {
+        // Recibir datos
+        int bytes_recibidos = recv(cliente_socket, buffer, sizeof(buffer), 0);
+
+        if (bytes_recibidos <= 0) {
+            if (bytes_recibidos < 0 || !conexion.negociado) {
+                log_servidor.registrar(LOG_ERROR_RECV);
+            }
+            return;
+        }
+
+        conexion.entrada.append(buffer, bytes_recibidos);
+        metricas.hilo().recibidos(bytes_recibidos);
+        if (conexion.entrada.size() > MAX_BUFFER_CONEXION) {
+            log_servidor.registrar(LOG_MENSAJE_GRANDE, Fragmento(), Fragmento(),
+                                   Fragmento(), conexion.entrada.size());
+            return;
+        }
+
+        // Parsear y procesar
+        procesar_entrada(conexion, -1);
+
+        // Enviar respuesta(s)
+        if (!conexion.salida.empty()) {
+            Reloj::time_point t = Reloj::now();
+            size_t total = 0;
+            while (total < conexion.salida.length()) {
+                int enviados = send(cliente_socket, conexion.salida.c_str() + total,
+                                    (int)(conexion.salida.length() - total), 0);
+                if (enviados <= 0) {
+                    log_servidor.registrar(LOG_ERROR_SEND);
+                    return;
+                }
+                total += enviados;
+            }
+            metricas.hilo().enviados(total);
+            metricas.hilo().registrar(EtapaServidor::ENVIAR, ns_desde(t));
+            log_servidor.registrar(LOG_RESPUESTA, Fragmento(conexion.salida.data(), conexion.salida.size()));
+            conexion.salida.clear();
+        }
+
+        if (conexion.cerrar_al_enviar) {
+            return;
+        }
+    }
+}
+
+int ServidorParqueadero::procesar_mensaje(const char* datos, size_t largo, std::string& salida,
+                                          int reactor, time_t hora) {
+    Reloj::time_point t = Reloj::now();
     MensajeDispositivo mensaje;
-    
-    // Formato esperado: TIPO|PLACA|TIPO_VEHICULO|DISPOSITIVO
-    // Ejemplo: ENTRADA|ABC123|carro|CAMARA-01
-    
-    std::stringstream ss(datos);
-    std::string token;
-    int campo = 0;
-    
-    while (std::getline(ss, token, '|')) {
-        switch (campo) {
-            case 0: mensaje.tipo = token; break;
-            case 1: mensaje.placa = token; break;
-            case 2: mensaje.tipo_vehiculo = token; break;
-            case 3: mensaje.dispositivo = token; break;
+    ErrorMensaje error = parsear_mensaje(datos, largo, mensaje);
+    uint64_t ns_parseo = ns_desde(t);
+
+    Parqueadero* destino = parqueadero;
+    const char* lote = "";
+    if (error == ErrorMensaje::NINGUNO && gestor != nullptr) {
+        const LoteGestor* l = gestor->enrutar(mensaje);
+        if (l == nullptr) {
+            error = ErrorMensaje::LOTE_DESCONOCIDO;
+        } else {
+            // Sin reactor (aceptar_conexion) no hay a quién traspasarlo
+            if (reactor >= 0) {
+                int dueno = l->indice % num_reactores;
+                if (dueno != reactor) {
+                    return dueno;
+                }
+            }
+            destino = l->parqueadero;
+            lote = l->id.c_str();
         }
-        campo++;
     }
-    
-    return mensaje;
+
+    // Después del traspaso: el filtro ve cada mensaje una sola vez. Un lote
+    // SINC llega de golpe: lecturas legítimas separadas por horas (la placa
+    // que entra, sale y vuelve a entrar) parecerían repetidas
+    if (error == ErrorMensaje::NINGUNO && filtro_repetidos && hora == 0 &&
+        filtro_repetidos->repetida(mensaje, ms_monotonos(t))) {
+        error = ErrorMensaje::REPETIDO;
+    }
+
+    log_servidor.registrar(LOG_MENSAJE, Fragmento(datos, largo));
+    MetricasHilo& m = metricas.hilo();
+    m.registrar(EtapaServidor::PARSEAR, ns_parseo);
+    m.mensaje_parseado(error);
+    if (error != ErrorMensaje::NINGUNO) {
+        if (error == ErrorMensaje::REPETIDO) {
+            log_servidor.registrar(LOG_REPETIDO, Fragmento(datos, largo));
+        } else {
+            log_servidor.registrar(LOG_RECHAZO, motivo_mensaje(error), Fragmento(datos, largo));
+        }
+        salida += "ERROR: ";
+        salida += describir_error(error);
+        return -1;
+    }
+    procesar_comando(mensaje, *destino, lote, hora, salida);
+    return -1;
 }
 
-std::string ServidorParqueadero::procesar_comando(const MensajeDispositivo& mensaje) {
-    std::string resultado;
-    bool exito = false;
+void ServidorParqueadero::procesar_comando(const MensajeDispositivo& mensaje, Parqueadero& destino,
+                                           const char* lote, time_t hora, std::string& salida) {
+    ResultadoOperacion r;
+    // Un dispositivo con el reloj adelantado no registra eventos futuros
+    time_t ahora = time(nullptr);
+    if (hora == 0 || hora > ahora) {
+        hora = ahora;
+    }
+    const Fragmento& placa = mensaje.placa;
+    TipoVehiculo tipo_vehiculo = mensaje.tipo_vehiculo;
+    bool con_tipo = mensaje.con_tipo;
+    
+    MetricasHilo& m = metricas.hilo();
+    Reloj::time_point t = Reloj::now();
     
-    if (mensaje.tipo == "ENTRADA") {
-        resultado = parqueadero->registrar_entrada(mensaje.placa, mensaje.tipo_vehiculo);
-        exito = resultado.find("OK") != std::string::npos;
+    if (mensaje.operacion == OperacionMensaje::ENTRADA) {
+        r = destino.procesar_entrada(mensaje.placa_compacta, tipo_vehiculo, hora);
+        m.registrar(EtapaServidor::PROCESAR, ns_desde(t));
+        salida += r.ok() ? "OK: " : "ERROR: ";
+        describir_entrada(salida, placa.datos, placa.largo, nombre_tipo(tipo_vehiculo), r);
         
-        std::cout << "🚗 ENTRADA detectada - " << mensaje.placa 
-                  << " (" << mensaje.tipo_vehiculo << ") desde " 
-                  << mensaje.dispositivo << std::endl;
+        if (r.ok()) {
+            log_servidor.registrar(LOG_ENTRADA, mensaje.placa, nombre_tipo(tipo_vehiculo),
+                                   mensaje.dispositivo, r.espacio);
+        } else {
+            log_servidor.registrar(LOG_ENTRADA_RECHAZADA, mensaje.placa,
+                                   motivo_operacion(r.codigo), mensaje.dispositivo);
+        }
     }
-    else if (mensaje.tipo == "SALIDA") {
-        resultado = parqueadero->registrar_salida(mensaje.placa);
-        exito = resultado.find("OK") != std::string::npos;
+    else {
+        r = destino.procesar_salida(mensaje.placa_compacta, hora);
+        m.registrar(EtapaServidor::PROCESAR, ns_desde(t));
+        salida += r.ok() ? "OK: " : "ERROR: ";
+        describir_salida(salida, placa.datos, placa.largo, r);
+        if (r.ok()) {
+            tipo_vehiculo = r.tipo;
+            con_tipo = true;
+        }
         
-        std::cout << "🚙 SALIDA detectada - " << mensaje.placa 
-                  << " desde " << mensaje.dispositivo << std::endl;
+        if (r.ok()) {
+            log_servidor.registrar(LOG_SALIDA, mensaje.placa, nombre_tipo(tipo_vehiculo),
+                                   mensaje.dispositivo, (int64_t)r.tarifa);
+        } else {
+            log_servidor.registrar(LOG_SALIDA_RECHAZADA, mensaje.placa,
+                                   motivo_operacion(r.codigo), mensaje.dispositivo);
+        }
     }
-    else {
-        resultado = "ERROR: Tipo de operación desconocido";
+    m.operacion(mensaje, tipo_vehiculo, r.codigo);
+    bool exito = r.ok();
+    const char* operacion = nombre_operacion(mensaje.operacion);
+    const char* tipo = con_tipo ? nombre_tipo(tipo_vehiculo) : "";
+    
+    // Publicar en la cola; Python la consume en lotes sin frenar la respuesta
+    EventoDispositivo evento;
+    copiar_campo(evento.tipo, operacion);
+    copiar_campo(evento.placa, mensaje.placa);
+    copiar_campo(evento.tipo_vehiculo, tipo);
+    copiar_campo(evento.dispositivo, mensaje.dispositivo);
+    copiar_campo(evento.lote, lote);
+    evento.exito = exito;
+    evento.espacio = r.espacio;
+    evento.tarifa = r.tarifa;
+    evento.hora = hora;
+    if (cola_eventos.encolar(evento) && consumidor_esperando.load()) {
+        std::lock_guard<std::mutex> lock(mutex_espera);
+        hay_eventos.notify_one();
     }
     
     // Notificar al callback (Python)
     if (evento_callback) {
-        evento_callback(mensaje.tipo, mensaje.placa, 
-                       mensaje.tipo_vehiculo, exito);
+        evento_callback(operacion, placa.texto(), tipo, exito);
     }
-    
-    return resultado;
+}
+
+bool ServidorParqueadero::filtrar_repetidos(int ventana_ms, size_t capacidad) {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (ejecutando) {
+        return false;
+    }
+    if (ventana_ms <= 0) {
+        filtro_repetidos.reset();
+    } else {
+        filtro_repetidos.reset(new FiltroRepetidos(ventana_ms, capacidad));
+    }
+    return true;
+}
+
+bool ServidorParqueadero::persistir_secuencias(const std::string& ruta) {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (ejecutando) {
+        return false;
+    }
+    return secuencias_aplicadas.cargar(ruta);
+}
+
+uint64_t ServidorParqueadero::ultima_secuencia(const std::string& dispositivo) const {
+    return secuencias_aplicadas.ultima(dispositivo);
+}
+
+uint64_t ServidorParqueadero::lecturas_repetidas() const {
+    return metricas.foto().rechazos_mensaje[(int)ErrorMensaje::REPETIDO];
 }
 
 void ServidorParqueadero::establecer_callback(EventCallback callback) {
     evento_callback = callback;
-}
\ No newline at end of file
+}
+
+size_t ServidorParqueadero::obtener_eventos(std::vector<EventoDispositivo>& destino,
+                                            size_t max_n, int timeout_ms) {
+    size_t n = cola_eventos.desencolar_lote(destino, max_n);
+    if (n > 0 || timeout_ms <= 0) {
+        return n;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_espera);
+    consumidor_esperando = true;
+    // Revisar de nuevo tras marcar la espera para no perder un aviso
+    n = cola_eventos.desencolar_lote(destino, max_n);
+    if (n == 0) {
+        hay_eventos.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+        n = cola_eventos.desencolar_lote(destino, max_n);
+    }
+    consumidor_esperando = false;
+    return n;
+}
+FotoMetricas ServidorParqueadero::obtener_metricas() const {
+    FotoMetricas foto = metricas.foto();
+    foto.cola_eventos = cola_eventos.tamano_aproximado();
+    foto.capacidad_cola = cola_eventos.capacidad();
+    foto.eventos_descartados = cola_eventos.total_descartados();
+    return foto;
+}
+
+std::string ServidorParqueadero::texto_metricas() const {
+    return formatear_prometheus(obtener_metricas());
+}
+
+bool ServidorParqueadero::iniciar_metricas(int puerto_metricas) {
+    std::lock_guard<std::mutex> lock(mutex_estado);
+    if (sirviendo_metricas) {
+        return true;
+    }
+    if (!inicializar_sockets()) {
+        return false;
+    }
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        log_servidor.registrar(LOG_ERROR_METRICAS, obtener_error_socket().c_str(),
+                               Fragmento(), Fragmento(), puerto_metricas);
+        limpiar_sockets();
+        return false;
+    }
+    int opt = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    struct sockaddr_in direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_addr.s_addr = INADDR_ANY;
+    direccion.sin_port = htons(puerto_metricas);
+    if (bind(s, (struct sockaddr*)&direccion, sizeof(direccion)) == SOCKET_ERROR ||
+        listen(s, 16) == SOCKET_ERROR) {
+        log_servidor.registrar(LOG_ERROR_METRICAS, obtener_error_socket().c_str(),
+                               Fragmento(), Fragmento(), puerto_metricas);
+        CLOSE_SOCKET(s);
+        limpiar_sockets();
+        return false;
+    }
+
+    metricas_socket = s;
+    sirviendo_metricas = true;
+    hilo_metricas = std::thread(&ServidorParqueadero::loop_metricas, this);
+    log_servidor.registrar(LOG_METRICAS, Fragmento(), Fragmento(), Fragmento(), puerto_metricas);
+    return true;
+}
+
+void ServidorParqueadero::detener_metricas() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_estado);
+        if (!sirviendo_metricas) {
+            return;
+        }
+        sirviendo_metricas = false;
+    }
+    hilo_metricas.join();
+    CLOSE_SOCKET(metricas_socket);
+    metricas_socket = INVALID_SOCKET;
+    limpiar_sockets();
+}
+
+void ServidorParqueadero::loop_metricas() {
+    while (sirviendo_metricas) {
+        // Esperar con timeout para revisar sirviendo_metricas
+        fd_set lectura;
+        FD_ZERO(&lectura);
+        FD_SET(metricas_socket, &lectura);
+        struct timeval espera;
+        espera.tv_sec = 0;
+        espera.tv_usec = 200000;
+        if (select((int)metricas_socket + 1, &lectura, nullptr, nullptr, &espera) <= 0) {
+            continue;
+        }
+        socket_t cliente = accept(metricas_socket, nullptr, nullptr);
+        if (cliente == INVALID_SOCKET) {
+            continue;
+        }
+
+        // Leer el pedido (se ignora la ruta) hasta la línea en blanco
+#ifdef _WIN32
+        DWORD limite_ms = 1000;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite_ms, sizeof(limite_ms));
+#else
+        struct timeval limite;
+        limite.tv_sec = 1;
+        limite.tv_usec = 0;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, (const char*)&limite, sizeof(limite));
+#endif
+        std::string pedido;
+        char buffer[1024];
+        while (pedido.find("\r\n\r\n") == std::string::npos && pedido.size() < 8192) {
+            int n = recv(cliente, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                break;
+            }
+            pedido.append(buffer, n);
+        }
+
+        std::string cuerpo = texto_metricas();
+        std::ostringstream respuesta;
+        respuesta << "HTTP/1.0 200 OK\r\n"
+                  << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                  << "Content-Length: " << cuerpo.size() << "\r\n"
+                  << "Connection: close\r\n\r\n" << cuerpo;
+        std::string datos = respuesta.str();
+        size_t total = 0;
+        while (total < datos.size()) {
+#ifdef MSG_NOSIGNAL
+            int n = send(cliente, datos.data() + total, (int)(datos.size() - total), MSG_NOSIGNAL);
+#else
+            int n = send(cliente, datos.data() + total, (int)(datos.size() - total), 0);
+#endif
+            if (n <= 0) {
+                break;
+            }
+            total += n;
+        }
+        CLOSE_SOCKET(cliente);
+    }
+}
@@ -2,56 +2,266 @@
 #define SERVIDOR_PARQUEADERO_HPP
 
 #include "parqueadero.hpp"
+#include "gestor_parqueaderos.hpp"
 #include "socket_utils.hpp"
+#include "protocolo.hpp"
+#include "cola_eventos.hpp"
+#include "metricas.hpp"
+#include "log_asincrono.hpp"
+#include "filtro_repetidos.hpp"
+#include "secuencias_dispositivos.hpp"
 #include <string>
+#include <vector>
 #include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <ctime>
+#include <memory>
+#include <unordered_map>
 
-// Estructura para mensajes del protocolo
-struct MensajeDispositivo {
-    std::string tipo;        // "ENTRADA" o "SALIDA"
-    std::string placa;       // Placa del vehículo
-    std::string tipo_vehiculo; // "carro" o "moto"
-    std::string dispositivo; // ID del dispositivo (ej: "CAMARA-01")
+// Evento procesado, de tamaño fijo para pasar por la cola sin asignar memoria
+struct EventoDispositivo {
+    char tipo[8];            // "ENTRADA" o "SALIDA"
+    char placa[16];
+    char tipo_vehiculo[8];
+    char dispositivo[32];
+    char lote[16];           // ID del lote con GestorParqueaderos; "" si no
+    bool exito;
+    int espacio;             // Espacio asignado o liberado; -1 si no aplica
+    double tarifa;           // Tarifa cobrada en una SALIDA
+    time_t hora;
 };
 
+// Cómo esperan y mueven bytes los reactores de ejecutar()
+enum class BackendServidor : uint8_t {
+    SOCKETS = 0,   // epoll y recv/send (select + bloqueante fuera de Linux)
+    IO_URING = 1   // io_uring en Linux 6.0+; si no está, se usa SOCKETS
+};
+
+class AnilloIO;
+
 // Callback para notificar eventos al Python
 typedef std::function<void(const std::string&, const std::string&, const std::string&, bool)> EventCallback;
 
 class ServidorParqueadero {
 private:
-    Parqueadero* parqueadero;
+    // Estado de una conexión atendida por el reactor
+    struct Conexion {
+        socket_t socket;
+        std::string entrada;   // Bytes recibidos pendientes de procesar
+        std::string salida;    // Respuesta pendiente de enviar
+        std::string en_vuelo;  // io_uring: lo que el kernel está enviando
+        size_t enviados;
+        bool cerrar_al_enviar;
+        bool negociado;        // Ya se decidió el modo de la conexión
+        bool enmarcado;        // Modo persistente con mensajes terminados en '\n'
+        int destino;           // Reactor al que hay que pasarla; -1 si ninguno
+        size_t posicion;       // En ConexionesReactor::abiertas
+        // Con io_uring: operaciones en vuelo sobre la conexión. Mientras
+        // haya alguna no se cierra ni se pasa a otro reactor.
+        bool recibiendo;       // recv multishot armado
+        bool enviando;         // send de en_vuelo sin completar
+        bool cerrando;
+        bool cancelando;       // Ya se pidió cancelar lo que esté en vuelo
+        // Lote SINC en curso: mensajes que faltan, secuencia del próximo,
+        // ID del dispositivo y la última secuencia aplicada al empezar
+        uint32_t sinc_restantes;
+        uint64_t sinc_secuencia;
+        std::string sinc_dispositivo;
+        uint64_t sinc_aplicada;
+
+        explicit Conexion(socket_t s) { reiniciar(s); }
+        // Dejarla como nueva para otro socket, conservando los buffers
+        // salvo que hayan crecido de más
+        void reiniciar(socket_t s);
+    };
+
+    // Conexiones de un reactor: las abiertas en un arreglo (cada una sabe
+    // su posición) y las cerradas en reserva con sus buffers, así abrir y
+    // cerrar conexiones no asigna memoria una vez que el reactor calentó
+    struct ConexionesReactor {
+        std::vector<Conexion*> abiertas;
+        std::vector<Conexion*> reserva;
+
+        ~ConexionesReactor();
+        Conexion* abrir(socket_t s);
+        void agregar(Conexion* conexion);  // Traspasada por otro reactor
+        void quitar(Conexion* conexion);   // Sin liberarla (traspaso)
+        void liberar(Conexion* conexion);  // A la reserva
+    };
+
+    // Conexiones que otros reactores le pasan a uno porque su próximo
+    // mensaje es de un lote que atiende él
+    struct Buzon {
+        std::mutex mutex;
+        std::vector<Conexion*> conexiones;
+        int evento;            // eventfd que despierta al reactor dueño
+    };
+
+    // Primero: se destruye al final y alcanza a escribir lo pendiente
+    LogAsincrono log_servidor;
+
+    Parqueadero* parqueadero;  // Un solo lote (sin gestor)
+    GestorParqueaderos* gestor;
     int puerto;
+    int backlog;
     socket_t servidor_socket;
-    bool ejecutando;
+    std::atomic<bool> ejecutando;
+    bool en_reactor;           // true mientras ejecutar() atiende conexiones
+    BackendServidor backend_activo;
+    int evento_parada;         // eventfd que despierta a los reactores (Linux)
+    int num_reactores;
+    std::vector<std::unique_ptr<Buzon> > buzones; // Uno por reactor
     EventCallback evento_callback;
+    std::unique_ptr<FiltroRepetidos> filtro_repetidos; // nullptr: no filtra
+    // Última secuencia aplicada por dispositivo, para que reenviar un lote
+    // SINC no repita eventos
+    SecuenciasDispositivos secuencias_aplicadas;
+    ColaEventos<EventoDispositivo> cola_eventos;
+    std::atomic<bool> consumidor_esperando;
+    std::mutex mutex_espera;   // Sólo para dormir al consumidor de eventos
+    std::condition_variable hay_eventos;
+    std::mutex mutex_estado;   // Protege iniciar/detener/ejecutar
+    MetricasServidor metricas;
+
+    // Endpoint de métricas (texto plano en un puerto secundario)
+    socket_t metricas_socket;
+    std::atomic<bool> sirviendo_metricas;
+    std::thread hilo_metricas;
     
-    // Parsear mensaje del dispositivo
-    MensajeDispositivo parsear_mensaje(const std::string& datos);
-    
-    // Procesar comando
-    std::string procesar_comando(const MensajeDispositivo& mensaje);
+    // Parsear un mensaje sin copiarlo y agregar su respuesta a salida.
+    // Con gestor y reactor >= 0, si el lote lo atiende otro reactor no lo
+    // procesa y retorna ese reactor; si no, retorna -1. hora: la de la
+    // lectura si viene de un lote SINC, que ya descarta reenvíos por
+    // secuencia y cuyas lecturas no se pueden juzgar con la hora de
+    // llegada (no se filtra); 0 para un mensaje en vivo.
+    int procesar_mensaje(const char* datos, size_t largo, std::string& salida, int reactor,
+                         time_t hora);
+
+    // Procesar comando ya validado sobre su parqueadero, a la hora dada
+    // (0: la actual)
+    void procesar_comando(const MensajeDispositivo& mensaje, Parqueadero& destino,
+                          const char* lote, time_t hora, std::string& salida);
     
     // Manejar cliente
     void manejar_cliente(socket_t cliente_socket);
 
+    // Procesar los bytes acumulados de una conexión; se detiene en el
+    // primer mensaje de un lote de otro reactor (conexion.destino)
+    void procesar_entrada(Conexion& conexion, int reactor);
+
+    // Cabecera SINC: preparar la conexión para el lote y responderla
+    void iniciar_sincronizacion(Conexion& conexion, const char* datos, size_t largo);
+    // Mensaje de un lote SINC (HORA|mensaje): responderlo sin aplicarlo si
+    // su secuencia ya se aplicó; si no, aplicarlo con procesar_mensaje() a
+    // la hora de la lectura y anotarla.
+    // Retorna lo mismo que procesar_mensaje().
+    int procesar_sincronizado(Conexion& conexion, const char* datos, size_t largo, int reactor);
+
+    // Cerrar socket servidor y recursos asociados
+    void liberar_recursos();
+
+    // Loop de un hilo reactor (epoll)
+    void loop_reactor(int indice);
+
+    // Procesar lo recibido, enviar lo pendiente y volver a esperar en
+    // epoll; o cerrar la conexión, o pasarla al reactor de su lote
+    void atender_conexion(int epoll_fd, int reactor, Conexion* conexion, bool cerrar,
+                          ConexionesReactor& conexiones, MetricasHilo& m);
+
+    // Loop de un hilo reactor con io_uring (ver anillo_io.hpp)
+    void loop_uring(int indice);
+
+    // Lo mismo que atender_conexion() con operaciones de io_uring: procesar
+    // lo recibido, enviar la salida si no hay otro envío en vuelo, y cerrar
+    // o traspasar la conexión cuando no le quede nada en vuelo
+    void atender_uring(AnilloIO& anillo, int reactor, Conexion* conexion,
+                       ConexionesReactor& conexiones, MetricasHilo& m);
+
+    // Atender pedidos al endpoint de métricas hasta detener_metricas()
+    void loop_metricas();
+
 public:
-    ServidorParqueadero(Parqueadero* p, int puerto = 8080);
+    ServidorParqueadero(Parqueadero* p, int puerto = 8080, int backlog = SOMAXCONN);
+    // Varios lotes: cada mensaje va al parqueadero de su lote y cada lote
+    // lo atiende siempre el mismo reactor (lote i -> reactor i % num_hilos,
+    // fijo a un núcleo), así su estado no salta entre núcleos
+    ServidorParqueadero(GestorParqueaderos* g, int puerto = 8080, int backlog = SOMAXCONN);
     ~ServidorParqueadero();
     
-    // Iniciar servidor
-    bool iniciar();
+    // Iniciar servidor. backend elige cómo atiende ejecutar(); si se pide
+    // IO_URING y el kernel no lo permite se usa SOCKETS (ver backend())
+    bool iniciar(BackendServidor backend = BackendServidor::SOCKETS);
     
     // Detener servidor
     void detener();
     
     // Aceptar una conexión (bloquea hasta recibir una)
     bool aceptar_conexion();
+
+    // Atender conexiones concurrentes con num_hilos reactores epoll (o
+    // io_uring, según iniciar()). Bloquea hasta que se llame detener().
+    // En plataformas sin epoll recurre a aceptar_conexion() en un loop.
+    bool ejecutar(int num_hilos = 1);
     
-    // Establecer callback para eventos
+    // Establecer callback para eventos. Se invoca en el hilo de red
+    // antes de responder al dispositivo; preferir obtener_eventos().
     void establecer_callback(EventCallback callback);
+
+    // Extraer hasta max_n eventos de la cola. Si está vacía espera
+    // hasta timeout_ms milisegundos a que llegue alguno.
+    size_t obtener_eventos(std::vector<EventoDispositivo>& destino,
+                           size_t max_n, int timeout_ms = 0);
+
+    // Descartar lecturas repetidas (mismo dispositivo, placa y operación
+    // dentro de ventana_ms) antes de que toquen el parqueadero, la cola de
+    // eventos o el callback; se responden con "ERROR: Lectura repetida,
+    // ignorada". Llamar con el servidor detenido; ventana_ms <= 0 lo apaga.
+    bool filtrar_repetidos(int ventana_ms, size_t capacidad = 65536);
+    int ventana_repetidos() const { return filtro_repetidos ? filtro_repetidos->ventana_ms() : 0; }
+    // Lecturas descartadas por el filtro (también en las métricas, motivo
+    // "repetido")
+    uint64_t lecturas_repetidas() const;
+
+    // Guardar la última secuencia SINC aplicada de cada dispositivo en
+    // ruta (se carga si ya existe), así sobrevive a un reinicio. Se
+    // escribe al terminar cada lote. Con un solo parqueadero con bitácora,
+    // iniciar() usa secuencias.sinc en su directorio si no se llamó antes.
+    // Llamar con el servidor detenido.
+    bool persistir_secuencias(const std::string& ruta);
+
+    // Última secuencia aplicada de un dispositivo en lotes SINC (0 si no
+    // envió ninguno)
+    uint64_t ultima_secuencia(const std::string& dispositivo) const;
+
+    // Eventos perdidos porque la cola estaba llena
+    size_t eventos_descartados() const { return cola_eventos.total_descartados(); }
     
     // Estado del servidor
     bool esta_ejecutando() const { return ejecutando; }
+    int obtener_backlog() const { return backlog; }
+    // Puerto de escucha; tras iniciar() con puerto 0, el que eligió el sistema
+    int obtener_puerto() const { return puerto; }
+    BackendServidor backend() const { return backend_activo; }
+
+    // Contadores e histogramas de todos los hilos de red, más la cola
+    FotoMetricas obtener_metricas() const;
+    // Las mismas métricas en formato de texto de Prometheus
+    std::string texto_metricas() const;
+
+    // Servir texto_metricas() por HTTP en otro puerto (cualquier ruta)
+    bool iniciar_metricas(int puerto);
+    void detener_metricas();
+
+    // Log asíncrono: nivel mínimo (INFO por defecto; DEPURACION agrega
+    // cada mensaje y respuesta) y destino opcional en archivo
+    void establecer_nivel_log(NivelLog nivel) { log_servidor.establecer_nivel(nivel); }
+    NivelLog nivel_log() const { return log_servidor.nivel(); }
+    bool log_a_archivo(const std::string& ruta) { return log_servidor.abrir_archivo(ruta); }
+    void vaciar_log() { log_servidor.vaciar(); }
+    size_t registros_log_descartados() const { return log_servidor.descartados(); }
 };
 
 #endif
\ No newline at end of file
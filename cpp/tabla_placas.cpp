@@ -0,0 +1,45 @@
+#include "tabla_placas.hpp"
+#include <cstring>
+
+bool empaquetar_placa(const char* placa, size_t largo, PlacaCompacta& resultado) {
+    if (largo == 0 || largo > MAX_LARGO_PLACA || memchr(placa, '\0', largo) != nullptr) {
+        return false;
+    }
+    // Primer carácter en el byte bajo: el orden de bytes coincide con el texto
+    PlacaCompacta valor = 0;
+    for (size_t i = 0; i < largo; i++) {
+        valor |= (PlacaCompacta)(unsigned char)placa[i] << (8 * i);
+    }
+    resultado = valor;
+    return true;
+}
+
+bool empaquetar_placa(const std::string& placa, PlacaCompacta& resultado) {
+    return empaquetar_placa(placa.data(), placa.size(), resultado);
+}
+
+std::string desempaquetar_placa(PlacaCompacta placa) {
+    char texto[MAX_LARGO_PLACA];
+    size_t largo = 0;
+    while (largo < MAX_LARGO_PLACA && (placa & 0xff) != 0) {
+        texto[largo++] = (char)(placa & 0xff);
+        placa >>= 8;
+    }
+    return std::string(texto, largo);
+}
+
+bool tipo_desde_texto(const std::string& texto, TipoVehiculo& tipo) {
+    if (texto == "carro") {
+        tipo = TipoVehiculo::CARRO;
+        return true;
+    }
+    if (texto == "moto") {
+        tipo = TipoVehiculo::MOTO;
+        return true;
+    }
+    return false;
+}
+
+const char* nombre_tipo(TipoVehiculo tipo) {
+    return tipo == TipoVehiculo::CARRO ? "carro" : "moto";
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#ifndef TABLA_PLACAS_HPP
+#define TABLA_PLACAS_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+
+// Placa empaquetada en un entero: hasta 8 caracteres, un byte cada uno.
+// El valor 0 no es una placa válida y marca las celdas vacías.
+typedef uint64_t PlacaCompacta;
+
+static const size_t MAX_LARGO_PLACA = 8;
+
+enum class TipoVehiculo : uint8_t {
+    CARRO = 0,
+    MOTO = 1
+};
+
+// Retorna false si la placa está vacía, tiene más de 8 caracteres o un '\0'
+bool empaquetar_placa(const char* placa, size_t largo, PlacaCompacta& resultado);
+bool empaquetar_placa(const std::string& placa, PlacaCompacta& resultado);
+std::string desempaquetar_placa(PlacaCompacta placa);
+
+// "carro" / "moto"; retorna false para cualquier otro texto
+bool tipo_desde_texto(const std::string& texto, TipoVehiculo& tipo);
+const char* nombre_tipo(TipoVehiculo tipo);
+
+struct Vehiculo {
+    PlacaCompacta placa;
+    TipoVehiculo tipo;
+    uint8_t etiqueta;  // Libre para quien use la tabla (cabe en el relleno)
+    int espacio;
+    time_t hora_entrada;
+};
+
+// Mezcla de bits (finalizador de MurmurHash3) para repartir las placas
+inline uint64_t hash_placa(PlacaCompacta placa) {
+    uint64_t h = placa;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Tabla hash plana de direccionamiento abierto (sondeo lineal) con los
+// vehículos guardados en línea: una búsqueda suele tocar una sola línea
+// de caché y no hay memoria dinámica por vehículo. Sólo crece (rehash)
+// si la carga supera el 50%. El borrado desplaza hacia atrás los
+// elementos siguientes, así que no hay lápidas.
+//
+// No es segura entre hilos; Parqueadero la protege por partición.
+class TablaPlacas {
+private:
+    std::vector<Vehiculo> celdas;
+    size_t mascara;
+    size_t num_elementos;
+    int desplazamiento; // Bits bajos del hash reservados para elegir partición
+
+    size_t inicio(PlacaCompacta placa) const {
+        return (size_t)(hash_placa(placa) >> desplazamiento) & mascara;
+    }
+
+    void crecer() {
+        std::vector<Vehiculo> anteriores;
+        anteriores.swap(celdas);
+        Vehiculo vacio = Vehiculo();
+        celdas.assign(anteriores.size() * 2, vacio);
+        mascara = celdas.size() - 1;
+        num_elementos = 0;
+        for (size_t i = 0; i < anteriores.size(); i++) {
+            if (anteriores[i].placa != 0) {
+                insertar(anteriores[i]);
+            }
+        }
+    }
+
+public:
+    // capacidad_esperada: vehículos que se esperan como máximo
+    explicit TablaPlacas(size_t capacidad_esperada = 0, int bits_reservados = 0)
+        : num_elementos(0), desplazamiento(bits_reservados) {
+        size_t tam = 16;
+        while (tam < capacidad_esperada * 2) tam <<= 1;
+        Vehiculo vacio = Vehiculo();
+        celdas.assign(tam, vacio);
+        mascara = tam - 1;
+    }
+
+    Vehiculo* buscar(PlacaCompacta placa) {
+        for (size_t i = inicio(placa);; i = (i + 1) & mascara) {
+            if (celdas[i].placa == placa) return &celdas[i];
+            if (celdas[i].placa == 0) return nullptr;
+        }
+    }
+
+    const Vehiculo* buscar(PlacaCompacta placa) const {
+        return const_cast<TablaPlacas*>(this)->buscar(placa);
+    }
+
+    // false si la placa ya estaba
+    bool insertar(const Vehiculo& v) {
+        if ((num_elementos + 1) * 2 > celdas.size()) {
+            crecer();
+        }
+        for (size_t i = inicio(v.placa);; i = (i + 1) & mascara) {
+            if (celdas[i].placa == v.placa) return false;
+            if (celdas[i].placa == 0) {
+                celdas[i] = v;
+                num_elementos++;
+                return true;
+            }
+        }
+    }
+
+    // Elimina la celda apuntada por v (obtenida con buscar)
+    void eliminar(Vehiculo* v) {
+        size_t hueco = v - &celdas[0];
+        // Desplazar hacia atrás los elementos de la misma secuencia de sondeo
+        for (size_t j = (hueco + 1) & mascara; celdas[j].placa != 0; j = (j + 1) & mascara) {
+            size_t ideal = inicio(celdas[j].placa);
+            // ¿El hueco está entre la posición ideal de j y j (circularmente)?
+            if (((j - ideal) & mascara) >= ((j - hueco) & mascara)) {
+                celdas[hueco] = celdas[j];
+                hueco = j;
+            }
+        }
+        celdas[hueco].placa = 0;
+        num_elementos--;
+    }
+
+    bool eliminar(PlacaCompacta placa) {
+        Vehiculo* v = buscar(placa);
+        if (v == nullptr) return false;
+        eliminar(v);
+        return true;
+    }
+
+    // Llama f(const Vehiculo&) por cada vehículo
+    template <typename F>
+    void recorrer(F f) const {
+        for (size_t i = 0; i < celdas.size(); i++) {
+            if (celdas[i].placa != 0) f(celdas[i]);
+        }
+    }
+
+    size_t tamano() const { return num_elementos; }
+    size_t capacidad() const { return celdas.size(); }
+};
+
+#endif
\ No newline at end of file
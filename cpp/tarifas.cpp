@@ -0,0 +1,131 @@
+#include "tarifas.hpp"
+#include <cmath>
+#include <ctime>
+
+static const int MINUTOS_DIA = 24 * 60;
+
+int desfase_local() {
+    time_t ahora = time(nullptr);
+    struct tm local, utc;
+#ifdef _WIN32
+    localtime_s(&local, &ahora);
+    gmtime_s(&utc, &ahora);
+#else
+    localtime_r(&ahora, &local);
+    gmtime_r(&ahora, &utc);
+#endif
+    int dias = local.tm_yday - utc.tm_yday;
+    if (dias > 1) dias = -1;   // Cambio de año entre las dos fechas
+    if (dias < -1) dias = 1;
+    return ((dias * 24 + local.tm_hour - utc.tm_hour) * 60 + local.tm_min - utc.tm_min) * 60 +
+           local.tm_sec - utc.tm_sec;
+}
+
+static bool es_noche(const ReglaTarifa& r, int minuto) {
+    int inicio = r.hora_inicio_noche * 60, fin = r.hora_fin_noche * 60;
+    if (r.valor_bloque_noche < 0.0 || inicio == fin) {
+        return false;
+    }
+    return inicio < fin ? (minuto >= inicio && minuto < fin) : (minuto >= inicio || minuto < fin);
+}
+
+MotorTarifas::MotorTarifas(const ConfiguracionTarifas& configuracion)
+    : config(configuracion), desfase_s(configuracion.desfase_utc_s),
+      con_noche(false), con_tope(false) {
+    for (int t = 0; t < 2 && valido(); t++) {
+        compilar(t);
+    }
+}
+
+bool MotorTarifas::compilar(int tipo) {
+    const ReglaTarifa& r = config.reglas[tipo];
+    std::string nombre = nombre_tipo((TipoVehiculo)tipo);
+    if (!(r.valor_bloque >= 0.0) || std::isinf(r.valor_bloque)) {
+        mensaje_error = nombre + ": valor_bloque debe ser un número no negativo";
+    } else if (r.minutos_bloque <= 0 || r.minutos_bloque > MINUTOS_DIA ||
+               MINUTOS_DIA % r.minutos_bloque != 0) {
+        mensaje_error = nombre + ": minutos_bloque debe dividir 1440 (un día)";
+    } else if (r.minutos_gracia < 0) {
+        mensaje_error = nombre + ": minutos_gracia no puede ser negativo";
+    } else if (!(r.tope_diario >= 0.0)) {
+        mensaje_error = nombre + ": tope_diario no puede ser negativo";
+    } else if (r.valor_bloque_noche >= 0.0 &&
+               (r.hora_inicio_noche < 0 || r.hora_inicio_noche > 23 ||
+                r.hora_fin_noche < 0 || r.hora_fin_noche > 23 || std::isinf(r.valor_bloque_noche))) {
+        mensaje_error = nombre + ": horas de la noche entre 0 y 23";
+    }
+    if (!valido()) {
+        return false;
+    }
+
+    TablaTipoTarifa& t = tablas[tipo];
+    t.minutos_bloque = r.minutos_bloque;
+    t.bloque_s = (int64_t)r.minutos_bloque * 60;
+    t.gracia_s = (int64_t)r.minutos_gracia * 60;
+    t.bloques_dia = MINUTOS_DIA / r.minutos_bloque;
+    t.valor_bloque = r.valor_bloque;
+    t.tope = r.tope_diario > 0.0 ? r.tope_diario : std::numeric_limits<double>::infinity();
+    con_tope = con_tope || r.tope_diario > 0.0;
+    con_noche = con_noche || es_noche(r, r.hora_inicio_noche * 60);
+
+    // Las tablas se arman siempre: si otro tipo tiene noche, éste también
+    // pasa por la variante con tablas (sin noche quedan uniformes)
+    int64_t largo = 2 * t.bloques_dia + 1;
+    prefijos[tipo].assign((size_t)(t.minutos_bloque * largo), 0.0);
+    ciclos[tipo].assign((size_t)t.minutos_bloque, 0.0);
+    for (int64_t residuo = 0; residuo < t.minutos_bloque; residuo++) {
+        double* p = &prefijos[tipo][(size_t)(residuo * largo)];
+        for (int64_t j = 0; j + 1 < largo; j++) {
+            int minuto = (int)((residuo + j * t.minutos_bloque) % MINUTOS_DIA);
+            p[j + 1] = p[j] + (es_noche(r, minuto) ? r.valor_bloque_noche : r.valor_bloque);
+        }
+        ciclos[tipo][(size_t)residuo] = p[t.bloques_dia];
+    }
+    t.prefijo = prefijos[tipo].data();
+    t.ciclo = ciclos[tipo].data();
+    return true;
+}
+
+// Aplica una calculadora especializada a un lote
+struct LoteTarifas {
+    const uint8_t* tipos;
+    const int64_t* entradas;
+    const uint8_t* abonados;
+    size_t n;
+    int64_t ahora;
+    double* destino;
+
+    template <typename Calculadora>
+    void operator()(const Calculadora& calcular) const {
+        for (size_t i = 0; i < n; i++) {
+            bool abonado = abonados != nullptr && abonados[i] != 0;
+            destino[i] = calcular(tipos[i], entradas[i], ahora, abonado);
+        }
+    }
+};
+
+void MotorTarifas::tarifas(const uint8_t* tipos, const int64_t* entradas, const uint8_t* abonados,
+                           size_t n, int64_t ahora, double* destino) const {
+    LoteTarifas lote = {tipos, entradas, abonados, n, ahora, destino};
+    especializar(lote);
+}
+
+// Una sola tarifa: calcula directo con la variante elegida
+struct UnaTarifa {
+    uint8_t tipo;
+    int64_t entrada;
+    int64_t salida;
+    bool abonado;
+    double resultado;
+
+    template <typename Calculadora>
+    void operator()(const Calculadora& calcular) {
+        resultado = calcular(tipo, entrada, salida, abonado);
+    }
+};
+
+double MotorTarifas::tarifa(TipoVehiculo tipo, int64_t entrada, int64_t salida, bool abonado) const {
+    UnaTarifa una = {(uint8_t)tipo, entrada, salida, abonado, 0.0};
+    especializar(una);
+    return una.resultado;
+}
@@ -0,0 +1,156 @@
+#ifndef TARIFAS_HPP
+#define TARIFAS_HPP
+
+#include "tabla_placas.hpp"
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+// Reglas de cobro de un tipo de vehículo
+struct ReglaTarifa {
+    double valor_bloque;        // Precio de cada bloque iniciado
+    int minutos_bloque;         // 60 = por hora, 15 = por cuartos; divisor de 1440
+    int minutos_gracia;         // Estancias de hasta estos minutos no pagan
+    double tope_diario;         // Máximo por cada 24 h desde la entrada; 0 = sin tope
+    double valor_bloque_noche;  // Bloques que empiezan de noche; < 0 = sin tarifa nocturna
+    int hora_inicio_noche;      // Hora local: la noche es [inicio, fin) y puede
+    int hora_fin_noche;         // cruzar la medianoche
+
+    explicit ReglaTarifa(double valor_hora = 0.0)
+        : valor_bloque(valor_hora), minutos_bloque(60), minutos_gracia(0), tope_diario(0.0),
+          valor_bloque_noche(-1.0), hora_inicio_noche(22), hora_fin_noche(6) {}
+};
+
+// Desfase de la hora local respecto a UTC, en segundos, en este momento
+int desfase_local();
+
+struct ConfiguracionTarifas {
+    ReglaTarifa reglas[2];      // Por TipoVehiculo
+    int desfase_utc_s;          // Para ubicar la noche en hora local
+
+    ConfiguracionTarifas(double hora_carro = 3000.0, double hora_moto = 2000.0)
+        : desfase_utc_s(desfase_local()) {
+        reglas[(int)TipoVehiculo::CARRO] = ReglaTarifa(hora_carro);
+        reglas[(int)TipoVehiculo::MOTO] = ReglaTarifa(hora_moto);
+    }
+};
+
+// Bit de Vehiculo::etiqueta en el parqueadero: la estancia la cubre una
+// mensualidad vigente al entrar
+static const uint8_t ETIQUETA_ABONADO = 1;
+
+// Reglas de un tipo ya compiladas a números y tablas
+struct TablaTipoTarifa {
+    int64_t bloque_s;
+    int64_t gracia_s;
+    int64_t bloques_dia;        // 1440 / minutos_bloque
+    int64_t minutos_bloque;
+    double valor_bloque;
+    double tope;                // Infinito sin tope
+    // Con tarifa nocturna, por residuo r = (minuto de entrada) % minutos_bloque:
+    // prefijo[r * (2 * bloques_dia + 1) + j] = costo de los j primeros bloques
+    // que empiezan en el minuto r del día, durante dos días; ciclo[r] = costo
+    // de 24 h
+    const double* prefijo;
+    const double* ciclo;
+};
+
+// Tarifa de una estancia con las variantes de la regla fijadas en
+// compilación: sin noche ni tope queda en bloques * valor
+template <bool NOCHE, bool TOPE>
+struct CalculadoraTarifa {
+    const TablaTipoTarifa* tablas;
+    int64_t desfase_s;
+
+    double operator()(uint8_t tipo, int64_t entrada, int64_t salida, bool abonado) const {
+        const TablaTipoTarifa& t = tablas[tipo];
+        int64_t duracion = salida > entrada ? salida - entrada : 0;
+        int64_t bloques = (duracion + t.bloque_s - 1) / t.bloque_s;
+        double valor;
+        if (!NOCHE && !TOPE) {
+            valor = (double)bloques * t.valor_bloque;
+        } else {
+            int64_t dias = bloques / t.bloques_dia;
+            int64_t resto = bloques - dias * t.bloques_dia;
+            double dia, parcial;
+            if (NOCHE) {
+                int64_t minuto = (((entrada + desfase_s) % 86400 + 86400) % 86400) / 60;
+                int64_t residuo = minuto % t.minutos_bloque;
+                int64_t j = minuto / t.minutos_bloque;
+                const double* p = t.prefijo + residuo * (2 * t.bloques_dia + 1);
+                parcial = p[j + resto] - p[j];
+                dia = t.ciclo[residuo];
+            } else {
+                parcial = (double)resto * t.valor_bloque;
+                dia = (double)t.bloques_dia * t.valor_bloque;
+            }
+            if (TOPE) {
+                parcial = parcial < t.tope ? parcial : t.tope;
+                dia = dia < t.tope ? dia : t.tope;
+            }
+            valor = (double)dias * dia + parcial;
+        }
+        return (duracion > t.gracia_s && !abonado) ? valor : 0.0;
+    }
+};
+
+// Motor de tarifas de un sitio: valida la configuración una vez y la
+// convierte en tablas, así calcular una tarifa no compara textos ni
+// llama funciones virtuales. Inmutable tras construirse (se reemplaza
+// entero para cambiar las reglas), así que se lee sin locks.
+class MotorTarifas {
+public:
+    explicit MotorTarifas(const ConfiguracionTarifas& config);
+
+    MotorTarifas(const MotorTarifas&) = delete;
+    MotorTarifas& operator=(const MotorTarifas&) = delete;
+
+    // false si alguna regla es inválida; error() dice cuál
+    bool valido() const { return mensaje_error.empty(); }
+    const std::string& error() const { return mensaje_error; }
+    const ConfiguracionTarifas& configuracion() const { return config; }
+
+    double tarifa(TipoVehiculo tipo, int64_t entrada, int64_t salida, bool abonado = false) const;
+
+    // Tarifas de n vehículos a la misma hora (abonados puede ser nullptr)
+    void tarifas(const uint8_t* tipos, const int64_t* entradas, const uint8_t* abonados,
+                 size_t n, int64_t ahora, double* destino) const;
+
+    // Llama f(calculadora) con la CalculadoraTarifa que corresponde a las
+    // reglas; un ciclo dentro de f se compila una vez por variante y cada
+    // vehículo se calcula sin saltos indirectos
+    template <typename F>
+    void especializar(F& f) const {
+        if (con_noche) {
+            if (con_tope) {
+                CalculadoraTarifa<true, true> c = {tablas, desfase_s};
+                f(c);
+            } else {
+                CalculadoraTarifa<true, false> c = {tablas, desfase_s};
+                f(c);
+            }
+        } else if (con_tope) {
+            CalculadoraTarifa<false, true> c = {tablas, desfase_s};
+            f(c);
+        } else {
+            CalculadoraTarifa<false, false> c = {tablas, desfase_s};
+            f(c);
+        }
+    }
+
+private:
+    ConfiguracionTarifas config;
+    std::string mensaje_error;
+    TablaTipoTarifa tablas[2];
+    std::vector<double> prefijos[2];
+    std::vector<double> ciclos[2];
+    int64_t desfase_s;
+    bool con_noche;
+    bool con_tope;
+
+    bool compilar(int tipo);
+};
+
+#endif
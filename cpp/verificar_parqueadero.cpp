@@ -0,0 +1,799 @@
+// Verificaciones de concurrencia del núcleo del parqueadero (sin Python).
+// Compilar y ejecutar con: make verificar
+//
+// Uso: verificar_parqueadero [hilos] [rondas]
+// Varios hilos registran entradas y salidas al azar sobre el mismo
+// parqueadero; al final de cada ronda (con los hilos detenidos) se revisa
+// que ningún espacio esté asignado a dos vehículos y que ocupados más
+// libres dé la capacidad de cada tipo. Además se pasan mensajes por el
+// servidor de dispositivos en los modos que no usan reactores (también
+// tras reiniciarlo) y por los reactores de ejecutar(2) con epoll e
+// io_uring, y se hace fallar la escritura de la bitácora. Termina con código 1 si algo falla.
+
+#include "parqueadero.hpp"
+#include "gestor_parqueaderos.hpp"
+#include "servidor_parqueadero.hpp"
+#include "socket_utils.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+    #include <csignal>
+    #include <sys/resource.h>
+#endif
+
+static std::atomic<int> fallas(0);  // fallar() se llama desde los hilos
+
+static void fallar(const std::string& mensaje) {
+    std::cerr << "❌ " << mensaje << std::endl;
+    fallas++;
+}
+
+static std::string placa_numerada(char prefijo, size_t i) {
+    char texto[16];
+    snprintf(texto, sizeof(texto), "%c%06zu", prefijo, i);
+    return texto;
+}
+
+// Cada hilo maneja sus propias placas y sabe cuáles dejó dentro; las
+// particiones y los espacios sí los comparten todos
+struct EstadoHilo {
+    std::vector<PlacaCompacta> placas;
+    std::vector<TipoVehiculo> tipos;
+    std::vector<char> dentro;
+    size_t dentro_carros;
+    size_t dentro_motos;
+    size_t sin_espacio;
+
+    EstadoHilo() : dentro_carros(0), dentro_motos(0), sin_espacio(0) {}
+};
+
+static void operar(Parqueadero& p, EstadoHilo& estado, unsigned semilla, size_t operaciones) {
+    std::mt19937 rng(semilla);
+    std::uniform_int_distribution<size_t> elegir(0, estado.placas.size() - 1);
+    for (size_t i = 0; i < operaciones; i++) {
+        size_t k = elegir(rng);
+        bool entrar = (rng() & 1) != 0;
+        size_t& contador = estado.tipos[k] == TipoVehiculo::CARRO ? estado.dentro_carros
+                                                                  : estado.dentro_motos;
+        if (entrar) {
+            ResultadoOperacion r = p.procesar_entrada(estado.placas[k], estado.tipos[k]);
+            if (r.ok()) {
+                if (estado.dentro[k]) {
+                    fallar("Entrada aceptada de un vehículo que ya estaba dentro");
+                }
+                estado.dentro[k] = 1;
+                contador++;
+            } else if (r.codigo == CodigoResultado::SIN_ESPACIO) {
+                estado.sin_espacio++;
+            } else if (r.codigo != CodigoResultado::YA_PRESENTE || !estado.dentro[k]) {
+                fallar("Entrada rechazada sin motivo");
+            }
+        } else {
+            ResultadoOperacion r = p.procesar_salida(estado.placas[k]);
+            if (r.ok() != (estado.dentro[k] != 0)) {
+                fallar("La salida no coincide con la entrada registrada");
+            }
+            if (r.ok()) {
+                estado.dentro[k] = 0;
+                contador--;
+            }
+        }
+    }
+}
+
+// Con los hilos detenidos: espacios únicos y dentro de rango, y las
+// cuentas del parqueadero iguales a las de los hilos
+static void revisar(const Parqueadero& p, const std::vector<EstadoHilo>& estados, int ronda) {
+    std::vector<RegistroTarifa> registros;
+    p.tarifas_actuales(registros);
+
+    std::vector<char> ocupado_carros(p.total_espacios_carros() + 1, 0);
+    std::vector<char> ocupado_motos(p.total_espacios_motos() + 1, 0);
+    size_t carros = 0, motos = 0;
+    for (size_t i = 0; i < registros.size(); i++) {
+        bool es_carro = registros[i].tipo == (uint8_t)TipoVehiculo::CARRO;
+        std::vector<char>& ocupado = es_carro ? ocupado_carros : ocupado_motos;
+        int espacio = registros[i].espacio;
+        if (espacio < 1 || espacio >= (int)ocupado.size()) {
+            fallar("Ronda " + std::to_string(ronda) + ": espacio fuera de rango " +
+                   std::to_string(espacio));
+            continue;
+        }
+        if (ocupado[espacio]) {
+            fallar("Ronda " + std::to_string(ronda) + ": espacio " + std::to_string(espacio) +
+                   " asignado a dos vehículos");
+        }
+        ocupado[espacio] = 1;
+        (es_carro ? carros : motos)++;
+    }
+
+    size_t esperados_carros = 0, esperados_motos = 0;
+    for (size_t i = 0; i < estados.size(); i++) {
+        esperados_carros += estados[i].dentro_carros;
+        esperados_motos += estados[i].dentro_motos;
+    }
+    if (carros != esperados_carros || motos != esperados_motos) {
+        fallar("Ronda " + std::to_string(ronda) + ": hay " + std::to_string(carros) +
+               " carros y " + std::to_string(motos) + " motos, se esperaban " +
+               std::to_string(esperados_carros) + " y " + std::to_string(esperados_motos));
+    }
+    if ((int)carros + p.espacios_disponibles_carros() != p.total_espacios_carros() ||
+        (int)motos + p.espacios_disponibles_motos() != p.total_espacios_motos()) {
+        fallar("Ronda " + std::to_string(ronda) + ": ocupados + libres no da la capacidad");
+    }
+    if (p.total_vehiculos() != (int)(carros + motos)) {
+        fallar("Ronda " + std::to_string(ronda) + ": total_vehiculos() = " +
+               std::to_string(p.total_vehiculos()) + ", dentro: " +
+               std::to_string(carros + motos));
+    }
+}
+
+static void verificar_concurrencia(int hilos, int rondas) {
+    // Menos espacios que placas: también se ejercita SIN_ESPACIO
+    const size_t placas_por_hilo = 2000;
+    const size_t operaciones = 50000;
+    Parqueadero p((int)(hilos * placas_por_hilo / 4), (int)(hilos * placas_por_hilo / 8));
+
+    std::vector<EstadoHilo> estados(hilos);
+    for (int h = 0; h < hilos; h++) {
+        for (size_t i = 0; i < placas_por_hilo; i++) {
+            PlacaCompacta placa;
+            empaquetar_placa(placa_numerada((char)('A' + h % 26), h / 26 * placas_por_hilo + i),
+                             placa);
+            estados[h].placas.push_back(placa);
+            estados[h].tipos.push_back(i % 3 == 0 ? TipoVehiculo::MOTO : TipoVehiculo::CARRO);
+            estados[h].dentro.push_back(0);
+        }
+    }
+
+    size_t sin_espacio = 0;
+    for (int ronda = 0; ronda < rondas; ronda++) {
+        std::vector<std::thread> trabajadores;
+        for (int h = 0; h < hilos; h++) {
+            trabajadores.push_back(std::thread(operar, std::ref(p), std::ref(estados[h]),
+                                               (unsigned)(ronda * hilos + h + 1), operaciones));
+        }
+        for (size_t h = 0; h < trabajadores.size(); h++) {
+            trabajadores[h].join();
+        }
+        revisar(p, estados, ronda);
+    }
+    for (int h = 0; h < hilos; h++) {
+        sin_espacio += estados[h].sin_espacio;
+    }
+    std::cout << "   " << hilos << " hilos x " << rondas << " rondas x " << operaciones
+              << " operaciones, " << p.total_vehiculos() << " vehículos dentro al final, "
+              << sin_espacio << " entradas sin espacio" << std::endl;
+}
+
+// Conectar a 127.0.0.1; buffer_recepcion > 0 achica el de recepción
+// (antes de conectar, así la ventana que anuncia también es chica). Leer
+// o escribir falla tras 5 s sin avanzar, así un servidor trabado hace
+// fallar la verificación en vez de colgarla.
+static socket_t conectar(int puerto, int buffer_recepcion = 0) {
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+#ifdef _WIN32
+    DWORD espera = 5000;
+#else
+    struct timeval espera = {5, 0};
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&espera, sizeof(espera));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&espera, sizeof(espera));
+    if (buffer_recepcion > 0) {
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer_recepcion,
+                   sizeof(buffer_recepcion));
+    }
+    struct sockaddr_in direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons((unsigned short)puerto);
+    inet_pton(AF_INET, "127.0.0.1", &direccion.sin_addr);
+    if (connect(s, (struct sockaddr*)&direccion, sizeof(direccion)) != 0) {
+        CLOSE_SOCKET(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+// Conexión enmarcada de prueba: saluda, envía cada línea y lee su
+// respuesta (sin el '\n')
+static bool conversar(int puerto, const std::vector<std::string>& lineas,
+                      std::vector<std::string>& respuestas) {
+    socket_t s = conectar(puerto);
+    if (s == INVALID_SOCKET) {
+        return false;
+    }
+
+    std::vector<std::string> enviar(1, std::string(PROTOCOLO_SALUDO, sizeof(PROTOCOLO_SALUDO) - 2));
+    enviar.insert(enviar.end(), lineas.begin(), lineas.end());
+    std::string pendiente;
+    char buffer[512];
+    for (size_t i = 0; i < enviar.size(); i++) {
+        std::string linea = enviar[i] + PROTOCOLO_FIN_MENSAJE;
+        if (send(s, linea.data(), (int)linea.size(), 0) != (int)linea.size()) {
+            break;
+        }
+        size_t fin;
+        while ((fin = pendiente.find('\n')) == std::string::npos) {
+            int n = recv(s, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                CLOSE_SOCKET(s);
+                return false;
+            }
+            pendiente.append(buffer, n);
+        }
+        respuestas.push_back(pendiente.substr(0, fin));
+        pendiente.erase(0, fin + 1);
+    }
+    CLOSE_SOCKET(s);
+    if (respuestas.empty() || respuestas[0] + PROTOCOLO_FIN_MENSAJE != PROTOCOLO_SALUDO_OK) {
+        return false;
+    }
+    respuestas.erase(respuestas.begin());
+    return respuestas.size() == lineas.size();
+}
+
+// Servidor con gestor atendido por aceptar_conexion(), sin ejecutar():
+// enrutar a un lote no debe depender de los reactores
+static void verificar_servidor_bloqueante() {
+    GestorParqueaderos gestor;
+    gestor.agregar_parqueadero("NORTE", 10, 10);
+    Parqueadero* sur = gestor.agregar_parqueadero("SUR", 10, 10);
+    ServidorParqueadero servidor(&gestor, 0);
+    servidor.establecer_nivel_log(NivelLog::FALLO);
+    if (!servidor.iniciar()) {
+        fallar("No se pudo iniciar el servidor");
+        return;
+    }
+    int puerto = servidor.obtener_puerto();
+    std::thread hilo_servidor([&servidor] { servidor.aceptar_conexion(); });
+
+    std::vector<std::string> lineas;
+    lineas.push_back("ENTRADA|ABC123|carro|CAM-1|SUR");
+    lineas.push_back("ENTRADA|XYZ98A|moto|CAM-1|NORTE");
+    lineas.push_back("SALIDA|ABC123|carro|CAM-1|SUR");
+    lineas.push_back("ENTRADA|DEF456|carro|CAM-1|OESTE");
+    std::vector<std::string> respuestas;
+    bool ok = conversar(puerto, lineas, respuestas);
+    hilo_servidor.join();
+    servidor.detener();
+
+    if (!ok) {
+        fallar("El servidor bloqueante con gestor no respondió todos los mensajes");
+        return;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (respuestas[i].compare(0, 3, "OK:") != 0) {
+            fallar("\"" + lineas[i] + "\" respondió \"" + respuestas[i] + "\"");
+        }
+    }
+    if (respuestas[3].compare(0, 6, "ERROR:") != 0) {
+        fallar("Mensaje a un lote inexistente aceptado: \"" + respuestas[3] + "\"");
+    }
+    if (sur->total_vehiculos() != 0 || gestor.total_vehiculos() != 1) {
+        fallar("Los mensajes no llegaron al lote indicado");
+    }
+}
+
+// Un lote SINC con el filtro de repetidos encendido: la placa que entra,
+// sale y vuelve a entrar durante la caída no es una lectura repetida, y
+// cada evento se aplica a la hora en que se leyó
+static void verificar_sincronizacion() {
+    Parqueadero p(10, 10);
+    ServidorParqueadero servidor(&p, 0);
+    servidor.establecer_nivel_log(NivelLog::FALLO);
+    servidor.filtrar_repetidos(2000);
+    if (!servidor.iniciar()) {
+        fallar("No se pudo iniciar el servidor");
+        return;
+    }
+    int puerto = servidor.obtener_puerto();
+    std::thread hilo_servidor([&servidor] { servidor.aceptar_conexion(); });
+
+    time_t ahora = time(nullptr);
+    std::vector<std::string> lineas;
+    lineas.push_back(std::string(PROTOCOLO_SINC) + "CAM-1|100|3");
+    lineas.push_back(std::to_string(ahora - 3 * 3600) + "|ENTRADA|ABC123|carro|CAM-1");
+    lineas.push_back(std::to_string(ahora - 2 * 3600) + "|SALIDA|ABC123|carro|CAM-1");
+    lineas.push_back(std::to_string(ahora - 3600) + "|ENTRADA|ABC123|carro|CAM-1");
+    std::vector<std::string> respuestas;
+    bool ok = conversar(puerto, lineas, respuestas);
+    hilo_servidor.join();
+    servidor.detener();
+
+    if (!ok) {
+        fallar("El lote SINC no recibió todas sus respuestas");
+        return;
+    }
+    for (size_t i = 0; i < respuestas.size(); i++) {
+        if (respuestas[i].compare(0, 3, "OK:") != 0) {
+            fallar("\"" + lineas[i] + "\" en un lote SINC respondió \"" + respuestas[i] + "\"");
+        }
+    }
+    if (!p.vehiculo_presente("ABC123") || servidor.lecturas_repetidas() != 0) {
+        fallar("El filtro de repetidos descartó lecturas de un lote SINC");
+    }
+    if (p.consultar_vehiculo("ABC123").hora_entrada != ahora - 3600) {
+        fallar("La entrada sincronizada no quedó a la hora de la lectura");
+    }
+    if (respuestas.size() > 2 && respuestas[2].find("$3000") == std::string::npos) {
+        fallar("La salida sincronizada no cobró la hora que duró la estancia: \"" +
+               respuestas[2] + "\"");
+    }
+}
+
+// Un lote SINC aplicado y reenviado después de reiniciar el servidor: la
+// última secuencia del dispositivo quedó en secuencias.sinc junto a la
+// bitácora, así el reenvío no se vuelve a aplicar
+static void verificar_secuencias_persistentes() {
+    const char* base = getenv("TMPDIR");
+    std::string dir = std::string(base ? base : "/tmp") + "/verificar_secuencias";
+    const char* archivos[] = {"bitacora.log", "bitacora.anterior", "ocupacion.map",
+                              "secuencias.sinc"};
+    for (size_t i = 0; i < sizeof(archivos) / sizeof(archivos[0]); i++) {
+        remove((dir + "/" + archivos[i]).c_str());
+    }
+
+    std::vector<std::string> lineas;
+    lineas.push_back(std::string(PROTOCOLO_SINC) + "CAM-1|200|2");
+    lineas.push_back(std::to_string(time(nullptr) - 60) + "|ENTRADA|XYZ789|moto|CAM-1");
+    lineas.push_back(std::to_string(time(nullptr) - 30) + "|ENTRADA|XYZ790|moto|CAM-1");
+
+    for (int arranque = 0; arranque < 2; arranque++) {
+        Parqueadero p(10, 10);
+        if (!p.habilitar_bitacora(dir)) {
+            fallar("No se pudo abrir la bitácora en " + dir);
+            return;
+        }
+        ServidorParqueadero servidor(&p, 0);
+        servidor.establecer_nivel_log(NivelLog::FALLO);
+        if (!servidor.iniciar()) {
+            fallar("No se pudo iniciar el servidor");
+            return;
+        }
+        int puerto = servidor.obtener_puerto();
+        std::thread hilo_servidor([&servidor] { servidor.aceptar_conexion(); });
+        std::vector<std::string> respuestas;
+        bool ok = conversar(puerto, lineas, respuestas);
+        hilo_servidor.join();
+        servidor.detener();
+
+        if (!ok) {
+            fallar("El lote SINC no recibió todas sus respuestas");
+            return;
+        }
+        for (size_t i = 1; i < respuestas.size(); i++) {
+            bool aplicado = respuestas[i].compare(0, 3, "OK:") == 0;
+            bool repetido = respuestas[i].find("ya aplicado") != std::string::npos;
+            if (!aplicado || repetido != (arranque == 1)) {
+                fallar("\"" + lineas[i] + "\" tras " + std::to_string(arranque) +
+                       " reinicios respondió \"" + respuestas[i] + "\"");
+            }
+        }
+        if (servidor.ultima_secuencia("CAM-1") != 201) {
+            fallar("La última secuencia de CAM-1 no es 201 tras " + std::to_string(arranque) +
+                   " reinicios");
+        }
+    }
+}
+
+#ifdef __linux__
+static bool enviar_todo(socket_t s, const std::string& datos) {
+    size_t enviados = 0;
+    while (enviados < datos.size()) {
+        ssize_t n = send(s, datos.data() + enviados, datos.size() - enviados, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        enviados += n;
+    }
+    return true;
+}
+
+// Leer hasta que el servidor cierre; false si pasan 5 s sin bytes
+static bool leer_hasta_cierre(socket_t s, std::string& recibido) {
+    char buffer[16384];
+    ssize_t n;
+    while ((n = recv(s, buffer, sizeof(buffer), 0)) > 0) {
+        recibido.append(buffer, n);
+    }
+    return n == 0 || errno == ECONNRESET;
+}
+
+static std::vector<std::string> separar_lineas(const std::string& texto) {
+    std::vector<std::string> lineas;
+    size_t inicio = 0, fin;
+    while ((fin = texto.find('\n', inicio)) != std::string::npos) {
+        lineas.push_back(texto.substr(inicio, fin - inicio));
+        inicio = fin + 1;
+    }
+    return lineas;
+}
+
+static double segundos_cpu() {
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_utime.tv_sec + uso.ru_stime.tv_sec +
+           (uso.ru_utime.tv_usec + uso.ru_stime.tv_usec) / 1e6;
+}
+
+// Servidor con ejecutar(2) en el backend pedido, en un puerto libre. Con
+// un gestor de dos lotes, cada lote es de un reactor distinto.
+class ServidorDePrueba {
+public:
+    ServidorDePrueba(GestorParqueaderos* g, BackendServidor pedido) : servidor(g, 0) {
+        servidor.establecer_nivel_log(NivelLog::FALLO);
+        listo = servidor.iniciar(pedido) && servidor.backend() == pedido;
+        if (listo) {
+            hilo = std::thread([this] { servidor.ejecutar(2); });
+        }
+    }
+    ~ServidorDePrueba() {
+        servidor.detener();
+        if (hilo.joinable()) {
+            hilo.join();
+        }
+    }
+    ServidorParqueadero servidor;
+    bool listo;  // false: no se pudo iniciar o el backend no está disponible
+
+private:
+    std::thread hilo;
+};
+
+// Esperar (hasta 5 s) a que el servidor haya recibido bytes en total
+static bool esperar_recibidos(const ServidorParqueadero& servidor, uint64_t bytes) {
+    for (int i = 0; i < 5000; i++) {
+        if (servidor.obtener_metricas().bytes_recibidos >= bytes) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// El dispositivo manda muchos mensajes, cierra su mitad (shutdown) sin
+// leer y la respuesta queda pendiente: el reactor no debe girar sobre el
+// EOF mientras espera, y al final entrega todo y cierra
+static void verificar_cierre_parcial(ServidorParqueadero& servidor, const std::string& backend) {
+    // Tandas por debajo de MAX_BUFFER_CONEXION, cada una cuando el
+    // servidor recibió la anterior; las respuestas (unos 14 MB) no caben
+    // en los buffers del socket
+    const size_t tandas = 10;
+    const size_t por_tanda = 20000;
+    const size_t mensajes = tandas * por_tanda;
+    uint64_t recibidos = servidor.obtener_metricas().bytes_recibidos;
+    socket_t s = conectar(servidor.obtener_puerto(), 4096);
+    if (s == INVALID_SOCKET) {
+        fallar(backend + ": no se pudo conectar");
+        return;
+    }
+    std::string tanda;
+    for (size_t i = 0; i < por_tanda; i++) {
+        tanda += "X\n";  // Inválido: cada uno responde un ERROR
+    }
+    bool enviado = enviar_todo(s, PROTOCOLO_SALUDO);
+    recibidos += sizeof(PROTOCOLO_SALUDO) - 1;
+    for (size_t t = 0; t < tandas && enviado; t++) {
+        recibidos += tanda.size();
+        enviado = enviar_todo(s, tanda) && esperar_recibidos(servidor, recibidos);
+    }
+    if (!enviado) {
+        fallar(backend + ": no se pudieron enviar los mensajes");
+        CLOSE_SOCKET(s);
+        return;
+    }
+    shutdown(s, SHUT_WR);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    double antes = segundos_cpu();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double gastado = segundos_cpu() - antes;
+    if (gastado > 0.25) {
+        fallar(backend + ": " + std::to_string(gastado) +
+               " s de CPU en 0.5 s esperando a un cliente que cerró su mitad");
+    }
+
+    std::string recibido;
+    if (!leer_hasta_cierre(s, recibido)) {
+        fallar(backend + ": el servidor no cerró tras enviar la respuesta");
+    }
+    CLOSE_SOCKET(s);
+    size_t lineas = std::count(recibido.begin(), recibido.end(), '\n');
+    if (lineas != mensajes + 1) {
+        fallar(backend + ": tras el cierre parcial llegaron " + std::to_string(lineas) +
+               " de " + std::to_string(mensajes + 1) + " respuestas");
+    }
+}
+
+// Mensajes a dos lotes alternados, todos en un envío: varios por
+// lectura, y la conexión pasa por el Buzon de un reactor al otro a cada
+// mensaje. Al final una SALIDA partida en tres lecturas y el cierre de la
+// mitad del cliente. Las respuestas deben llegar todas y en orden.
+static void verificar_enmarcado(ServidorParqueadero& servidor, GestorParqueaderos& gestor,
+                                const std::string& backend) {
+    const char* lotes[] = {"NORTE", "SUR"};
+    const size_t mensajes = 200;
+    std::vector<std::string> placas;
+    std::string datos(PROTOCOLO_SALUDO);
+    for (size_t i = 0; i < mensajes; i++) {
+        placas.push_back(placa_numerada('R', i));
+        datos += "ENTRADA|" + placas[i] + "|carro|CAM-1|" + lotes[i % 2] + "\n";
+    }
+    std::string salida = "SALIDA|" + placas[0] + "|carro|CAM-1|NORTE\n";
+    const size_t cortes[] = {0, 4, 13, salida.size()};
+
+    uint64_t recibidos = servidor.obtener_metricas().bytes_recibidos;
+    socket_t s = conectar(servidor.obtener_puerto());
+    if (s == INVALID_SOCKET) {
+        fallar(backend + ": no se pudo conectar");
+        return;
+    }
+    bool enviado = enviar_todo(s, datos);
+    recibidos += datos.size();
+    for (size_t i = 0; i + 1 < sizeof(cortes) / sizeof(cortes[0]) && enviado; i++) {
+        // Cada pedazo después de que el servidor leyó el anterior
+        enviado = esperar_recibidos(servidor, recibidos) &&
+                  enviar_todo(s, salida.substr(cortes[i], cortes[i + 1] - cortes[i]));
+        recibidos += cortes[i + 1] - cortes[i];
+    }
+    if (!enviado) {
+        fallar(backend + ": no se pudieron enviar los mensajes");
+        CLOSE_SOCKET(s);
+        return;
+    }
+    shutdown(s, SHUT_WR);
+    std::string recibido;
+    bool cerrada = leer_hasta_cierre(s, recibido);
+    CLOSE_SOCKET(s);
+
+    std::vector<std::string> respuestas = separar_lineas(recibido);
+    if (!cerrada || respuestas.size() != mensajes + 2) {
+        fallar(backend + ": llegaron " + std::to_string(respuestas.size()) + " de " +
+               std::to_string(mensajes + 2) + " respuestas enmarcadas");
+        return;
+    }
+    if (respuestas[0] + PROTOCOLO_FIN_MENSAJE != PROTOCOLO_SALUDO_OK) {
+        fallar(backend + ": saludo respondido con \"" + respuestas[0] + "\"");
+    }
+    for (size_t i = 0; i <= mensajes; i++) {
+        const std::string& placa = i < mensajes ? placas[i] : placas[0];
+        std::string esperado = "OK: Vehículo " + placa + (i < mensajes ? " registrado" : " retirado");
+        if (respuestas[i + 1].compare(0, esperado.size(), esperado) != 0) {
+            fallar(backend + ": la respuesta " + std::to_string(i + 1) + " es \"" +
+                   respuestas[i + 1] + "\", se esperaba \"" + esperado + "...\"");
+            return;
+        }
+    }
+    const Parqueadero* norte = gestor.parqueadero("NORTE");
+    if (norte == nullptr || norte->total_vehiculos() != (int)mensajes / 2 - 1 ||
+        gestor.total_vehiculos() != (int)mensajes - 1) {
+        fallar(backend + ": los mensajes no llegaron a su lote");
+    }
+}
+
+// Un mensaje sin fin de línea de más de MAX_BUFFER_CONEXION (64 KB): el
+// reactor cierra esa conexión y sigue atendiendo las demás
+static void verificar_desborde(ServidorParqueadero& servidor, const std::string& backend) {
+    int puerto = servidor.obtener_puerto();
+    socket_t s = conectar(puerto);
+    if (s == INVALID_SOCKET) {
+        fallar(backend + ": no se pudo conectar");
+        return;
+    }
+    std::string datos(PROTOCOLO_SALUDO);
+    datos.append(70 * 1024, 'A');
+    enviar_todo(s, datos);  // Puede fallar si el servidor ya cerró
+    std::string recibido;
+    if (!leer_hasta_cierre(s, recibido)) {
+        fallar(backend + ": no se cerró la conexión con un mensaje de más de 64 KB");
+    }
+    CLOSE_SOCKET(s);
+
+    std::vector<std::string> lineas(1, "ENTRADA|DESB01|moto|CAM-1|SUR");
+    std::vector<std::string> respuestas;
+    if (!conversar(puerto, lineas, respuestas) || respuestas[0].compare(0, 3, "OK:") != 0) {
+        fallar(backend + ": tras cerrar una conexión desbordada no atiende las demás");
+    }
+}
+
+// Los reactores de ejecutar() con cada backend
+static void verificar_reactores() {
+    const BackendServidor backends[] = {BackendServidor::SOCKETS, BackendServidor::IO_URING};
+    const char* nombres[] = {"epoll", "io_uring"};
+    for (int b = 0; b < 2; b++) {
+        GestorParqueaderos gestor;
+        gestor.agregar_parqueadero("NORTE", 200, 200);
+        gestor.agregar_parqueadero("SUR", 200, 200);
+        ServidorDePrueba prueba(&gestor, backends[b]);
+        if (!prueba.listo) {
+            std::cout << "   " << nombres[b] << " no disponible, se omite" << std::endl;
+            continue;
+        }
+        verificar_enmarcado(prueba.servidor, gestor, nombres[b]);
+        verificar_cierre_parcial(prueba.servidor, nombres[b]);
+        verificar_desborde(prueba.servidor, nombres[b]);
+    }
+}
+#endif
+
+#ifndef _WIN32
+static long long largo_archivo(const std::string& ruta) {
+    struct stat info;
+    return stat(ruta.c_str(), &info) == 0 ? (long long)info.st_size : -1;
+}
+
+// Con un límite de tamaño de archivo (RLIMIT_FSIZE) la escritura de un
+// lote queda a medias: la operación debe retornar ERROR_BITACORA, el
+// archivo volver a terminar en un registro completo y, sin el límite, el
+// registro fallido escribirse con el siguiente lote
+static void verificar_bitacora_fallida() {
+    const char* base = getenv("TMPDIR");
+    std::string dir = std::string(base ? base : "/tmp") + "/verificar_bitacora";
+    const char* archivos[] = {"bitacora.log", "bitacora.anterior", "ocupacion.map"};
+    for (size_t i = 0; i < sizeof(archivos) / sizeof(archivos[0]); i++) {
+        remove((dir + "/" + archivos[i]).c_str());
+    }
+    std::string ruta_log = dir + "/bitacora.log";
+    const long long largo_registro = sizeof(RegistroBitacora);
+
+    {
+        Parqueadero p(10, 10);
+        if (!p.habilitar_bitacora(dir)) {
+            fallar("No se pudo abrir la bitácora en " + dir);
+            return;
+        }
+        if (!p.procesar_entrada("AAA001", "carro").ok()) {
+            fallar("Entrada con la bitácora sana rechazada");
+        }
+        long long largo_sano = largo_archivo(ruta_log);
+
+        // Cabe el comienzo del siguiente registro, no el registro completo
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit anterior, limite;
+        getrlimit(RLIMIT_FSIZE, &anterior);
+        limite = anterior;
+        limite.rlim_cur = (rlim_t)(largo_sano + largo_registro / 2);
+        setrlimit(RLIMIT_FSIZE, &limite);
+        ResultadoOperacion r = p.procesar_entrada("AAA002", "carro");
+        long long largo_fallido = largo_archivo(ruta_log);
+        setrlimit(RLIMIT_FSIZE, &anterior);
+
+        if (r.codigo != CodigoResultado::ERROR_BITACORA) {
+            fallar("Entrada sin escribir en la bitácora confirmada (código " +
+                   std::to_string((int)r.codigo) + ")");
+        }
+        if (largo_fallido != largo_sano) {
+            fallar("Quedó un registro a medias en la bitácora: " + std::to_string(largo_fallido) +
+                   " bytes, se esperaban " + std::to_string(largo_sano));
+        }
+        if (!p.procesar_entrada("AAA003", "moto").ok()) {
+            fallar("La bitácora no se recuperó tras el fallo");
+        }
+        if (largo_archivo(ruta_log) != largo_sano + 2 * largo_registro) {
+            fallar("El registro fallido no se reintentó");
+        }
+        if (p.obtener_bitacora()->escrituras_fallidas() == 0) {
+            fallar("Escritura fallida sin contar");
+        }
+    }
+
+    // Al recuperar están las tres entradas y ningún registro dañado
+    Parqueadero recuperado(10, 10);
+    if (!recuperado.habilitar_bitacora(dir) || recuperado.total_vehiculos() != 3 ||
+        !recuperado.vehiculo_presente("AAA002")) {
+        fallar("La recuperación tras el fallo no tiene las tres entradas");
+    }
+}
+#endif
+
+// Una instantánea cuyo msync falló deja bitacora.anterior: la siguiente
+// debe terminarla (mapa a disco, borrar la rotada) en vez de negarse a
+// rotar para siempre
+static void verificar_instantanea_pendiente() {
+    const char* base = getenv("TMPDIR");
+    std::string dir = std::string(base ? base : "/tmp") + "/verificar_instantanea";
+    const char* archivos[] = {"bitacora.log", "bitacora.anterior", "ocupacion.map"};
+    for (size_t i = 0; i < sizeof(archivos) / sizeof(archivos[0]); i++) {
+        remove((dir + "/" + archivos[i]).c_str());
+    }
+    std::string rotada = dir + "/bitacora.anterior";
+    OpcionesBitacora opciones;
+    opciones.registros_por_instantanea = 0;
+
+    {
+        Parqueadero p(10, 10);
+        if (!p.habilitar_bitacora(dir, opciones)) {
+            fallar("No se pudo abrir la bitácora en " + dir);
+            return;
+        }
+        p.procesar_entrada("AAA001", "carro");
+        if (!p.tomar_instantanea()) {
+            fallar("Instantánea con la bitácora sana fallida");
+        }
+        p.procesar_entrada("AAA002", "moto");
+        // Lo que deja un msync fallido tras rotar
+        FILE* f = fopen(rotada.c_str(), "wb");
+        if (f != nullptr) {
+            fclose(f);
+        }
+        for (int i = 0; i < 2; i++) {
+            if (!p.tomar_instantanea()) {
+                fallar("Instantánea " + std::to_string(i + 1) +
+                       " tras una que no terminó rechazada");
+            }
+        }
+        struct stat info;
+        if (stat(rotada.c_str(), &info) == 0) {
+            fallar("bitacora.anterior sigue ahí tras la instantánea");
+        }
+        p.procesar_entrada("AAA003", "carro");
+    }
+
+    Parqueadero recuperado(10, 10);
+    if (!recuperado.habilitar_bitacora(dir, opciones) || recuperado.total_vehiculos() != 3) {
+        fallar("La recuperación tras la instantánea pendiente no tiene las tres entradas");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Por defecto uno por núcleo, y al menos 4 para que haya disputa
+    int hilos = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    if (argc <= 1 && hilos < 4) {
+        hilos = 4;
+    }
+    int rondas = argc > 2 ? atoi(argv[2]) : 5;
+    if (hilos < 2) {
+        hilos = 2;  // Con uno solo no hay concurrencia que verificar
+    }
+    if (rondas <= 0) {
+        std::cerr << "Uso: " << argv[0] << " [hilos] [rondas]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "🧪 Entradas y salidas concurrentes" << std::endl;
+    verificar_concurrencia(hilos, rondas);
+
+#ifndef _WIN32
+    std::cout << "🧪 Escritura fallida de la bitácora" << std::endl;
+    verificar_bitacora_fallida();
+#endif
+    std::cout << "🧪 Instantánea que no terminó" << std::endl;
+    verificar_instantanea_pendiente();
+
+    std::cout << "🧪 Servidor bloqueante: varios lotes y sincronización" << std::endl;
+    if (!inicializar_sockets()) {
+        fallar("No se pudieron inicializar los sockets");
+    } else {
+        verificar_servidor_bloqueante();
+        verificar_sincronizacion();
+        verificar_secuencias_persistentes();
+#ifdef __linux__
+        std::cout << "🧪 Reactores de ejecutar()" << std::endl;
+        verificar_reactores();
+#endif
+        limpiar_sockets();
+    }
+
+    if (fallas > 0) {
+        std::cerr << "❌ " << fallas << " verificaciones fallaron" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Verificaciones completadas" << std::endl;
+    return 0;
+}
@@ -1,70 +1,50 @@
-from datetime import datetime
+import parqueadero_cpp
 
 class Database:
-    """Implementación simple en memoria para pruebas.
-    Guarda un historial básico de entradas/salidas y calcula estadísticas.
+    """Historial de entradas/salidas con estadísticas y reportes.
+    El trabajo lo hace parqueadero_cpp.HistorialParqueadero: las estancias
+    abiertas se indexan por placa y los totales se actualizan con cada
+    evento, así que ninguna operación recorre el historial. Las estancias
+    cerradas se guardan por columnas (en `archivo`, si se da) y los reportes
+    por rango las recorren en C++ con varios hilos.
     """
-    def __init__(self):
-        self.historial = []  # lista de dicts: {placa,tipo,entrada,salida,tarifa,fuente}
+    def __init__(self, archivo=None):
+        self.historial = parqueadero_cpp.HistorialParqueadero()
+        if archivo and not self.historial.abrir_archivo(archivo):
+            raise RuntimeError(f"No se pudo abrir el historial en {archivo}")
 
     def registrar_entrada(self, placa, tipo, espacio, fuente):
-        now = datetime.now().isoformat(sep=' ')
-        self.historial.append({
-            'placa': placa,
-            'tipo': tipo,
-            'hora_entrada': now,
-            'hora_salida': None,
-            'tarifa': 0.0,
-            'espacio': espacio,
-            'fuente': fuente,
-        })
+        self.historial.registrar_entrada(placa, tipo, espacio, fuente)
 
     def registrar_salida(self, placa, tarifa, fuente):
-        now = datetime.now().isoformat(sep=' ')
-        # buscar última entrada sin salida para esta placa
-        for rec in reversed(self.historial):
-            if rec['placa'] == placa and rec['hora_salida'] is None:
-                rec['hora_salida'] = now
-                rec['tarifa'] = float(tarifa)
-                rec['fuente_salida'] = fuente
-                return True
-        # si no existe, agregar un registro de salida solitario
-        self.historial.append({
-            'placa': placa,
-            'tipo': None,
-            'hora_entrada': None,
-            'hora_salida': now,
-            'tarifa': float(tarifa),
-            'espacio': None,
-            'fuente': fuente,
-        })
-        return False
+        # False si no había una entrada abierta para esta placa
+        # (la salida queda registrada igual y su tarifa suma al recaudo)
+        return self.historial.registrar_salida(placa, float(tarifa), fuente)
+
+    def sincronizar(self):
+        return self.historial.sincronizar()
 
     def obtener_estadisticas(self):
-        total_vehiculos = 0
-        total_carros = 0
-        total_motos = 0
-        total_recaudado = 0.0
+        return self.historial.estadisticas()
+
+    def ocupacion_por_hora(self, horas=24):
+        return self.historial.ocupacion_por_hora(horas)
 
-        placas_actuales = set()
+    def ultimas_estancias(self, n=100):
+        return self.historial.ultimas_estancias(n)
 
-        for rec in self.historial:
-            if rec.get('hora_entrada') and not rec.get('hora_salida'):
-                placas_actuales.add(rec['placa'])
+    # Reportes por rango [desde, hasta) en segundos epoch. Las series
+    # (ingresos, salidas, ocupación, distribución) son buffers:
+    # memoryview(serie) o numpy.frombuffer(serie) no copian los datos.
 
-            if rec.get('tarifa'):
-                total_recaudado += float(rec.get('tarifa', 0.0))
+    def resumen(self, desde, hasta, tipo=None):
+        return self.historial.resumen(desde, hasta, tipo)
 
-            if rec.get('tipo') == 'carro':
-                total_carros += 1
-            elif rec.get('tipo') == 'moto':
-                total_motos += 1
+    def ingresos_por_hora(self, desde, hasta, tipo=None):
+        return self.historial.ingresos_por_intervalo(desde, hasta, 3600, tipo)
 
-        total_vehiculos = len(placas_actuales)
+    def distribucion_estancias(self, desde, hasta, ancho_min=15, cubetas=32, tipo=None):
+        return self.historial.distribucion_estancias(desde, hasta, ancho_min * 60, cubetas, tipo)
 
-        return {
-            'total_vehiculos': total_vehiculos,
-            'total_carros': total_carros,
-            'total_motos': total_motos,
-            'total_recaudado': total_recaudado,
-        }
+    def ocupacion_por_intervalo(self, desde, hasta, resolucion_min=5):
+        return self.historial.ocupacion_por_intervalo(desde, hasta, resolucion_min * 60)
@@ -0,0 +1,88 @@
+"""
+Lector del mapa de ocupación (ocupacion.map) sin pasar por el módulo C++
+ni por el servidor TCP. Mapea el archivo en solo lectura: los reportes ven
+los cambios del parqueadero en vivo.
+
+Uso: python lector_ocupacion.py datos/ocupacion.map
+"""
+import mmap
+import struct
+import sys
+import time
+
+# Debe coincidir con CabeceraMapa y EspacioMapa en cpp/mapa_ocupacion.hpp
+CABECERA = struct.Struct("<8sIIIiiIQQQQddQQii24x")
+ESPACIO = struct.Struct("<IBBHQqQ")
+MAGIA = b"PQMAPA01"
+VERSION = 1
+TIPOS = ("carro", "moto")
+
+
+class LectorOcupacion:
+    def __init__(self, ruta):
+        with open(ruta, "rb") as archivo:
+            self.mapa = mmap.mmap(archivo.fileno(), 0, access=mmap.ACCESS_READ)
+        (magia, version, tam_cabecera, tam_espacio, self.capacidad_carros,
+         self.capacidad_motos, _, self.offset_espacios, _, _, _,
+         self.tarifa_hora_carro, self.tarifa_hora_moto,
+         _, _, _, _) = CABECERA.unpack_from(self.mapa, 0)
+        if (magia != MAGIA or version != VERSION or
+                tam_cabecera != CABECERA.size or tam_espacio != ESPACIO.size):
+            raise ValueError(f"{ruta} no es un mapa de ocupación v{VERSION}")
+
+    def cabecera(self):
+        campos = CABECERA.unpack_from(self.mapa, 0)
+        return {
+            "secuencia_instantanea": campos[13],
+            "generacion": campos[14],
+            "ocupados_carros": campos[15],
+            "ocupados_motos": campos[16],
+        }
+
+    def espacio(self, tipo, numero):
+        """(placa, hora_entrada) del espacio 1..N, o None si está libre"""
+        indice = numero - 1
+        if tipo == "moto":
+            indice += self.capacidad_carros
+        offset = self.offset_espacios + indice * ESPACIO.size
+        while True:
+            # Seqlock: versión impar o distinta al terminar = escritura en curso
+            version, ocupado, _, _, placa, hora, _ = ESPACIO.unpack_from(self.mapa, offset)
+            if version % 2 == 0 and struct.unpack_from("<I", self.mapa, offset)[0] == version:
+                break
+        if not ocupado:
+            return None
+        return placa.to_bytes(8, "little").rstrip(b"\0").decode(), hora
+
+    def vehiculos(self):
+        for tipo, capacidad in (("carro", self.capacidad_carros), ("moto", self.capacidad_motos)):
+            for numero in range(1, capacidad + 1):
+                ocupante = self.espacio(tipo, numero)
+                if ocupante:
+                    placa, hora = ocupante
+                    yield placa, tipo, numero, hora
+
+    def cerrar(self):
+        self.mapa.close()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Uso: python lector_ocupacion.py <ruta/ocupacion.map>")
+        sys.exit(1)
+
+    lector = LectorOcupacion(sys.argv[1])
+    estado = lector.cabecera()
+    print(f"🅿️  Carros: {estado['ocupados_carros']}/{lector.capacidad_carros}  "
+          f"Motos: {estado['ocupados_motos']}/{lector.capacidad_motos}  "
+          f"(generación {estado['generacion']})")
+    ahora = time.time()
+    for placa, tipo, numero, hora in lector.vehiculos():
+        horas = -(-int(ahora - hora) // 3600)  # Redondear hacia arriba, como en C++
+        tarifa = horas * (lector.tarifa_hora_carro if tipo == "carro" else lector.tarifa_hora_moto)
+        print(f"  {placa:8} {tipo:5} espacio {numero:4}  ${tarifa:,.0f}")
+    lector.cerrar()
+
+
+if __name__ == "__main__":
+    main()
\ No newline at end of file
@@ -5,13 +5,16 @@ Recibe eventos de dispositivos remotos (cámaras de placas)
 """
 
 import parqueadero_cpp
+import os
 import threading
 import time
 from datetime import datetime
 from database import Database
 
 class ServidorIoT:
-    def __init__(self, capacidad_carros=20, capacidad_motos=30, puerto=8080):
+    def __init__(self, capacidad_carros=20, capacidad_motos=30, puerto=8080, hilos_reactor=4,
+                 directorio_bitacora=None, puerto_metricas=None, nivel_log="info",
+                 tarifas=None, ventana_repetidos_ms=0):
         # Crear parqueadero
         self.parqueadero = parqueadero_cpp.Parqueadero(
             capacidad_carros, 
@@ -20,28 +23,62 @@ class ServidorIoT:
             2000.0
         )
         
+        # Reglas de cobro por tipo, p. ej. {"carro": {"valor_bloque": 800,
+        # "minutos_bloque": 15, "tope_diario": 25000}}
+        for tipo, regla in (tarifas or {}).items():
+            self.parqueadero.configurar_tarifa(tipo, parqueadero_cpp.ReglaTarifa(**regla))
+        
+        # Recuperar el estado de la bitácora, si se pidió persistencia
+        if directorio_bitacora:
+            if not self.parqueadero.habilitar_bitacora(directorio_bitacora):
+                raise RuntimeError(f"No se pudo abrir la bitácora en {directorio_bitacora}")
+            print(f"💾 Bitácora en {directorio_bitacora}: "
+                  f"{self.parqueadero.total_vehiculos()} vehículos recuperados")
+        
         # Crear servidor TCP/IP
         self.servidor = parqueadero_cpp.ServidorParqueadero(self.parqueadero, puerto)
+        # Log asíncrono en C++: "debug" muestra cada mensaje y respuesta
+        self.servidor.establecer_nivel_log(nivel_log)
+        # Las cámaras reportan la misma placa varias veces seguidas: con una
+        # ventana > 0 las repeticiones se descartan antes del parqueadero
+        if ventana_repetidos_ms > 0:
+            self.servidor.filtrar_repetidos(ventana_repetidos_ms)
         
-        # Base de datos para persistencia
-        self.db = Database()
+        # Historial de estancias; con bitácora se guarda en el mismo directorio
+        archivo_estancias = (os.path.join(directorio_bitacora, "estancias.col")
+                             if directorio_bitacora else None)
+        self.db = Database(archivo_estancias)
         
         # Estado
         self.ejecutando = False
         self.puerto = puerto
+        self.hilos_reactor = hilos_reactor
+        self.puerto_metricas = puerto_metricas
         self.eventos_procesados = 0
         self.thread_servidor = None
-        
-        # Configurar callback para eventos
-        self.servidor.establecer_callback(self._manejar_evento)
+        self.thread_eventos = None
+    
+    def _loop_eventos(self):
+        """Consume en lotes los eventos que el servidor C++ deja en su cola"""
+        while self.ejecutando:
+            # Libera el GIL mientras espera; hasta 256 eventos por llamada
+            for evento in self.servidor.obtener_eventos(256, 200):
+                try:
+                    self._manejar_evento(evento.tipo, evento.placa,
+                                         evento.tipo_vehiculo, evento.exito,
+                                         evento.espacio, evento.tarifa)
+                except Exception as e:
+                    print(f"❌ Error procesando evento: {e}")
     
-    def _manejar_evento(self, tipo, placa, tipo_vehiculo, exito):
+    def _manejar_evento(self, tipo, placa, tipo_vehiculo, exito, espacio=-1, tarifa=0.0):
         """
-        Callback llamado cuando un dispositivo envía un evento
+        Procesa un evento enviado por un dispositivo
         tipo: "ENTRADA" o "SALIDA"
         placa: placa del vehículo
         tipo_vehiculo: "carro" o "moto"
         exito: True si la operación fue exitosa
+        espacio: espacio asignado (ENTRADA) o liberado (SALIDA)
+        tarifa: tarifa cobrada (SALIDA)
         """
         self.eventos_procesados += 1
         timestamp = datetime.now().strftime('%Y-%m-%d %H:%M:%S')
@@ -58,33 +95,20 @@ class ServidorIoT:
         
         # Guardar en base de datos si fue exitoso
         if exito and tipo == "ENTRADA":
-            # Obtener info del vehículo para saber el espacio
-            info = self.parqueadero.info_vehiculo(placa)
-            # Parsear espacio de la info (formato: "Espacio: N")
-            espacio = 0
-            for linea in info.split('\n'):
-                if linea.startswith('Espacio:'):
-                    espacio = int(linea.split(':')[1].strip())
-                    break
-            
             self.db.registrar_entrada(placa, tipo_vehiculo, espacio, "dispositivo_iot")
         
         elif exito and tipo == "SALIDA":
-            tarifa = self.parqueadero.calcular_tarifa(placa)
             self.db.registrar_salida(placa, tarifa, "dispositivo_iot")
     
     def _loop_servidor(self):
-        """Loop principal del servidor que acepta conexiones"""
-        while self.ejecutando:
-            try:
-                # Aceptar conexión (bloquea hasta recibir una)
-                if not self.servidor.aceptar_conexion():
-                    if self.ejecutando:  # Solo mostrar error si aún está ejecutando
-                        print("⚠️  Error al aceptar conexión")
-            except Exception as e:
-                if self.ejecutando:
-                    print(f"❌ Error en servidor: {e}")
-                break
+        """Loop principal del servidor que atiende conexiones"""
+        try:
+            # Reactores epoll concurrentes (bloquea hasta detener())
+            if not self.servidor.ejecutar(self.hilos_reactor) and self.ejecutando:
+                print("⚠️  Error al ejecutar el servidor")
+        except Exception as e:
+            if self.ejecutando:
+                print(f"❌ Error en servidor: {e}")
     
     def iniciar(self):
         """Inicia el servidor IoT"""
@@ -102,10 +126,18 @@ class ServidorIoT:
         
         self.ejecutando = True
         
+        # Endpoint de métricas para Prometheus (hilo propio en C++)
+        if self.puerto_metricas and not self.servidor.iniciar_metricas(self.puerto_metricas):
+            print(f"⚠️  No se pudo abrir el puerto de métricas {self.puerto_metricas}")
+        
         # Iniciar thread para aceptar conexiones
         self.thread_servidor = threading.Thread(target=self._loop_servidor, daemon=True)
         self.thread_servidor.start()
         
+        # Iniciar thread que consume eventos fuera del hilo de red
+        self.thread_eventos = threading.Thread(target=self._loop_eventos, daemon=True)
+        self.thread_eventos.start()
+        
         print(f"✅ Servidor escuchando en puerto {self.puerto}")
         print(f"📡 Esperando dispositivos IoT...")
         print(f"🅿️  Capacidad: {self.parqueadero.espacios_disponibles_carros()} carros, "
@@ -124,10 +156,14 @@ class ServidorIoT:
         print("="*60)
         
         self.ejecutando = False
+        self.servidor.detener_metricas()
         self.servidor.detener()
         
         if self.thread_servidor:
             self.thread_servidor.join(timeout=2)
+        if self.thread_eventos:
+            self.thread_eventos.join(timeout=2)
+        self.db.sincronizar()
         
         print(f"📊 Total eventos procesados: {self.eventos_procesados}")
         print("="*60 + "\n")
@@ -139,15 +175,15 @@ class ServidorIoT:
         print("="*60)
         print(f"🚗 Espacios carros disponibles: {self.parqueadero.espacios_disponibles_carros()}")
         print(f"🏍️  Espacios motos disponibles:  {self.parqueadero.espacios_disponibles_motos()}")
-        print(f"📍 Vehículos dentro: {len(self.parqueadero.listar_vehiculos())}")
+        print(f"📍 Vehículos dentro: {self.parqueadero.total_vehiculos()}")
         print(f"🔔 Eventos procesados: {self.eventos_procesados}")
         
-        vehiculos = self.parqueadero.listar_vehiculos()
+        # Una sola llamada para todas las placas y tarifas
+        vehiculos = sorted(self.parqueadero.tarifas_actuales().tuplas())
         if vehiculos:
             print("\n📋 Vehículos actuales:")
-            for placa in vehiculos:
-                tarifa = self.parqueadero.calcular_tarifa(placa)
-                print(f"   • {placa} - Tarifa actual: ${tarifa:,.0f}")
+            for placa, espacio, tipo, _, tarifa in vehiculos:
+                print(f"   • {placa} ({tipo}, espacio {espacio}) - Tarifa actual: ${tarifa:,.0f}")
         
         print("="*60 + "\n")
     
@@ -196,6 +232,10 @@ class ServidorIoT:
                     print(f"Total carros: {stats['total_carros']}")
                     print(f"Total motos: {stats['total_motos']}")
                     print(f"Recaudado: ${stats['total_recaudado']:,.0f}")
+                    print(f"Estancia promedio: {stats['estancia_promedio_min']:.1f} min")
+                    ahora = int(time.time())
+                    dia = self.db.resumen(ahora - 86400, ahora + 1)
+                    print(f"Últimas 24 h: {dia['estancias']} salidas, ${dia['recaudado']:,.0f}")
                     print("="*40)
                 
                 elif opcion == "5":
@@ -62,13 +62,14 @@ class SimuladorParqueadero:
             tipo = self.obtener_tipo_vehiculo()
         
         # Registrar entrada
-        resultado = self.parqueadero.registrar_entrada(placa, tipo)
+        resultado = self.parqueadero.procesar_entrada(placa, tipo)
+        mensaje = parqueadero_cpp.describir_entrada(placa, tipo, resultado)
         
-        if resultado.startswith('OK'):
-            print(f"✅ ENTRADA: {placa} ({tipo.upper()}) - {resultado[4:]}")
+        if resultado.ok:
+            print(f"✅ ENTRADA: {placa} ({tipo.upper()}) - {mensaje}")
             self.estadisticas['entradas_exitosas'] += 1
         else:
-            print(f"❌ ENTRADA RECHAZADA: {placa} - {resultado[7:]}")
+            print(f"❌ ENTRADA RECHAZADA: {placa} - {mensaje}")
             self.estadisticas['entradas_rechazadas'] += 1
     
     def simular_salida(self):
@@ -83,23 +84,21 @@ class SimuladorParqueadero:
         # Seleccionar vehículo aleatorio
         placa = random.choice(vehiculos_dentro)
         
-        # Calcular tarifa antes de sacar
-        tarifa = self.parqueadero.calcular_tarifa(placa)
+        # Registrar salida (el resultado trae la tarifa cobrada)
+        resultado = self.parqueadero.procesar_salida(placa)
         
-        # Registrar salida
-        resultado = self.parqueadero.registrar_salida(placa)
-        
-        if resultado.startswith('OK'):
-            print(f"🚗 SALIDA: {placa} - Tarifa: ${tarifa:,.0f}")
+        if resultado.ok:
+            print(f"🚗 SALIDA: {placa} - Tarifa: ${resultado.tarifa:,.0f}")
             self.estadisticas['salidas_exitosas'] += 1
-            self.estadisticas['total_recaudado'] += tarifa
+            self.estadisticas['total_recaudado'] += resultado.tarifa
         else:
-            print(f"❌ SALIDA RECHAZADA: {placa} - {resultado[7:]}")
+            mensaje = parqueadero_cpp.describir_salida(placa, resultado)
+            print(f"❌ SALIDA RECHAZADA: {placa} - {mensaje}")
             self.estadisticas['salidas_rechazadas'] += 1
     
     def decidir_accion(self):
         """Decide si hacer entrada o salida basado en el estado actual"""
-        vehiculos_dentro = len(self.parqueadero.listar_vehiculos())
+        vehiculos_dentro = self.parqueadero.total_vehiculos()
         espacios_carros = self.parqueadero.espacios_disponibles_carros()
         espacios_motos = self.parqueadero.espacios_disponibles_motos()
         
@@ -129,7 +128,7 @@ class SimuladorParqueadero:
         print("="*60)
         print(f"🚗 Espacios disponibles CARROS: {self.parqueadero.espacios_disponibles_carros()}")
         print(f"🏍️  Espacios disponibles MOTOS: {self.parqueadero.espacios_disponibles_motos()}")
-        print(f"📍 Vehículos dentro: {len(self.parqueadero.listar_vehiculos())}")
+        print(f"📍 Vehículos dentro: {self.parqueadero.total_vehiculos()}")
         print("="*60 + "\n")
     
     def mostrar_estadisticas_finales(self):
@@ -185,11 +184,10 @@ class SimuladorParqueadero:
             self.mostrar_estadisticas_finales()
             
             # Mostrar vehículos que quedaron dentro
-            vehiculos_restantes = self.parqueadero.listar_vehiculos()
+            vehiculos_restantes = sorted(self.parqueadero.tarifas_actuales().tuplas())
             if vehiculos_restantes:
                 print("🚗 Vehículos que quedaron en el parqueadero:")
-                for placa in vehiculos_restantes:
-                    tarifa_actual = self.parqueadero.calcular_tarifa(placa)
+                for placa, _, _, _, tarifa_actual in vehiculos_restantes:
                     print(f"   • {placa} - Tarifa actual: ${tarifa_actual:,.0f}")
 
 